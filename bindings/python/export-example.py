@@ -0,0 +1,16 @@
+import sys
+import time
+
+import pysurvive
+
+actx = pysurvive.SimpleContext(sys.argv)
+export = actx.EventExport()
+
+while actx.Running():
+    time.sleep(.5)
+
+    light, imu, poses = export.light(), export.imu(), export.poses()
+    print("%d light, %d imu, %d poses" % (len(light), len(imu), len(poses)))
+    if len(poses):
+        last = poses[-1]
+        print("\t", last['object'], last['pos'], last['rot'])
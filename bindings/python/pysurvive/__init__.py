@@ -81,6 +81,53 @@ def configs(ctx, name, method=SC_GET, default=None):
 def configf(ctx, name, method=SC_GET, default=None):
     return pysurvive_generated.configf(ctx, name, method, default)
 
+class EventExport:
+    """
+    Buffers light, IMU and pose events natively and hands them over in bulk, instead of calling into python per event.
+    Each drain returns every buffered record of one type as a NumPy structured array if NumPy is available, or as a list
+    of ctypes structures otherwise. See survive_event_export.h for the record layouts.
+    """
+    record_types = {
+        SURVIVE_EVENT_EXPORT_LIGHT: SurviveLightEvent,
+        SURVIVE_EVENT_EXPORT_IMU: SurviveImuEvent,
+        SURVIVE_EVENT_EXPORT_POSE: SurvivePoseEvent,
+    }
+
+    def __init__(self, ctx, capacity = 1 << 16):
+        if event_export_install(ctx, capacity) != 0:
+            raise ValueError("Could not install the event export")
+        self.ctx = ctx
+
+    def drain(self, event_type, max_cnt = None):
+        cnt = event_export_count(self.ctx, event_type)
+        if max_cnt is not None:
+            cnt = min(cnt, max_cnt)
+        record_type = self.record_types[event_type]
+
+        try:
+            import numpy as np
+        except ImportError:
+            buffer = (record_type * cnt)()
+            read = event_export_drain(self.ctx, event_type, buffer, cnt)
+            return buffer[:read]
+
+        # Records are copied straight into the array's memory
+        rtn = np.empty(cnt, dtype=np.dtype(record_type))
+        read = event_export_drain(self.ctx, event_type, rtn.ctypes.data_as(ctypes.c_void_p), cnt)
+        return rtn[:read]
+
+    def light(self, max_cnt = None):
+        return self.drain(SURVIVE_EVENT_EXPORT_LIGHT, max_cnt)
+
+    def imu(self, max_cnt = None):
+        return self.drain(SURVIVE_EVENT_EXPORT_IMU, max_cnt)
+
+    def poses(self, max_cnt = None):
+        return self.drain(SURVIVE_EVENT_EXPORT_POSE, max_cnt)
+
+    def dropped(self, event_type):
+        return event_export_dropped(self.ctx, event_type)
+
 class SimpleObject:
     ptr = 0
     def __init__(self, ptr):
@@ -116,6 +163,15 @@ class SimpleContext:
     def Objects(self):
         return self.objects
 
+    def EventExport(self, capacity = 1 << 16):
+        # The context is already being polled on its own thread
+        ctx = simple_get_ctx(self.ptr)
+        get_ctx_lock(ctx)
+        try:
+            return EventExport(ctx, capacity)
+        finally:
+            release_ctx_lock(ctx)
+
     def Running(self):
         return simple_is_running(self.ptr)
 
@@ -189,6 +189,10 @@ struct SurviveObject {
 
 		uint32_t extent_hits, extent_misses, naive_hits;
 		FLT min_extent, max_extent;
+
+		// Measurements and lighthouses the optimizer considered and the ones it threw out as outliers
+		uint32_t optimizer_meas_cnt, optimizer_dropped_meas_cnt;
+		uint32_t optimizer_lh_cnt, optimizer_dropped_lh_cnt;
 	} stats;
 };
 
@@ -225,6 +229,10 @@ struct BaseStationData {
 	 */
 	SurvivePose Pose;
 	uint8_t OOTXSet : 1;
+	/**
+	 * OOTX data came from the calibration cache and hasn't been confirmed against a live OOTX packet yet
+	 */
+	uint8_t OOTXCached : 1;
 	uint32_t BaseStationID;
 
 	BaseStationCal fcal[2];
@@ -268,6 +276,8 @@ typedef struct {
 typedef enum { SURVIVE_STOPPED = 0, SURVIVE_RUNNING, SURVIVE_CLOSING, SURVIVE_STATE_MAX } SurviveState;
 
 struct SurviveRecordingData;
+struct SurviveCache;
+struct SurviveDeviceConfigCache;
 
 enum SurviveCalFlag {
 	SVCal_None = 0,
@@ -289,10 +299,17 @@ struct SurviveContext {
 	// Calibration data:
 	int activeLighthouses;
 	BaseStationData bsd[NUM_GEN2_LIGHTHOUSES];
-	int8_t bsd_map[NUM_GEN2_LIGHTHOUSES]; // maps channels to idxs
+	int8_t bsd_map[NUM_GEN2_CHANNELS];	// maps channels to idxs
 
 	void *disambiguator_data;			 // global disambiguator data
 	struct SurviveRecordingData *recptr; // Iff recording is attached
+	struct SurviveCache *cache;			 // Iff calibration-cache is set
+	struct SurviveDeviceConfigCache *device_config_cache; // Iff device-config-cache is set
+	struct survive_optimizer_capture *optimizer_capture;  // Iff optimizer-capture is set
+	struct SurviveEventExport *event_export;              // Iff survive_event_export_install was called
+	struct SurviveTelemetry *telemetry;                   // Iff telemetry-file or telemetry-socket is set
+	struct SurviveMetrics *metrics;                       // Iff metrics or metrics-port is set
+	struct SurviveClock *clock;                           // See survive_clock.h
 	SurviveObject **objs;
 	int objs_ct;
 
@@ -496,6 +513,9 @@ SURVIVE_EXPORT char *survive_export_config(SurviveObject *so);
 // This is the disambiguator function, for taking light timing and figuring out place-in-sweep for a given photodiode.
 SURVIVE_EXPORT uint8_t survive_map_sensor_id(SurviveObject *so, uint8_t reported_id);
 SURVIVE_EXPORT bool handle_lightcap(SurviveObject *so, const LightcapElement *le);
+// Same as calling handle_lightcap on each element in turn, but hands them to the disambiguator as one batch when it
+// supports that and no lightcap hook is installed over it.
+SURVIVE_EXPORT bool handle_lightcaps(SurviveObject *so, const LightcapElement *les, size_t cnt);
 
 #define SV_LOG_NULL_GUARD                                                                                              \
 	if (ctx == 0) {                                                                                                    \
@@ -534,7 +554,32 @@ SURVIVE_EXPORT bool handle_lightcap(SurviveObject *so, const LightcapElement *le
 			assert(0);                                                                                                 \
 	}
 
+#ifdef SURVIVE_ALLOC_COUNTER
+/**
+ * Debug builds can count every SV_MALLOC / SV_CALLOC / SV_REALLOC made on the calling thread; the tracking hot path
+ * checks this count to make sure it doesn't touch the allocator once it reaches a steady state.
+ */
+SURVIVE_EXPORT void survive_alloc_counter_increment(void);
+SURVIVE_EXPORT size_t survive_alloc_counter(void);
+
+#define SV_ASSERT_NO_ALLOCS_BEGIN() size_t sv_alloc_counter_start = survive_alloc_counter();
+#define SV_ASSERT_NO_ALLOCS_END(steady_state, what)                                                                    \
+	{                                                                                                                  \
+		size_t sv_allocs = survive_alloc_counter() - sv_alloc_counter_start;                                           \
+		if (sv_allocs && (steady_state)) {                                                                             \
+			SV_WARN("%d allocation(s) in steady state %s", (int)sv_allocs, what);                                      \
+			assert(sv_allocs == 0);                                                                                    \
+		}                                                                                                              \
+	}
+#else
+#define SV_ASSERT_NO_ALLOCS_BEGIN()
+#define SV_ASSERT_NO_ALLOCS_END(steady_state, what)
+#endif
+
 inline static void *sv_dynamic_ptr_check(char *file, int line, void *ptr) {
+#ifdef SURVIVE_ALLOC_COUNTER
+	survive_alloc_counter_increment();
+#endif
 	if (ptr == NULL) {
 		fprintf(stderr, "Survive: memory allocation request failed in file %s, line %d, exiting", file, line);
 		exit(EXIT_FAILURE);
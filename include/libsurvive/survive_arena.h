@@ -0,0 +1,51 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bump allocator for scratch memory that lives for one processing cycle -- typically one sync period of one object.
+ *
+ * Allocations are carved out of a single block and are all released at once by survive_arena_reset. If a cycle needs
+ * more than the block holds, the extra requests are served from overflow blocks and the next reset grows the main
+ * block to fit, so after the first few cycles the arena settles at its working size and stops touching the heap.
+ */
+typedef struct survive_arena {
+	uint8_t *base;
+	size_t capacity;
+	size_t used;
+
+	// Total bytes requested since the last reset, including overflow
+	size_t requested;
+	struct survive_arena_block *overflow;
+
+	// Number of times the arena had to go to the heap; constant in steady state
+	uint32_t grow_cnt;
+} survive_arena;
+
+#define SURVIVE_ARENA_ALIGNMENT 16
+
+SURVIVE_EXPORT void survive_arena_init(survive_arena *arena, size_t capacity);
+SURVIVE_EXPORT void survive_arena_reset(survive_arena *arena);
+SURVIVE_EXPORT void survive_arena_free(survive_arena *arena);
+
+SURVIVE_EXPORT void *survive_arena_alloc_overflow(survive_arena *arena, size_t size);
+
+static inline void *survive_arena_alloc(survive_arena *arena, size_t size) {
+	size = (size + SURVIVE_ARENA_ALIGNMENT - 1) & ~(size_t)(SURVIVE_ARENA_ALIGNMENT - 1);
+	arena->requested += size;
+	if (arena->used + size > arena->capacity) {
+		return survive_arena_alloc_overflow(arena, size);
+	}
+
+	void *rtn = arena->base + arena->used;
+	arena->used += size;
+	return rtn;
+}
+
+#ifdef __cplusplus
+}
+#endif
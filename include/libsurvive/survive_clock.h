@@ -0,0 +1,65 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Every context has one clock, which is what survive_run_time reports. By default it is wall time since the context
+ * was created. A driver that produces data with its own timeline -- playback, usbmon pcap replay, the simulator --
+ * attaches itself as the clock source and advances session time as it emits data. The source is paced by a factor:
+ * one second of session time takes `factor` seconds of wall time, and a factor of 0 makes the clock fully virtual so
+ * the source runs as fast as the data can be processed without ever sleeping.
+ *
+ * Drivers ask the clock how long to wait before emitting data for a given session time rather than comparing
+ * against wall time themselves, so one setting governs every driver and survive_poll stops throttling in virtual
+ * mode.
+ */
+
+typedef enum SurviveClockMode {
+	/** Session time is wall time since the context was created */
+	SURVIVE_CLOCK_REAL = 0,
+	/** Session time follows the source, which is paced against wall time */
+	SURVIVE_CLOCK_SCALED = 1,
+	/** Session time follows the source, which runs unpaced */
+	SURVIVE_CLOCK_VIRTUAL = 2,
+} SurviveClockMode;
+
+SURVIVE_EXPORT SurviveClockMode survive_clock_mode(const SurviveContext *ctx);
+
+/** Wall time, in seconds, since the context was created; independent of the clock source */
+SURVIVE_EXPORT double survive_clock_real_time(const SurviveContext *ctx);
+
+/** Session time in seconds; this is survive_run_time unless a run time function is installed over it */
+SURVIVE_EXPORT double survive_clock_time(const SurviveContext *ctx);
+
+/**
+ * Makes the calling driver the clock source, with session time starting at 0. A factor of 0 selects virtual time;
+ * anything else paces the source at `factor` wall seconds per session second.
+ */
+SURVIVE_EXPORT void survive_clock_attach_source(SurviveContext *ctx, double factor);
+
+/** Changes the pacing of the attached source from here on, without moving session time */
+SURVIVE_EXPORT void survive_clock_set_factor(SurviveContext *ctx, double factor);
+
+/** Detaches the source. Session time stays where the source left it so that late consumers see a consistent end. */
+SURVIVE_EXPORT void survive_clock_detach_source(SurviveContext *ctx);
+
+/** Called by the source as it emits data for the given session time */
+SURVIVE_EXPORT void survive_clock_advance(SurviveContext *ctx, double session_time);
+
+/** Wall seconds the source should wait before emitting data for session_time; always 0 unless the clock is scaled */
+SURVIVE_EXPORT double survive_clock_wait_time(const SurviveContext *ctx, double session_time);
+
+/** Sleeps until data for session_time is due. Returns the number of microseconds slept. */
+SURVIVE_EXPORT uint64_t survive_clock_wait_until(const SurviveContext *ctx, double session_time);
+
+/** Called from survive_init / survive_close */
+SURVIVE_EXPORT void survive_clock_init(SurviveContext *ctx);
+SURVIVE_EXPORT void survive_clock_free(SurviveContext *ctx);
+
+#ifdef __cplusplus
+}
+#endif
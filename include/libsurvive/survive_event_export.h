@@ -0,0 +1,90 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Event export buffers light, IMU and pose events into fixed layout ring buffers on the thread that produces them, so
+ * a consumer in another runtime can drain them in bulk instead of taking a callback per event. The records only use
+ * fixed width types and doubles regardless of FLT, so they map directly onto ctypes structures and NumPy structured
+ * arrays; see `pysurvive.EventExport`.
+ *
+ * The export is chained in front of whatever light, imu and pose hooks are installed when it is enabled. When a buffer
+ * is full new events are dropped and counted rather than blocking the tracker.
+ */
+
+#define SURVIVE_EVENT_EXPORT_NAME_LEN 8
+
+typedef enum SurviveEventExportType {
+	SURVIVE_EVENT_EXPORT_LIGHT = 0,
+	SURVIVE_EVENT_EXPORT_IMU = 1,
+	SURVIVE_EVENT_EXPORT_POSE = 2,
+	SURVIVE_EVENT_EXPORT_TYPE_CNT = 3
+} SurviveEventExportType;
+
+/** One angle measurement; from the angle hook for gen 1 systems and the sweep_angle hook for gen 2 */
+typedef struct SurviveLightEvent {
+	double time;
+	char object[SURVIVE_EVENT_EXPORT_NAME_LEN];
+	uint32_t timecode;
+	int32_t sensor_id;
+	int32_t lh;
+	int32_t plane;
+	double angle;
+	/** Pulse length in ticks; gen 1 only */
+	double length;
+} SurviveLightEvent;
+
+typedef struct SurviveImuEvent {
+	double time;
+	char object[SURVIVE_EVENT_EXPORT_NAME_LEN];
+	uint32_t timecode;
+	int32_t mask;
+	int32_t id;
+	int32_t reserved;
+	double accelgyro[9];
+} SurviveImuEvent;
+
+typedef struct SurvivePoseEvent {
+	double time;
+	char object[SURVIVE_EVENT_EXPORT_NAME_LEN];
+	uint32_t timecode;
+	int32_t reserved;
+	double pos[3];
+	double rot[4];
+} SurvivePoseEvent;
+
+/**
+ * Starts buffering events; each buffer holds up to `capacity` records. Calling it again resizes the buffers and drops
+ * anything buffered. Like the other hook installers, call this from the polling thread or with the context lock held.
+ * The count, dropped and drain calls can be made from any thread.
+ */
+SURVIVE_EXPORT int survive_event_export_install(SurviveContext *ctx, size_t capacity);
+
+SURVIVE_EXPORT size_t survive_event_export_record_size(SurviveEventExportType type);
+
+/** Number of records currently buffered */
+SURVIVE_EXPORT size_t survive_event_export_count(SurviveContext *ctx, SurviveEventExportType type);
+
+/** Number of events dropped because the buffer was full since the export was installed */
+SURVIVE_EXPORT uint64_t survive_event_export_dropped(SurviveContext *ctx, SurviveEventExportType type);
+
+/**
+ * Moves up to max_cnt of the oldest buffered records of the given type into dst, which must hold max_cnt records of
+ * the matching Survive*Event type. Returns the number of records written.
+ */
+SURVIVE_EXPORT size_t survive_event_export_drain(SurviveContext *ctx, SurviveEventExportType type, void *dst,
+												 size_t max_cnt);
+
+/**
+ * Unhooks the export and frees its buffers. A hook installed on top of one of the export's hooks still calls through
+ * it, so in that case the export stays in the chain, forwarding events without buffering them.
+ */
+SURVIVE_EXPORT void survive_event_export_free(SurviveContext *ctx);
+
+#ifdef __cplusplus
+}
+#endif
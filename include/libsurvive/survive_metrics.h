@@ -0,0 +1,61 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Metrics are counters, gauges and latency histograms that are exposed in the Prometheus text format. They are
+ * collected when `metrics` or `metrics-port` is set; the latter also serves them over HTTP on localhost, eg
+ * `curl localhost:9090/metrics`.
+ *
+ * Updates never lock: counters are sharded per thread and summed when scraped, and gauges / histogram buckets are
+ * single atomic operations. When metrics aren't enabled, survive_metric_register returns null and every update call
+ * is a no-op, so callers can keep the handles unconditionally.
+ *
+ * Besides the registered metrics, every scrape also reports each object's telemetry counters (see
+ * survive_telemetry.h), lighthouse confidence and the button queue depth.
+ */
+
+typedef enum SurviveMetricType {
+	SURVIVE_METRIC_COUNTER = 0,
+	SURVIVE_METRIC_GAUGE = 1,
+	/** Observations are in seconds; the buckets run from 10us to 250ms */
+	SURVIVE_METRIC_HISTOGRAM = 2,
+} SurviveMetricType;
+
+typedef struct SurviveMetric SurviveMetric;
+
+/**
+ * Returns the metric with the given name and labels, creating it if it doesn't exist yet. Labels are in exposition
+ * format without the braces, eg `object="HMD",interface="IMU"`, and may be null. Returns null if metrics aren't
+ * enabled. Handles stay valid until the context is closed.
+ */
+SURVIVE_EXPORT SurviveMetric *survive_metric_register(SurviveContext *ctx, SurviveMetricType type, const char *name,
+													  const char *help, const char *labels);
+
+SURVIVE_EXPORT void survive_metric_add(SurviveMetric *metric, uint64_t value);
+SURVIVE_EXPORT void survive_metric_set(SurviveMetric *metric, double value);
+SURVIVE_EXPORT void survive_metric_observe(SurviveMetric *metric, double seconds);
+
+/** Times a block into a histogram; the clock is only read when the metric is enabled */
+#define SURVIVE_METRIC_TIMER_START(metric) ((metric) ? OGGetAbsoluteTime() : 0)
+#define SURVIVE_METRIC_TIMER_STOP(metric, start)                                                                       \
+	if (metric)                                                                                                        \
+		survive_metric_observe(metric, OGGetAbsoluteTime() - (start));
+
+/** Renders every metric in the Prometheus text format. Free the result. */
+SURVIVE_EXPORT char *survive_metrics_format(SurviveContext *ctx);
+
+/** Enables metrics if configured, and the HTTP endpoint if metrics-port is set. Called from survive_startup. */
+SURVIVE_EXPORT void survive_metrics_install(SurviveContext *ctx);
+SURVIVE_EXPORT void survive_metrics_free(SurviveContext *ctx);
+
+/** Stops reporting an object that is about to be freed */
+SURVIVE_EXPORT void survive_metrics_remove_object(SurviveContext *ctx, SurviveObject *so);
+
+#ifdef __cplusplus
+}
+#endif
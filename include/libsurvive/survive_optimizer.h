@@ -3,6 +3,7 @@
 #include "math.h"
 #include "string.h"
 #include "survive.h"
+#include "survive_arena.h"
 #include "survive_reproject.h"
 #include <mpfit/mpfit.h>
 #include <os_generic.h>
@@ -60,7 +61,7 @@ typedef struct survive_optimizer {
 #define SURVIVE_OPTIMIZER_SETUP_BUFFERS(ctx, alloc_fn, ...)                                                            \
 	{                                                                                                                  \
 		size_t par_count = survive_optimizer_get_parameters_count(&(ctx));                                             \
-		size_t sensor_cnt = 32;                                                                                        \
+		size_t sensor_cnt = SENSORS_PER_OBJECT;                                                                        \
 		void *param_buffer = alloc_fn(((ctx).parameters), par_count * sizeof(FLT));                                    \
 		void *param_info_buffer = alloc_fn(((ctx).parameters_info), par_count * sizeof(struct mp_par_struct));         \
 		void *measurement_buffer =                                                                                     \
@@ -77,6 +78,15 @@ typedef struct survive_optimizer {
 	SURVIVE_OPTIMIZER_SETUP_BUFFERS(ctx, SURVIVE_OPTIMIZER_ALLOCA, __VA_ARGS__)
 #define SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(ctx, ...)                                                                 \
 	SURVIVE_OPTIMIZER_SETUP_BUFFERS(ctx, survive_optimizer_realloc, __VA_ARGS__)
+
+// Carves the buffers out of an arena; they stay valid until the arena is next reset
+#define SURVIVE_OPTIMIZER_ARENA_ALLOC(ptr, size) survive_arena_alloc(survive_optimizer_arena, size)
+#define SURVIVE_OPTIMIZER_SETUP_ARENA_BUFFERS(ctx, arena, ...)                                                         \
+	{                                                                                                                  \
+		survive_arena *survive_optimizer_arena = (arena);                                                              \
+		SURVIVE_OPTIMIZER_SETUP_BUFFERS(ctx, SURVIVE_OPTIMIZER_ARENA_ALLOC, __VA_ARGS__)                               \
+	}
+
 #define SURVIVE_OPTIMIZER_CLEANUP_STACK_BUFFERS(ctx)
 #define SURVIVE_OPTIMIZER_CLEANUP_HEAP_BUFFERS(ctx)                                                                    \
 	{                                                                                                                  \
@@ -134,6 +144,25 @@ SURVIVE_EXPORT void survive_optimizer_serialize(const survive_optimizer *optimiz
 
 SURVIVE_EXPORT survive_optimizer *survive_optimizer_load(const char *fn);
 
+/**
+ * Binary problem captures. Unlike survive_optimizer_serialize, these are compact enough to leave on in production and
+ * hold many problems per file -- every problem carries the sensor layout of its objects and the solver settings it
+ * was run with, so it can be re-solved without any device config.
+ */
+SURVIVE_EXPORT void survive_optimizer_install_capture(SurviveContext *ctx);
+SURVIVE_EXPORT void survive_optimizer_close_capture(SurviveContext *ctx);
+
+SURVIVE_EXPORT int survive_optimizer_write_problem_header(FILE *f);
+SURVIVE_EXPORT int survive_optimizer_read_problem_header(FILE *f);
+SURVIVE_EXPORT int survive_optimizer_write_problem(FILE *f, const survive_optimizer *optimizer, const mp_config *cfg);
+
+/**
+ * Reads the next problem from a capture; cfg is filled in with the settings it was captured with. Returns 0 at the end
+ * of the file or on error. Free the result with survive_optimizer_free_problem.
+ */
+SURVIVE_EXPORT survive_optimizer *survive_optimizer_read_problem(FILE *f, mp_config *cfg);
+SURVIVE_EXPORT void survive_optimizer_free_problem(survive_optimizer *optimizer);
+
 SURVIVE_EXPORT FLT survive_optimizer_current_norm(const survive_optimizer *optimizer);
 
 SURVIVE_EXPORT mp_config *survive_optimizer_precise_config();
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pose tracks are a columnar sidecar format for solved poses. Samples are buffered per object and written out in
+ * chunks; each column of a chunk is stored contiguously and compressed on its own. A time index at the end of the file
+ * lists every chunk with its object and time span, so a reader can pull out one object's samples over a time range
+ * without touching any other chunk.
+ *
+ * Enable it for a running context with `--record-pose-track <file>`.
+ */
+
+#define SURVIVE_POSETRACK_VERSION 1
+#define SURVIVE_POSETRACK_NAME_LEN 32
+
+typedef struct survive_posetrack_sample {
+	double time;
+	SurvivePose pose;
+	SurviveVelocity velocity;
+	/** Diagonal of the pose covariance -- 3 position then 4 rotation terms; all zero if unknown */
+	FLT variance[7];
+} survive_posetrack_sample;
+
+typedef struct survive_posetrack_writer survive_posetrack_writer;
+typedef struct survive_posetrack_reader survive_posetrack_reader;
+
+SURVIVE_EXPORT survive_posetrack_writer *survive_posetrack_writer_open(const char *path);
+
+/**
+ * Appends a new sample for the named object. `variance` may be null.
+ */
+SURVIVE_EXPORT int survive_posetrack_write_pose(survive_posetrack_writer *writer, const char *name, double time,
+												const SurvivePose *pose, const FLT *variance);
+
+/**
+ * Sets the velocity of the most recent sample of the named object; or if there is none, or it already has a velocity,
+ * appends a sample repeating the last known pose.
+ */
+SURVIVE_EXPORT int survive_posetrack_write_velocity(survive_posetrack_writer *writer, const char *name, double time,
+													const SurviveVelocity *velocity);
+
+/**
+ * Flushes all buffered samples, writes the time index and frees the writer.
+ */
+SURVIVE_EXPORT int survive_posetrack_writer_close(survive_posetrack_writer *writer);
+
+SURVIVE_EXPORT survive_posetrack_reader *survive_posetrack_reader_open(const char *path);
+SURVIVE_EXPORT void survive_posetrack_reader_close(survive_posetrack_reader *reader);
+
+SURVIVE_EXPORT size_t survive_posetrack_object_count(const survive_posetrack_reader *reader);
+SURVIVE_EXPORT const char *survive_posetrack_object_name(const survive_posetrack_reader *reader, size_t idx);
+
+/**
+ * Reads all samples for `name` with start <= time <= end into `out`, in time order. `out` is reallocated as needed and
+ * `out_capacity` tracks its size, so the same buffer can be reused across calls. Returns the number of samples read or
+ * -1 on error.
+ */
+SURVIVE_EXPORT int survive_posetrack_read_range(survive_posetrack_reader *reader, const char *name, double start,
+											   double end, survive_posetrack_sample **out, size_t *out_capacity);
+
+#ifdef __cplusplus
+}
+#endif
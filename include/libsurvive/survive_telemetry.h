@@ -0,0 +1,61 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Telemetry periodically snapshots the health counters of every tracked object -- the sync / light counters in
+ * SurviveObject.stats, the kalman tracker's stats and the optimizer's measurement rejections -- and streams them out as
+ * CSV rows. Rows go to the file named by `telemetry-file` and / or as datagrams to the unix socket named by
+ * `telemetry-socket`, every `telemetry-period` seconds.
+ *
+ * Sampling happens on its own thread and never takes the context lock. The counters are only ever incremented, so a
+ * sample may be a hair behind the tracker but never blocks it.
+ */
+
+#define SURVIVE_TELEMETRY_NAME_LEN 8
+
+/** Counters are cumulative since the object was added; the lighthouse counters are summed over all lighthouses */
+typedef struct SurviveTelemetrySample {
+	double time;
+	char object[SURVIVE_TELEMETRY_NAME_LEN];
+
+	uint32_t syncs, skipped_syncs, bad_syncs, sync_resets;
+	uint32_t hit_from_lhs, rejected_data, dropped_light;
+
+	uint32_t late_imu_dropped, late_light_dropped;
+	uint64_t imu_cnt, lightcap_cnt, obs_cnt;
+	uint64_t reported_poses, dropped_poses;
+	/** Mean kalman update errors */
+	double imu_error, lightcap_error, obs_error;
+
+	uint32_t optimizer_meas_cnt, optimizer_dropped_meas_cnt;
+	uint32_t optimizer_lh_cnt, optimizer_dropped_lh_cnt;
+} SurviveTelemetrySample;
+
+/** Fills in a sample for the given object. Safe to call from any thread while the object is alive. */
+SURVIVE_EXPORT void survive_telemetry_sample(const SurviveObject *so, double time, SurviveTelemetrySample *sample);
+
+/** Writes the CSV header / a CSV row, including the trailing newline. Returns the length like snprintf. */
+SURVIVE_EXPORT int survive_telemetry_format_header(char *buffer, size_t len);
+SURVIVE_EXPORT int survive_telemetry_format_sample(const SurviveTelemetrySample *sample, char *buffer, size_t len);
+
+/**
+ * Copies up to max_cnt of the most recent samples, one per object, into out. Returns the number of objects sampled,
+ * which may be more than max_cnt. Can be called from any thread.
+ */
+SURVIVE_EXPORT size_t survive_telemetry_latest(SurviveContext *ctx, SurviveTelemetrySample *out, size_t max_cnt);
+
+/** Starts the telemetry thread if telemetry-file or telemetry-socket is set. Called from survive_startup. */
+SURVIVE_EXPORT void survive_telemetry_install(SurviveContext *ctx);
+SURVIVE_EXPORT void survive_telemetry_free(SurviveContext *ctx);
+
+/** Stops sampling an object that is about to be freed */
+SURVIVE_EXPORT void survive_telemetry_remove_object(SurviveContext *ctx, SurviveObject *so);
+
+#ifdef __cplusplus
+}
+#endif
@@ -109,10 +109,27 @@ typedef struct survive_kalman_model_t {
 //Careful with this, you can't just add another one right now, would take minor changes in survive_data.c and the cal tools.
 //It will also require a recompile.  TODO: revisit this and correct the comment once fixed.
 #define NUM_GEN1_LIGHTHOUSES 2
+
+// Gen2 lighthouses pick one of 16 channels; that range is fixed by the hardware no matter how many lighthouses are
+// tracked at once.
+#define NUM_GEN2_CHANNELS 16
+
+// Capacities for the per context / per object arrays. Most of the per object memory is sized by the product of the
+// two, so builds that know their setup can shrink them -- see SURVIVE_MAX_LIGHTHOUSES and SURVIVE_MAX_SENSORS in
+// CMakeLists.txt. Everything linking against libsurvive has to agree on them.
+#ifndef NUM_GEN2_LIGHTHOUSES
 #define NUM_GEN2_LIGHTHOUSES 16
+#endif
+
+#ifndef SENSORS_PER_OBJECT
+#define SENSORS_PER_OBJECT 32
+#endif
+
+#if NUM_GEN2_LIGHTHOUSES < NUM_GEN1_LIGHTHOUSES || NUM_GEN2_LIGHTHOUSES > NUM_GEN2_CHANNELS
+#error "NUM_GEN2_LIGHTHOUSES must be between NUM_GEN1_LIGHTHOUSES and NUM_GEN2_CHANNELS"
+#endif
 
 #define INTBUFFSIZE 64
-#define SENSORS_PER_OBJECT	32
 
 // These are used for the eventType of button_process_func
 enum SurviveInputEvent {
@@ -236,6 +253,12 @@ typedef void (*gen_detected_process_func)(SurviveObject *so, int gen);
  */
 typedef void (*lightcap_process_func)(SurviveObject *so, const LightcapElement *le);
 
+/**
+ * Optional batch form of a disambiguator; takes all the lightcaps of one USB report, in the order they are to be
+ * processed. See handle_lightcaps.
+ */
+typedef void (*lightcap_batch_process_func)(SurviveObject *so, const LightcapElement *les, size_t cnt);
+
 /**
  * This is called on disambiguated data in a v1 system; so it contains the lighthouse index of the data as well as
  * the time in sweep of the event.
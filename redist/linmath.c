@@ -3,6 +3,7 @@
 #define LINMATH_EXPORT __declspec(dllexport)
 #endif
 #include "linmath.h"
+#include "linmath_inline.h"
 #include <float.h>
 #include <math.h>
 #include <stdbool.h>
@@ -886,6 +887,30 @@ inline void ApplyAxisAnglePoseToPose(LinmathAxisAnglePose *pout, const LinmathAx
 		assert(!isnan(pout->Pos[i]));
 }
 
+void quatrotatevectors(FLT *out_pts, const LinmathQuat quat, const FLT *pts, size_t num_pts) {
+	for (size_t i = 0; i < num_pts; i++)
+		quatrotatevector_inline(out_pts + i * 3, quat, pts + i * 3);
+}
+
+void ApplyPoseToPoints(FLT *out_pts, const LinmathPose *pose, const FLT *pts, size_t num_pts) {
+	for (size_t i = 0; i < num_pts; i++)
+		ApplyPoseToPoint_inline(out_pts + i * 3, pose, pts + i * 3);
+}
+
+void ApplyAxisAnglePoseToPoints(FLT *out_pts, const LinmathAxisAnglePose *pose, const FLT *pts, size_t num_pts) {
+	linmath_axisangle_rotation r;
+	linmath_axisangle_rotation_init(&r, pose->AxisAngleRot);
+
+	for (size_t i = 0; i < num_pts; i++) {
+		FLT *pout = out_pts + i * 3;
+		LinmathPoint3d tmp;
+		linmath_axisangle_rotation_apply(tmp, &r, pts + i * 3);
+		add3d(pout, tmp, pose->Pos);
+		for (int j = 0; j < 3; j++)
+			assert(isfinite(pout[j]));
+	}
+}
+
 inline void InvertPose(LinmathPose *poseout, const LinmathPose *pose) {
 	quatgetreciprocal(poseout->Rot, pose->Rot);
 
@@ -255,6 +255,16 @@ LINMATH_EXPORT void ApplyAxisAnglePoseToPoint(LinmathPoint3d pout, const Linmath
 LINMATH_EXPORT void ApplyAxisAnglePoseToPose(LinmathAxisAnglePose *pout, const LinmathAxisAnglePose *lhs_pose,
 											 const LinmathAxisAnglePose *rhs_pose);
 
+/***
+ * Batched forms; identical results to calling the single point versions on each element, but the per transform work
+ * (the sin / cos of an axis angle, for instance) is only done once. Points are packed xyz triples; out_pts may alias
+ * pts.
+ */
+LINMATH_EXPORT void quatrotatevectors(FLT *out_pts, const LinmathQuat quat, const FLT *pts, size_t num_pts);
+LINMATH_EXPORT void ApplyPoseToPoints(FLT *out_pts, const LinmathPose *pose, const FLT *pts, size_t num_pts);
+LINMATH_EXPORT void ApplyAxisAnglePoseToPoints(FLT *out_pts, const LinmathAxisAnglePose *pose, const FLT *pts,
+											   size_t num_pts);
+
 // This is the quat equivlant of 'pose_in^-1'; so that ApplyPoseToPose(..., InvertPose(..., pose_in), pose_in) ==
 // Identity ( [0, 0, 0], [1, 0, 0, 0] )
 // by definition.
@@ -0,0 +1,135 @@
+// Header only versions of the hottest linmath transforms. Every function here computes exactly what its namesake in
+// linmath.c computes, in the same order, so the results are bit identical -- it just lets the compiler inline them into
+// tight loops (the reprojection and optimizer inner loops) where the call overhead and lost scheduling dominate.
+//
+// lintest checks each of these against the linmath.c implementation; keep the two in sync.
+
+#ifndef _LINMATH_INLINE_H
+#define _LINMATH_INLINE_H
+
+#include "linmath.h"
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LINMATH_INLINE
+#define LINMATH_INLINE static inline
+#endif
+
+LINMATH_INLINE void quatrotatevector_inline(FLT *vec3out, const LinmathQuat quat, const FLT *vec3in) {
+	FLT tmp[3];
+	tmp[0] = quat[2] * vec3in[2] - quat[3] * vec3in[1];
+	tmp[1] = quat[3] * vec3in[0] - quat[1] * vec3in[2];
+	tmp[2] = quat[1] * vec3in[1] - quat[2] * vec3in[0];
+	tmp[0] += vec3in[0] * quat[0];
+	tmp[1] += vec3in[1] * quat[0];
+	tmp[2] += vec3in[2] * quat[0];
+
+	FLT tmp2[3];
+	tmp2[0] = quat[2] * tmp[2] - quat[3] * tmp[1];
+	tmp2[1] = quat[3] * tmp[0] - quat[1] * tmp[2];
+	tmp2[2] = quat[1] * tmp[1] - quat[2] * tmp[0];
+
+	vec3out[0] = vec3in[0] + 2 * tmp2[0];
+	vec3out[1] = vec3in[1] + 2 * tmp2[1];
+	vec3out[2] = vec3in[2] + 2 * tmp2[2];
+}
+
+// Same as quatrotateabout; qout may alias either input
+LINMATH_INLINE void quatmultiply_inline(LinmathQuat qout, const LinmathQuat q1, const LinmathQuat q2) {
+	FLT p[4];
+	p[0] = (q1[0] * q2[0]) - (q1[1] * q2[1]) - (q1[2] * q2[2]) - (q1[3] * q2[3]);
+	p[1] = (q1[0] * q2[1]) + (q1[1] * q2[0]) + (q1[2] * q2[3]) - (q1[3] * q2[2]);
+	p[2] = (q1[0] * q2[2]) - (q1[1] * q2[3]) + (q1[2] * q2[0]) + (q1[3] * q2[1]);
+	p[3] = (q1[0] * q2[3]) + (q1[1] * q2[2]) - (q1[2] * q2[1]) + (q1[3] * q2[0]);
+
+	qout[0] = p[0];
+	qout[1] = p[1];
+	qout[2] = p[2];
+	qout[3] = p[3];
+}
+
+LINMATH_INLINE void ApplyPoseToPoint_inline(LinmathPoint3d pout, const LinmathPose *pose, const LinmathPoint3d pin) {
+	LinmathPoint3d tmp;
+	quatrotatevector_inline(tmp, pose->Rot, pin);
+	pout[0] = tmp[0] + pose->Pos[0];
+	pout[1] = tmp[1] + pose->Pos[1];
+	pout[2] = tmp[2] + pose->Pos[2];
+}
+
+LINMATH_INLINE void ApplyPoseToPose_inline(LinmathPose *pout, const LinmathPose *lhs_pose,
+										  const LinmathPose *rhs_pose) {
+	ApplyPoseToPoint_inline(pout->Pos, lhs_pose, rhs_pose->Pos);
+	quatmultiply_inline(pout->Rot, lhs_pose->Rot, rhs_pose->Rot);
+}
+
+/***
+ * The parts of rotatearoundaxis that only depend on the axis angle. Rotating many points by the same axis angle only
+ * needs the normalization and the sin / cos once.
+ */
+typedef struct linmath_axisangle_rotation {
+	FLT u, v, w;
+	FLT s, c;
+	bool identity;
+} linmath_axisangle_rotation;
+
+LINMATH_INLINE void linmath_axisangle_rotation_init(linmath_axisangle_rotation *r, const LinmathAxisAngle axisAngle) {
+	FLT angle = FLT_SQRT(axisAngle[0] * axisAngle[0] + axisAngle[1] * axisAngle[1] + axisAngle[2] * axisAngle[2]);
+	r->identity = angle == 0.0;
+	if (r->identity) {
+		r->u = r->v = r->w = r->s = r->c = 0;
+		return;
+	}
+
+	// Matches normalize3d, which rescales by the reciprocal of the magnitude
+	FLT r_mag = ((FLT)1.) / angle;
+	r->u = axisAngle[0] * r_mag;
+	r->v = axisAngle[1] * r_mag;
+	r->w = axisAngle[2] * r_mag;
+
+	r->s = FLT_SIN(angle);
+	r->c = FLT_COS(angle);
+}
+
+LINMATH_INLINE void linmath_axisangle_rotation_apply(FLT *vec3out, const linmath_axisangle_rotation *r,
+													 const FLT *vec3in) {
+	FLT x = vec3in[0], y = vec3in[1], z = vec3in[2];
+	if (r->identity) {
+		vec3out[0] = x;
+		vec3out[1] = y;
+		vec3out[2] = z;
+		return;
+	}
+
+	FLT u = r->u, v = r->v, w = r->w, s = r->s, c = r->c;
+	vec3out[0] = u * (u * x + v * y + w * z) * (1 - c) + x * c + (-w * y + v * z) * s;
+	vec3out[1] = v * (u * x + v * y + w * z) * (1 - c) + y * c + (w * x - u * z) * s;
+	vec3out[2] = w * (u * x + v * y + w * z) * (1 - c) + z * c + (-v * x + u * y) * s;
+}
+
+LINMATH_INLINE void ApplyAxisAnglePoseToPoint_inline(LinmathPoint3d pout, const LinmathAxisAnglePose *pose,
+													 const LinmathPoint3d pin) {
+	linmath_axisangle_rotation r;
+	linmath_axisangle_rotation_init(&r, pose->AxisAngleRot);
+
+	LinmathPoint3d tmp;
+	linmath_axisangle_rotation_apply(tmp, &r, pin);
+	pout[0] = tmp[0] + pose->Pos[0];
+	pout[1] = tmp[1] + pose->Pos[1];
+	pout[2] = tmp[2] + pose->Pos[2];
+}
+
+// The rotation half goes through quaternions and atan2 anyway, so only the point half is inlined
+LINMATH_INLINE void ApplyAxisAnglePoseToPose_inline(LinmathAxisAnglePose *pout, const LinmathAxisAnglePose *lhs_pose,
+													const LinmathAxisAnglePose *rhs_pose) {
+	ApplyAxisAnglePoseToPoint_inline(pout->Pos, lhs_pose, rhs_pose->Pos);
+	axisanglerotateabout(pout->AxisAngleRot, lhs_pose->AxisAngleRot, rhs_pose->AxisAngleRot);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,6 @@
 
 #include "linmath.h"
+#include "linmath_inline.h"
 #ifndef WIN32
 #include <alloca.h>
 #endif
@@ -8,6 +9,8 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 bool assertFLTEquals(FLT a, FLT b) { return fabs(a - b) < 0.0001; }
 
@@ -231,9 +234,180 @@ static void testFindBestIntersections() {
 		assert(err < (sigma + 1e-5));
 	}
 }
-int main()
-{
+static void random_pose(LinmathPose *pose) {
+	for (int i = 0; i < 3; i++)
+		pose->Pos[i] = linmath_rand(-5, 5);
+	for (int i = 0; i < 4; i++)
+		pose->Rot[i] = linmath_rand(-1, 1);
+	quatnormalize(pose->Rot, pose->Rot);
+}
+
+static void random_axisangle_pose(LinmathAxisAnglePose *pose) {
+	for (int i = 0; i < 3; i++) {
+		pose->Pos[i] = linmath_rand(-5, 5);
+		pose->AxisAngleRot[i] = linmath_rand(-2, 2);
+	}
+}
+
+#define ASSERT_BIT_EXACT(a, b)                                                                                         \
+	if (memcmp(a, b, sizeof(a)) != 0) {                                                                                \
+		fprintf(stderr, "'" #a "' and '" #b "' differ\n");                                                             \
+		printFLTA((FLT *)a, sizeof(a) / sizeof(FLT));                                                                   \
+		fprintf(stderr, "\n");                                                                                         \
+		printFLTA((FLT *)b, sizeof(b) / sizeof(FLT));                                                                   \
+		fprintf(stderr, "\n");                                                                                         \
+		assert(memcmp(a, b, sizeof(a)) == 0);                                                                          \
+	}
+
+// The inline and batched versions must match linmath.c bit for bit, not just within an epsilon
+static void testInlineBitExact() {
+	for (int iter = 0; iter < 1000; iter++) {
+		LinmathPose lhs, rhs;
+		random_pose(&lhs);
+		random_pose(&rhs);
+		LinmathPoint3d pt = {linmath_rand(-1, 1), linmath_rand(-1, 1), linmath_rand(-1, 1)};
+
+		LinmathPoint3d a, b;
+		quatrotatevector(a, lhs.Rot, pt);
+		quatrotatevector_inline(b, lhs.Rot, pt);
+		ASSERT_BIT_EXACT(a, b);
+
+		ApplyPoseToPoint(a, &lhs, pt);
+		ApplyPoseToPoint_inline(b, &lhs, pt);
+		ASSERT_BIT_EXACT(a, b);
+
+		LinmathQuat qa, qb;
+		quatrotateabout(qa, lhs.Rot, rhs.Rot);
+		quatmultiply_inline(qb, lhs.Rot, rhs.Rot);
+		ASSERT_BIT_EXACT(qa, qb);
+
+		LinmathPose pa, pb;
+		ApplyPoseToPose(&pa, &lhs, &rhs);
+		ApplyPoseToPose_inline(&pb, &lhs, &rhs);
+		ASSERT_BIT_EXACT(pa.Pos, pb.Pos);
+		ASSERT_BIT_EXACT(pa.Rot, pb.Rot);
+
+		LinmathAxisAnglePose alhs, arhs;
+		random_axisangle_pose(&alhs);
+		random_axisangle_pose(&arhs);
+		if (iter == 0) {
+			alhs.AxisAngleRot[0] = alhs.AxisAngleRot[1] = alhs.AxisAngleRot[2] = 0;
+		}
+
+		ApplyAxisAnglePoseToPoint(a, &alhs, pt);
+		ApplyAxisAnglePoseToPoint_inline(b, &alhs, pt);
+		ASSERT_BIT_EXACT(a, b);
+
+		LinmathAxisAnglePose apa, apb;
+		ApplyAxisAnglePoseToPose(&apa, &alhs, &arhs);
+		ApplyAxisAnglePoseToPose_inline(&apb, &alhs, &arhs);
+		ASSERT_BIT_EXACT(apa.Pos, apb.Pos);
+		ASSERT_BIT_EXACT(apa.AxisAngleRot, apb.AxisAngleRot);
+	}
+}
+
+#define BATCH_SIZE 32
+static void testBatchedBitExact() {
+	LinmathPoint3d pts[BATCH_SIZE];
+	for (int i = 0; i < BATCH_SIZE; i++)
+		for (int j = 0; j < 3; j++)
+			pts[i][j] = linmath_rand(-1, 1);
+
+	LinmathPose pose;
+	random_pose(&pose);
+	LinmathAxisAnglePose aapose;
+	random_axisangle_pose(&aapose);
+
+	LinmathPoint3d batched[BATCH_SIZE], single[BATCH_SIZE];
+
+	quatrotatevectors((FLT *)batched, pose.Rot, (FLT *)pts, BATCH_SIZE);
+	for (int i = 0; i < BATCH_SIZE; i++)
+		quatrotatevector(single[i], pose.Rot, pts[i]);
+	ASSERT_BIT_EXACT(batched, single);
+
+	ApplyPoseToPoints((FLT *)batched, &pose, (FLT *)pts, BATCH_SIZE);
+	for (int i = 0; i < BATCH_SIZE; i++)
+		ApplyPoseToPoint(single[i], &pose, pts[i]);
+	ASSERT_BIT_EXACT(batched, single);
+
+	ApplyAxisAnglePoseToPoints((FLT *)batched, &aapose, (FLT *)pts, BATCH_SIZE);
+	for (int i = 0; i < BATCH_SIZE; i++)
+		ApplyAxisAnglePoseToPoint(single[i], &aapose, pts[i]);
+	ASSERT_BIT_EXACT(batched, single);
+
+	// In place
+	memcpy(batched, pts, sizeof(pts));
+	ApplyAxisAnglePoseToPoints((FLT *)batched, &aapose, (FLT *)batched, BATCH_SIZE);
+	ASSERT_BIT_EXACT(batched, single);
+}
+
+static double bench_seconds() { return (double)clock() / CLOCKS_PER_SEC; }
+
+#define BENCH(name, iterations, body)                                                                                  \
+	{                                                                                                                  \
+		double start = bench_seconds();                                                                                \
+		for (int iter = 0; iter < (iterations); iter++) {                                                              \
+			body;                                                                                                      \
+		}                                                                                                              \
+		double elapsed = bench_seconds() - start;                                                                      \
+		printf("%-36s %8.2f ns/pt\n", name, elapsed * 1e9 / ((double)(iterations)*BATCH_SIZE));                       \
+	}
+
+/***
+ * `lintest --bench` times each transform as a call per point, inlined per point, and batched. Build with optimization
+ * on; the numbers are meaningless in a debug build.
+ */
+static void benchTransforms(int iterations) {
+	LinmathPoint3d pts[BATCH_SIZE], out[BATCH_SIZE];
+	for (int i = 0; i < BATCH_SIZE; i++)
+		for (int j = 0; j < 3; j++)
+			pts[i][j] = linmath_rand(-1, 1);
+
+	LinmathPose pose;
+	random_pose(&pose);
+	LinmathAxisAnglePose aapose;
+	random_axisangle_pose(&aapose);
+
+	FLT sink = 0;
+#define SINK sink += out[iter % BATCH_SIZE][0]; pose.Pos[0] += 1e-12; aapose.Pos[0] += 1e-12
+
+	BENCH("quatrotatevector", iterations, for (int i = 0; i < BATCH_SIZE; i++) quatrotatevector(out[i], pose.Rot, pts[i]);
+		  SINK);
+	BENCH("quatrotatevector_inline", iterations,
+		  for (int i = 0; i < BATCH_SIZE; i++) quatrotatevector_inline(out[i], pose.Rot, pts[i]);
+		  SINK);
+	BENCH("quatrotatevectors", iterations, quatrotatevectors((FLT *)out, pose.Rot, (FLT *)pts, BATCH_SIZE); SINK);
+
+	BENCH("ApplyPoseToPoint", iterations, for (int i = 0; i < BATCH_SIZE; i++) ApplyPoseToPoint(out[i], &pose, pts[i]);
+		  SINK);
+	BENCH("ApplyPoseToPoint_inline", iterations,
+		  for (int i = 0; i < BATCH_SIZE; i++) ApplyPoseToPoint_inline(out[i], &pose, pts[i]);
+		  SINK);
+	BENCH("ApplyPoseToPoints", iterations, ApplyPoseToPoints((FLT *)out, &pose, (FLT *)pts, BATCH_SIZE); SINK);
+
+	BENCH("ApplyAxisAnglePoseToPoint", iterations,
+		  for (int i = 0; i < BATCH_SIZE; i++) ApplyAxisAnglePoseToPoint(out[i], &aapose, pts[i]);
+		  SINK);
+	BENCH("ApplyAxisAnglePoseToPoint_inline", iterations,
+		  for (int i = 0; i < BATCH_SIZE; i++) ApplyAxisAnglePoseToPoint_inline(out[i], &aapose, pts[i]);
+		  SINK);
+	BENCH("ApplyAxisAnglePoseToPoints", iterations,
+		  ApplyAxisAnglePoseToPoints((FLT *)out, &aapose, (FLT *)pts, BATCH_SIZE);
+		  SINK);
+#undef SINK
+
+	printf("(%f)\n", sink);
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+		benchTransforms(argc > 2 ? atoi(argv[2]) : 100000);
+		return 0;
+	}
+
 	testFindBestIntersections();
+	testInlineBitExact();
+	testBatchedBitExact();
 
 	testInvertPose();
 	testApplyPoseToPoint();
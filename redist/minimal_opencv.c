@@ -1,5 +1,7 @@
+#ifndef SURVIVE_NO_LAPACK
 #include <cblas.h>
 #include <lapacke.h>
+#endif
 
 #include "math.h"
 #include "minimal_opencv.h"
@@ -38,6 +40,7 @@ SURVIVE_LOCAL_ONLY void cvCopy(const CvMat *srcarr, CvMat *dstarr, const CvMat *
 	memcpy(CV_RAW_PTR(dstarr), CV_RAW_PTR(srcarr), mat_size_bytes(srcarr));
 }
 
+#ifndef SURVIVE_NO_LAPACK
 #ifdef USE_FLOAT
 #define cblas_gemm cblas_sgemm
 #define cblas_symm cblas_ssymm
@@ -106,6 +109,7 @@ SURVIVE_LOCAL_ONLY void cvSYMM(const CvMat *src1, const CvMat *src2, double alph
 	cblas_symm(CblasRowMajor, src1First ? CblasLeft : CblasRight, CblasUpper, dst->rows, dst->cols, alpha,
 			   CV_RAW_PTR(src1), lda, CV_RAW_PTR(src2), ldb, beta, CV_RAW_PTR(dst), dst->cols);
 }
+#endif
 
 // Special case dst = alpha * src2 * src1 * src2' + beta * src3
 void mulBABt(const CvMat *src1, const CvMat *src2, double alpha, const CvMat *src3, double beta, CvMat *dst) {
@@ -127,6 +131,9 @@ void mulBABt(const CvMat *src1, const CvMat *src2, double alpha, const CvMat *sr
 // dst = alpha * src1 * src2 + beta * src3
 SURVIVE_LOCAL_ONLY void cvGEMM(const CvMat *src1, const CvMat *src2, double alpha, const CvMat *src3, double beta,
 							   CvMat *dst, int tABC) {
+#ifdef SURVIVE_NO_LAPACK
+	cvNativeGEMM(src1, src2, alpha, src3, beta, dst, tABC);
+#else
 
 	int rows1 = (tABC & CV_GEMM_A_T) ? src1->cols : src1->rows;
 	int cols1 = (tABC & CV_GEMM_A_T) ? src1->rows : src1->cols;
@@ -160,11 +167,15 @@ SURVIVE_LOCAL_ONLY void cvGEMM(const CvMat *src1, const CvMat *src2, double alph
 	cblas_gemm(CblasRowMajor, (tABC & CV_GEMM_A_T) ? CblasTrans : CblasNoTrans,
 			   (tABC & CV_GEMM_B_T) ? CblasTrans : CblasNoTrans, dst->rows, dst->cols, cols1, alpha, CV_RAW_PTR(src1),
 			   lda, CV_RAW_PTR(src2), ldb, beta, CV_RAW_PTR(dst), dst->cols);
+#endif
 }
 
 // dst = scale * src ^ t * src     iff order == 1
 // dst = scale *     src * src ^ t iff order == 0
 SURVIVE_LOCAL_ONLY void cvMulTransposed(const CvMat *src, CvMat *dst, int order, const CvMat *delta, double scale) {
+#ifdef SURVIVE_NO_LAPACK
+	cvNativeMulTransposed(src, dst, order, delta, scale);
+#else
 	lapack_int rows = src->rows;
 	lapack_int cols = src->cols;
 
@@ -182,6 +193,7 @@ SURVIVE_LOCAL_ONLY void cvMulTransposed(const CvMat *src, CvMat *dst, int order,
 	cblas_gemm(CblasRowMajor, isAT ? CblasTrans : CblasNoTrans, isBT ? CblasTrans : CblasNoTrans, dst->rows, dst->cols,
 			   order == 1 ? src->rows : src->cols, scale, CV_RAW_PTR(src), src->cols, CV_RAW_PTR(src), src->cols, beta,
 			   CV_RAW_PTR(dst), dstCols);
+#endif
 }
 
 SURVIVE_LOCAL_ONLY void *cvAlloc(size_t size) { return malloc(size); }
@@ -277,6 +289,9 @@ SURVIVE_LOCAL_ONLY CvMat *cvCreateMat(int height, int width, int type) {
   CvMat name = cvMat(rows, cols, SURVIVE_CV_F, _##name);
 
 SURVIVE_LOCAL_ONLY double cvInvert(const CvMat *srcarr, CvMat *dstarr, int method) {
+#ifdef SURVIVE_NO_LAPACK
+	return cvNativeInvert(srcarr, dstarr, method);
+#else
 	lapack_int inf;
 	lapack_int rows = srcarr->rows;
 	lapack_int cols = srcarr->cols;
@@ -318,17 +333,16 @@ SURVIVE_LOCAL_ONLY double cvInvert(const CvMat *srcarr, CvMat *dstarr, int metho
 			cvmSet(&um, i, i, 1. / (_w)[i]);
 		}
 
-		CvMat *tmp = cvCreateMat(dstarr->cols, dstarr->rows, dstarr->type);
-		cvGEMM(&v, &um, 1, 0, 0, tmp, CV_GEMM_A_T);
-		cvGEMM(tmp, &u, 1, 0, 0, dstarr, CV_GEMM_B_T);
-
-		cvReleaseMat(&tmp);
+		CREATE_CV_STACK_MAT(tmp, dstarr->cols, dstarr->rows, dstarr->type);
+		cvGEMM(&v, &um, 1, 0, 0, &tmp, 0);
+		cvGEMM(&tmp, &u, 1, 0, 0, dstarr, CV_GEMM_B_T);
 	} else {
 		assert(0 && "Bad argument");
 		return -1;
 	}
 
 	return 0;
+#endif
 }
 
 #define CV_CLONE_MAT_ALLOCA(stack_mat, mat)                                                                            \
@@ -342,6 +356,9 @@ SURVIVE_LOCAL_ONLY CvMat *cvCloneMat(const CvMat *mat) {
 }
 
 SURVIVE_LOCAL_ONLY int cvSolve(const CvMat *Aarr, const CvMat *xarr, CvMat *Barr, int method) {
+#ifdef SURVIVE_NO_LAPACK
+	return cvNativeSolve(Aarr, xarr, Barr, method);
+#else
 	lapack_int inf;
 	lapack_int arows = Aarr->rows;
 	lapack_int acols = Aarr->cols;
@@ -379,7 +396,7 @@ SURVIVE_LOCAL_ONLY int cvSolve(const CvMat *Aarr, const CvMat *xarr, CvMat *Barr
 		print_mat(Barr);
 #endif
 
-		inf = LAPACKE_getrs(LAPACK_ROW_MAJOR, CblasNoTrans, arows, bcols, (a_ws), lda, ipiv, CV_RAW_PTR(Barr), ldb);
+		inf = LAPACKE_getrs(LAPACK_ROW_MAJOR, 'N', arows, bcols, (a_ws), lda, ipiv, CV_RAW_PTR(Barr), ldb);
 		assert(inf == 0);
 
 		//free(ipiv);
@@ -428,6 +445,7 @@ SURVIVE_LOCAL_ONLY int cvSolve(const CvMat *Aarr, const CvMat *xarr, CvMat *Barr
 		assert(inf == 0);
 	}
 	return 0;
+#endif
 }
 
 SURVIVE_LOCAL_ONLY void cvTranspose(const CvMat *M, CvMat *dst) {
@@ -450,13 +468,17 @@ SURVIVE_LOCAL_ONLY void cvTranspose(const CvMat *M, CvMat *dst) {
 }
 
 SURVIVE_LOCAL_ONLY void cvSVD(CvMat *aarr, CvMat *warr, CvMat *uarr, CvMat *varr, int flags) {
+#ifdef SURVIVE_NO_LAPACK
+	cvNativeSVD(aarr, warr, uarr, varr, flags);
+#else
 	char jobu = 'A';
 	char jobvt = 'A';
 
 	lapack_int inf;
 
 	if ((flags & CV_SVD_MODIFY_A) == 0) {
-		aarr = cvCloneMat(aarr);
+		CV_CLONE_MAT_ALLOCA(aCpy, aarr);
+		aarr = aCpy;
 	}
 
 	if (uarr == 0)
@@ -497,10 +519,7 @@ SURVIVE_LOCAL_ONLY void cvSVD(CvMat *aarr, CvMat *warr, CvMat *uarr, CvMat *varr
 	if (varr && (flags & CV_SVD_V_T) == 0) {
 		cvTranspose(varr, varr);
 	}
-
-	if ((flags & CV_SVD_MODIFY_A) == 0) {
-		cvReleaseMat(&aarr);
-	}
+#endif
 }
 
 SURVIVE_LOCAL_ONLY void cvSetZero(CvMat *arr) {
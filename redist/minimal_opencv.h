@@ -232,6 +232,18 @@ void print_mat(const CvMat *M);
 
 double cvDet(const CvMat *M);
 
+/**
+ * Built in versions of the routines above for the small matrices libsurvive uses, with no BLAS / LAPACK dependency
+ * and no allocations. Building with USE_LAPACK=OFF (SURVIVE_NO_LAPACK) makes the cv* functions forward to these; they
+ * are always built so they can be checked against the LAPACK versions.
+ */
+void cvNativeGEMM(const CvMat *src1, const CvMat *src2, double alpha, const CvMat *src3, double beta, CvMat *dst,
+				  int tABC);
+void cvNativeMulTransposed(const CvMat *src, CvMat *dst, int order, const CvMat *delta, double scale);
+double cvNativeInvert(const CvMat *srcarr, CvMat *dstarr, int method);
+int cvNativeSolve(const CvMat *Aarr, const CvMat *Barr, CvMat *xarr, int method);
+void cvNativeSVD(CvMat *aarr, CvMat *warr, CvMat *uarr, CvMat *varr, int flags);
+
 #define CV_SVD 1
 #define CV_SVD_MODIFY_A 1
 #define CV_SVD_SYM 2
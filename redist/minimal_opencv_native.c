@@ -0,0 +1,541 @@
+// Built in versions of the minimal_opencv routines that would otherwise go to CBLAS / LAPACKE. Everything libsurvive
+// does is at most about 20x20, where the call overhead of the reference libraries -- and the column major copies
+// LAPACKE makes -- outweighs the arithmetic. The kernels take their scratch from the caller; the cvNative* entry points
+// put it on the stack, so nothing here allocates.
+
+#include "math.h"
+#include "minimal_opencv.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include <float.h>
+
+#include "linmath.h"
+
+#ifdef _WIN32
+#define SURVIVE_LOCAL_ONLY
+#include <malloc.h>
+#define alloca _alloca
+#else
+#include <alloca.h>
+#define SURVIVE_LOCAL_ONLY __attribute__((visibility("hidden")))
+#endif
+
+#ifdef USE_FLOAT
+#define NATIVE_EPS FLT_EPSILON
+#else
+#define NATIVE_EPS DBL_EPSILON
+#endif
+
+#define NATIVE_ALLOCA(cnt) ((FLT *)alloca(sizeof(FLT) * (cnt)))
+
+static inline void gemm_3x3x3(FLT alpha, const FLT *a, const FLT *b, FLT beta, FLT *c) {
+	for (int i = 0; i < 3; i++) {
+		const FLT *ar = a + 3 * i;
+		FLT *cr = c + 3 * i;
+		FLT c0 = ar[0] * b[0] + ar[1] * b[3] + ar[2] * b[6];
+		FLT c1 = ar[0] * b[1] + ar[1] * b[4] + ar[2] * b[7];
+		FLT c2 = ar[0] * b[2] + ar[1] * b[5] + ar[2] * b[8];
+		if (beta == 0) {
+			cr[0] = alpha * c0, cr[1] = alpha * c1, cr[2] = alpha * c2;
+		} else {
+			cr[0] = alpha * c0 + beta * cr[0], cr[1] = alpha * c1 + beta * cr[1], cr[2] = alpha * c2 + beta * cr[2];
+		}
+	}
+}
+
+/**
+ * c = alpha * op(a) * op(b) + beta * c, where op(a) is m x k and op(b) is k x n; all row major. Like BLAS, c isn't read
+ * when beta is 0. row is n elements of scratch.
+ */
+static void native_gemm(int m, int n, int k, FLT alpha, const FLT *a, bool ta, const FLT *b, bool tb, FLT beta, FLT *c,
+						FLT *row) {
+	if (m == 3 && n == 3 && k == 3 && !ta && !tb) {
+		gemm_3x3x3(alpha, a, b, beta, c);
+		return;
+	}
+
+	// Element strides for walking a row of op(a) and a column of op(b)
+	const int a_row = ta ? 1 : k, a_col = ta ? m : 1;
+	const int b_row = tb ? 1 : n, b_col = tb ? k : 1;
+
+	for (int i = 0; i < m; i++) {
+		const FLT *ai = a + i * a_row;
+		FLT *ci = c + i * n;
+
+		if (n == 1) {
+			// Matrix vector product
+			FLT sum = 0;
+			for (int p = 0; p < k; p++)
+				sum += ai[p * a_col] * b[p * b_row];
+			row[0] = sum;
+		} else if (!tb) {
+			// Accumulate rows of b; skipping the zeros pays off for the sparse jacobians the kalman filter passes in
+			for (int j = 0; j < n; j++)
+				row[j] = 0;
+			for (int p = 0; p < k; p++) {
+				FLT aip = ai[p * a_col];
+				if (aip == 0)
+					continue;
+				const FLT *bp = b + p * b_row;
+				for (int j = 0; j < n; j++)
+					row[j] += aip * bp[j];
+			}
+		} else {
+			for (int j = 0; j < n; j++) {
+				const FLT *bj = b + j * b_col;
+				FLT sum = 0;
+				for (int p = 0; p < k; p++)
+					sum += ai[p * a_col] * bj[p];
+				row[j] = sum;
+			}
+		}
+
+		if (beta == 0) {
+			for (int j = 0; j < n; j++)
+				ci[j] = alpha * row[j];
+		} else {
+			for (int j = 0; j < n; j++)
+				ci[j] = alpha * row[j] + beta * ci[j];
+		}
+	}
+}
+
+/** In place LU decomposition with partial pivoting; piv records the row swapped into each row like getrf does */
+static bool native_lu(int n, FLT *a, int *piv) {
+	bool singular = false;
+	for (int k = 0; k < n; k++) {
+		int p = k;
+		FLT max = fabs(a[k * n + k]);
+		for (int i = k + 1; i < n; i++) {
+			FLT v = fabs(a[i * n + k]);
+			if (v > max)
+				max = v, p = i;
+		}
+		piv[k] = p;
+
+		if (p != k) {
+			for (int j = 0; j < n; j++) {
+				FLT tmp = a[k * n + j];
+				a[k * n + j] = a[p * n + j];
+				a[p * n + j] = tmp;
+			}
+		}
+
+		FLT pivot = a[k * n + k];
+		if (pivot == 0) {
+			singular = true;
+			continue;
+		}
+
+		for (int i = k + 1; i < n; i++) {
+			FLT l = a[i * n + k] /= pivot;
+			if (l == 0)
+				continue;
+			for (int j = k + 1; j < n; j++)
+				a[i * n + j] -= l * a[k * n + j];
+		}
+	}
+	return !singular;
+}
+
+/** Solves lu * x = b in place for the n x nrhs matrix b */
+static void native_lu_solve(int n, const FLT *lu, const int *piv, int nrhs, FLT *b) {
+	for (int k = 0; k < n; k++) {
+		if (piv[k] != k) {
+			for (int j = 0; j < nrhs; j++) {
+				FLT tmp = b[k * nrhs + j];
+				b[k * nrhs + j] = b[piv[k] * nrhs + j];
+				b[piv[k] * nrhs + j] = tmp;
+			}
+		}
+	}
+
+	for (int i = 1; i < n; i++)
+		for (int k = 0; k < i; k++) {
+			FLT l = lu[i * n + k];
+			if (l == 0)
+				continue;
+			for (int j = 0; j < nrhs; j++)
+				b[i * nrhs + j] -= l * b[k * nrhs + j];
+		}
+
+	for (int i = n - 1; i >= 0; i--) {
+		for (int k = i + 1; k < n; k++) {
+			FLT u = lu[i * n + k];
+			for (int j = 0; j < nrhs; j++)
+				b[i * nrhs + j] -= u * b[k * nrhs + j];
+		}
+		for (int j = 0; j < nrhs; j++)
+			b[i * nrhs + j] /= lu[i * n + i];
+	}
+}
+
+static bool native_invert_small(int n, const FLT *m, FLT *out) {
+	switch (n) {
+	case 1:
+		if (m[0] == 0)
+			return false;
+		out[0] = 1. / m[0];
+		return true;
+	case 2: {
+		FLT det = m[0] * m[3] - m[1] * m[2];
+		if (det == 0)
+			return false;
+		FLT a = m[0], b = m[1], c = m[2], d = m[3];
+		out[0] = d / det, out[1] = -b / det, out[2] = -c / det, out[3] = a / det;
+		return true;
+	}
+	case 3: {
+		FLT c00 = m[4] * m[8] - m[5] * m[7], c01 = m[5] * m[6] - m[3] * m[8], c02 = m[3] * m[7] - m[4] * m[6];
+		FLT det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+		if (det == 0)
+			return false;
+		FLT inv = 1. / det;
+		FLT r[9] = {c00 * inv,
+					(m[2] * m[7] - m[1] * m[8]) * inv,
+					(m[1] * m[5] - m[2] * m[4]) * inv,
+					c01 * inv,
+					(m[0] * m[8] - m[2] * m[6]) * inv,
+					(m[2] * m[3] - m[0] * m[5]) * inv,
+					c02 * inv,
+					(m[1] * m[6] - m[0] * m[7]) * inv,
+					(m[0] * m[4] - m[1] * m[3]) * inv};
+		memcpy(out, r, sizeof(r));
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+static void swap_columns(int rows, int cols, FLT *m, int a, int b) {
+	for (int i = 0; i < rows; i++) {
+		FLT tmp = m[i * cols + a];
+		m[i * cols + a] = m[i * cols + b];
+		m[i * cols + b] = tmp;
+	}
+}
+
+/**
+ * Thin SVD of the r x c (r >= c) matrix in w by one sided Jacobi. On return the columns of w are the left singular
+ * vectors (zero where the singular value is), s holds the singular values in descending order and the columns of the
+ * c x c matrix v are the right singular vectors.
+ */
+static void native_svd_thin(int r, int c, FLT *w, FLT *s, FLT *v) {
+	for (int i = 0; i < c; i++)
+		for (int j = 0; j < c; j++)
+			v[i * c + j] = i == j;
+
+	for (int sweep = 0; sweep < 60; sweep++) {
+		bool rotated = false;
+		for (int p = 0; p < c - 1; p++) {
+			for (int q = p + 1; q < c; q++) {
+				FLT alpha = 0, beta = 0, gamma = 0;
+				for (int i = 0; i < r; i++) {
+					FLT wp = w[i * c + p], wq = w[i * c + q];
+					alpha += wp * wp;
+					beta += wq * wq;
+					gamma += wp * wq;
+				}
+				if (gamma == 0 || fabs(gamma) <= NATIVE_EPS * sqrt(alpha * beta))
+					continue;
+				rotated = true;
+
+				FLT zeta = (beta - alpha) / (2 * gamma);
+				FLT t = (zeta >= 0 ? 1 : -1) / (fabs(zeta) + sqrt(1 + zeta * zeta));
+				FLT cs = 1 / sqrt(1 + t * t), sn = cs * t;
+				for (int i = 0; i < r; i++) {
+					FLT wp = w[i * c + p], wq = w[i * c + q];
+					w[i * c + p] = cs * wp - sn * wq;
+					w[i * c + q] = sn * wp + cs * wq;
+				}
+				for (int i = 0; i < c; i++) {
+					FLT vp = v[i * c + p], vq = v[i * c + q];
+					v[i * c + p] = cs * vp - sn * vq;
+					v[i * c + q] = sn * vp + cs * vq;
+				}
+			}
+		}
+		if (!rotated)
+			break;
+	}
+
+	for (int j = 0; j < c; j++) {
+		FLT sum = 0;
+		for (int i = 0; i < r; i++)
+			sum += w[i * c + j] * w[i * c + j];
+		s[j] = sqrt(sum);
+	}
+
+	for (int j = 0; j < c; j++) {
+		int max = j;
+		for (int k = j + 1; k < c; k++)
+			if (s[k] > s[max])
+				max = k;
+		if (max != j) {
+			FLT tmp = s[j];
+			s[j] = s[max];
+			s[max] = tmp;
+			swap_columns(r, c, w, j, max);
+			swap_columns(c, c, v, j, max);
+		}
+
+		FLT scale = s[j] > 0 ? 1. / s[j] : 0;
+		for (int i = 0; i < r; i++)
+			w[i * c + j] *= scale;
+	}
+}
+
+/**
+ * Fills out the n x n matrix q into an orthonormal basis. Columns [0, valid_cnt) are already orthonormal, except for
+ * those whose entry in s is zero, which are replaced along with the rest. scratch needs 2 * n elements.
+ */
+static void native_complete_basis(int n, FLT *q, int valid_cnt, const FLT *s, FLT *scratch) {
+	FLT *cand = scratch, *keep = scratch + n;
+	for (int j = 0; j < n; j++) {
+		if (j < valid_cnt && s[j] > 0)
+			continue;
+
+		// Pick the unit vector that is furthest from the span so far
+		FLT best_norm = -1;
+		for (int e = 0; e < n; e++) {
+			for (int i = 0; i < n; i++)
+				cand[i] = i == e;
+			for (int pass = 0; pass < 2; pass++) {
+				for (int k = 0; k < n; k++) {
+					if (k == j || (k > j && !(k < valid_cnt && s[k] > 0)))
+						continue;
+					FLT dot = 0;
+					for (int i = 0; i < n; i++)
+						dot += cand[i] * q[i * n + k];
+					for (int i = 0; i < n; i++)
+						cand[i] -= dot * q[i * n + k];
+				}
+			}
+			FLT norm = 0;
+			for (int i = 0; i < n; i++)
+				norm += cand[i] * cand[i];
+			if (norm > best_norm) {
+				best_norm = norm;
+				memcpy(keep, cand, sizeof(FLT) * n);
+			}
+		}
+
+		FLT scale = 1. / sqrt(best_norm);
+		for (int i = 0; i < n; i++)
+			q[i * n + j] = keep[i] * scale;
+	}
+}
+
+static inline int native_svd_solve_scratch(int m, int n, int nrhs) {
+	int c = m >= n ? n : m;
+	return m * n + c + c * c + c * nrhs;
+}
+
+/**
+ * x = pinv(a) * b for the m x n matrix a and m x nrhs matrix b, or pinv(a) itself if b is null (and nrhs is m).
+ * Singular values below machine precision relative to the largest are treated as zero, as gelss does with rcond = -1.
+ * scratch needs native_svd_solve_scratch elements.
+ */
+static void native_svd_solve(int m, int n, const FLT *a, int nrhs, const FLT *b, FLT *x, FLT *scratch) {
+	const int r = m >= n ? m : n, c = m >= n ? n : m;
+	FLT *w = scratch, *s = w + r * c, *v = s + c, *tmp = v + c * c;
+
+	// Work on whichever of a / a^T is tall. left then holds the m x c left singular vectors and right the n x c right
+	// ones, with strides of c.
+	if (m >= n) {
+		memcpy(w, a, sizeof(FLT) * m * n);
+	} else {
+		for (int i = 0; i < m; i++)
+			for (int j = 0; j < n; j++)
+				w[j * m + i] = a[i * n + j];
+	}
+	native_svd_thin(r, c, w, s, v);
+	const FLT *left = m >= n ? w : v, *right = m >= n ? v : w;
+
+	const FLT tol = NATIVE_EPS * s[0];
+	assert(b || nrhs == m);
+
+	// tmp = diag(1/s) * left^T * b
+	for (int k = 0; k < c; k++) {
+		FLT inv = s[k] > tol ? 1. / s[k] : 0;
+		for (int j = 0; j < nrhs; j++) {
+			FLT sum = 0;
+			if (b) {
+				for (int i = 0; i < m; i++)
+					sum += left[i * c + k] * b[i * nrhs + j];
+			} else {
+				sum = left[j * c + k];
+			}
+			tmp[k * nrhs + j] = sum * inv;
+		}
+	}
+
+	// x = right * tmp
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < nrhs; j++) {
+			FLT sum = 0;
+			for (int k = 0; k < c; k++)
+				sum += right[i * c + k] * tmp[k * nrhs + j];
+			x[i * nrhs + j] = sum;
+		}
+	}
+}
+
+SURVIVE_LOCAL_ONLY void cvNativeGEMM(const CvMat *src1, const CvMat *src2, double alpha, const CvMat *src3, double beta,
+									 CvMat *dst, int tABC) {
+	bool ta = tABC & CV_GEMM_A_T, tb = tABC & CV_GEMM_B_T;
+	int k = ta ? src1->rows : src1->cols;
+
+	assert((ta ? src1->cols : src1->rows) == dst->rows);
+	assert((tb ? src2->rows : src2->cols) == dst->cols);
+	assert((tb ? src2->cols : src2->rows) == k);
+	assert(CV_RAW_PTR(dst) != CV_RAW_PTR(src1));
+	assert(CV_RAW_PTR(dst) != CV_RAW_PTR(src2));
+	assert((tABC & CV_GEMM_C_T) == 0 && "This isn't implemented yet");
+
+	if (src3) {
+		assert(src3->rows == dst->rows && src3->cols == dst->cols);
+		if (CV_RAW_PTR(src3) != CV_RAW_PTR(dst))
+			memcpy(CV_RAW_PTR(dst), CV_RAW_PTR(src3), sizeof(FLT) * dst->rows * dst->cols);
+	} else {
+		beta = 0;
+	}
+
+	native_gemm(dst->rows, dst->cols, k, alpha, CV_RAW_PTR(src1), ta, CV_RAW_PTR(src2), tb, beta, CV_RAW_PTR(dst),
+				NATIVE_ALLOCA(dst->cols));
+}
+
+SURVIVE_LOCAL_ONLY void cvNativeMulTransposed(const CvMat *src, CvMat *dst, int order, const CvMat *delta,
+											  double scale) {
+	assert(delta == 0 && "This isn't implemented yet");
+	const FLT *a = CV_RAW_PTR(src);
+	FLT *d = CV_RAW_PTR(dst);
+	int rows = src->rows, cols = src->cols;
+
+	// order == 1: dst = scale * src^T * src, otherwise dst = scale * src * src^T
+	int n = order == 1 ? cols : rows, k = order == 1 ? rows : cols;
+	int stride_i = order == 1 ? 1 : cols, stride_k = order == 1 ? cols : 1;
+	assert(dst->rows == n && dst->cols == n);
+
+	for (int i = 0; i < n; i++) {
+		for (int j = i; j < n; j++) {
+			FLT sum = 0;
+			for (int p = 0; p < k; p++)
+				sum += a[i * stride_i + p * stride_k] * a[j * stride_i + p * stride_k];
+			d[i * n + j] = d[j * n + i] = scale * sum;
+		}
+	}
+}
+
+SURVIVE_LOCAL_ONLY double cvNativeInvert(const CvMat *srcarr, CvMat *dstarr, int method) {
+	int rows = srcarr->rows, cols = srcarr->cols;
+	const FLT *src = CV_RAW_PTR(srcarr);
+	FLT *dst = CV_RAW_PTR(dstarr);
+
+	if (method == DECOMP_LU) {
+		assert(rows == cols && dstarr->rows == rows && dstarr->cols == cols);
+		if (rows <= 3) {
+			if (!native_invert_small(rows, src, dst))
+				printf("Warning: Singular matrix: \n");
+			return 0;
+		}
+
+		FLT *lu = NATIVE_ALLOCA(rows * rows);
+		int *piv = alloca(sizeof(int) * rows);
+		memcpy(lu, src, sizeof(FLT) * rows * rows);
+		if (!native_lu(rows, lu, piv))
+			printf("Warning: Singular matrix: \n");
+
+		for (int i = 0; i < rows; i++)
+			for (int j = 0; j < rows; j++)
+				dst[i * rows + j] = i == j;
+		native_lu_solve(rows, lu, piv, rows, dst);
+	} else if (method == DECOMP_SVD) {
+		assert(dstarr->rows == cols && dstarr->cols == rows);
+		FLT *scratch = NATIVE_ALLOCA(native_svd_solve_scratch(rows, cols, rows));
+		FLT *out = NATIVE_ALLOCA(rows * cols);
+		native_svd_solve(rows, cols, src, rows, 0, out, scratch);
+		memcpy(dst, out, sizeof(FLT) * rows * cols);
+	} else {
+		assert(0 && "Bad argument");
+		return -1;
+	}
+
+	return 0;
+}
+
+SURVIVE_LOCAL_ONLY int cvNativeSolve(const CvMat *Aarr, const CvMat *Barr, CvMat *xarr, int method) {
+	int m = Aarr->rows, n = Aarr->cols, nrhs = Barr->cols;
+	assert(Barr->rows == m);
+	assert(xarr->rows == n && xarr->cols == nrhs);
+
+	if (method == DECOMP_LU) {
+		assert(m == n);
+		FLT *lu = NATIVE_ALLOCA(n * n);
+		int *piv = alloca(sizeof(int) * n);
+		memcpy(lu, CV_RAW_PTR(Aarr), sizeof(FLT) * n * n);
+		if (!native_lu(n, lu, piv))
+			printf("Warning: Singular matrix: \n");
+
+		if (CV_RAW_PTR(xarr) != CV_RAW_PTR(Barr))
+			memcpy(CV_RAW_PTR(xarr), CV_RAW_PTR(Barr), sizeof(FLT) * n * nrhs);
+		native_lu_solve(n, lu, piv, nrhs, CV_RAW_PTR(xarr));
+	} else if (method == DECOMP_SVD) {
+		FLT *scratch = NATIVE_ALLOCA(native_svd_solve_scratch(m, n, nrhs));
+		FLT *out = NATIVE_ALLOCA(n * nrhs);
+		native_svd_solve(m, n, CV_RAW_PTR(Aarr), nrhs, CV_RAW_PTR(Barr), out, scratch);
+		memcpy(CV_RAW_PTR(xarr), out, sizeof(FLT) * n * nrhs);
+	} else {
+		assert(0 && "Bad argument");
+		return -1;
+	}
+	return 0;
+}
+
+SURVIVE_LOCAL_ONLY void cvNativeSVD(CvMat *aarr, CvMat *warr, CvMat *uarr, CvMat *varr, int flags) {
+	const int m = aarr->rows, n = aarr->cols;
+	const int r = m >= n ? m : n, c = m >= n ? n : m;
+	const FLT *a = CV_RAW_PTR(aarr);
+
+	FLT *w = NATIVE_ALLOCA(r * c), *v = NATIVE_ALLOCA(c * c), *s = NATIVE_ALLOCA(c);
+	if (m >= n) {
+		memcpy(w, a, sizeof(FLT) * m * n);
+	} else {
+		for (int i = 0; i < m; i++)
+			for (int j = 0; j < n; j++)
+				w[j * m + i] = a[i * n + j];
+	}
+	native_svd_thin(r, c, w, s, v);
+
+	if (warr)
+		memcpy(CV_RAW_PTR(warr), s, sizeof(FLT) * c);
+
+	// For a tall matrix w holds U and v holds V; for a wide one they trade places. Either way the one from w is only
+	// r x c and needs filling out to a full basis.
+	FLT *full = NATIVE_ALLOCA(r * r);
+	for (int i = 0; i < r; i++)
+		for (int j = 0; j < r; j++)
+			full[i * r + j] = j < c ? w[i * c + j] : 0;
+	native_complete_basis(r, full, c, s, NATIVE_ALLOCA(2 * r));
+
+	const FLT *u_src = m >= n ? full : v, *v_src = m >= n ? v : full;
+	if (uarr) {
+		assert(uarr->rows == m && uarr->cols == m);
+		FLT *u = CV_RAW_PTR(uarr);
+		bool transpose = flags & CV_SVD_U_T;
+		for (int i = 0; i < m; i++)
+			for (int j = 0; j < m; j++)
+				u[transpose ? j * m + i : i * m + j] = u_src[i * m + j];
+	}
+	if (varr) {
+		assert(varr->rows == n && varr->cols == n);
+		FLT *vt = CV_RAW_PTR(varr);
+		bool transpose = flags & CV_SVD_V_T;
+		for (int i = 0; i < n; i++)
+			for (int j = 0; j < n; j++)
+				vt[transpose ? j * n + i : i * n + j] = v_src[i * n + j];
+	}
+}
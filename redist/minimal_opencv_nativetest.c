@@ -0,0 +1,334 @@
+// Checks the built in small matrix routines in minimal_opencv_native.c for every shape libsurvive could plausibly use.
+// Results are compared against the LAPACK backed cv* functions when those are built, and always against naive
+// reference implementations / reconstruction identities. `--bench` times the two backends against each other.
+
+#include "linmath.h"
+#include "minimal_opencv.h"
+#include "os_generic.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DIM 20
+
+#ifdef USE_FLOAT
+static const FLT tolerance = 1e-3;
+#else
+static const FLT tolerance = 1e-8;
+#endif
+
+static int failures = 0;
+
+static void fill_random(FLT *m, int cnt) {
+	for (int i = 0; i < cnt; i++)
+		m[i] = rand() / (FLT)RAND_MAX * 2 - 1;
+}
+
+static bool check_near(const char *what, int m, int n, const FLT *expected, const FLT *actual, int cnt) {
+	for (int i = 0; i < cnt; i++) {
+		FLT err = fabs(expected[i] - actual[i]);
+		if (!(err <= tolerance * (1 + fabs(expected[i])))) {
+			fprintf(stderr, "%s %dx%d: element %d is %g, expected %g\n", what, m, n, i, actual[i], expected[i]);
+			failures++;
+			return false;
+		}
+	}
+	return true;
+}
+
+// op(a) is m x k, op(b) is k x n
+static void reference_gemm(int m, int n, int k, FLT alpha, const FLT *a, bool ta, const FLT *b, bool tb, FLT beta,
+						   const FLT *c, FLT *out) {
+	for (int i = 0; i < m; i++) {
+		for (int j = 0; j < n; j++) {
+			FLT sum = 0;
+			for (int p = 0; p < k; p++)
+				sum += (ta ? a[p * m + i] : a[i * k + p]) * (tb ? b[j * k + p] : b[p * n + j]);
+			out[i * n + j] = alpha * sum + (c ? beta * c[i * n + j] : 0);
+		}
+	}
+}
+
+static void test_gemm() {
+	FLT a[MAX_DIM * MAX_DIM], b[MAX_DIM * MAX_DIM], c[MAX_DIM * MAX_DIM];
+	FLT expected[MAX_DIM * MAX_DIM], actual[MAX_DIM * MAX_DIM];
+
+	for (int m = 1; m <= MAX_DIM; m++) {
+		for (int n = 1; n <= MAX_DIM; n++) {
+			for (int k = 1; k <= MAX_DIM; k += 3) {
+				for (int tABC = 0; tABC < 4; tABC++) {
+					bool ta = tABC & CV_GEMM_A_T, tb = tABC & CV_GEMM_B_T;
+					fill_random(a, m * k);
+					fill_random(b, k * n);
+					fill_random(c, m * n);
+					// Sparse rows exercise the zero skipping
+					for (int i = 0; i < m * k; i += 3)
+						a[i] = 0;
+
+					CvMat A = cvMat(ta ? k : m, ta ? m : k, CV_FLT, a);
+					CvMat B = cvMat(tb ? n : k, tb ? k : n, CV_FLT, b);
+					CvMat C = cvMat(m, n, CV_FLT, c);
+					CvMat Actual = cvMat(m, n, CV_FLT, actual);
+					bool with_c = (m + n + k) % 2;
+
+					reference_gemm(m, n, k, 1.5, a, ta, b, tb, .5, with_c ? c : 0, expected);
+					cvNativeGEMM(&A, &B, 1.5, with_c ? &C : 0, .5, &Actual, tABC);
+					if (!check_near("gemm", m, n, expected, actual, m * n))
+						return;
+
+#ifndef SURVIVE_NO_LAPACK
+					cvGEMM(&A, &B, 1.5, with_c ? &C : 0, .5, &Actual, tABC);
+					if (!check_near("gemm vs lapack", m, n, expected, actual, m * n))
+						return;
+#endif
+				}
+			}
+		}
+	}
+}
+
+static void test_mul_transposed() {
+	FLT a[MAX_DIM * MAX_DIM], expected[MAX_DIM * MAX_DIM], actual[MAX_DIM * MAX_DIM];
+	for (int r = 1; r <= MAX_DIM; r++) {
+		for (int c = 1; c <= MAX_DIM; c++) {
+			for (int order = 0; order < 2; order++) {
+				fill_random(a, r * c);
+				int n = order ? c : r, k = order ? r : c;
+				CvMat A = cvMat(r, c, CV_FLT, a);
+				CvMat Actual = cvMat(n, n, CV_FLT, actual);
+
+				reference_gemm(n, n, k, 2, a, order == 1, a, order == 0, 0, 0, expected);
+				cvNativeMulTransposed(&A, &Actual, order, 0, 2);
+				if (!check_near("multransposed", r, c, expected, actual, n * n))
+					return;
+#ifndef SURVIVE_NO_LAPACK
+				cvMulTransposed(&A, &Actual, order, 0, 2);
+				if (!check_near("multransposed vs lapack", r, c, expected, actual, n * n))
+					return;
+#endif
+			}
+		}
+	}
+}
+
+// Well conditioned: random with a dominant diagonal
+static void fill_invertible(FLT *a, int n) {
+	fill_random(a, n * n);
+	for (int i = 0; i < n; i++)
+		a[i * n + i] += n;
+}
+
+static void test_invert() {
+	FLT a[MAX_DIM * MAX_DIM], inv[MAX_DIM * MAX_DIM], product[MAX_DIM * MAX_DIM], eye[MAX_DIM * MAX_DIM];
+#ifndef SURVIVE_NO_LAPACK
+	FLT lapack[MAX_DIM * MAX_DIM];
+#endif
+
+	for (int method = 0; method < 2; method++) {
+		int decomp = method ? DECOMP_SVD : DECOMP_LU;
+		const char *name = method ? "invert svd" : "invert lu";
+		for (int n = 1; n <= MAX_DIM; n++) {
+			fill_invertible(a, n);
+			CvMat A = cvMat(n, n, CV_FLT, a), Inv = cvMat(n, n, CV_FLT, inv);
+			cvNativeInvert(&A, &Inv, decomp);
+
+			for (int i = 0; i < n * n; i++)
+				eye[i] = i % (n + 1) == 0;
+			reference_gemm(n, n, n, 1, a, false, inv, false, 0, 0, product);
+			if (!check_near(name, n, n, eye, product, n * n))
+				return;
+
+#ifndef SURVIVE_NO_LAPACK
+			CvMat Lapack = cvMat(n, n, CV_FLT, lapack);
+			cvInvert(&A, &Lapack, decomp);
+			if (!check_near(method ? "invert svd vs lapack" : "invert lu vs lapack", n, n, lapack, inv, n * n))
+				return;
+#endif
+		}
+	}
+}
+
+static void test_solve() {
+	FLT a[MAX_DIM * MAX_DIM], b[MAX_DIM * 3], x[MAX_DIM * 3], check[MAX_DIM * MAX_DIM];
+#ifndef SURVIVE_NO_LAPACK
+	FLT lapack[MAX_DIM * 3];
+#endif
+
+	for (int n = 1; n <= MAX_DIM; n++) {
+		for (int nrhs = 1; nrhs <= 3; nrhs++) {
+			fill_invertible(a, n);
+			fill_random(b, n * nrhs);
+			CvMat A = cvMat(n, n, CV_FLT, a), B = cvMat(n, nrhs, CV_FLT, b), X = cvMat(n, nrhs, CV_FLT, x);
+			cvNativeSolve(&A, &B, &X, DECOMP_LU);
+
+			reference_gemm(n, nrhs, n, 1, a, false, x, false, 0, 0, check);
+			if (!check_near("solve lu", n, nrhs, b, check, n * nrhs))
+				return;
+
+#ifndef SURVIVE_NO_LAPACK
+			CvMat Lapack = cvMat(n, nrhs, CV_FLT, lapack);
+			cvSolve(&A, &B, &Lapack, DECOMP_LU);
+			if (!check_near("solve lu vs lapack", n, nrhs, lapack, x, n * nrhs))
+				return;
+#endif
+		}
+	}
+
+	// Least squares for tall systems, minimum norm for wide ones
+	for (int m = 1; m <= 12; m++) {
+		for (int n = 1; n <= 12; n++) {
+			for (int nrhs = 1; nrhs <= 2; nrhs++) {
+				fill_random(a, m * n);
+				fill_random(b, m * nrhs);
+				CvMat A = cvMat(m, n, CV_FLT, a), B = cvMat(m, nrhs, CV_FLT, b), X = cvMat(n, nrhs, CV_FLT, x);
+				cvNativeSolve(&A, &B, &X, DECOMP_SVD);
+
+				// Residuals are orthogonal to the column space either way
+				FLT residual[MAX_DIM * 3], normal[MAX_DIM * 3], zero[MAX_DIM * 3] = {0};
+				reference_gemm(m, nrhs, n, 1, a, false, x, false, -1, b, residual);
+				reference_gemm(n, nrhs, m, 1, a, true, residual, false, 0, 0, normal);
+				if (!check_near("solve svd", m, n, zero, normal, n * nrhs))
+					return;
+
+#ifndef SURVIVE_NO_LAPACK
+				CvMat Lapack = cvMat(n, nrhs, CV_FLT, lapack);
+				cvSolve(&A, &B, &Lapack, DECOMP_SVD);
+				if (!check_near("solve svd vs lapack", m, n, lapack, x, n * nrhs))
+					return;
+#endif
+			}
+		}
+	}
+}
+
+static bool check_orthonormal(const char *what, int n, const FLT *q) {
+	FLT qtq[MAX_DIM * MAX_DIM], eye[MAX_DIM * MAX_DIM];
+	for (int i = 0; i < n * n; i++)
+		eye[i] = i % (n + 1) == 0;
+	reference_gemm(n, n, n, 1, q, true, q, false, 0, 0, qtq);
+	return check_near(what, n, n, eye, qtq, n * n);
+}
+
+static void test_svd() {
+	FLT a[MAX_DIM * MAX_DIM], w[MAX_DIM], u[MAX_DIM * MAX_DIM], v[MAX_DIM * MAX_DIM];
+	FLT us[MAX_DIM * MAX_DIM], recon[MAX_DIM * MAX_DIM];
+#ifndef SURVIVE_NO_LAPACK
+	FLT lapack_w[MAX_DIM], scratch[MAX_DIM * MAX_DIM];
+#endif
+
+	for (int m = 1; m <= 12; m++) {
+		for (int n = 1; n <= 12; n++) {
+			for (int flags = 0; flags < 4; flags++) {
+				int svd_flags = (flags & 1 ? CV_SVD_U_T : 0) | (flags & 2 ? CV_SVD_V_T : 0);
+				int c = m < n ? m : n;
+				fill_random(a, m * n);
+				// A rank deficient case, to make sure the null space still gets a basis
+				if (flags == 3 && n > 1)
+					for (int i = 0; i < m; i++)
+						a[i * n + n - 1] = a[i * n];
+
+				CvMat A = cvMat(m, n, CV_FLT, a), W = cvMat(c, 1, CV_FLT, w);
+				CvMat U = cvMat(m, m, CV_FLT, u), V = cvMat(n, n, CV_FLT, v);
+				cvNativeSVD(&A, &W, &U, &V, svd_flags);
+
+				// Normalize to plain U and V
+				if (svd_flags & CV_SVD_U_T)
+					cvTranspose(&U, &U);
+				if (svd_flags & CV_SVD_V_T)
+					cvTranspose(&V, &V);
+
+				if (!check_orthonormal("svd u", m, u) || !check_orthonormal("svd v", n, v))
+					return;
+
+				for (int i = 1; i < c; i++) {
+					if (w[i] > w[i - 1]) {
+						fprintf(stderr, "svd %dx%d: singular values not sorted\n", m, n);
+						failures++;
+						return;
+					}
+				}
+
+				// U * S * V^T
+				for (int i = 0; i < m; i++)
+					for (int j = 0; j < n; j++)
+						us[i * n + j] = j < c ? u[i * m + j] * w[j] : 0;
+				reference_gemm(m, n, n, 1, us, false, v, true, 0, 0, recon);
+				if (!check_near("svd reconstruction", m, n, a, recon, m * n))
+					return;
+
+#ifndef SURVIVE_NO_LAPACK
+				memcpy(scratch, a, sizeof(FLT) * m * n);
+				CvMat Scratch = cvMat(m, n, CV_FLT, scratch), LapackW = cvMat(c, 1, CV_FLT, lapack_w);
+				cvSVD(&Scratch, &LapackW, 0, 0, CV_SVD_MODIFY_A);
+				if (!check_near("svd vs lapack", m, n, lapack_w, w, c))
+					return;
+#endif
+			}
+		}
+	}
+}
+
+#define BENCH(name, iterations, body)                                                                                  \
+	{                                                                                                                  \
+		double start = OGGetAbsoluteTime();                                                                            \
+		for (int _i = 0; _i < (iterations); _i++) {                                                                    \
+			body;                                                                                                      \
+		}                                                                                                              \
+		printf("%-28s %10.2fkhz\n", name, (iterations) / (OGGetAbsoluteTime() - start) / 1000.);                       \
+	}
+
+static void bench(int iterations) {
+	FLT a[MAX_DIM * MAX_DIM], b[MAX_DIM * MAX_DIM], c[MAX_DIM * MAX_DIM], w[MAX_DIM], u[MAX_DIM * MAX_DIM],
+		v[MAX_DIM * MAX_DIM];
+	int sizes[] = {3, 7, 12, 19};
+	for (int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		int n = sizes[s];
+		char name[64];
+		fill_invertible(a, n);
+		fill_random(b, n * n);
+		CvMat A = cvMat(n, n, CV_FLT, a), B = cvMat(n, n, CV_FLT, b), C = cvMat(n, n, CV_FLT, c);
+		CvMat W = cvMat(n, 1, CV_FLT, w), U = cvMat(n, n, CV_FLT, u), V = cvMat(n, n, CV_FLT, v);
+
+		snprintf(name, sizeof(name), "native gemm %dx%d", n, n);
+		BENCH(name, iterations, cvNativeGEMM(&A, &B, 1, 0, 0, &C, 0));
+		snprintf(name, sizeof(name), "native invert lu %dx%d", n, n);
+		BENCH(name, iterations, cvNativeInvert(&A, &C, DECOMP_LU));
+		snprintf(name, sizeof(name), "native svd %dx%d", n, n);
+		BENCH(name, iterations / 10, cvNativeSVD(&A, &W, &U, &V, 0));
+#ifndef SURVIVE_NO_LAPACK
+		snprintf(name, sizeof(name), "lapack gemm %dx%d", n, n);
+		BENCH(name, iterations, cvGEMM(&A, &B, 1, 0, 0, &C, 0));
+		snprintf(name, sizeof(name), "lapack invert lu %dx%d", n, n);
+		BENCH(name, iterations, cvInvert(&A, &C, DECOMP_LU));
+		snprintf(name, sizeof(name), "lapack svd %dx%d", n, n);
+		BENCH(name, iterations / 10, {
+			memcpy(b, a, sizeof(FLT) * n * n);
+			cvSVD(&B, &W, &U, &V, CV_SVD_MODIFY_A);
+		});
+#endif
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	srand(42);
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+		bench(argc > 2 ? atoi(argv[2]) : 100000);
+		return 0;
+	}
+
+	test_gemm();
+	test_mul_transposed();
+	test_invert();
+	test_solve();
+	test_svd();
+
+	if (failures) {
+		fprintf(stderr, "%d checks failed\n", failures);
+		return -1;
+	}
+	return 0;
+}
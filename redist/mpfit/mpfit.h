@@ -159,16 +159,15 @@ typedef int (*mp_func)(int m,				/* Number of functions (elts of fvec) */
 #define MP_GTOL (8)	/* gtol is too small; no further improvement*/
 #define MP_OK_NORM (9) /* norm is small enough according to user */
 
-/* FLT precision numeric constants */
+/* FLT precision numeric constants; the double values underflow / overflow to 0 / inf as floats */
+#ifdef USE_FLOAT
+#define MP_MACHEP0 (FLT)1.19209e-07
+#define MP_DWARF (FLT)1.17549e-38
+#define MP_GIANT (FLT)3.40282e+38
+#else
 #define MP_MACHEP0 (FLT)2.2204460e-16
 #define MP_DWARF (FLT)2.2250739e-308
 #define MP_GIANT (FLT)1.7976931e+308
-
-#if 0
-/* Float precision */
-#define MP_MACHEP0 1.19209e-07
-#define MP_DWARF 1.17549e-38
-#define MP_GIANT 3.40282e+38
 #endif
 
 #define MP_RDWARF (FLT_SQRT(MP_DWARF * (FLT)1.5) * (FLT)10)
@@ -1,13 +1,21 @@
 #include "barycentric_svd.h"
+#include "float.h"
 #include "math.h"
 #include "stdbool.h"
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
 #include "survive.h"
 #include <malloc.h>
 
 #pragma GCC diagnostic ignored "-Wpedantic"
 
+#ifdef USE_FLOAT
+#define BC_SVD_EPS FLT_EPSILON
+#else
+#define BC_SVD_EPS DBL_EPSILON
+#endif
+
 static void bc_svd_choose_control_points(bc_svd *self) {
 	// Take C0 as the reference points centroid:
 	self->setup.control_points[0][0] = self->setup.control_points[0][1] = self->setup.control_points[0][2] = 0;
@@ -107,7 +115,12 @@ void bc_svd_compute_rho(bc_svd *self, FLT *rho) {
 	rho[5] = dist2(self->setup.control_points[2], self->setup.control_points[3]);
 }
 
-void bc_svd_reset_correspondences(bc_svd *self) { self->meas_cnt = 0; }
+void bc_svd_reset_correspondences(bc_svd *self) {
+	self->meas_cnt = 0;
+	memset(self->mtm, 0, sizeof(self->mtm));
+	memset(self->col_covered, 0, sizeof(self->col_covered));
+	memset(self->has_axis, 0, sizeof(self->has_axis));
+}
 
 void bc_svd_add_single_correspondence(bc_svd *self, size_t idx, int axis, FLT angle) {
 	if (isnan(angle))
@@ -119,7 +132,29 @@ void bc_svd_add_single_correspondence(bc_svd *self, size_t idx, int axis, FLT an
 	}
 
 	assert(idx < self->setup.obj_cnt);
-	self->meas[self->meas_cnt] = (bc_svd_meas_t){.angle = angle, .axis = axis, .obj_idx = idx};
+	bc_svd_meas_t *meas = &self->meas[self->meas_cnt];
+	*meas = (bc_svd_meas_t){.angle = angle, .axis = axis, .obj_idx = idx, .eq = {NAN, NAN, NAN}};
+	self->setup.fillFn(self->setup.user, meas->eq, axis, angle);
+	self->has_axis[axis] = true;
+
+	// This measurement's row of M; fold it straight into MtM
+	const FLT *as = self->setup.alphas[idx];
+	FLT row[12];
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 3; j++) {
+			row[i * 3 + j] = meas->eq[j] * as[i];
+			assert(isfinite(row[i * 3 + j]));
+		}
+	}
+
+	for (int i = 0; i < 12; i++) {
+		if (row[i] == 0.0)
+			continue;
+		self->col_covered[i] = true;
+		FLT *mtm_row = self->mtm + 12 * i;
+		for (int j = i; j < 12; j++)
+			mtm_row[j] += row[i] * row[j];
+	}
 
 	self->meas_cnt++;
 }
@@ -130,18 +165,184 @@ void bc_svd_add_correspondence(bc_svd *self, size_t idx, FLT u, FLT v) {
 	}
 }
 
-void bc_svd_fill_M(bc_svd *self, CvMat *_M, const int row, const FLT *as, int axis, FLT angle) {
-	FLT *M = CV_RAW_PTR(_M) + row * 12;
-
-	FLT eq[3] = {NAN, NAN, NAN};
-	self->setup.fillFn(self->setup.user, eq, axis, angle);
+/**
+ * Eigen decomposition of a symmetric 12x12 matrix; Householder reduction to tridiagonal form followed by implicit QL,
+ * after the EISPACK tred2 / tql2 routines. Only the upper triangle of a is read, and a is used as scratch. Eigenvalues
+ * come out in d in descending order with the matching eigenvectors in the rows of ut, which is the same layout
+ * cvSVD(..., CV_SVD_U_T) gives for the positive semi-definite MtM.
+ */
+static void bc_svd_eigen_12x12(FLT *a, FLT *d, FLT *ut) {
+	enum { n = 12 };
+	// Eigenvectors are accumulated in the columns of v
+	FLT(*v)[n] = (FLT(*)[n])a;
+	FLT e[n];
+
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < i; j++)
+			v[i][j] = v[j][i];
+
+	for (int j = 0; j < n; j++)
+		d[j] = v[n - 1][j];
+
+	for (int i = n - 1; i > 0; i--) {
+		FLT scale = 0, h = 0;
+		for (int k = 0; k < i; k++)
+			scale += FLT_FABS(d[k]);
+
+		if (scale == 0.0) {
+			e[i] = d[i - 1];
+			for (int j = 0; j < i; j++) {
+				d[j] = v[i - 1][j];
+				v[i][j] = v[j][i] = 0;
+			}
+		} else {
+			for (int k = 0; k < i; k++) {
+				d[k] /= scale;
+				h += d[k] * d[k];
+			}
+			FLT f = d[i - 1];
+			FLT g = FLT_SQRT(h);
+			if (f > 0)
+				g = -g;
+			e[i] = scale * g;
+			h -= f * g;
+			d[i - 1] = f - g;
+			for (int j = 0; j < i; j++)
+				e[j] = 0;
+
+			for (int j = 0; j < i; j++) {
+				f = d[j];
+				v[j][i] = f;
+				g = e[j] + v[j][j] * f;
+				for (int k = j + 1; k < i; k++) {
+					g += v[k][j] * d[k];
+					e[k] += v[k][j] * f;
+				}
+				e[j] = g;
+			}
 
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 3; j++) {
-			M[i * 3 + j] = eq[j] * as[i];
-			assert(isfinite(M[i * 3 + j]));
+			f = 0;
+			for (int j = 0; j < i; j++) {
+				e[j] /= h;
+				f += e[j] * d[j];
+			}
+			FLT hh = f / (h + h);
+			for (int j = 0; j < i; j++)
+				e[j] -= hh * d[j];
+			for (int j = 0; j < i; j++) {
+				f = d[j];
+				g = e[j];
+				for (int k = j; k < i; k++)
+					v[k][j] -= f * e[k] + g * d[k];
+				d[j] = v[i - 1][j];
+				v[i][j] = 0;
+			}
+		}
+		d[i] = h;
+	}
+
+	for (int i = 0; i < n - 1; i++) {
+		v[n - 1][i] = v[i][i];
+		v[i][i] = 1;
+		FLT h = d[i + 1];
+		if (h != 0.0) {
+			for (int k = 0; k <= i; k++)
+				d[k] = v[k][i + 1] / h;
+			for (int j = 0; j <= i; j++) {
+				FLT g = 0;
+				for (int k = 0; k <= i; k++)
+					g += v[k][i + 1] * v[k][j];
+				for (int k = 0; k <= i; k++)
+					v[k][j] -= g * d[k];
+			}
+		}
+		for (int k = 0; k <= i; k++)
+			v[k][i + 1] = 0;
+	}
+	for (int j = 0; j < n; j++) {
+		d[j] = v[n - 1][j];
+		v[n - 1][j] = 0;
+	}
+	v[n - 1][n - 1] = 1;
+
+	// QL on the tridiagonal d / e
+	for (int i = 1; i < n; i++)
+		e[i - 1] = e[i];
+	e[n - 1] = 0;
+
+	FLT f = 0, tst1 = 0;
+	for (int l = 0; l < n; l++) {
+		FLT t = FLT_FABS(d[l]) + FLT_FABS(e[l]);
+		if (tst1 < t)
+			tst1 = t;
+
+		int m = l;
+		while (m < n - 1 && FLT_FABS(e[m]) > BC_SVD_EPS * tst1)
+			m++;
+
+		for (int iter = 0; m > l && iter < 30 && FLT_FABS(e[l]) > BC_SVD_EPS * tst1; iter++) {
+			FLT g = d[l];
+			FLT p = (d[l + 1] - g) / (2 * e[l]);
+			FLT r = FLT_SQRT(p * p + 1);
+			if (p < 0)
+				r = -r;
+			d[l] = e[l] / (p + r);
+			d[l + 1] = e[l] * (p + r);
+			FLT dl1 = d[l + 1];
+			FLT h = g - d[l];
+			for (int i = l + 2; i < n; i++)
+				d[i] -= h;
+			f += h;
+
+			p = d[m];
+			FLT c = 1, c2 = 1, c3 = 1, s = 0, s2 = 0;
+			FLT el1 = e[l + 1];
+			for (int i = m - 1; i >= l; i--) {
+				c3 = c2;
+				c2 = c;
+				s2 = s;
+				g = c * e[i];
+				h = c * p;
+				r = FLT_SQRT(p * p + e[i] * e[i]);
+				e[i + 1] = s * r;
+				s = e[i] / r;
+				c = p / r;
+				p = c * d[i] - s * g;
+				d[i + 1] = h + s * (c * g + s * d[i]);
+
+				for (int k = 0; k < n; k++) {
+					h = v[k][i + 1];
+					v[k][i + 1] = s * v[k][i] + c * h;
+					v[k][i] = c * v[k][i] - s * h;
+				}
+			}
+			p = -s * s2 * c3 * el1 * e[l] / dl1;
+			e[l] = s * p;
+			d[l] = c * p;
+		}
+		d[l] += f;
+		e[l] = 0;
+	}
+
+	// Sort descending; the eigenvectors go out transposed
+	int order[n];
+	for (int i = 0; i < n; i++)
+		order[i] = i;
+	for (int i = 1; i < n; i++) {
+		for (int j = i; j > 0 && d[order[j]] > d[order[j - 1]]; j--) {
+			int tmp = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = tmp;
 		}
 	}
+
+	FLT sorted[n];
+	for (int i = 0; i < n; i++) {
+		sorted[i] = d[order[i]];
+		for (int k = 0; k < n; k++)
+			ut[i * n + k] = v[k][order[i]];
+	}
+	memcpy(d, sorted, sizeof(sorted));
 }
 
 void bc_svd_compute_ccs(bc_svd *self, const FLT *betas, const FLT *ut) {
@@ -209,20 +410,90 @@ void bc_svd_compute_L_6x10(bc_svd *self, const FLT *ut, FLT *l_6x10) {
 	}
 }
 
-void find_betas_approx_1(const CvMat *L_6x10, const CvMat *Rho, FLT *betas) {
-	FLT l_6x4[6 * 4], b4[4];
-	CvMat L_6x4 = cvMat(6, 4, CV_FLT, l_6x4);
-	CvMat B4 = cvMat(4, 1, CV_FLT, b4);
+// The three beta approximations are each a least squares fit of a column subset of L_6x10 to rho; they share the normal
+// equations LtL / Ltrho, which are formed once.
+typedef struct {
+	FLT l_6x10[6 * 10], rho[6];
+	FLT ltl[10 * 10], ltrho[10];
+} bc_svd_betas_problem;
+
+static void bc_svd_betas_problem_init(bc_svd_betas_problem *problem) {
+	for (int i = 0; i < 10; i++) {
+		FLT sum = 0;
+		for (int k = 0; k < 6; k++)
+			sum += problem->l_6x10[10 * k + i] * problem->rho[k];
+		problem->ltrho[i] = sum;
+
+		for (int j = i; j < 10; j++) {
+			sum = 0;
+			for (int k = 0; k < 6; k++)
+				sum += problem->l_6x10[10 * k + i] * problem->l_6x10[10 * k + j];
+			problem->ltl[10 * i + j] = problem->ltl[10 * j + i] = sum;
+		}
+	}
+}
+
+void qr_solve(CvMat *A, CvMat *b, CvMat *X);
+
+static void bc_svd_betas_problem_solve(const bc_svd_betas_problem *problem, const int *cols, int n, FLT *b) {
+	// Cholesky on the shared normal equations...
+	FLT c[5 * 5], y[5];
+	assert(n <= 5);
+	bool ok = true;
+	for (int i = 0; i < n && ok; i++) {
+		for (int j = 0; j <= i; j++) {
+			FLT sum = problem->ltl[10 * cols[i] + cols[j]];
+			for (int k = 0; k < j; k++)
+				sum -= c[5 * i + k] * c[5 * j + k];
+
+			if (i != j) {
+				c[5 * i + j] = sum / c[5 * j + j];
+			} else if (sum > 1e3 * BC_SVD_EPS * problem->ltl[10 * cols[i] + cols[i]]) {
+				c[5 * i + i] = FLT_SQRT(sum);
+			} else {
+				ok = false;
+				break;
+			}
+		}
+	}
 
+	if (ok) {
+		for (int i = 0; i < n; i++) {
+			FLT sum = problem->ltrho[cols[i]];
+			for (int k = 0; k < i; k++)
+				sum -= c[5 * i + k] * y[k];
+			y[i] = sum / c[5 * i + i];
+		}
+		for (int i = n - 1; i >= 0; i--) {
+			FLT sum = y[i];
+			for (int k = i + 1; k < n; k++)
+				sum -= c[5 * k + i] * b[k];
+			b[i] = sum / c[5 * i + i];
+		}
+		return;
+	}
+
+	// ...unless the subset is too badly conditioned for that, in which case QR the columns themselves
+	FLT a[6 * 5], rho[6];
 	for (int i = 0; i < 6; i++) {
-		cvmSet(&L_6x4, i, 0, cvmGet(L_6x10, i, 0));
-		cvmSet(&L_6x4, i, 1, cvmGet(L_6x10, i, 1));
-		cvmSet(&L_6x4, i, 2, cvmGet(L_6x10, i, 3));
-		cvmSet(&L_6x4, i, 3, cvmGet(L_6x10, i, 6));
+		for (int j = 0; j < n; j++)
+			a[n * i + j] = problem->l_6x10[10 * i + cols[j]];
+		rho[i] = problem->rho[i];
 	}
+	CvMat A = cvMat(6, n, CV_FLT, a);
+	CvMat Rho = cvMat(6, 1, CV_FLT, rho);
+	CvMat B = cvMat(n, 1, CV_FLT, b);
+	memset(b, 0, sizeof(FLT) * n);
+	qr_solve(&A, &Rho, &B);
+}
 
-	cvSolve(&L_6x4, Rho, &B4, CV_SVD);
+// betas10        = [B11 B12 B22 B13 B23 B33 B14 B24 B34 B44]
+// betas_approx_1 = [B11 B12     B13         B14]
 
+static void find_betas_approx_1(const bc_svd_betas_problem *problem, FLT *betas) {
+	static const int cols[] = {0, 1, 3, 6};
+	FLT b4[4];
+	bc_svd_betas_problem_solve(problem, cols, 4, b4);
 
 	if (b4[0] < 0) {
 		betas[0] = sqrt(-b4[0]);
@@ -256,21 +527,12 @@ void compute_A_and_b_gauss_newton(const FLT *l_6x10, const FLT *rho, FLT betas[4
 }
 
 void qr_solve(CvMat *A, CvMat *b, CvMat *X) {
-	static int max_nr = 0;
-	static FLT *A1, *A2;
-
 	const int nr = A->rows;
 	const int nc = A->cols;
 
-	if (max_nr != 0 && max_nr < nr) {
-		free(A1);
-		free(A2);
-	}
-	if (max_nr < nr) {
-		max_nr = nr;
-		A1 = SV_MALLOC(sizeof(FLT) * nr);
-		A2 = SV_MALLOC(sizeof(FLT) * nr);
-	}
+	// Only ever called on the 6 row systems here
+	FLT A1[6] = {0}, A2[6] = {0};
+	assert(nr <= 6 && nc <= nr);
 
 	FLT *pA = CV_RAW_PTR(A), *ppAkk = pA;
 	for (int k = 0; k < nc; k++) {
@@ -347,7 +609,7 @@ void qr_solve(CvMat *A, CvMat *b, CvMat *X) {
 	}
 }
 
-void gauss_newton(const CvMat *L_6x10, const CvMat *Rho, FLT betas[4]) {
+static void gauss_newton(const bc_svd_betas_problem *problem, FLT betas[4]) {
 	const int iterations_number = 5;
 
 	FLT a[6 * 4], b[6], x[4];
@@ -356,7 +618,8 @@ void gauss_newton(const CvMat *L_6x10, const CvMat *Rho, FLT betas[4]) {
 	CvMat X = cvMat(4, 1, CV_FLT, x);
 
 	for (int k = 0; k < iterations_number; k++) {
-		compute_A_and_b_gauss_newton(CV_RAW_PTR(L_6x10), CV_RAW_PTR(Rho), betas, &A, &B);
+		memset(x, 0, sizeof(x));
+		compute_A_and_b_gauss_newton(problem->l_6x10, problem->rho, betas, &A, &B);
 		qr_solve(&A, &B, &X);
 
 		for (int i = 0; i < 4; i++)
@@ -364,18 +627,13 @@ void gauss_newton(const CvMat *L_6x10, const CvMat *Rho, FLT betas[4]) {
 	}
 }
 
-void find_betas_approx_2(const CvMat *L_6x10, const CvMat *Rho, FLT *betas) {
-	FLT l_6x3[6 * 3], b3[3];
-	CvMat L_6x3 = cvMat(6, 3, CV_FLT, l_6x3);
-	CvMat B3 = cvMat(3, 1, CV_FLT, b3);
-
-	for (int i = 0; i < 6; i++) {
-		cvmSet(&L_6x3, i, 0, cvmGet(L_6x10, i, 0));
-		cvmSet(&L_6x3, i, 1, cvmGet(L_6x10, i, 1));
-		cvmSet(&L_6x3, i, 2, cvmGet(L_6x10, i, 2));
-	}
+// betas10        = [B11 B12 B22 B13 B23 B33 B14 B24 B34 B44]
+// betas_approx_2 = [B11 B12 B22                            ]
 
-	cvSolve(&L_6x3, Rho, &B3, CV_SVD);
+static void find_betas_approx_2(const bc_svd_betas_problem *problem, FLT *betas) {
+	static const int cols[] = {0, 1, 2};
+	FLT b3[3];
+	bc_svd_betas_problem_solve(problem, cols, 3, b3);
 
 	if (b3[0] < 0) {
 		betas[0] = sqrt(-b3[0]);
@@ -395,20 +653,10 @@ void find_betas_approx_2(const CvMat *L_6x10, const CvMat *Rho, FLT *betas) {
 // betas10        = [B11 B12 B22 B13 B23 B33 B14 B24 B34 B44]
 // betas_approx_3 = [B11 B12 B22 B13 B23                    ]
 
-void bc_svd_find_betas_approx_3(bc_svd *self, const CvMat *L_6x10, const CvMat *Rho, FLT *betas) {
-	FLT l_6x5[6 * 5], b5[5];
-	CvMat L_6x5 = cvMat(6, 5, CV_FLT, l_6x5);
-	CvMat B5 = cvMat(5, 1, CV_FLT, b5);
-
-	for (int i = 0; i < 6; i++) {
-		cvmSet(&L_6x5, i, 0, cvmGet(L_6x10, i, 0));
-		cvmSet(&L_6x5, i, 1, cvmGet(L_6x10, i, 1));
-		cvmSet(&L_6x5, i, 2, cvmGet(L_6x10, i, 2));
-		cvmSet(&L_6x5, i, 3, cvmGet(L_6x10, i, 3));
-		cvmSet(&L_6x5, i, 4, cvmGet(L_6x10, i, 4));
-	}
-
-	cvSolve(&L_6x5, Rho, &B5, CV_SVD);
+static void find_betas_approx_3(const bc_svd_betas_problem *problem, FLT *betas) {
+	static const int cols[] = {0, 1, 2, 3, 4};
+	FLT b5[5];
+	bc_svd_betas_problem_solve(problem, cols, 5, b5);
 
 	if (b5[0] < 0) {
 		betas[0] = sqrt(-b5[0]);
@@ -431,68 +679,39 @@ void copy_R_and_t(const FLT R_src[3][3], const FLT t_src[3], FLT R_dst[3][3], FL
 	}
 }
 
-#define CREATE_STACK_MAT(name, rows, cols)                                                                             \
-	FLT *_##name = alloca(rows * cols * sizeof(FLT));                                                                  \
-	CvMat name = cvMat(rows, cols, SURVIVE_CV_F, _##name);
-
 FLT bc_svd_compute_pose(bc_svd *self, FLT R[3][3], FLT t[3]) {
-	CREATE_STACK_MAT(M, self->meas_cnt, 12);
-	bool colCovered[12] = { 0 };
-	bool has_axis[2] = {false, false};
-	for (int i = 0; i < self->meas_cnt; i++) {
-		size_t obj_pt_idx = self->meas[i].obj_idx;
-		const bc_svd_meas_t *meas = &self->meas[i];
-		bc_svd_fill_M(self, &M, i, self->setup.alphas[obj_pt_idx], meas->axis, meas->angle);
-		has_axis[meas->axis] = true;
-
-		FLT *_M = CV_RAW_PTR(&M) + i * 12;
-		for (int j = 0; j < 12; j++) {
-			assert(isfinite(_M[j]));
-			if (_M[j] != 0.0)
-				colCovered[j] = true;
-		}
-	}
-
 	// Gen2 can technically solve with just one axis but it's very very very noisey
-	if (has_axis[0] == false || has_axis[1] == false) {
+	if (self->has_axis[0] == false || self->has_axis[1] == false) {
 		return -1;
 	}
 
 	for (int j = 0; j < 12; j++) {
-		if (colCovered[j] == false)
+		if (self->col_covered[j] == false)
 			return -1;
 	}
 
 	FLT mtm[12 * 12], d[12], ut[12 * 12];
-	CvMat MtM = cvMat(12, 12, CV_FLT, mtm);
-	CvMat D = cvMat(12, 1, CV_FLT, d);
-	CvMat Ut = cvMat(12, 12, CV_FLT, ut);
-
-	cvMulTransposed(&M, &MtM, 1, 0, 1);
-
-	cvSVD(&MtM, &D, &Ut, 0, CV_SVD_MODIFY_A | CV_SVD_U_T);
-
-	FLT l_6x10[6 * 10], rho[6];
-	CvMat L_6x10 = cvMat(6, 10, CV_FLT, l_6x10);
-	CvMat Rho = cvMat(6, 1, CV_FLT, rho);
-
-	bc_svd_compute_L_6x10(self, ut, l_6x10);
+	memcpy(mtm, self->mtm, sizeof(mtm));
+	bc_svd_eigen_12x12(mtm, d, ut);
 
-	bc_svd_compute_rho(self, rho);
+	bc_svd_betas_problem problem;
+	bc_svd_compute_L_6x10(self, ut, problem.l_6x10);
+	bc_svd_compute_rho(self, problem.rho);
+	bc_svd_betas_problem_init(&problem);
 
 	FLT Betas[4][4] = {0}, rep_errors[3] = {0};
 	FLT Rs[4][3][3] = {0}, ts[4][3] = {0};
 
-	find_betas_approx_1(&L_6x10, &Rho, Betas[1]);
-	gauss_newton(&L_6x10, &Rho, Betas[1]);
+	find_betas_approx_1(&problem, Betas[1]);
+	gauss_newton(&problem, Betas[1]);
 	rep_errors[0] = bc_svd_compute_R_and_t(self, ut, Betas[1], Rs[1], ts[1]);
 
-	find_betas_approx_2(&L_6x10, &Rho, Betas[2]);
-	gauss_newton(&L_6x10, &Rho, Betas[2]);
+	find_betas_approx_2(&problem, Betas[2]);
+	gauss_newton(&problem, Betas[2]);
 	rep_errors[1] = bc_svd_compute_R_and_t(self, ut, Betas[2], Rs[2], ts[2]);
 
-	bc_svd_find_betas_approx_3(self, &L_6x10, &Rho, Betas[3]);
-	gauss_newton(&L_6x10, &Rho, Betas[3]);
+	find_betas_approx_3(&problem, Betas[3]);
+	gauss_newton(&problem, Betas[3]);
 	rep_errors[2] = bc_svd_compute_R_and_t(self, ut, Betas[3], Rs[3], ts[3]);
 
 	int N = 0;
@@ -517,9 +736,7 @@ static FLT bc_svd_reprojection_error(bc_svd *self, const FLT R[3][3], const FLT
 		FLT Yc = dot(R[1], pw) + t[1];
 		FLT Zc = dot(R[2], pw) + t[2];
 
-		FLT eq[3];
-
-		self->setup.fillFn(self->setup.user, eq, self->meas[i].axis, self->meas[i].angle);
+		const FLT *eq = self->meas[i].eq;
 		FLT rerr = eq[0] * Xc + eq[1] * Yc + eq[2] * Zc;
 		sum2 += rerr * rerr;
 	}
@@ -622,12 +839,6 @@ FLT bc_svd_compute_R_and_t(bc_svd *self, const FLT *ut, const FLT *betas, FLT R[
 	return bc_svd_reprojection_error(self, R, t);
 }
 
-// betas10        = [B11 B12 B22 B13 B23 B33 B14 B24 B34 B44]
-// betas_approx_1 = [B11 B12     B13         B14]
-
-// betas10        = [B11 B12 B22 B13 B23 B33 B14 B24 B34 B44]
-// betas_approx_2 = [B11 B12 B22                            ]
-
 void mat_to_quat(const FLT R[3][3], FLT q[4]) {
 	FLT tr = R[0][0] + R[1][1] + R[2][2];
 	FLT n4;
@@ -8,6 +8,7 @@
 #endif
 
 #include "../redist/linmath.h"
+#include "survive_types.h"
 
 typedef FLT LinmathPoint4d[4];
 
@@ -28,6 +29,8 @@ typedef struct {
 	int obj_idx;
 	int axis;
 	FLT angle;
+	// Plane equation from fillFn; kept so the reprojection error doesn't have to call it again
+	FLT eq[3];
 } bc_svd_meas_t;
 
 typedef struct {
@@ -36,18 +39,24 @@ typedef struct {
 	size_t meas_space, meas_cnt;
 	bc_svd_meas_t *meas; // [meas_cnt]
 
+	// Upper triangle of MtM, accumulated as correspondences are added so M itself is never formed
+	FLT mtm[12 * 12];
+	bool col_covered[12];
+	bool has_axis[2];
+
 	LinmathPoint3d *object_pts_in_camera; // [obj_cnt]
 	LinmathPoint3d control_points_in_camera[4];
 } bc_svd;
 
-void bc_svd_bc_svd(bc_svd *self, void *user, bc_svd_fill_M_fn fillFn, const LinmathPoint3d *obj_pts, size_t obj_cnt);
-void bc_svd_dtor(bc_svd *self);
+SURVIVE_EXPORT void bc_svd_bc_svd(bc_svd *self, void *user, bc_svd_fill_M_fn fillFn, const LinmathPoint3d *obj_pts,
+								  size_t obj_cnt);
+SURVIVE_EXPORT void bc_svd_dtor(bc_svd *self);
 
-void bc_svd_reset_correspondences(bc_svd *self);
-void bc_svd_add_single_correspondence(bc_svd *self, size_t idx, int axis, FLT u);
-void bc_svd_add_correspondence(bc_svd *self, size_t idx, FLT u, FLT v);
+SURVIVE_EXPORT void bc_svd_reset_correspondences(bc_svd *self);
+SURVIVE_EXPORT void bc_svd_add_single_correspondence(bc_svd *self, size_t idx, int axis, FLT u);
+SURVIVE_EXPORT void bc_svd_add_correspondence(bc_svd *self, size_t idx, FLT u, FLT v);
 
-FLT bc_svd_compute_pose(bc_svd *self, FLT R[3][3], FLT t[3]);
+SURVIVE_EXPORT FLT bc_svd_compute_pose(bc_svd *self, FLT R[3][3], FLT t[3]);
 void relative_error(FLT *rot_err, FLT *transl_err, const FLT Rtrue[3][3], const FLT ttrue[3], const FLT Rest[3][3],
 					const FLT test[3]);
 void bc_svd_print_pose(bc_svd *self, const FLT R[3][3], const FLT t[3]);
@@ -122,19 +122,16 @@ const LighthouseStateParameters LS_Params[LS_END + 1] = {
 
 static inline int LSParam_acode(enum LighthouseState s) { return LS_Params[s].acode; }
 
-static int LSParam_offset_for_state(enum LighthouseState s) {
-	static int offsets[LS_END + 1] = {-1};
-	if (offsets[0] == -1) {
-		int offset = 0;
-		for (int i = 0; i < LS_END + 1; i++) {
-			offsets[i] = offset;
-			offset += LS_Params[i].window;
-		}
-	}
-	return offsets[s];
-}
+// Start of each state within the cycle; filled in by build_state_tables
+static int LS_Offsets[LS_END + 1];
 
-static enum LighthouseState LighthouseState_findByOffset(int offset, int *error) {
+static inline int LSParam_offset_for_state(enum LighthouseState s) { return LS_Offsets[s]; }
+
+/**
+ * Reference classification of an offset into the cycle. This walks the state list, so it is only used to build the
+ * lookup table below and to check it.
+ */
+static enum LighthouseState LighthouseState_scanByOffset(int offset) {
 	for (int i = 2; i < LS_END + 1; i++) {
 		if (LSParam_offset_for_state(i) > offset) {
 			int offset_from_last = LSParam_offset_for_state(i - 1);
@@ -148,9 +145,6 @@ static enum LighthouseState LighthouseState_findByOffset(int offset, int *error)
 				this_is_closest = false;
 			}
 
-			if (error) {
-				*error = this_is_closest ? dist_from_this : dist_from_last;
-			}
 			return this_is_closest ? i : i - 1;
 		}
 	}
@@ -158,6 +152,77 @@ static enum LighthouseState LighthouseState_findByOffset(int offset, int *error)
 	return -1;
 }
 
+/**
+ * Offsets into the cycle are quantized into buckets of 2^CLASSIFY_SHIFT ticks. State boundaries are always more than
+ * a bucket apart, so each bucket holds at most one; it stores the state at its start, the state past the boundary and
+ * where in the bucket the boundary is. That makes classifying a pulse a shift, a load and a compare.
+ */
+#define CLASSIFY_SHIFT 10
+#define CLASSIFY_BUCKET (1 << CLASSIFY_SHIFT)
+#define CYCLE_LENGTH (PULSE_WINDOW * 8 + CAPTURE_WINDOW * 4)
+#define CLASSIFY_BUCKETS ((CYCLE_LENGTH + CLASSIFY_BUCKET - 1) >> CLASSIFY_SHIFT)
+
+typedef struct {
+	uint8_t state, next_state;
+	uint16_t split;
+} StateClassification;
+
+static StateClassification classify_table[CLASSIFY_BUCKETS];
+
+static void build_state_tables() {
+	static bool built = false;
+	if (built)
+		return;
+
+	int offset = 0;
+	for (int i = 0; i < LS_END + 1; i++) {
+		LS_Offsets[i] = offset;
+		offset += LS_Params[i].window;
+	}
+	assert(LS_Offsets[LS_END] == CYCLE_LENGTH);
+
+	for (int b = 0; b < CLASSIFY_BUCKETS; b++) {
+		int start = b << CLASSIFY_SHIFT;
+		int end = linmath_imin(start + CLASSIFY_BUCKET, CYCLE_LENGTH) - 1;
+		StateClassification *c = &classify_table[b];
+		c->state = c->next_state = LighthouseState_scanByOffset(start);
+		c->split = CLASSIFY_BUCKET;
+
+		// Binary search for the first offset past the boundary, if there is one
+		if (LighthouseState_scanByOffset(end) != c->state) {
+			int lo = start, hi = end;
+			while (lo + 1 < hi) {
+				int mid = (lo + hi) / 2;
+				if (LighthouseState_scanByOffset(mid) == c->state)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			c->next_state = LighthouseState_scanByOffset(hi);
+			c->split = hi - start;
+		}
+	}
+
+#ifndef NDEBUG
+	for (int offset = 0; offset < CYCLE_LENGTH; offset++) {
+		const StateClassification *c = &classify_table[offset >> CLASSIFY_SHIFT];
+		enum LighthouseState state = (offset & (CLASSIFY_BUCKET - 1)) < c->split ? c->state : c->next_state;
+		assert(state == LighthouseState_scanByOffset(offset));
+	}
+#endif
+	built = true;
+}
+
+static inline enum LighthouseState LighthouseState_findByOffset(int offset, int *error) {
+	assert(offset >= 0 && offset < CYCLE_LENGTH);
+	const StateClassification *c = &classify_table[offset >> CLASSIFY_SHIFT];
+	enum LighthouseState state = (offset & (CLASSIFY_BUCKET - 1)) < c->split ? c->state : c->next_state;
+	if (error) {
+		*error = abs(offset - LS_Offsets[state]);
+	}
+	return state;
+}
+
 typedef struct {
 	SurviveContext *ctx;
 
@@ -205,29 +270,12 @@ typedef struct {
 	LightcapElement sweep_data[];
 } Disambiguator_data_t;
 
-static int find_acode(uint32_t pulseLen) {
+// Sync pulses encode the acode in 500 tick steps starting at 2500 ticks
+static inline int find_acode(uint32_t pulseLen) {
 	const static int offset = 50;
-	if (pulseLen < 2500 + offset)
+	if (pulseLen < 2500 + offset || pulseLen >= 6500 + offset)
 		return -1;
-
-	if (pulseLen < 3000 + offset)
-		return 0;
-	if (pulseLen < 3500 + offset)
-		return 1;
-	if (pulseLen < 4000 + offset)
-		return 2;
-	if (pulseLen < 4500 + offset)
-		return 3;
-	if (pulseLen < 5000 + offset)
-		return 4;
-	if (pulseLen < 5500 + offset)
-		return 5;
-	if (pulseLen < 6000 + offset)
-		return 6;
-	if (pulseLen < 6500 + offset)
-		return 7;
-
-	return -1;
+	return (pulseLen - (2500 + offset)) / 500;
 }
 
 static int32_t overlap_area(const LightcapElement *a, const LightcapElement *b) {
@@ -331,14 +379,10 @@ static uint32_t calculate_error(int target_acode, const LightcapElement *le) {
 #define DEBUG_LOCK DEBUG_TB
 static uint32_t apply_mod_offset(uint32_t timestamp, uint32_t mod_offset, enum LighthouseState end_state) {
 	int mod_group = LSParam_offset_for_state(end_state);
-	if (timestamp > mod_offset)
+	// Unsigned subtraction also covers a mod_offset from _before_ a 32bit rollover
+	if (timestamp > mod_offset || mod_offset - timestamp > 0xFFFFFFFF / 2)
 		return (timestamp - mod_offset) % mod_group;
 
-	// Indicates mod_offset was from _before_ a 32bit rollover
-	if (mod_offset - timestamp > 0xFFFFFFFF / 2) {
-		return (0xFFFFFFFF - mod_offset + timestamp) % mod_group;
-	}
-
 	timestamp = timestamp % mod_group;
 	mod_offset = mod_offset % mod_group;
 
@@ -653,9 +697,8 @@ static void ProcessStateChange(Disambiguator_data_t *d, const LightcapElement *l
 			}
 		}
 		if (cnt > 0) {
-			FLT var = 3;
 			size_t minl = DIV_ROUND_CLOSEST(avg_length, cnt * 4);
-			size_t maxl = var * DIV_ROUND_CLOSEST(avg_length, cnt);
+			size_t maxl = 3 * DIV_ROUND_CLOSEST(avg_length, cnt);
 
 			for (int i = 0; i < d->so->sensor_ct; i++) {
 				const LightcapElement *le = &d->sweep_data[i];
@@ -740,42 +783,42 @@ static void PropagateState(Disambiguator_data_t *d, const LightcapElement *le) {
 	}
 }
 
-void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
+static void DestroyDisambiguator(SurviveObject *so) {
 	SurviveContext *ctx = so->ctx;
-
-	// Signal to destroy self
-	if (le == 0) {
-		Disambiguator_data_t *d = so->disambiguator_data;
-		if (d) {
-			SV_VERBOSE(5, "StateBased Disambiguator statistics:");
-			SV_VERBOSE(5, "\tsync_time_error         %u", d->stats.sync_time_error);
-			SV_VERBOSE(5, "\tconfidence_resets       %u", d->stats.confidence_resets);
-			SV_VERBOSE(5, "\tdrop_sweeps             %u", d->stats.drop_sweeps);
-			SV_VERBOSE(5, "\tsweep_hit_count         %u", d->stats.sweep_hit_count);
-			for (int i = 0; i < 2; i++) {
-				SV_VERBOSE(5, "\tsync_count[%d]           %u", i, d->stats.sync_count[i]);
-				SV_VERBOSE(5, "\tdrop_syncs[%d]           %u", i, d->stats.drop_syncs[i]);
-			}
+	Disambiguator_data_t *d = so->disambiguator_data;
+	if (d) {
+		SV_VERBOSE(5, "StateBased Disambiguator statistics:");
+		SV_VERBOSE(5, "\tsync_time_error         %u", d->stats.sync_time_error);
+		SV_VERBOSE(5, "\tconfidence_resets       %u", d->stats.confidence_resets);
+		SV_VERBOSE(5, "\tdrop_sweeps             %u", d->stats.drop_sweeps);
+		SV_VERBOSE(5, "\tsweep_hit_count         %u", d->stats.sweep_hit_count);
+		for (int i = 0; i < 2; i++) {
+			SV_VERBOSE(5, "\tsync_count[%d]           %u", i, d->stats.sync_count[i]);
+			SV_VERBOSE(5, "\tdrop_syncs[%d]           %u", i, d->stats.drop_syncs[i]);
 		}
-		free(ctx->disambiguator_data);
-		ctx->disambiguator_data = 0;
-
-		free(so->disambiguator_data);
-		so->disambiguator_data = 0;
-		return;
 	}
+	free(ctx->disambiguator_data);
+	ctx->disambiguator_data = 0;
 
+	free(so->disambiguator_data);
+	so->disambiguator_data = 0;
+}
+
+// Returns the disambiguator data for so, creating it on first use, or 0 if lightcaps should be ignored for now.
+static Disambiguator_data_t *GetDisambiguator(SurviveObject *so) {
+	SurviveContext *ctx = so->ctx;
 	if (ctx->state == SURVIVE_CLOSING) {
-		return;
+		return 0;
 	}
 
 	// Note, this happens if we don't have config yet -- just bail
 	if (so->sensor_ct == 0) {
-		return;
+		return 0;
 	}
 
 	if (so->ctx->disambiguator_data == NULL) {
 		DEBUG_TB("Initializing Global Disambiguator Data");
+		build_state_tables();
 		Global_Disambiguator_data_t *d = SV_CALLOC(1, sizeof(Global_Disambiguator_data_t));
 		d->ctx = ctx;
 		ctx->disambiguator_data = d;
@@ -788,7 +831,12 @@ void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
 		so->disambiguator_data = d;
 	}
 
-	Disambiguator_data_t *d = so->disambiguator_data;
+	return so->disambiguator_data;
+}
+
+static void ProcessLightcap(Disambiguator_data_t *d, const LightcapElement *le) {
+	SurviveObject *so = d->so;
+	SurviveContext *ctx = so->ctx;
 
 	// It seems like the first few hundred lightcapelements are missing a ton of data; let it stabilize.
 	if (d->stabalize < 200) {
@@ -836,4 +884,33 @@ void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
 	d->last_timestamp = le->timestamp;
 }
 
+void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
+	// Signal to destroy self
+	if (le == 0) {
+		DestroyDisambiguator(so);
+		return;
+	}
+
+	Disambiguator_data_t *d = GetDisambiguator(so);
+	if (d) {
+		ProcessLightcap(d, le);
+	}
+}
+
+/**
+ * Processes a whole decoded report at once; see handle_lightcaps. The per object checks and lookups are done once per
+ * report instead of once per pulse.
+ */
+void BatchDisambiguatorStateBased(SurviveObject *so, const LightcapElement *les, size_t cnt) {
+	Disambiguator_data_t *d = GetDisambiguator(so);
+	if (d == 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		ProcessLightcap(d, &les[i]);
+	}
+}
+
 REGISTER_LINKTIME(DisambiguatorStateBased)
+REGISTER_LINKTIME(BatchDisambiguatorStateBased)
@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <survive_arena.h>
 #include <survive_optimizer.h>
 #include <survive_reproject_gen2.h>
 
@@ -13,11 +14,15 @@ STATIC_CONFIG_ITEM(GSS_ENABLE, "globalscenesolver", 'i', "Enable global scene so
 #define GSS_NUM_STORED_SCENES 16
 #endif
 
+#define GSS_MAX_SCENE_MEAS (SENSORS_PER_OBJECT * 2 * NUM_GEN2_LIGHTHOUSES)
+
 typedef struct global_scene_solver {
 	struct SurviveContext *ctx;
 
 	size_t scenes_cnt;
 	struct PoserDataGlobalScene scenes[GSS_NUM_STORED_SCENES];
+	// Holds the measurement buffers of every stored scene
+	survive_arena meas_arena;
 
 	size_t last_capture_time_cnt;
 	survive_long_timecode *last_capture_time;
@@ -45,7 +50,6 @@ static size_t add_scenes(struct global_scene_solver *gss, SurviveObject *so) {
 	scene->so = so;
 	copy3d(scene->accel, activations->accel);
 	scene->meas_cnt = 0;
-	scene->meas = SV_REALLOC(scene->meas, 32 * 2 * ctx->activeLighthouses * sizeof(scene->meas[0]));
 
 	size_t lh_meas[NUM_GEN2_LIGHTHOUSES] = {0};
 	for (uint8_t lh = 0; lh < ctx->activeLighthouses; lh++) {
@@ -163,9 +167,7 @@ static int DriverRegGlobalSceneSolverPoll(struct SurviveContext *ctx, void *driv
 static int DriverRegGlobalSceneSolverClose(struct SurviveContext *ctx, void *driver) {
 	global_scene_solver *gss = (global_scene_solver *)driver;
 	free(gss->last_capture_time);
-	for (int i = 0; i < GSS_NUM_STORED_SCENES; i++) {
-		free(gss->scenes[i].meas);
-	}
+	survive_arena_free(&gss->meas_arena);
 	free(driver);
 	return 0;
 }
@@ -202,6 +204,12 @@ global_scene_solver *global_scene_solver_init(global_scene_solver *driver, Survi
 	driver->last_capture_time_cnt = 0;
 	driver->last_capture_time = SV_CALLOC(driver->last_capture_time_cnt, sizeof(survive_long_timecode) * 4);
 
+	size_t meas_size = GSS_MAX_SCENE_MEAS * sizeof(PoserDataGlobalSceneMeasurement);
+	survive_arena_init(&driver->meas_arena, GSS_NUM_STORED_SCENES * meas_size);
+	for (int i = 0; i < GSS_NUM_STORED_SCENES; i++) {
+		driver->scenes[i].meas = survive_arena_alloc(&driver->meas_arena, meas_size);
+	}
+
 	return driver;
 }
 
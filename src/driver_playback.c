@@ -4,6 +4,7 @@
 #include "os_generic.h"
 #include "survive.h"
 
+#include "survive_clock.h"
 #include "survive_recording.h"
 #include "survive_internal.h"
 
@@ -13,10 +14,19 @@
 
 STATIC_CONFIG_ITEM(PLAYBACK_REPLAY_POSE, "playback-replay-pose", 'i', "Whether or not to output pose", 0)
 STATIC_CONFIG_ITEM(PLAYBACK, "playback", 's', "File to be used for playback if playing a recording.", 0)
+STATIC_CONFIG_ITEM(PLAYBACK_MERGE, "playback-merge", 's',
+				   "Comma separated recordings to merge into the playback by timestamp, e.g. from other hosts", "")
+STATIC_CONFIG_ITEM(PLAYBACK_MERGE_OFFSETS, "playback-merge-offsets", 's',
+				   "Comma separated seconds added to the timestamps of each playback-merge recording", "")
 STATIC_CONFIG_ITEM(PLAYBACK_FACTOR, "playback-factor", 'f',
 				   "Time factor of playback -- 1 is run at the same timing as original, 0 is run as fast as possible.",
 				   1.0f)
 STATIC_CONFIG_ITEM(PLAYBACK_TIME, "playback-time", 'f', "End time of playback", -1.0f)
+STATIC_CONFIG_ITEM(PLAYBACK_START, "playback-start", 'f', "Start time of playback", 0.)
+STATIC_CONFIG_ITEM(PLAYBACK_PREROLL, "playback-preroll", 'f',
+				   "Seconds before playback-start that are replayed as fast as possible to warm up tracking", 5.)
+STATIC_CONFIG_ITEM(PLAYBACK_INDEX_INTERVAL, "playback-index-interval", 'f',
+				   "Seconds between the checkpoints playback-start can seek to", 1.)
 
 STATIC_CONFIG_ITEM(PLAYBACK_RUN_TIME, "run-time", 'f', "How long to run for", -1.)
 
@@ -37,18 +47,63 @@ ssize_t gzgetdelim(char **RESTRICT_KEYWORD lineptr, size_t *RESTRICT_KEYWORD n,
 				   gzFile RESTRICT_KEYWORD stream);
 ssize_t gzgetline(char **RESTRICT_KEYWORD lineptr, size_t *RESTRICT_KEYWORD n, gzFile RESTRICT_KEYWORD stream);
 
+// Where in the uncompressed recording a given time starts, and the state that was current there
+typedef struct PlaybackCheckpoint {
+	double time;
+	z_off_t offset;
+	int lineno;
+
+	uint32_t lh_pose_set;
+	SurvivePose lh_poses[NUM_GEN2_LIGHTHOUSES];
+} PlaybackCheckpoint;
+
+#define MAX_PLAYBACK_RENAMES 16
+
+// One recording feeding the playback
+typedef struct PlaybackSource {
+	char *path;
+	gzFile file;
+	// Added to every timestamp in the file to line its clock up with the main recording
+	double offset;
+	int lineno;
+	char *line;
+	size_t line_size;
+
+	// Time of the next message, which has been read up to its device name
+	double next_time_s;
+
+	// Devices whose names were already taken by another recording
+	struct {
+		char from[8], to[8];
+	} renames[MAX_PLAYBACK_RENAMES];
+	size_t renames_cnt;
+
+	PlaybackCheckpoint *checkpoints;
+	size_t checkpoints_cnt;
+
+	// Raw light and sweeps supersede the derived light and sweep angles recorded next to them
+	bool hasRawLight;
+	bool hasSweepAngle;
+} PlaybackSource;
+
 typedef struct SurvivePlaybackData {
     SurviveContext *ctx;
-    const char *playback_dir;
-    gzFile playback_file;
-    int lineno;
+    const char *blacklist;
+
+	PlaybackSource *sources;
+	size_t sources_cnt;
+	// Min-heap on next_time_s of the sources that still have messages left
+	PlaybackSource **heap;
+	size_t heap_cnt;
+	// Source of the message being run
+	PlaybackSource *source;
 
-    double next_time_s;
     double time_now;
     FLT playback_factor;
 	FLT playback_time;
-	bool hasRawLight;
-    bool hasSweepAngle;
+	FLT playback_start;
+	bool prerolling;
+
     bool outputExternalPose;
 
     uint32_t total_sleep_time;
@@ -56,20 +111,27 @@ typedef struct SurvivePlaybackData {
     og_thread_t playback_thread;
 } SurvivePlaybackData;
 
-static double survive_playback_run_time(const SurviveContext *ctx, void *_sp) {
-	const struct SurvivePlaybackData *sp = _sp;
-	return sp->time_now;
-}
 
+static const char *playback_device_name(const PlaybackSource *source, const char *dev) {
+	for (size_t i = 0; i < source->renames_cnt; i++) {
+		if (strcmp(source->renames[i].from, dev) == 0)
+			return source->renames[i].to;
+	}
+	return dev;
+}
 
 static SurviveObject *find_or_warn(SurvivePlaybackData *driver, const char *dev) {
 	SurviveContext *ctx = driver->ctx;
+	dev = playback_device_name(driver->source, dev);
 	SurviveObject *so = survive_get_so_by_name(driver->ctx, dev);
+	if (!so && strstr(driver->blacklist, dev)) {
+		return 0;
+	}
 	if (!so) {
 		static bool display_once = false;
 		SurviveContext *ctx = driver->ctx;
 		if (display_once == false) {
-			SV_WARN("Could not find device named %s from lineno %d\r\n", dev, driver->lineno);
+			SV_WARN("Could not find device named %s from lineno %d\r\n", dev, driver->source->lineno);
 		}
 		display_once = true;
 
@@ -98,7 +160,7 @@ static int parse_and_run_sweep(char *line, SurvivePlaybackData *driver) {
 		return 0;
 	}
 
-	driver->hasSweepAngle = true;
+	driver->source->hasSweepAngle = true;
 	driver->ctx->sweepproc(so, channel, sensor_id, timecode, flag);
 	return 0;
 }
@@ -189,7 +251,7 @@ static int parse_and_run_imu(const char *line, SurvivePlaybackData *driver, bool
 		id = accelgyro[6];
 		accelgyro[6] = 0;
 	} else if (rr != 14) {
-		SV_WARN("On line %d, only %d values read: '%s'", driver->lineno, rr, line);
+		SV_WARN("On line %d, only %d values read: '%s'", driver->source->lineno, rr, line);
 		return -1;
 	}
 
@@ -201,18 +263,22 @@ static int parse_and_run_imu(const char *line, SurvivePlaybackData *driver, bool
 	return 0;
 }
 
+static void run_lhpose(struct SurvivePlaybackData *driver, int lh, const SurvivePose *pose) {
+	SurviveContext *ctx = driver->ctx;
+	if (driver->outputExternalPose) {
+		char buffer[32] = {0};
+		snprintf(buffer, 31, "previous_LH%d", lh);
+		ctx->external_poseproc(ctx, buffer, pose);
+	}
+}
+
 static int parse_and_run_lhpose(const char *line, struct SurvivePlaybackData *driver) {
 	SurvivePose pose;
 	int lh = -1;
 	int rr = sscanf(line, "%d LH_POSE " SurvivePose_sformat "\n", &lh, &pose.Pos[0], &pose.Pos[1], &pose.Pos[2],
 					&pose.Rot[0], &pose.Rot[1], &pose.Rot[2], &pose.Rot[3]);
 
-	SurviveContext *ctx = driver->ctx;
-	if (driver->outputExternalPose) {
-		char buffer[32] = {0};
-		snprintf(buffer, 31, "previous_LH%d", lh);
-		ctx->external_poseproc(ctx, buffer, &pose);
-	}
+	run_lhpose(driver, lh, &pose);
 	return 0;
 }
 
@@ -229,7 +295,7 @@ static int parse_and_run_externalpose(const char *line, SurvivePlaybackData *dri
 }
 
 static int parse_and_run_rawlight(const char *line, SurvivePlaybackData *driver) {
-	driver->hasRawLight = 1;
+	driver->source->hasRawLight = 1;
 
 	char dev[10];
 	char op[10];
@@ -258,7 +324,7 @@ static int parse_and_run_lightcode(const char *line, SurvivePlaybackData *driver
 					&length, &lh);
 
 	if (rr != 9) {
-		SV_WARN("Warning:  On line %d, only %d values read: '%s'\n", driver->lineno, rr, line);
+		SV_WARN("Warning:  On line %d, only %d values read: '%s'\n", driver->source->lineno, rr, line);
 		return -1;
 	}
 
@@ -270,146 +336,189 @@ static int parse_and_run_lightcode(const char *line, SurvivePlaybackData *driver
 
 
 
-static int playback_pump_msg(struct SurviveContext *ctx, void *_driver) {
-	SurvivePlaybackData *driver = _driver;
-	gzFile f = driver->playback_file;
-
-	if (f && !gzeof(f) && !gzerror_dropin(f)) {
-		driver->lineno++;
-		char *line = 0;
-
-		if (driver->next_time_s == 0) {
-			size_t n = 0;
-			ssize_t r = gzgetdelim(&line, &n, ' ', f);
-			if (r <= 0) {
-				free(line);
-				return 0;
-			}
-
-			if (sscanf(line, "%lf", &driver->next_time_s) != 1) {
-				free(line);
-				return 0;
-			}
-
-			if(!isfinite(driver->next_time_s)) {
-				driver->next_time_s = 0;
-			}
-			free(line);
-			line = 0;
-		}
-
-		if (driver->next_time_s * driver->playback_factor > OGRelativeTime())
-			return 0;
-
-		driver->time_now = driver->next_time_s;
-		driver->next_time_s = 0;
+static bool playback_source_before(const PlaybackSource *a, const PlaybackSource *b) {
+	if (a->next_time_s != b->next_time_s)
+		return a->next_time_s < b->next_time_s;
+	// Ties go to the recording given first so the merge order is deterministic
+	return a < b;
+}
 
-		size_t n = 0;
-		ssize_t r = gzgetline(&line, &n, f);
+static void playback_heap_sift_down(SurvivePlaybackData *driver, size_t i) {
+	PlaybackSource **heap = driver->heap;
+	while (true) {
+		size_t first = i, left = 2 * i + 1, right = 2 * i + 2;
+		if (left < driver->heap_cnt && playback_source_before(heap[left], heap[first]))
+			first = left;
+		if (right < driver->heap_cnt && playback_source_before(heap[right], heap[first]))
+			first = right;
+		if (first == i)
+			return;
+
+		PlaybackSource *tmp = heap[i];
+		heap[i] = heap[first];
+		heap[first] = tmp;
+		i = first;
+	}
+}
 
+// Reads the time of the next message in the source; false once the file is done
+static bool playback_source_read_time(PlaybackSource *source) {
+	gzFile f = source->file;
+	while (f && !gzeof(f) && !gzerror_dropin(f)) {
+		ssize_t r = gzgetdelim(&source->line, &source->line_size, ' ', f);
 		if (r <= 0) {
-			free(line);
-			return 0;
-		}
-		while (r && (line[r - 1] == '\n' || line[r - 1] == '\r')) {
-			line[--r] = 0;
-		}
-		char dev[32];
-		char op[32];
-		if (sscanf(line, "%31s %31s", dev, op) < 2) {
-			free(line);
-			return 0;
+			return false;
 		}
 
-		if (strcmp(dev, "OPTION") == 0) {
-			free(line);
-			return 0;
+		double time;
+		if (sscanf(source->line, "%lf", &time) == 1) {
+			// Messages without a usable time play back right after the one before them
+			if (isfinite(time))
+				source->next_time_s = time + source->offset;
+			return true;
 		}
+	}
+	return false;
+}
 
-		survive_get_ctx_lock(ctx);
-		switch (op[0]) {
-		case 'W':
-			if (op[1] == 0)
-				parse_and_run_sweep(line, driver);
-			break;
-		case 'B':
-			if (op[1] == 0 && driver->hasSweepAngle == false)
-				parse_and_run_sweep_angle(line, driver);
-			break;
-		case 'Y':
-			if (op[1] == 0)
-				parse_and_run_sync(line, driver);
-			break;
-		case 'E':
-			if (strcmp(op, "EXTERNAL_POSE") == 0) {
-				parse_and_run_externalpose(line, driver);
-				break;
-			}
-		case 'C':
-			if (op[1] == 0)
-				parse_and_run_rawlight(line, driver);
-			break;
-		case 'L':
-			if (strcmp(op, "LH_POSE") == 0) {
-				parse_and_run_lhpose(line, driver);
-				break;
-			}
-		case 'R':
-			if (op[1] == 0 && driver->hasRawLight == false)
-				parse_and_run_lightcode(line, driver);
-			break;
-		case 'i':
-			if (op[1] == 0)
-				parse_and_run_imu(line, driver, true);
-			break;
-		case 'I':
-			if (op[1] == 0)
-				parse_and_run_imu(line, driver, false);
-			break;
-		case 'P':
-			if (strcmp(op, "POSE") == 0 && driver->outputExternalPose)
-				parse_and_run_pose(line, driver);
+static void playback_run_line(struct SurviveContext *ctx, SurvivePlaybackData *driver, char *line, ssize_t r) {
+	while (r && (line[r - 1] == '\n' || line[r - 1] == '\r')) {
+		line[--r] = 0;
+	}
+	char dev[32];
+	char op[32];
+	if (sscanf(line, "%31s %31s", dev, op) < 2) {
+		return;
+	}
+
+	if (strcmp(dev, "OPTION") == 0) {
+		return;
+	}
+
+	survive_get_ctx_lock(ctx);
+	switch (op[0]) {
+	case 'W':
+		if (op[1] == 0)
+			parse_and_run_sweep(line, driver);
+		break;
+	case 'B':
+		if (op[1] == 0 && driver->source->hasSweepAngle == false)
+			parse_and_run_sweep_angle(line, driver);
+		break;
+	case 'Y':
+		if (op[1] == 0)
+			parse_and_run_sync(line, driver);
+		break;
+	case 'E':
+		if (strcmp(op, "EXTERNAL_POSE") == 0) {
+			parse_and_run_externalpose(line, driver);
 			break;
-		case 'A':
-		case 'V':
+		}
+	case 'C':
+		if (op[1] == 0)
+			parse_and_run_rawlight(line, driver);
+		break;
+	case 'L':
+		if (strcmp(op, "LH_POSE") == 0) {
+			parse_and_run_lhpose(line, driver);
 			break;
-		default:
-			SV_WARN("Playback doesn't understand '%s' op in '%s'", op, line);
 		}
-		survive_release_ctx_lock(ctx);
+	case 'R':
+		if (op[1] == 0 && driver->source->hasRawLight == false)
+			parse_and_run_lightcode(line, driver);
+		break;
+	case 'i':
+		if (op[1] == 0)
+			parse_and_run_imu(line, driver, true);
+		break;
+	case 'I':
+		if (op[1] == 0)
+			parse_and_run_imu(line, driver, false);
+		break;
+	case 'P':
+		if (strcmp(op, "POSE") == 0 && driver->outputExternalPose)
+			parse_and_run_pose(line, driver);
+		break;
+	case 'A':
+	case 'V':
+		break;
+	default:
+		SV_WARN("Playback doesn't understand '%s' op in '%s'", op, line);
+	}
+	survive_release_ctx_lock(ctx);
+}
 
-		free(line);
-	} else {
+static double playback_next_time(const SurvivePlaybackData *driver) {
+	return driver->heap_cnt ? driver->heap[0]->next_time_s : 0;
+}
+
+static int playback_pump_msg(struct SurviveContext *ctx, void *_driver) {
+	SurvivePlaybackData *driver = _driver;
+	if (driver->heap_cnt == 0) {
 		SV_VERBOSE(100, "EOF for playback received.");
-		if (f) {
-			gzclose(driver->playback_file);
-		}
-		driver->playback_file = 0;
 		return -1;
 	}
 
+	PlaybackSource *source = driver->heap[0];
+	if (driver->prerolling && source->next_time_s >= driver->playback_start) {
+		// Pacing starts here, from playback-start rather than the last prerolled message; everything before it only
+		// warmed up tracking
+		driver->prerolling = false;
+		survive_clock_advance(ctx, driver->playback_start);
+		survive_clock_set_factor(ctx, driver->playback_factor);
+	}
+
+	if (!driver->prerolling && survive_clock_wait_time(ctx, source->next_time_s) > 0)
+		return 0;
+
+	driver->time_now = source->next_time_s;
+	survive_clock_advance(ctx, driver->time_now);
+
+	// The line buffer is kept across messages so steady state playback never touches the allocator
+	source->lineno++;
+	ssize_t r = gzgetline(&source->line, &source->line_size, source->file);
+	if (r > 0) {
+		driver->source = source;
+		playback_run_line(ctx, driver, source->line, r);
+	}
+
+	// Only the source that was just read can have moved in the merge order
+	if (playback_source_read_time(source)) {
+		playback_heap_sift_down(driver, 0);
+	} else {
+		SV_VERBOSE(100, "EOF for playback of %s received.", source->path);
+		gzclose(source->file);
+		source->file = 0;
+		driver->heap[0] = driver->heap[--driver->heap_cnt];
+		playback_heap_sift_down(driver, 0);
+	}
+
 	return 0;
 }
 
 static void *playback_thread(void *_driver) {
 	SurvivePlaybackData *driver = _driver;
+	FLT playback_factor = driver->playback_factor;
 	while (driver->keepRunning) {
-		double next_time_s_scaled = driver->next_time_s * driver->playback_factor;
-		double time_now = OGRelativeTime();
 		if (driver->playback_time >= 0 && driver->time_now > driver->playback_time) {
 			driver->keepRunning = false;
 			return 0;
 		}
-		if (next_time_s_scaled == 0 || next_time_s_scaled < time_now) {
-			int rtnVal = playback_pump_msg(driver->ctx, driver);
-			if (rtnVal < 0)
-				driver->keepRunning = false;
-		} else {
-			int sleep_time_ms = 1 + (next_time_s_scaled - time_now) * 1000.;
-			int sr = OGUSleep(sleep_time_ms * 1000);
-			if (sr == 0)
-				driver->total_sleep_time += sleep_time_ms;
+
+		// playback-factor can be changed while running
+		if (playback_factor != driver->playback_factor) {
+			playback_factor = driver->playback_factor;
+			survive_clock_set_factor(driver->ctx, playback_factor);
 		}
+
+		// With a virtual clock this never sleeps
+		double next_time_s = playback_next_time(driver);
+		if (next_time_s != 0 && !driver->prerolling)
+			driver->total_sleep_time += survive_clock_wait_until(driver->ctx, next_time_s) / 1000;
+
+		int rtnVal = playback_pump_msg(driver->ctx, driver);
+		if (rtnVal < 0)
+			driver->keepRunning = false;
 	}
 	return 0;
 }
@@ -429,118 +538,338 @@ static int playback_close(struct SurviveContext *ctx, void *_driver) {
 	OGJoinThread(driver->playback_thread);
 	survive_get_ctx_lock(ctx);
 	SV_VERBOSE(50, "Playback thread slept for %" PRIu32 "ms", driver->total_sleep_time);
-	SV_VERBOSE(10, "Playback thread played back %6.2fs in %6.2fs real-time", driver->time_now, OGRelativeTime());
-	if (driver->playback_file)
-		gzclose(driver->playback_file);
-	driver->playback_file = 0;
+	SV_VERBOSE(10, "Playback thread played back %6.2fs in %6.2fs real-time", driver->time_now,
+			   survive_clock_real_time(ctx));
+	for (size_t i = 0; i < driver->sources_cnt; i++) {
+		PlaybackSource *source = &driver->sources[i];
+		if (source->file)
+			gzclose(source->file);
+		free(source->checkpoints);
+		free(source->line);
+		free(source->path);
+	}
 
 	survive_detach_config(ctx, "playback-factor", &driver->playback_factor);
 	survive_detach_config(ctx, "playback-time", &driver->playback_time);
-	survive_install_run_time_fn(ctx, 0, 0);
+	survive_clock_detach_source(ctx);
+	free(driver->sources);
+	free(driver->heap);
 	free(driver);
 	return 0;
 }
 
-int DriverRegPlayback(SurviveContext *ctx) {
-	const char *playback_file = survive_configs(ctx, "playback", SC_GET, 0);
+static void playback_add_checkpoint(PlaybackSource *source, const PlaybackCheckpoint *checkpoint) {
+	source->checkpoints =
+		SV_REALLOC(source->checkpoints, (source->checkpoints_cnt + 1) * sizeof(PlaybackCheckpoint));
+	source->checkpoints[source->checkpoints_cnt++] = *checkpoint;
+}
 
-	if (playback_file == 0 || strlen(playback_file) == 0) {
-		SV_WARN("The playback argument requires a filename");
-		return -1;
+// A CONFIG line from the scan; devices are only created once every name the recording uses is known
+typedef struct PlaybackConfig {
+	char dev[32];
+	// Null for blacklisted devices
+	char *config;
+	size_t len;
+} PlaybackConfig;
+
+static bool playback_configs_use_name(const PlaybackConfig *configs, size_t configs_cnt, const char *name) {
+	for (size_t i = 0; i < configs_cnt; i++) {
+		if (strcmp(configs[i].dev, name) == 0)
+			return true;
 	}
+	return false;
+}
 
-	if (strstr(playback_file, ".pcap")) {
-		int (*usb_driver)(SurviveContext *) = (int (*)(SurviveContext *))GetDriver("DriverRegUSBMon_Playback");
-		if (usb_driver) {
-			return usb_driver(ctx);
+/*
+ * Recordings from different hosts can use the same device names, e.g. for the first tracker on each. A name that
+ * another recording already took keeps its prefix and gets the first free last character instead. Names the
+ * recording uses itself are never free, or two of its devices would end up sharing one.
+ */
+static const char *playback_claim_device_name(SurvivePlaybackData *sp, PlaybackSource *source,
+											  const PlaybackConfig *configs, size_t configs_cnt, const char *dev) {
+	SurviveContext *ctx = sp->ctx;
+	const char *renamed = playback_device_name(source, dev);
+	SurviveObject *existing = survive_get_so_by_name(ctx, renamed);
+	if (renamed != dev || existing == 0 || existing->driver == source)
+		return renamed;
+
+	size_t len = strlen(dev);
+	if (len == 0 || len >= sizeof(existing->codename) || source->renames_cnt >= MAX_PLAYBACK_RENAMES)
+		return 0;
+
+	static const char suffixes[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	char *to = source->renames[source->renames_cnt].to;
+	strcpy(to, dev);
+	for (const char *c = suffixes; *c; c++) {
+		to[len - 1] = *c;
+		if (survive_get_so_by_name(ctx, to) == 0 && !playback_configs_use_name(configs, configs_cnt, to)) {
+			strcpy(source->renames[source->renames_cnt++].from, dev);
+			SV_INFO("Device %s from %s is played back as %s", dev, source->path, to);
+			return to;
 		}
-		SV_WARN("Playback file %s is a USB packet capture, but the usbmon playback driver does not exist.",
-				playback_file);
-		return -1;
 	}
+	return 0;
+}
 
-	SurvivePlaybackData *sp = SV_CALLOC(1, sizeof(SurvivePlaybackData));
-	sp->ctx = ctx;
-	sp->playback_dir = playback_file;
+static void playback_create_devices(SurvivePlaybackData *sp, PlaybackSource *source, PlaybackConfig *configs,
+									size_t configs_cnt) {
+	SurviveContext *ctx = sp->ctx;
+	for (size_t i = 0; i < configs_cnt; i++) {
+		const char *dev = configs[i].dev;
+		if (configs[i].config == 0) {
+			SV_INFO("Skipping blacklisted device %s in playback file", dev);
+			continue;
+		}
 
-	sp->outputExternalPose = survive_configi(ctx, "playback-replay-pose", SC_GET, 0);
+		const char *name = playback_claim_device_name(sp, source, configs, configs_cnt, dev);
+		if (name == 0) {
+			SV_WARN("Skipping %s from %s; its name is taken and there is no free one to rename it to", dev,
+					source->path);
+			free(configs[i].config);
+			continue;
+		}
 
-	sp->playback_file = gzopen(playback_file, "r");
-	if (sp->playback_file == 0) {
-		SV_ERROR(SURVIVE_ERROR_INVALID_CONFIG, "Could not open playback events file %s", playback_file);
-		return -1;
+		SurviveObject *so = survive_create_device(ctx, "replay", source, name, 0);
+		if (ctx->configproc(so, configs[i].config, configs[i].len) == 0) {
+			SV_INFO("Found %s in playback file...", name);
+			survive_add_object(ctx, so);
+		} else {
+			SV_WARN("Found %s in playback file, but could not read config description", name);
+			free(so);
+		}
 	}
-	survive_install_run_time_fn(ctx, survive_playback_run_time, sp);
-	survive_attach_configf(ctx, "playback-factor", &sp->playback_factor);
-	survive_attach_configf(ctx, "playback-time", &sp->playback_time);
-
-	SV_INFO("Using playback file '%s' with timefactor of %f until %f", playback_file, sp->playback_factor,
-			sp->playback_time);
-
-	ctx->poll_min_time_ms = 1;
-	if (sp->playback_factor == 0.0)
-		ctx->poll_min_time_ms = 0;
-
-	FLT time;
-	while (!gzeof(sp->playback_file) && !gzerror_dropin(sp->playback_file)) {
-		char *line = 0;
-		size_t n;
-		int r = gzgetline(&line, &n, sp->playback_file);
+}
 
+/*
+ * Reads the recording from the start up to scan_until. Every device with a CONFIG line on the way is created, and a
+ * checkpoint is indexed every playback-index-interval seconds so playback_seek can land there with the right context.
+ */
+static int playback_scan(SurvivePlaybackData *sp, PlaybackSource *source, double scan_until) {
+	SurviveContext *ctx = sp->ctx;
+	FLT interval = survive_configf(ctx, PLAYBACK_INDEX_INTERVAL_TAG, SC_GET, 1.);
+	if (interval <= 0)
+		interval = 1;
+
+	PlaybackCheckpoint current = {0};
+	double next_checkpoint = 0;
+	PlaybackConfig *configs = 0;
+	size_t configs_cnt = 0;
+	int lineno = 0;
+	char *line = 0;
+	size_t n = 0;
+
+	while (!gzeof(source->file) && !gzerror_dropin(source->file)) {
+		z_off_t offset = gztell(source->file);
+		int r = gzgetline(&line, &n, source->file);
 		if (r <= 0) {
-			free(line);
 			continue;
 		}
 
 		if (line[0] == 0x1f) {
 			SV_ERROR(SURVIVE_ERROR_INVALID_CONFIG, "Attempting to playback a gz compressed file without gz support.");
 			free(line);
+			free(configs);
 			return -1;
 		}
 
+		FLT time;
 		char dev[32];
 		char command[32];
 
-		if (sscanf(line, FLT_sformat " %s %s", &time, dev, command) != 3) {
-			free(line);
+		if (sscanf(line, FLT_sformat " %31s %31s", &time, dev, command) != 3) {
 			break;
 		}
 
-		// 60 seconds is enough time for all configurations; don't read the whole file -- could be huge
-		if (time > 60) {
-			free(line);
+		if (time > scan_until) {
 			break;
 		}
 
-		if (strcmp(command, "CONFIG") == 0) {
-			char *configStart = line;
+		if (isfinite(time) && time >= next_checkpoint) {
+			current.time = time;
+			current.offset = offset;
+			current.lineno = lineno;
+			playback_add_checkpoint(source, &current);
+			next_checkpoint = (floor(time / interval) + 1) * interval;
+		}
+		lineno++;
 
-			// Skip three spaces
-			for (int i = 0; i < 3; i++) {
-				while (*(++configStart) != ' ')
-					;
+		if (strcmp(command, "CONFIG") == 0) {
+			configs = SV_REALLOC(configs, (configs_cnt + 1) * sizeof(PlaybackConfig));
+			PlaybackConfig *config = &configs[configs_cnt++];
+			memset(config, 0, sizeof(*config));
+			strcpy(config->dev, dev);
+
+			if (!strstr(sp->blacklist, dev)) {
+				char *configStart = line;
+
+				// Skip three spaces
+				for (int i = 0; i < 3; i++) {
+					while (*(++configStart) != ' ')
+						;
+				}
+				config->len = strlen(configStart);
+				config->config = SV_CALLOC(1, config->len + 1);
+				memcpy(config->config, configStart, config->len);
+			}
+		} else if (strcmp(command, "LH_POSE") == 0) {
+			int lh = atoi(dev);
+			if (lh >= 0 && lh < NUM_GEN2_LIGHTHOUSES) {
+				SurvivePose *pose = &current.lh_poses[lh];
+				if (sscanf(line, FLT_sformat " %*d LH_POSE " SurvivePose_sformat, &time, &pose->Pos[0], &pose->Pos[1],
+						   &pose->Pos[2], &pose->Rot[0], &pose->Rot[1], &pose->Rot[2], &pose->Rot[3]) == 8)
+					current.lh_pose_set |= 1u << lh;
 			}
-			size_t len = strlen(configStart);
+		}
+	}
+
+	playback_create_devices(sp, source, configs, configs_cnt);
+	free(configs);
+	free(line);
+	return 0;
+}
+
+static void playback_seek(SurvivePlaybackData *sp, PlaybackSource *source, double time) {
+	SurviveContext *ctx = sp->ctx;
+
+	// Last checkpoint at or before time
+	size_t lo = 0, hi = source->checkpoints_cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (source->checkpoints[mid].time <= time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-			SurviveObject *so = survive_create_device(ctx, "replay", sp, dev, 0);
+	if (lo == 0) {
+		gzseek(source->file, 0, SEEK_SET);
+		return;
+	}
 
-			char *config = SV_CALLOC(1, len + 1);
-			memcpy(config, configStart, len);
+	// gzip has no random access, so this inflates up to the offset again; that is still far cheaper than replaying
+	const PlaybackCheckpoint *checkpoint = &source->checkpoints[lo - 1];
+	gzseek(source->file, checkpoint->offset, SEEK_SET);
+	source->lineno = checkpoint->lineno;
+	SV_INFO("Seeking playback of %s to %.3fs, line %d", source->path, checkpoint->time, checkpoint->lineno);
 
-			if (ctx->configproc(so, config, len) == 0) {
-				SV_INFO("Found %s in playback file...", dev);
-				survive_add_object(ctx, so);
-			} else {
-				SV_WARN("Found %s in playback file, but could not read config description", dev);
-				free(so);
-			}
+	for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+		if (checkpoint->lh_pose_set & (1u << lh))
+			run_lhpose(sp, lh, &checkpoint->lh_poses[lh]);
+	}
+}
+
+static int playback_add_source(SurvivePlaybackData *sp, const char *path, double offset) {
+	SurviveContext *ctx = sp->ctx;
+	PlaybackSource *source = &sp->sources[sp->sources_cnt++];
+	source->path = strdup(path);
+	source->offset = offset;
+
+	source->file = gzopen(path, "r");
+	if (source->file == 0) {
+		SV_ERROR(SURVIVE_ERROR_INVALID_CONFIG, "Could not open playback events file %s", path);
+		return -1;
+	}
+
+	// 60 seconds is enough time for all configurations; don't read the whole file -- could be huge. A seek needs
+	// everything up to where it lands though.
+	double start = sp->playback_start - offset;
+	if (playback_scan(sp, source, linmath_max(60, start)) < 0)
+		return -1;
+
+	if (sp->playback_start > 0) {
+		playback_seek(sp, source, start - survive_configf(ctx, PLAYBACK_PREROLL_TAG, SC_GET, 5.));
+	} else {
+		gzseek(source->file, 0, SEEK_SET); // same as rewind(f);
+	}
+
+	if (playback_source_read_time(source))
+		sp->heap[sp->heap_cnt++] = source;
+	return 0;
+}
+
+int DriverRegPlayback(SurviveContext *ctx) {
+	const char *playback_file = survive_configs(ctx, "playback", SC_GET, 0);
+
+	if (playback_file == 0 || strlen(playback_file) == 0) {
+		SV_WARN("The playback argument requires a filename");
+		return -1;
+	}
+
+	const char *merge = survive_configs(ctx, PLAYBACK_MERGE_TAG, SC_GET, "");
+	if (strstr(merge, ".pcap")) {
+		SV_WARN("USB packet captures can't be merged into a playback; replay them with --usbmon-playback and --record "
+				"first");
+		return -1;
+	}
+
+	if (strstr(playback_file, ".pcap")) {
+		int (*usb_driver)(SurviveContext *) = (int (*)(SurviveContext *))GetDriver("DriverRegUSBMon_Playback");
+		if (usb_driver) {
+			return usb_driver(ctx);
+		}
+		SV_WARN("Playback file %s is a USB packet capture, but the usbmon playback driver does not exist.",
+				playback_file);
+		return -1;
+	}
+
+	SurvivePlaybackData *sp = SV_CALLOC(1, sizeof(SurvivePlaybackData));
+	sp->ctx = ctx;
+	sp->blacklist = survive_configs(ctx, "blacklist-devs", SC_GET, "-");
+
+	sp->outputExternalPose = survive_configi(ctx, "playback-replay-pose", SC_GET, 0);
+	sp->playback_start = survive_configf(ctx, PLAYBACK_START_TAG, SC_GET, 0.);
+
+	size_t sources_cnt = 1;
+	for (const char *c = merge; *c; c++)
+		sources_cnt += *c == ',';
+	sp->sources = SV_CALLOC(sources_cnt + 1, sizeof(PlaybackSource));
+	sp->heap = SV_CALLOC(sources_cnt + 1, sizeof(PlaybackSource *));
+
+	if (playback_add_source(sp, playback_file, 0) < 0)
+		return -1;
+
+	// Merged recordings are shifted onto the timeline of the main one by their offsets
+	const char *merge_offsets = survive_configs(ctx, PLAYBACK_MERGE_OFFSETS_TAG, SC_GET, "");
+	while (*merge) {
+		size_t len = strcspn(merge, ",");
+		char *end;
+		double offset = strtod(merge_offsets, &end);
+		merge_offsets = *end == ',' ? end + 1 : end;
+
+		if (len > 0) {
+			char *path = SV_CALLOC(1, len + 1);
+			memcpy(path, merge, len);
+			SV_INFO("Merging playback file '%s' offset by %fs", path, offset);
+			int rtn = playback_add_source(sp, path, offset);
+			free(path);
+			if (rtn < 0)
+				return -1;
 		}
 
-		free(line);
+		merge += len;
+		if (*merge == ',')
+			merge++;
 	}
 
-	gzseek(sp->playback_file, 0, SEEK_SET); // same as rewind(f);
+	for (size_t i = sp->heap_cnt / 2; i-- > 0;)
+		playback_heap_sift_down(sp, i);
+
+	survive_attach_configf(ctx, "playback-factor", &sp->playback_factor);
+	survive_clock_attach_source(ctx, sp->playback_factor);
+	survive_attach_configf(ctx, "playback-time", &sp->playback_time);
+
+	SV_INFO("Using playback file '%s' with timefactor of %f until %f", playback_file, sp->playback_factor,
+			sp->playback_time);
+
+	ctx->poll_min_time_ms = 1;
+
+	if (sp->playback_start > 0) {
+		sp->prerolling = true;
+		survive_clock_advance(ctx, playback_next_time(sp));
+	}
 
+	// Pacing starts with the first message, not with the config scan above
+	survive_clock_set_factor(ctx, sp->playback_factor);
 	sp->keepRunning = true;
 	sp->playback_thread = OGCreateThread(playback_thread, "playback", sp);
 
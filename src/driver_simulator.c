@@ -5,6 +5,7 @@
 #include "os_generic.h"
 #include "survive_config.h"
 #include "survive_default_devices.h"
+#include "survive_clock.h"
 #include "survive_reproject_gen2.h"
 #include "survive_str.h"
 #include <assert.h>
@@ -20,6 +21,8 @@
 
 STATIC_CONFIG_ITEM(Simulator_DRIVER_ENABLE, "simulator", 'i', "Load a Simulator driver for testing.", 0)
 STATIC_CONFIG_ITEM(Simulator_TIME, "simulator-time", 'f', "Seconds to run simulator for.", 0.0)
+STATIC_CONFIG_ITEM(Simulator_TIME_FACTOR, "time-factor", 'f',
+				   "Wall seconds per simulated second; 0 runs the simulation as fast as possible", 1.)
 STATIC_CONFIG_ITEM(Simulator_OBJ_RADIUS, "simulator-obj-radius", 'f', "Radius of the simulated object", 0.05)
 STATIC_CONFIG_ITEM(Simulator_SHOW_GT_DEVICE, "simulator-show-gt", 'i',
 				   "0: No GT device, 1: Show GT device, 2: Only GT device", 1)
@@ -82,13 +85,6 @@ struct SurviveDriverSimulator {
 };
 typedef struct SurviveDriverSimulator SurviveDriverSimulator;
 
-static double timestamp_in_s() {
-	static double start_time_s = 0;
-	if (start_time_s == 0.)
-		start_time_s = OGGetAbsoluteTime();
-	return OGGetAbsoluteTime() - start_time_s;
-}
-
 static FLT lighthouse_lasttime_of_angle(SurviveDriverSimulator *driver, int lh, FLT timestamp, FLT angle) {
 	SurviveDriverSimulatorLHState *lhs = &driver->lhstates[lh];
 	return timestamp - fmod(timestamp - lhs->start_time, lhs->period_s) + angle / (2 * LINMATHPI) * lhs->period_s;
@@ -381,23 +377,17 @@ static void apply_initial_velocity(SurviveDriverSimulator *sp) {
 
 static int Simulator_poll(struct SurviveContext *ctx, void *_driver) {
 	SurviveDriverSimulator *driver = _driver;
-	static FLT last_time = 0;
-	FLT realtime = timestamp_in_s();
-	
-	FLT timefactor = linmath_max(survive_configf(ctx, "time-factor", SC_GET, 1.), .00001);
-	// FLT timestamp = timestamp_in_s() / timefactor;
 	FLT timestep = .0001;
-
-	while (last_time != 0 && last_time + timefactor * timestep > realtime) {
+	FLT timestamp = driver->current_timestamp + timestep;
+	if (survive_clock_wait_time(ctx, timestamp) > 0) {
 		survive_release_ctx_lock(ctx);
-		OGUSleep((timefactor * timestep + realtime - last_time) * 1e6);
+		survive_clock_wait_until(ctx, timestamp);
 		survive_get_ctx_lock(ctx);
-		realtime = timestamp_in_s();
 	}
-	last_time = realtime;
 
 	bool wasIniting = driver->current_timestamp < driver->init_time;
-	FLT timestamp = (driver->current_timestamp += timestep);
+	driver->current_timestamp = timestamp;
+	survive_clock_advance(ctx, timestamp);
 	FLT time_between_imu = 1. / driver->so->imu_freq;
 	FLT time_between_pulses = 0.00833333333;
 	FLT time_between_gt = time_between_imu;
@@ -437,7 +427,7 @@ static int Simulator_poll(struct SurviveContext *ctx, void *_driver) {
 
 	FLT time = survive_configf(ctx, "simulator-time", SC_GET, 0);
 	if (timestamp - driver->timestart > time && time > 0) {
-		SV_INFO("Simulation finished after %f seconds", realtime);
+		SV_INFO("Simulation finished after %f seconds", survive_clock_real_time(ctx));
 		return 1;
 	}
 
@@ -531,6 +521,7 @@ static int simulator_close(struct SurviveContext *ctx, void *_driver) {
 	SV_VERBOSE(5, "\tError         " Point7_format, LINMATH_VEC7_EXPAND(var));
 	SV_VERBOSE(5, "\tTracker bias  " Point3_format, LINMATH_VEC3_EXPAND(driver->gyro_bias));
 
+	survive_clock_detach_source(ctx);
 	return 0;
 }
 
@@ -646,7 +637,7 @@ int DriverRegSimulator(SurviveContext *ctx) {
 
 	srand(42);
 
-	FLT freq_per_channel[NUM_GEN2_LIGHTHOUSES] = {
+	FLT freq_per_channel[NUM_GEN2_CHANNELS] = {
 		50.0521, 50.1567, 50.3673, 50.5796, 50.6864, 50.9014, 51.0096, 51.1182,
 		51.2273, 51.6685, 52.2307, 52.6894, 52.9217, 53.2741, 53.7514, 54.1150,
 	};
@@ -661,7 +652,7 @@ int DriverRegSimulator(SurviveContext *ctx) {
 
 		sp->lhstates[i].start_time = (rand() / (FLT)RAND_MAX);
 
-		assert(ctx->bsd[i].mode < NUM_GEN2_LIGHTHOUSES);
+		assert(ctx->bsd[i].mode < NUM_GEN2_CHANNELS);
 
 		sp->lhstates[i].period_s = 1. / freq_per_channel[ctx->bsd[i].mode];
 	}
@@ -675,7 +666,7 @@ int DriverRegSimulator(SurviveContext *ctx) {
 								.ogeemag = .25};
 
 	if (ctx->activeLighthouses == 0) {
-		for (int i = 0; i < sizeof(simulated_bsd) / sizeof(simulated_bsd[0]); i++) {
+		for (int i = 0; i < sizeof(simulated_bsd) / sizeof(simulated_bsd[0]) && i < NUM_GEN2_LIGHTHOUSES; i++) {
 			ctx->bsd[i] = simulated_bsd[i];
 
 			for (int axis = 0; axis < 2; axis++) {
@@ -718,6 +709,7 @@ int DriverRegSimulator(SurviveContext *ctx) {
 
 	sp->pose_fn = survive_install_imupose_fn(ctx, simulation_compare);
 	sp->lh_fn = survive_install_lighthouse_pose_fn(ctx, simulation_lh_compare);
+	survive_clock_attach_source(ctx, survive_configf(ctx, Simulator_TIME_FACTOR_TAG, SC_GET, 1.));
 	survive_add_driver(ctx, sp, Simulator_poll, simulator_close);
 	return 0;
 }
@@ -4,6 +4,7 @@
 
 #include "errno.h"
 #include "os_generic.h"
+#include "survive_clock.h"
 #include "survive_config.h"
 #include "survive_default_devices.h"
 
@@ -23,6 +24,10 @@
 
 STATIC_CONFIG_ITEM(USBMON_RECORD, "usbmon-record", 's', "File to save .pcap to.", 0)
 STATIC_CONFIG_ITEM(USBMON_PLAYBACK, "usbmon-playback", 's', "File to replay .pcap from.", 0)
+STATIC_CONFIG_ITEM(USBMON_PLAYBACK_INDEX, "usbmon-playback-index", 'i',
+				   "Decompress and index the whole .pcap in memory before replaying it", 1)
+STATIC_CONFIG_ITEM(USBMON_PLAYBACK_START, "usbmon-playback-start", 'f',
+				   "Seconds into the .pcap to start replaying from; requires usbmon-playback-index", 0.)
 STATIC_CONFIG_ITEM(USBMON_RECORD_ALL, "usbmon-record-all", 'i', "Whether or not to record all usb traffic", 0)
 STATIC_CONFIG_ITEM(USBMON_OUTPUT_EVERYTHING, "usbmon-output-all", 'i', "Whether or not to log all usb traffic", 0)
 STATIC_CONFIG_ITEM(USBMON_OUTPUT, "usbmon-output", 'i', "Whether or not to log any generic usb traffic", 0)
@@ -72,13 +77,38 @@ struct vive_device_t devices[] = {{.vid = 0x28de, .pid = 0x2000, .codename = "HM
 
 static const int DEVICES_CNT = sizeof(devices) / sizeof(vive_device_t);
 
+typedef pcap_usb_header_mmapped usb_header_t;
+
+typedef struct usbmon_packet {
+	struct pcap_pkthdr hdr;
+	// Offset of the usb header into usbmon_packet_index::data
+	size_t offset;
+	double time;
+	// Traffic on the control endpoint; this is what carries device configuration
+	bool is_control;
+} usbmon_packet;
+
+// Every packet of a playback, decompressed once and kept in one buffer so replay never touches zlib or libpcap
+typedef struct usbmon_packet_index {
+	uint8_t *data;
+	size_t data_size, data_capacity;
+
+	usbmon_packet *packets;
+	size_t packets_cnt, packets_capacity;
+} usbmon_packet_index;
+
 typedef struct SurviveDriverUSBMon {
 	SurviveContext *ctx;
 	pcap_t *pcap;
 	double playback_factor;
+	double playback_start;
+	double start_time;
 	double time_now;
 	double run_time;
 
+	usbmon_packet_index index;
+	bool seeking;
+
 	pcap_dumper_t *pcapDumper;
 	bool record_all;
 	bool record_only;
@@ -205,13 +235,6 @@ static void ingest_config_request(vive_device_inst_t *dev, const struct _usb_hea
 	}
 }
 
-static double timestamp_in_s() {
-	static double start_time_s = 0;
-	if (start_time_s == 0.)
-		start_time_s = OGGetAbsoluteTime();
-	return OGGetAbsoluteTime() - start_time_s;
-}
-
 static int usbmon_close(struct SurviveContext *ctx, void *_driver) {
 	SurviveDriverUSBMon *driver = _driver;
 
@@ -220,7 +243,7 @@ static int usbmon_close(struct SurviveContext *ctx, void *_driver) {
 
 	SV_INFO("usbmon saw %u/%u packets, %u dropped, %u dropped in driver in %.2f seconds (%.2fs runtime)",
 			(uint32_t)driver->packet_cnt, stats.ps_recv, stats.ps_drop, stats.ps_ifdrop, driver->time_now,
-			timestamp_in_s());
+			survive_clock_real_time(ctx));
 	if (driver->pcapDumper) {
 		pcap_dump_close(driver->pcapDumper);
 	}
@@ -230,7 +253,10 @@ static int usbmon_close(struct SurviveContext *ctx, void *_driver) {
 		vive_device_inst_t *dev = &driver->usb_devices[i];
 		free(dev->usbInfo);
 	}
-	survive_install_run_time_fn(ctx, 0, 0);
+	free(driver->index.data);
+	free(driver->index.packets);
+	if (driver->playback_factor >= 0)
+		survive_clock_detach_source(ctx);
 	free(driver);
 	return 0;
 }
@@ -433,195 +459,192 @@ const char *requestTypeToStr(uint8_t requestType) {
 	return "<unknown>";
 }
 
-static double survive_usbmon_playback_run_time(const SurviveContext *ctx, void *_driver) {
-	SurviveDriverUSBMon *driver = _driver;
-	return driver->time_now;
-}
-
-void *pcap_thread_fn(void *_driver) {
-	SurviveDriverUSBMon *driver = _driver;
+static void usbmon_process_packet(SurviveDriverUSBMon *driver, const struct pcap_pkthdr *pkthdr,
+								  const usb_header_t *usbp) {
 	struct SurviveContext *ctx = driver->ctx;
-	typedef pcap_usb_header_mmapped usb_header_t;
+	vive_device_inst_t *dev = find_device_inst(driver, usbp->bus_id, usbp->device_address);
 
-	struct pcap_pkthdr *pkthdr = 0;
-	const usb_header_t *usbp = 0;
+	// Packet data is directly after the packet header
+	uint8_t *pktData = (uint8_t *)&usbp[1];
+	if (driver->pcapDumper && (dev || driver->record_all) && !driver->seeking) {
+		pcap_dump((uint8_t *)driver->pcapDumper, pkthdr, (uint8_t *)usbp);
+	}
 
-	SV_INFO("Pcap thread started");
-	double start_time = 0;
-	double real_time_start = timestamp_in_s();
-	while ((driver->keepRunning == 0 || *driver->keepRunning) && ctx->currentError == SURVIVE_OK) {
-		int result = pcap_next_ex(driver->pcap, &pkthdr, (const uint8_t **)&usbp);
-		switch (result) {
-		case 0:
-			goto continue_loop;
-		case 1: {
-			// if (usbp = (usb_header_t *)pcap_next(driver->pcap, &pkthdr)) {
-			vive_device_inst_t *dev = find_device_inst(driver, usbp->bus_id, usbp->device_address);
-
-			// Packet data is directly after the packet header
-			uint8_t *pktData = (uint8_t *)&usbp[1];
-			if (driver->pcapDumper && (dev || driver->record_all)) {
-				pcap_dump((uint8_t *)driver->pcapDumper, pkthdr, (uint8_t *)usbp);
-			}
+	if (dev) {
+		driver->packet_cnt++;
+		const char *dev_name = dev->device->codename;
+		if (dev->so)
+			dev_name = dev->so->codename;
 
-			if (dev) {
-				driver->packet_cnt++;
-				const char *dev_name = dev->device->codename;
-				if (dev->so)
-					dev_name = dev->so->codename;
+		if (driver->start_time == 0) {
+			driver->start_time = make_time(0, usbp);
+		}
+		// Only a replay is the clock source; live captures and virtual time never wait here, and neither does the
+		// control traffic replayed ahead of a seek
+		double this_time = make_time(driver->start_time, usbp);
+		if (!driver->seeking)
+			survive_clock_wait_until(ctx, this_time);
+
+		while (survive_input_event_count(ctx) > 0) {
+			OGUSleep(1000);
+		}
 
-				if (start_time == 0) {
-					start_time = make_time(0, usbp);
-				}
-				double this_real_time = timestamp_in_s();
-				double this_time = make_time(start_time, usbp);
-				if (driver->playback_factor > 0.) {
-					double next_time_s_scaled = this_time * driver->playback_factor;
-					while (this_real_time < next_time_s_scaled) {
-						int sleep_time_ms = 1 + (next_time_s_scaled - this_real_time) * 1000.;
-						OGUSleep(sleep_time_ms * 1000);
-						this_real_time = timestamp_in_s();
-					}
-				}
+		driver->time_now = this_time;
+		if (driver->playback_factor >= 0)
+			survive_clock_advance(ctx, this_time);
+		if (this_time > driver->run_time && driver->run_time > 0)
+			*driver->keepRunning = false;
 
-				while (survive_input_event_count(ctx) > 0) {
-					OGUSleep(1000);
-				}
+		// Print setup flags, then just bail
+		if (!usbp->setup_flag) {
+			if (is_config_start(usbp)) {
+				dev->last_config_id = 0;
+				dev->compressed_data_idx = 0;
+				SV_VERBOSE(200, "%s start of config", dev_name);
+			} else if (is_config_request(usbp)) {
+				dev->last_config_id = usbp->id;
+			} else if (is_command_setup(usbp)) {
+				SV_INFO("%s sent command 0x%02x with %u bytes:", dev_name, pktData[1], pktData[2]);
+				survive_dump_buffer(ctx, pktData + 3, pktData[2]);
+			}
+			if (driver->output_usb_stream) {
+				ctx->printfproc(
+					ctx,
+					"--> %10.6f S: %s 0x%016lx event_type: %c transfer_type: %d bmRequestType: 0x%02x "
+					"bRequest: 0x%02x (%s) "
+					"wValue: 0x%04x wIndex: 0x%04x wLength: %4d\n",
+					this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type,
+					usbp->s.setup.bmRequestType, usbp->s.setup.bRequest,
+					requestTypeToStr(usbp->s.setup.bRequest), usbp->s.setup.wValue, usbp->s.setup.wIndex,
+					usbp->s.setup.wLength);
+
+				survive_dump_buffer(ctx, pktData, usbp->data_len);
+			}
 
-				driver->time_now = this_time;
-				if (this_time > driver->run_time && driver->run_time > 0)
-					*driver->keepRunning = false;
-
-				// Print setup flags, then just bail
-				if (!usbp->setup_flag) {
-					if (is_config_start(usbp)) {
-						dev->last_config_id = 0;
-						dev->compressed_data_idx = 0;
-						SV_VERBOSE(200, "%s start of config", dev_name);
-					} else if (is_config_request(usbp)) {
-						dev->last_config_id = usbp->id;
-					} else if (is_command_setup(usbp)) {
-						SV_INFO("%s sent command 0x%02x with %u bytes:", dev_name, pktData[1], pktData[2]);
-						survive_dump_buffer(ctx, pktData + 3, pktData[2]);
-					}
-					if (driver->output_usb_stream) {
-						ctx->printfproc(
-							ctx,
-							"--> %10.6f S: %s 0x%016lx event_type: %c transfer_type: %d bmRequestType: 0x%02x "
-							"bRequest: 0x%02x (%s) "
-							"wValue: 0x%04x wIndex: 0x%04x wLength: %4d\n",
-							this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type,
-							usbp->s.setup.bmRequestType, usbp->s.setup.bRequest,
-							requestTypeToStr(usbp->s.setup.bRequest), usbp->s.setup.wValue, usbp->s.setup.wIndex,
-							usbp->s.setup.wLength);
-
-						survive_dump_buffer(ctx, pktData, usbp->data_len);
-					}
+			if (dev->so) {
+				survive_data_on_setup_write(dev->so, usbp->s.setup.bmRequestType, usbp->s.setup.bRequest,
+											usbp->s.setup.wValue, usbp->s.setup.wIndex, pktData,
+											usbp->data_len);
+			}
+			return;
+		}
 
-					if (dev->so) {
-						survive_data_on_setup_write(dev->so, usbp->s.setup.bmRequestType, usbp->s.setup.bRequest,
-													usbp->s.setup.wValue, usbp->s.setup.wIndex, pktData,
-													usbp->data_len);
-					}
-					goto continue_loop;
-				}
+		if (!(usbp->endpoint_number & 0x80u)) {
 
-				if (!(usbp->endpoint_number & 0x80u)) {
-
-					if (driver->output_usb_stream) {
-						if (usbp->event_type == 'C') {
-							ctx->printfproc(
-								ctx, "<-- %10.6f C: %s 0x%016lx event_type: %c transfer_type: %d 0x%02x (0x%02x):\n",
-								this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type,
-								usbp->endpoint_number, usbp->data_len);
-						} else {
-							ctx->printfproc(
-								ctx, "--> %10.6f W: %s 0x%016lx event_type: %c transfer_type: %d 0x%02x (0x%02x):\n",
-								this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type,
-								usbp->endpoint_number, usbp->data_len);
-						}
-						survive_dump_buffer(ctx, pktData, usbp->data_len);
-					}
-					goto continue_loop; // Only want incoming data
+			if (driver->output_usb_stream) {
+				if (usbp->event_type == 'C') {
+					ctx->printfproc(
+						ctx, "<-- %10.6f C: %s 0x%016lx event_type: %c transfer_type: %d 0x%02x (0x%02x):\n",
+						this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type,
+						usbp->endpoint_number, usbp->data_len);
+				} else {
+					ctx->printfproc(
+						ctx, "--> %10.6f W: %s 0x%016lx event_type: %c transfer_type: %d 0x%02x (0x%02x):\n",
+						this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type,
+						usbp->endpoint_number, usbp->data_len);
 				}
+				survive_dump_buffer(ctx, pktData, usbp->data_len);
+			}
+			return; // Only want incoming data
+		}
 
-				if (usbp->status != 0) {
-					// EINPROGRESS is normal, EPIPE means stalled
-					if (driver->output_usb_stream) {
-						if ((usbp->status != -115 && usbp->status != -32) || driver->output_everything)
-							ctx->printfproc(
-								ctx, "<-- %10.6f E: %s 0x%016lx event_type: %c transfer_type: %d status: %d\n",
-								this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type, usbp->status);
-					}
-					if (usbp->id == dev->last_config_id) {
-						dev->last_config_id = 0;
-					}
-					goto continue_loop; // Only want responses
-				}
+		if (usbp->status != 0) {
+			// EINPROGRESS is normal, EPIPE means stalled
+			if (driver->output_usb_stream) {
+				if ((usbp->status != -115 && usbp->status != -32) || driver->output_everything)
+					ctx->printfproc(
+						ctx, "<-- %10.6f E: %s 0x%016lx event_type: %c transfer_type: %d status: %d\n",
+						this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type, usbp->status);
+			}
+			if (usbp->id == dev->last_config_id) {
+				dev->last_config_id = 0;
+			}
+			return; // Only want responses
+		}
 
-				int interface = interface_lookup(dev, usbp->endpoint_number);
+		int interface = interface_lookup(dev, usbp->endpoint_number);
 
-				bool output_read = driver->output_usb_stream &&
-								   (interface == 0 || driver->output_everything || interface == USB_IF_TRACKER_INFO) &&
-								   interface != USB_IF_W_WATCHMAN1_IMU && interface != USB_IF_TRACKER1_IMU &&
-								   interface != USB_IF_TRACKER0_IMU;
+		bool output_read = driver->output_usb_stream &&
+						   (interface == 0 || driver->output_everything || interface == USB_IF_TRACKER_INFO) &&
+						   interface != USB_IF_W_WATCHMAN1_IMU && interface != USB_IF_TRACKER1_IMU &&
+						   interface != USB_IF_TRACKER0_IMU;
 
-				if (output_read) {
-					ctx->printfproc(
-						ctx,
-						"<-- %10.6f R: %s 0x%016lx event_type: %c transfer_type: %d endpoint: 0x%02x (%s) (0x%02x): \n",
-						this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type, usbp->endpoint_number,
-						survive_usb_interface_str(interface), usbp->data_len);
+		if (output_read) {
+			ctx->printfproc(
+				ctx,
+				"<-- %10.6f R: %s 0x%016lx event_type: %c transfer_type: %d endpoint: 0x%02x (%s) (0x%02x): \n",
+				this_time, dev_name, usbp->id, usbp->event_type, usbp->transfer_type, usbp->endpoint_number,
+				survive_usb_interface_str(interface), usbp->data_len);
 
-					survive_dump_buffer(ctx, pktData, usbp->data_len);
-				}
+			survive_dump_buffer(ctx, pktData, usbp->data_len);
+		}
 
-				if (usbp->id == dev->last_config_id && usbp->event_type == 'C' && dev->hasConfiged == false) {
-					ingest_config_request(dev, usbp, pktData);
-					dev->last_config_id = 0;
-					dev->packets_without_config = 0;
-					goto continue_loop;
-				}
+		if (usbp->id == dev->last_config_id && usbp->event_type == 'C' && dev->hasConfiged == false) {
+			ingest_config_request(dev, usbp, pktData);
+			dev->last_config_id = 0;
+			dev->packets_without_config = 0;
+			return;
+		}
 
-				bool forward_to_data_cb = driver->record_only == false &&
-										  (interface != 0 && (dev->hasConfiged || interface == USB_IF_TRACKER_INFO)) &&
-										  dev->so != 0;
-
-				if (forward_to_data_cb) {
-					SurviveUSBInterface si = {.ctx = ctx,
-											  .actual_len = pkthdr->len,
-											  .assoc_obj = dev->so,
-											  .which_interface_am_i = interface,
-											  .hname = dev->so->codename};
-
-					// memcpy(si.buffer, (u_char*)&usbp[1], usbp->data);
-					si.actual_len = usbp->data_len;
-					memset(si.buffer, 0xCA, sizeof(si.buffer));
-					memcpy(si.buffer, pktData, usbp->data_len);
-
-					survive_data_cb(&si);
-				} else if (!dev->hasConfiged) {
-					if (driver->allow_fs_read && dev->packets_without_config++ > 1000 &&
-						dev->tried_config_file == false) {
-						for (int i = 0; i < 2 && !dev->hasConfiged; i++) {
-							char filename[128] = {0};
-							snprintf(filename, sizeof(filename), "%s_config.json",
-									 i == 0 ? dev->serial : (uint8_t *)dev_name);
-							int res = survive_load_htc_config_format_from_file(dev->so, filename);
-							SV_VERBOSE(50,
-									   "Too long without config packet for %s; trying to read config from file %s: %d",
-									   dev_name, filename, res);
-							if (res == 0) {
-								dev->hasConfiged = true;
-							}
-							dev->tried_config_file = true;
-						}
+		bool forward_to_data_cb = driver->record_only == false && driver->seeking == false &&
+								  (interface != 0 && (dev->hasConfiged || interface == USB_IF_TRACKER_INFO)) &&
+								  dev->so != 0;
+
+		if (forward_to_data_cb) {
+			SurviveUSBInterface si = {.ctx = ctx,
+									  .actual_len = pkthdr->len,
+									  .assoc_obj = dev->so,
+									  .which_interface_am_i = interface,
+									  .hname = dev->so->codename};
+
+			// memcpy(si.buffer, (u_char*)&usbp[1], usbp->data);
+			si.actual_len = usbp->data_len;
+			memset(si.buffer, 0xCA, sizeof(si.buffer));
+			memcpy(si.buffer, pktData, usbp->data_len);
+
+			survive_data_cb(&si);
+		} else if (!dev->hasConfiged) {
+			if (driver->allow_fs_read && dev->packets_without_config++ > 1000 &&
+				dev->tried_config_file == false) {
+				for (int i = 0; i < 2 && !dev->hasConfiged; i++) {
+					char filename[128] = {0};
+					snprintf(filename, sizeof(filename), "%s_config.json",
+							 i == 0 ? dev->serial : (uint8_t *)dev_name);
+					int res = survive_load_htc_config_format_from_file(dev->so, filename);
+					SV_VERBOSE(50,
+							   "Too long without config packet for %s; trying to read config from file %s: %d",
+							   dev_name, filename, res);
+					if (res == 0) {
+						dev->hasConfiged = true;
 					}
+					dev->tried_config_file = true;
 				}
 			}
+		}
+	}
 
+}
+
+static bool usbmon_keep_running(const SurviveDriverUSBMon *driver) {
+	return (driver->keepRunning == 0 || *driver->keepRunning) && driver->ctx->currentError == SURVIVE_OK;
+}
+
+void *pcap_thread_fn(void *_driver) {
+	SurviveDriverUSBMon *driver = _driver;
+	struct SurviveContext *ctx = driver->ctx;
+
+	struct pcap_pkthdr *pkthdr = 0;
+	const usb_header_t *usbp = 0;
+
+	SV_INFO("Pcap thread started");
+	while (usbmon_keep_running(driver)) {
+		int result = pcap_next_ex(driver->pcap, &pkthdr, (const uint8_t **)&usbp);
+		switch (result) {
+		case 0:
+			break;
+		case 1:
+			usbmon_process_packet(driver, pkthdr, usbp);
 			break;
-		}
 		case PCAP_ERROR:
 			SV_WARN("Pcap error %s", pcap_geterr(driver->pcap));
 		case PCAP_ERROR_BREAK:
@@ -630,9 +653,6 @@ void *pcap_thread_fn(void *_driver) {
 		default:
 			SV_WARN("Pcap next got %d", result);
 		}
-
-	continue_loop:
-		continue;
 	}
 
 exit_loop:
@@ -641,6 +661,108 @@ exit_loop:
 	return 0;
 }
 
+static void usbmon_index_add(usbmon_packet_index *index, const struct pcap_pkthdr *pkthdr, const uint8_t *bytes,
+							 double time, bool is_control) {
+	// Keeps every usb header 8 byte aligned
+	size_t offset = (index->data_size + 7) & ~(size_t)7;
+	if (offset + pkthdr->caplen > index->data_capacity) {
+		index->data_capacity = 2 * index->data_capacity + pkthdr->caplen + (1 << 20);
+		index->data = SV_REALLOC(index->data, index->data_capacity);
+	}
+	if (index->packets_cnt == index->packets_capacity) {
+		index->packets_capacity = 2 * index->packets_capacity + 1024;
+		index->packets = SV_REALLOC(index->packets, index->packets_capacity * sizeof(usbmon_packet));
+	}
+
+	memcpy(index->data + offset, bytes, pkthdr->caplen);
+	index->data_size = offset + pkthdr->caplen;
+	index->packets[index->packets_cnt++] =
+		(usbmon_packet){.hdr = *pkthdr, .offset = offset, .time = time, .is_control = is_control};
+}
+
+static const usb_header_t *usbmon_index_packet(const usbmon_packet_index *index, size_t i) {
+	return (const usb_header_t *)(index->data + index->packets[i].offset);
+}
+
+static void usbmon_build_index(SurviveDriverUSBMon *driver) {
+	SurviveContext *ctx = driver->ctx;
+	struct pcap_pkthdr *pkthdr = 0;
+	const usb_header_t *usbp = 0;
+
+	int result;
+	while ((result = pcap_next_ex(driver->pcap, &pkthdr, (const uint8_t **)&usbp)) >= 0) {
+		if (result == 0)
+			continue;
+
+		// Anything the replay would ignore is left out, unless it is being recorded again
+		bool is_device = find_device_inst(driver, usbp->bus_id, usbp->device_address) != 0;
+		if (!is_device && !(driver->pcapDumper && driver->record_all))
+			continue;
+		if (is_device && driver->start_time == 0)
+			driver->start_time = make_time(0, usbp);
+
+		usbmon_index_add(&driver->index, pkthdr, (const uint8_t *)usbp, make_time(driver->start_time, usbp),
+						 (usbp->endpoint_number & 0x7fu) == 0);
+	}
+
+	if (result == PCAP_ERROR) {
+		SV_WARN("Pcap error %s while indexing; replaying the %zu packets read so far", pcap_geterr(driver->pcap),
+				driver->index.packets_cnt);
+	}
+}
+
+// First packet at or after the given time
+static size_t usbmon_index_seek(const usbmon_packet_index *index, double time) {
+	size_t lo = 0, hi = index->packets_cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (index->packets[mid].time < time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void *pcap_index_thread_fn(void *_driver) {
+	SurviveDriverUSBMon *driver = _driver;
+	struct SurviveContext *ctx = driver->ctx;
+	const usbmon_packet_index *index = &driver->index;
+
+	size_t start = driver->playback_start > 0 ? usbmon_index_seek(index, driver->playback_start) : 0;
+	SV_INFO("Pcap index thread started at packet %zu of %zu", start, index->packets_cnt);
+	if (start > 0 && start == index->packets_cnt) {
+		SV_WARN("usbmon-playback-start of %.3fs is past the end of the capture at %.3fs; nothing to replay",
+				driver->playback_start, index->packets[start - 1].time);
+	}
+
+	if (start > 0) {
+		// Devices only send their configuration at the start of a capture, so the control traffic ahead of the seek
+		// point still has to be seen. Nothing else before it is forwarded.
+		driver->seeking = true;
+		for (size_t i = 0; i < start && usbmon_keep_running(driver); i++) {
+			if (index->packets[i].is_control)
+				usbmon_process_packet(driver, &index->packets[i].hdr, usbmon_index_packet(index, i));
+		}
+		driver->seeking = false;
+
+		// Pace from the seek point rather than from the start of the capture, or the last control packet
+		if (driver->playback_factor >= 0 && start < index->packets_cnt)
+			survive_clock_advance(ctx, index->packets[start].time);
+		survive_clock_set_factor(ctx, driver->playback_factor);
+	}
+
+	for (size_t i = start; i < index->packets_cnt && usbmon_keep_running(driver); i++) {
+		usbmon_process_packet(driver, &index->packets[i].hdr, usbmon_index_packet(index, i));
+	}
+
+	if (driver->keepRunning)
+		*driver->keepRunning = false;
+
+	SV_VERBOSE(100, "Exiting usbmon thread");
+	return 0;
+}
+
 #if defined(HAVE_FOPENCOOKIE)
 static ssize_t gzip_cookie_write(void *cookie, const char *buf, size_t size) {
 	return gzwrite((gzFile)cookie, (voidpc)buf, size);
@@ -698,7 +820,7 @@ static int DriverRegUSBMon_(SurviveContext *ctx, int driver_id) {
 			SV_WARN("Trying to open a compressed file without FOPENCOOKIE support in the usbmon driver.");
 		}
 #endif
-		survive_install_run_time_fn(ctx, survive_usbmon_playback_run_time, sp);
+		survive_clock_attach_source(ctx, sp->playback_factor);
 	} else {
 		sp->pcap = pcap_open_live("usbmon0", PCAP_ERRBUF_SIZE, 0, -1, sp->errbuf);
 	}
@@ -732,11 +854,25 @@ static int DriverRegUSBMon_(SurviveContext *ctx, int driver_id) {
 
 	int device_count = setup_usb_devices(sp);
 	if (device_count) {
+		void *(*thread_fn)(void *) = pcap_thread_fn;
+		sp->playback_start = survive_configf(ctx, USBMON_PLAYBACK_START_TAG, SC_GET, 0.);
+		if (isPlaybackMode && survive_configi(ctx, USBMON_PLAYBACK_INDEX_TAG, SC_GET, 1)) {
+			double index_start = OGGetAbsoluteTime();
+			usbmon_build_index(sp);
+			SV_INFO("Indexed %zu usb packets (%.1fMB) in %.2fs", sp->index.packets_cnt, sp->index.data_size / 1e6,
+					OGGetAbsoluteTime() - index_start);
+			// Indexing can take a while; don't count it against the replay
+			survive_clock_set_factor(ctx, sp->playback_factor);
+			thread_fn = pcap_index_thread_fn;
+		} else if (sp->playback_start > 0) {
+			SV_WARN("usbmon-playback-start needs usbmon-playback-index; replaying from the start");
+		}
+
 		// sp->keepRunning = true;
 		// sp->pcap_thread = OGCreateThread(pcap_thread_fn, sp);
 		// OGNameThread(sp->pcap_thread, "pcap_thread");
 
-		sp->keepRunning = survive_add_threaded_driver(ctx, sp, "pcap_thread", pcap_thread_fn, usbmon_close);
+		sp->keepRunning = survive_add_threaded_driver(ctx, sp, "pcap_thread", thread_fn, usbmon_close);
 		// survive_add_driver(ctx, sp, usbmon_poll, usbmon_close, 0);
 	} else {
 		usbmon_close(ctx, sp);
@@ -28,6 +28,7 @@
 #include "json_helpers.h"
 #include "survive_config.h"
 #include "survive_default_devices.h"
+#include "survive_metrics.h"
 
 #include "driver_vive.h"
 #include "lfsr_lh2.h"
@@ -590,6 +591,12 @@ static int AttachInterface(SurviveViveData *sv, struct SurviveUSBInfo *usbObject
 	iface->hname = hname;
 	iface->cb = cb;
 
+	char labels[64];
+	snprintf(labels, sizeof(labels), "object=\"%s\",interface=\"%s\"", assocobj ? assocobj->codename : "unknown",
+			 hname);
+	iface->packets_metric = survive_metric_register(ctx, SURVIVE_METRIC_COUNTER, "survive_usb_packets_total",
+													"USB packets received per interface", labels);
+
 #ifdef HIDAPI
 	// What do here?
 	iface->uh = usbObject->handle->interfaces[endpoint - usbObject->device_info->endpoints];
@@ -1983,6 +1990,8 @@ static inline void parse_and_process_lightcap(SurviveObject *w, uint16_t time, u
 
 		assert(cnt == les_old_cnt);
 #endif
+		// The report is processed last element first; the whole report goes down as one batch
+		LightcapElement ordered[10];
 		for (int i = (int)cnt - 1; i >= 0; i--) {
 #ifdef DEBUG_WATCHMAN
 			printf("%d: %u [%u]\n", les[i].sensor_id, les[i].length, les[i].timestamp);
@@ -1990,8 +1999,9 @@ static inline void parse_and_process_lightcap(SurviveObject *w, uint16_t time, u
 #ifdef VERIFY_LIGHTCAP
 			assert(memcmp(&les[i], &les_old[i], sizeof(LightcapElement)) == 0);
 #endif
-			handle_lightcap(w, &les[i]);
+			ordered[cnt - 1 - i] = les[i];
 		}
+		handle_lightcaps(w, ordered, cnt);
 	}
 }
 
@@ -2449,6 +2459,8 @@ static void handle_watchman(SurviveObject *w, uint8_t *readdata) {
 
 			assert(cnt == les_old_cnt);
 #endif
+			// The report is processed last element first; the whole report goes down as one batch
+			LightcapElement ordered[10];
 			for (int i = (int)cnt - 1; i >= 0; i--) {
 #ifdef DEBUG_WATCHMAN
 				printf("%d: %u [%u]\n", les[i].sensor_id, les[i].length, les[i].timestamp);
@@ -2456,8 +2468,9 @@ static void handle_watchman(SurviveObject *w, uint8_t *readdata) {
 #ifdef VERIFY_LIGHTCAP
 				assert(memcmp(&les[i], &les_old[i], sizeof(LightcapElement)) == 0);
 #endif
-				handle_lightcap(w, &les[i]);
+				ordered[cnt - 1 - i] = les[i];
 			}
+			handle_lightcaps(w, ordered, cnt);
 		}
 	}
 }
@@ -93,6 +93,7 @@ typedef struct SurviveUSBInterface {
 	int which_interface_am_i; // for indexing into uiface
 	const char *hname;		  // human-readable names
 	size_t packet_count;
+	struct SurviveMetric *packets_metric; // Null unless metrics are enabled
 
 	bool shutdown;
 } SurviveUSBInterface;
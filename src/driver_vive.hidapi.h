@@ -32,6 +32,7 @@ static void *HAPIReceiver(void *v) {
 	if ((iface->actual_len = hid_read(*hp, iface->buffer, sizeof(iface->buffer))) > 0) {
 		// if( iface->actual_len  == 52 ) continue;
 		iface->packet_count++;
+		survive_metric_add(iface->packets_metric, 1);
 		survive_data_cb(iface);
 	}
 	if (iface->actual_len < 0) {
@@ -174,6 +174,7 @@ static void handle_transfer(struct libusb_transfer *transfer) {
 	iface->actual_len = transfer->actual_length;
 	iface->cb(iface);
 	iface->packet_count++;
+	survive_metric_add(iface->packets_metric, 1);
 
 	if (libusb_submit_transfer(transfer)) {
 		SV_ERROR(SURVIVE_ERROR_HARWARE_FAULT, "Error resubmitting transfer for %s", iface->hname);
@@ -2,6 +2,29 @@
 #include "survive.h"
 #include <linmath.h>
 #include <math.h>
+
+#if defined(USE_FLOAT) && !defined(_MSC_VER)
+// Keep single precision builds in single precision; without this every sin / cos / atan2 in the generated code goes
+// through the double versions and back. tgmath leaves calls with double arguments alone.
+#include <tgmath.h>
+#undef sqrt
+#undef asin
+#undef pow
+
+static inline float __safe_sqrt(float x) { return x > 0 ? sqrtf(x) : 0; }
+#define sqrt __safe_sqrt
+static inline float __safe_asin(float x) { return asinf(linmath_enforce_range(x, -1, 1)); }
+#define asin __safe_asin
+#ifndef ANDROID
+static inline float __safe_pow(float x, float y) {
+	// Almost all of the generated powers are squares, which powf doesn't special case
+	if (y == 2)
+		return x * x;
+	return x >= 0 ? powf(x, y) : crealf(cpowf(x, y));
+}
+#define pow __safe_pow
+#endif
+#else
 static inline double __safe_sqrt(double x) { return x > 0 ? sqrt(x) : 0; }
 #define sqrt __safe_sqrt
 static inline double __safe_asin(double x) { return asin(linmath_enforce_range(x, -1, 1)); }
@@ -13,4 +36,5 @@ static inline double __safe_pow(double x, double y) { return x >= 0 ? pow(x, y)
 #define pow __safe_pow
 #endif
 #endif
+#endif
 #define GEN_FLT FLT
@@ -29,7 +29,7 @@ void ootx_error(ootx_decoder_context *ctx, const char *msg) {
 
 void ootx_init_decoder_context(ootx_decoder_context *ctx, float start) {
 	ctx->buf_offset = 0;
-	ctx->bits_written = 0;
+	ctx->crc = crc32(0L, 0 /*Z_NULL*/, 0);
 
 	ctx->preamble = 0XFFFFFFFF;
 	ctx->bits_processed = 0;
@@ -67,53 +67,65 @@ static bool ootx_detect_preamble(ootx_decoder_context *ctx, int8_t dbit) {
 
 void ootx_reset_buffer(ootx_decoder_context *ctx) {
 	ctx->buf_offset = 0;
-	ctx->bits_written = 0;
 	ctx->found_preamble = 0;
+	ctx->crc = crc32(0L, 0 /*Z_NULL*/, 0);
 	*(ctx->payload_size) = 0;
 }
 
-void ootx_inc_buffer_offset(ootx_decoder_context *ctx) {
-	++(ctx->buf_offset);
+static void ootx_emit_packet(ootx_decoder_context *ctx, uint16_t padded_length) {
+	ootx_packet op = {0};
 
-//	assert(ctx->buf_offset<MAX_BUFF_SIZE);
+	op.length = *(ctx->payload_size);
+	op.data = ctx->buffer + 2;
+	memcpy(&op.crc32, op.data + padded_length, sizeof(uint32_t));
+
+	if (ctx->crc != op.crc32) {
+		if (ctx->ootx_bad_crc_clbk != NULL) {
+			ctx->ootx_bad_crc_clbk(ctx, &op, ctx->crc);
+		}
+		ctx->stats.bad_crcs++;
+	} else if (ctx->ootx_packet_clbk != NULL) {
+		ctx->stats.packets_found++;
+		ctx->stats.used_bytes += op.length;
+		ctx->ootx_packet_clbk(ctx, &op);
+	}
+
+	ootx_reset_buffer(ctx);
+}
+
+/* Packets are sent as 16 bit words separated by sync bits, so the data bits are collected into a word and written out
+ * together once the word is complete. Bits that were missed (-1) leave whatever was decoded for them last time as is;
+ * lighthouses repeat the same packet so this is usually right, and the CRC catches it when it isn't. */
+static void ootx_write_word(ootx_decoder_context *ctx) {
+	uint8_t *current = ctx->buffer + ctx->buf_offset;
+	for (int i = 0; i < 2; i++) {
+		uint8_t bits = ctx->word_bits >> (8 - 8 * i), known = ctx->word_known >> (8 - 8 * i);
+		current[i] = (current[i] & ~known) | (bits & known);
+	}
+
+	// The CRC covers the payload only -- not the length in front or the padding byte behind it
+	uint16_t length = *(ctx->payload_size);
+	if (ctx->buf_offset >= 2 && ctx->buf_offset - 2 < length) {
+		size_t payload_bytes = length - (ctx->buf_offset - 2);
+		ctx->crc = crc32(ctx->crc, current, payload_bytes < 2 ? payload_bytes : 2);
+	}
 
 	/* the buffer is going to overflow, wrap the buffer and don't write more data until the preamble is found again */
+	ctx->buf_offset += 2;
 	if (ctx->buf_offset >= OOTX_MAX_BUFF_SIZE) {
 		ctx->buf_offset = 0;
 		ctx->found_preamble = 0;
+		return;
 	}
-}
 
-static void ootx_write_to_buffer(ootx_decoder_context *ctx, int8_t dbit) {
-	uint8_t *current_byte = ctx->buffer + ctx->buf_offset;
-
-	// Purposefully leave the value as is if dbit is -1
-	uint8_t mask = (1u << (7u - ctx->bits_written));
-	if (dbit == 0) {
-		*current_byte &= ~mask;
-	} else if (dbit == 1) {
-		*current_byte |= mask;
-	} else {
-		ctx->stats.guess_bits++;
-	}
-	ctx->stats.package_bits++;
-
-	if (++ctx->bits_written > 7) {
-		ctx->bits_written=0;
-		ootx_inc_buffer_offset(ctx);
+	uint16_t padded_length = length + (length & 0x01); // extra null byte if odd
+	if (ctx->buf_offset >= (padded_length + 6)) {
+		/*	once we have a complete ootx packet, send it out in the callback */
+		ootx_emit_packet(ctx, padded_length);
 	}
 }
 
 void ootx_pump_bit(ootx_decoder_context *ctx, int8_t dbit) {
-	/*if (dbit < 0) {
-		if(ctx->found_preamble) {
-			size_t bits_cnt = ctx->bits_written + ctx->buf_offset * 8;
-			dbit = ctx->bits_processed == 16 ? 1 : ctx->bits_post_preamble[bits_cnt];
-		} else {
-			dbit = ((ctx->preamble & 0x0001ffff) == 0x00000000) ? 1 : ctx->bits_processed == 16;
-		}
-	}*/
-
 	++(ctx->bits_processed);
 	ctx->stats.bits_seen++;
 	if ( ootx_detect_preamble(ctx, dbit) ) {
@@ -146,35 +158,13 @@ void ootx_pump_bit(ootx_decoder_context *ctx, int8_t dbit) {
 			if the buffer overflows, found_preamble will be cleared
 			and writing will stop. data would be corrupted, so there is no point in continuing
 		*/
+		ctx->word_bits = (ctx->word_bits << 1) | (dbit == 1);
+		ctx->word_known = (ctx->word_known << 1) | (dbit >= 0);
+		ctx->stats.guess_bits += dbit < 0;
+		ctx->stats.package_bits++;
 
-		ootx_write_to_buffer(ctx, dbit);
-
-		uint16_t padded_length = *(ctx->payload_size);
-		padded_length += (padded_length&0x01); //extra null byte if odd
-
-		if (ctx->buf_offset >= (padded_length+6)) {
-			/*	once we have a complete ootx packet, send it out in the callback */
-			ootx_packet op = {0};
-
-			op.length = *(ctx->payload_size);
-			op.data = ctx->buffer+2;
-			memcpy(&op.crc32, op.data + padded_length, sizeof(uint32_t));
-
-			uint32_t crc = crc32( 0L, 0 /*Z_NULL*/, 0 );
-			crc = crc32( crc, op.data,op.length);
-
-			if (crc != op.crc32) {
-				if (ctx->ootx_bad_crc_clbk != NULL) {
-					ctx->ootx_bad_crc_clbk(ctx, &op, crc);
-				}
-				ctx->stats.bad_crcs++;
-			} else if (ctx->ootx_packet_clbk != NULL) {
-				ctx->stats.packets_found++;
-				ctx->stats.used_bytes += op.length;
-				ctx->ootx_packet_clbk(ctx, &op);
-			}
-
-			ootx_reset_buffer(ctx);
+		if (ctx->bits_processed == 16) {
+			ootx_write_word(ctx);
 		}
 	}
 }
@@ -9,6 +9,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "survive_types.h"
+
 typedef struct {
 	uint16_t length;
 	uint8_t* data;
@@ -20,12 +22,15 @@ typedef struct {
 typedef struct ootx_decoder_context {
 	uint8_t buffer[OOTX_MAX_BUFF_SIZE];
 
-	bool bits_post_preamble[64 * 8];
-
 	uint16_t buf_offset;
-	uint8_t bits_written;
 	uint16_t* payload_size;
 
+	// Data bits of the current 16 bit word and which of them were actually seen; written to buffer a word at a time
+	uint16_t word_bits;
+	uint16_t word_known;
+	// Running CRC32 of the payload bytes written so far
+	uint32_t crc;
+
 	uint32_t preamble;
 	uint8_t bits_processed;
 	uint8_t found_preamble;
@@ -97,10 +102,10 @@ void init_lighthouse_info_v15(lighthouse_info_v15 *lhi, uint8_t *data);
 void init_lighthouse_info_v6(lighthouse_info_v6* lhi, uint8_t* data);
 void print_lighthouse_info_v6(lighthouse_info_v6* lhi);
 
-void ootx_init_decoder_context(ootx_decoder_context *ctx, float time);
-void ootx_free_decoder_context(ootx_decoder_context *ctx);
+SURVIVE_EXPORT void ootx_init_decoder_context(ootx_decoder_context *ctx, float time);
+SURVIVE_EXPORT void ootx_free_decoder_context(ootx_decoder_context *ctx);
 
-void ootx_pump_bit(ootx_decoder_context *ctx, int8_t dbit);
+SURVIVE_EXPORT void ootx_pump_bit(ootx_decoder_context *ctx, int8_t dbit);
 
 uint8_t ootx_decode_bit(uint32_t length);
 
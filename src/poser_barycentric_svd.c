@@ -176,7 +176,7 @@ static void add_correspondences(SurviveObject *so, bc_svd *bc, uint32_t timecode
 	}
 }
 
-void solve_global_scene(struct SurviveObject *so, PoserDataSVD *dd, PoserDataGlobalScenes *gss) {
+static void solve_global_scene(struct SurviveObject *so, PoserDataSVD *dd, PoserDataGlobalScenes *gss) {
 	SurviveContext *ctx = so->ctx;
 
 	if (gss->scenes == 0 || gss->scenes_cnt == 0)
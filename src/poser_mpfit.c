@@ -14,6 +14,7 @@
 #include "survive_async_optimizer.h"
 #include "survive_config.h"
 #include "survive_kalman_tracker.h"
+#include "survive_metrics.h"
 #include "survive_recording.h"
 #include "survive_reproject.h"
 #include "survive_reproject_gen2.h"
@@ -34,6 +35,22 @@ STATIC_CONFIG_ITEM(SENSOR_VARIANCE, "sensor-variance", 'f', "Base variance for e
 STATIC_CONFIG_ITEM(DISABLE_LIGHTHOUSE, "disable-lighthouse", 'i', "Disable given lighthouse from tracking", -1)
 STATIC_CONFIG_ITEM(RUN_EVERY_N_SYNCS, "syncs-per-run", 'i', "Number of sync pulses before running optimizer", 1)
 STATIC_CONFIG_ITEM(RUN_POSER_ASYNC, "poser-async", 'i', "Run the poser in it's own thread", 0)
+STATIC_CONFIG_ITEM(STATIONARY_SYNCS_PER_RUN, "stationary-syncs-per-run", 'i',
+				   "Number of sync pulses before running optimizer while the object's IMU reports it at rest; 0 uses "
+				   "syncs-per-run",
+				   0)
+STATIC_CONFIG_ITEM(FAST_MOTION_SPEED, "fast-motion-speed", 'f',
+				   "Speed in m/s above which the optimizer runs every sync regardless of syncs-per-run", 1.)
+STATIC_CONFIG_ITEM(FAST_MOTION_ANG_SPEED, "fast-motion-ang-speed", 'f',
+				   "Angular speed in rad/s above which the optimizer runs every sync regardless of syncs-per-run", 3.)
+STATIC_CONFIG_ITEM(ANCHOR_RESIDUAL, "mpfit-anchor-residual", 'f',
+				   "If set, let the kalman tracker's light updates carry the pose and only run MPFIT when their residual "
+				   "exceeds this or after mpfit-anchor-period seconds",
+				   0.)
+STATIC_CONFIG_ITEM(ANCHOR_PERIOD, "mpfit-anchor-period", 'f',
+				   "Max seconds between MPFIT solves when mpfit-anchor-residual is set", .5)
+STATIC_CONFIG_ITEM(MPFIT_CPU_BUDGET, "mpfit-cpu-budget", 'f',
+				   "Fraction of a core each object's synchronous MPFIT solves may use; 0 for no limit", 0.)
 
 STATIC_CONFIG_ITEM(PRECISE_POSE, "precise", 'i', "Always calculate precise pose", 0)
 STATIC_CONFIG_ITEM(USE_STATIONARY_SENSOR_WINDOW, "use-stationary-sensor-window", 'i',
@@ -52,6 +69,13 @@ typedef struct MPFITStats {
 	uint32_t total_lh_cnt;
 	uint32_t dropped_meas_cnt;
 	uint32_t dropped_lh_cnt;
+
+	int stationary_skips;
+	int fast_motion_runs;
+	int budget_skips;
+	int kalman_only_syncs;
+	int residual_anchors;
+	double solve_time;
 } MPFITStats;
 
 typedef struct MPFITGlobalData {
@@ -71,6 +95,8 @@ typedef struct MPFITData {
 	int use_jacobian_function_lh;
 	int required_meas;
   int syncs_per_run;
+  int stationary_syncs_per_run;
+  FLT fast_motion_speed, fast_motion_ang_speed;
   int run_async;
   int syncs_per_run_cnt;
   int syncs_seen;
@@ -85,8 +111,22 @@ typedef struct MPFITData {
   const char *serialize_prefix;
   MPFITStats stats;
 
+  // Null unless metrics are enabled
+  struct SurviveMetric *solve_latency;
+
   bool globalDataAvailable;
   struct survive_async_optimizer *async_optimizer;
+
+  // Scratch space for the synchronous solver; reset every solve
+  survive_arena arena;
+
+  FLT anchor_residual, anchor_period;
+  FLT last_anchor_time;
+
+  // Token bucket of CPU seconds available for solves; refilled at cpu_budget seconds per wall clock second
+  FLT cpu_budget;
+  double budget_balance;
+  double budget_last_time;
 } MPFITData;
 
 SurviveSensorActivations last_scene;
@@ -445,6 +485,10 @@ static FLT handle_optimizer_results(survive_optimizer *mpfitctx, int res, const
 	d->stats.dropped_lh_cnt += mpfitctx->stats.dropped_lh_cnt;
 	d->stats.total_meas_cnt += mpfitctx->stats.total_meas_cnt;
 	d->stats.total_lh_cnt += mpfitctx->stats.total_lh_cnt;
+	so->stats.optimizer_meas_cnt += mpfitctx->stats.total_meas_cnt;
+	so->stats.optimizer_dropped_meas_cnt += mpfitctx->stats.dropped_meas_cnt;
+	so->stats.optimizer_lh_cnt += mpfitctx->stats.total_lh_cnt;
+	so->stats.optimizer_dropped_lh_cnt += mpfitctx->stats.dropped_lh_cnt;
 	d->stats.total_fev += result->nfev;
 	d->stats.total_iterations += result->niter;
 	d->stats.total_runs++;
@@ -474,6 +518,8 @@ static void async_optimizer_cb(struct survive_async_optimizer_buffer *buffer, in
 	SurvivePose out = {0};
 	struct async_optimizer_user *user = buffer->user;
 
+	survive_metric_observe(user->d->solve_latency, buffer->solve_time);
+
 	survive_get_ctx_lock(user->d->opt.so->ctx);
 	FLT error = handle_optimizer_results(&buffer->optimizer, res, result, user, &out);
 	handle_results(user->d, &user->pdl, error, &out);
@@ -493,7 +539,7 @@ static void run_mpfit_find_3d_structure_async(MPFITData *d, PoserDataLight *pdl,
 	opt_buff->optimizer.poseLength = 1;
 	opt_buff->optimizer.cameraLength = so->ctx->activeLighthouses;
 
-	SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(opt_buff->optimizer, so);
+	SURVIVE_OPTIMIZER_SETUP_ARENA_BUFFERS(opt_buff->optimizer, &opt_buff->arena, so);
 
 	struct async_optimizer_user *user_data = opt_buff->user;
 	if (user_data == 0) {
@@ -526,7 +572,8 @@ static FLT run_mpfit_find_3d_structure(MPFITData *d, PoserDataLight *pdl, Surviv
 		.cameraLength = so->ctx->activeLighthouses,
 	};
 
-	SURVIVE_OPTIMIZER_SETUP_STACK_BUFFERS(mpfitctx, so);
+	survive_arena_reset(&d->arena);
+	SURVIVE_OPTIMIZER_SETUP_ARENA_BUFFERS(mpfitctx, &d->arena, so);
 
 	struct async_optimizer_user user_data = {.d = d, .pdl = *pdl};
 
@@ -547,6 +594,81 @@ static FLT run_mpfit_find_3d_structure(MPFITData *d, PoserDataLight *pdl, Surviv
 
 }
 
+enum mpfit_schedule { MPFIT_SCHEDULE_NORMAL, MPFIT_SCHEDULE_STATIONARY, MPFIT_SCHEDULE_FAST };
+
+static enum mpfit_schedule mpfit_schedule(const MPFITData *d) {
+	const SurviveObject *so = d->opt.so;
+
+	// Without an IMU nothing ever updates last_movement, so there's no telling whether the object is at rest
+	bool hasImu = so->activations.last_imu != 0;
+	if (hasImu && SurviveSensorActivations_stationary_time(&so->activations) > so->timebase_hz) {
+		return MPFIT_SCHEDULE_STATIONARY;
+	}
+
+	if ((d->fast_motion_speed > 0 && norm3d(so->velocity.Pos) > d->fast_motion_speed) ||
+		(d->fast_motion_ang_speed > 0 && norm3d(so->velocity.AxisAngleRot) > d->fast_motion_ang_speed)) {
+		return MPFIT_SCHEDULE_FAST;
+	}
+	return MPFIT_SCHEDULE_NORMAL;
+}
+
+static int mpfit_syncs_per_run(const MPFITData *d, enum mpfit_schedule schedule) {
+	switch (schedule) {
+	case MPFIT_SCHEDULE_STATIONARY:
+		return d->stationary_syncs_per_run > d->syncs_per_run ? d->stationary_syncs_per_run : d->syncs_per_run;
+	case MPFIT_SCHEDULE_FAST:
+		return 1;
+	default:
+		return d->syncs_per_run;
+	}
+}
+
+/*
+ * With mpfit-anchor-residual set, the kalman tracker integrates each light measurement on its own between solves and
+ * MPFIT only runs to re-anchor it: when the light residuals grow, when the tracker stops taking light data, or at
+ * mpfit-anchor-period.
+ */
+static bool mpfit_needs_anchor(MPFITData *d, const PoserDataLight *lightData) {
+	if (d->anchor_residual <= 0)
+		return true;
+
+	const SurviveObject *so = d->opt.so;
+	const SurviveKalmanTracker *tracker = so->tracker;
+	FLT time = lightData->hdr.timecode / (FLT)so->timebase_hz;
+
+	// The light updates need a pose to start from; and stop being applied once its variance grows too large
+	bool trackerUsesLight = tracker && tracker->light_var >= 0 && !tracker->use_raw_obs &&
+							tracker->stats.obs_count >= tracker->light_required_obs &&
+							tracker->stats.obs_count > 0 && time - tracker->last_light_time < .1;
+	if (!trackerUsesLight || time - d->last_anchor_time > d->anchor_period) {
+		return true;
+	}
+
+	if (tracker->light_residuals_all > d->anchor_residual) {
+		d->stats.residual_anchors++;
+		return true;
+	}
+	return false;
+}
+
+static bool mpfit_within_budget(MPFITData *d) {
+	if (d->cpu_budget <= 0)
+		return true;
+
+	double now = OGGetAbsoluteTime();
+	if (d->budget_last_time == 0)
+		d->budget_last_time = now;
+
+	// Allow bursts of up to a quarter second worth of budget so a busy spell after idling isn't throttled immediately
+	double max_balance = .25 * d->cpu_budget;
+	d->budget_balance += (now - d->budget_last_time) * d->cpu_budget;
+	if (d->budget_balance > max_balance)
+		d->budget_balance = max_balance;
+	d->budget_last_time = now;
+
+	return d->budget_balance >= 0;
+}
+
 static inline void print_stats(SurviveContext *ctx, MPFITStats *stats) {
 	// if (stats->total_iterations == 0)
 	//		return;
@@ -562,6 +684,12 @@ static inline void print_stats(SurviveContext *ctx, MPFITStats *stats) {
 	SV_INFO("\ttotal runs        %d", stats->total_runs);
 	SV_INFO("\tavg error         %10.10f", stats->sum_errors / total_runs);
 	SV_INFO("\tavg orig error    %10.10f", stats->sum_origerrors / total_runs);
+	SV_INFO("\tavg solve time    %10.10f", stats->solve_time / total_runs);
+	SV_INFO("\tstationary skips  %d", stats->stationary_skips);
+	SV_INFO("\tfast motion runs  %d", stats->fast_motion_runs);
+	SV_INFO("\tbudget skips      %d", stats->budget_skips);
+	SV_INFO("\tkalman only syncs %d", stats->kalman_only_syncs);
+	SV_INFO("\tresidual anchors  %d", stats->residual_anchors);
 	if (stats->total_meas_cnt)
 		SV_INFO("\tnoisy meas cnt    %7d / %8d (%4.2f%%)", stats->dropped_meas_cnt, stats->total_meas_cnt,
 				100. * (stats->dropped_meas_cnt / (FLT)stats->total_meas_cnt));
@@ -624,7 +752,7 @@ void global_lh_pose(SurviveObject *so, uint8_t lighthouse, SurvivePose *lighthou
 	SV_VERBOSE(10, "Initial LH pose (%d) " SurvivePose_format, lighthouse, SURVIVE_POSE_EXPAND(*lighthouse_pose));
 }
 
-bool solve_global_scene(struct SurviveContext *ctx, PoserDataGlobalScenes *gss) {
+static bool solve_global_scene(struct SurviveContext *ctx, PoserDataGlobalScenes *gss) {
 	if (gss->scenes_cnt == 0 || gss->scenes == 0)
 		return false;
 
@@ -851,7 +979,18 @@ int PoserMPFIT(SurviveObject *so, void **user, PoserData *pd) {
 		d->syncs_to_setup = 16;
 		d->required_meas = survive_configi(ctx, "required-meas", SC_GET, 8);
 		d->syncs_per_run = survive_configi(ctx, "syncs-per-run", SC_GET, 1);
+		survive_attach_configi(ctx, STATIONARY_SYNCS_PER_RUN_TAG, &d->stationary_syncs_per_run);
+		survive_attach_configf(ctx, FAST_MOTION_SPEED_TAG, &d->fast_motion_speed);
+		survive_attach_configf(ctx, FAST_MOTION_ANG_SPEED_TAG, &d->fast_motion_ang_speed);
+		survive_attach_configf(ctx, MPFIT_CPU_BUDGET_TAG, &d->cpu_budget);
+		survive_attach_configf(ctx, ANCHOR_RESIDUAL_TAG, &d->anchor_residual);
+		survive_attach_configf(ctx, ANCHOR_PERIOD_TAG, &d->anchor_period);
 		d->run_async = survive_configi(ctx, RUN_POSER_ASYNC_TAG, SC_GET, 0);
+
+		char labels[32];
+		snprintf(labels, sizeof(labels), "object=\"%s\"", so->codename);
+		d->solve_latency = survive_metric_register(ctx, SURVIVE_METRIC_HISTOGRAM, "survive_mpfit_solve_seconds",
+												   "Time taken by an MPFIT solve", labels);
 		if (d->run_async) {
 			d->async_optimizer = SV_NEW(survive_async_optimizer, async_optimizer_cb);
 		}
@@ -899,15 +1038,34 @@ int PoserMPFIT(SurviveObject *so, void **user, PoserData *pd) {
 		SurvivePose estimate = {0};
 
 		FLT error = -1;
-		if (++d->syncs_per_run_cnt >= d->syncs_per_run) {
-			d->syncs_per_run_cnt = 0;
+		enum mpfit_schedule schedule = mpfit_schedule(d);
+		if (++d->syncs_per_run_cnt < mpfit_syncs_per_run(d, schedule)) {
+			d->stats.stationary_skips += schedule == MPFIT_SCHEDULE_STATIONARY;
+			return 0;
+		}
+		d->syncs_per_run_cnt = 0;
+		d->stats.fast_motion_runs += schedule == MPFIT_SCHEDULE_FAST && d->syncs_per_run > 1;
 
-			if (d->run_async) {
-				run_mpfit_find_3d_structure_async(d, lightData, scene, &estimate);
-			} else {
-				error = run_mpfit_find_3d_structure(d, lightData, scene, &estimate);
-				handle_results(d, lightData, error, &estimate);
-			}
+		if (!mpfit_needs_anchor(d, lightData)) {
+			d->stats.kalman_only_syncs++;
+			return 0;
+		}
+		d->last_anchor_time = lightData->hdr.timecode / (FLT)so->timebase_hz;
+
+		if (d->run_async) {
+			run_mpfit_find_3d_structure_async(d, lightData, scene, &estimate);
+		} else if (!mpfit_within_budget(d)) {
+			d->stats.budget_skips++;
+		} else {
+			double start = OGGetAbsoluteTime();
+			SV_ASSERT_NO_ALLOCS_BEGIN();
+			error = run_mpfit_find_3d_structure(d, lightData, scene, &estimate);
+			SV_ASSERT_NO_ALLOCS_END(d->stats.total_runs > 1, "MPFIT solve");
+			double solve_time = OGGetAbsoluteTime() - start;
+			d->stats.solve_time += solve_time;
+			survive_metric_observe(d->solve_latency, solve_time);
+			d->budget_balance -= solve_time;
+			handle_results(d, lightData, error, &estimate);
 		}
 		return 0;
 	}
@@ -933,6 +1091,12 @@ int PoserMPFIT(SurviveObject *so, void **user, PoserData *pd) {
 		g.stats.meas_failures += d->stats.meas_failures;
 		g.stats.total_iterations += d->stats.total_iterations;
 		g.stats.sum_origerrors += d->stats.sum_origerrors;
+		g.stats.solve_time += d->stats.solve_time;
+		g.stats.stationary_skips += d->stats.stationary_skips;
+		g.stats.fast_motion_runs += d->stats.fast_motion_runs;
+		g.stats.budget_skips += d->stats.budget_skips;
+		g.stats.kalman_only_syncs += d->stats.kalman_only_syncs;
+		g.stats.residual_anchors += d->stats.residual_anchors;
 		for (int i = 0; i < sizeof(d->stats.status_cnts) / sizeof(int); i++) {
 			g.stats.status_cnts[i] += d->stats.status_cnts[i];
 		}
@@ -949,7 +1113,14 @@ int PoserMPFIT(SurviveObject *so, void **user, PoserData *pd) {
 		survive_detach_config(ctx, "disable-lighthouse", &d->disable_lighthouse);
 		survive_detach_config(ctx, "sensor-variance-per-sec", &d->sensor_variance_per_second);
 		survive_detach_config(ctx, "sensor-variance", &d->sensor_variance);
+		survive_detach_config(ctx, STATIONARY_SYNCS_PER_RUN_TAG, &d->stationary_syncs_per_run);
+		survive_detach_config(ctx, FAST_MOTION_SPEED_TAG, &d->fast_motion_speed);
+		survive_detach_config(ctx, FAST_MOTION_ANG_SPEED_TAG, &d->fast_motion_ang_speed);
+		survive_detach_config(ctx, MPFIT_CPU_BUDGET_TAG, &d->cpu_budget);
+		survive_detach_config(ctx, ANCHOR_RESIDUAL_TAG, &d->anchor_residual);
+		survive_detach_config(ctx, ANCHOR_PERIOD_TAG, &d->anchor_period);
 		survive_async_free(d->async_optimizer);
+		survive_arena_free(&d->arena);
 		*user = 0;
 		free(d);
 		return 0;
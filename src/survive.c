@@ -13,9 +13,15 @@
 #include "stdarg.h"
 
 #include "os_generic.h"
+#include "survive_cache.h"
+#include "survive_clock.h"
 #include "survive_config.h"
 #include "survive_default_devices.h"
+#include "survive_event_export.h"
+#include "survive_metrics.h"
+#include "survive_optimizer.h"
 #include "survive_recording.h"
+#include "survive_telemetry.h"
 
 #include <stdarg.h>
 
@@ -42,6 +48,16 @@ STATIC_CONFIG_ITEM(LIGHTHOUSE_GEN, "lighthouse-gen", 'i',
 
 STATIC_CONFIG_ITEM(THREADED_POSERS, "threaded-posers", 'i', "Whether or not to run each poser in their own thread.", 0)
 
+#ifdef SURVIVE_ALLOC_COUNTER
+#ifdef _MSC_VER
+static __declspec(thread) size_t alloc_counter;
+#else
+static __thread size_t alloc_counter;
+#endif
+void survive_alloc_counter_increment(void) { alloc_counter++; }
+size_t survive_alloc_counter(void) { return alloc_counter; }
+#endif
+
 const char *survive_config_file_name(struct SurviveContext *ctx) {
 	return survive_configs(ctx, "configfile", SC_GET, DEFAULT_CONFIG_PATH);
 }
@@ -210,11 +226,14 @@ static void PrintMatchingDrivers( const char * prefix, const char * matchingpara
 }
 
 SURVIVE_EXPORT int8_t survive_get_bsd_idx(SurviveContext *ctx, survive_channel channel) {
-	if (channel < 0 || channel >= 16) {
+	if (channel < 0 || channel >= NUM_GEN2_CHANNELS) {
 		return -1;
 	}
 
 	if (ctx->lh_version == 0) {
+		if (channel >= NUM_GEN2_LIGHTHOUSES) {
+			return -1;
+		}
 		if (ctx->bsd[channel].mode == 0xFF) {
 			ctx->bsd[channel] = (BaseStationData){0};
 			ctx->bsd[channel].mode = channel;
@@ -226,7 +245,7 @@ SURVIVE_EXPORT int8_t survive_get_bsd_idx(SurviveContext *ctx, survive_channel c
 
 	int8_t i = ctx->bsd_map[channel];
 	if (i != -1)
-		return i;
+		return i < 0 ? -1 : i;
 
 	for (i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
 		if (ctx->bsd[i].mode == 0xFF) {
@@ -240,6 +259,9 @@ SURVIVE_EXPORT int8_t survive_get_bsd_idx(SurviveContext *ctx, survive_channel c
 		}
 	}
 
+	// Every slot is taken; remember the channel so fixed capacity builds only complain about it once
+	SV_WARN("Ignoring lighthouse ch %d; this build only tracks %d lighthouses", channel, NUM_GEN2_LIGHTHOUSES);
+	ctx->bsd_map[channel] = -2;
 	return -1;
 }
 
@@ -248,8 +270,29 @@ struct SurviveContext_private {
 	survive_run_time_fn runTimeFn;
 	void *runTimeFnUser;
 	double lastRunTime;
+
+	// Batch form of the configured disambiguator, and the lightcap hook it stands in for
+	lightcap_batch_process_func lightcapbatchproc;
+	lightcap_process_func batched_lightcapproc;
 };
 
+// Finds the batch entry point registered next to the given disambiguator as Batch<DisambiguatorName>, if any
+static lightcap_batch_process_func find_lightcap_batch_fn(lightcap_process_func lightcapproc) {
+	const char *DriverName;
+	for (int i = 0; (DriverName = GetDriverNameMatching("Disambiguator", i)); i++) {
+		if (GetDriver(DriverName) == (survive_driver_fn)lightcapproc)
+			return (lightcap_batch_process_func)GetDriverWithPrefix("Batch", DriverName);
+	}
+	return 0;
+}
+
+lightcap_batch_process_func survive_lightcap_batch_fn(const SurviveContext *ctx) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	if (pctx->lightcapbatchproc == 0 || ctx->lightcapproc != pctx->batched_lightcapproc)
+		return 0;
+	return pctx->lightcapbatchproc;
+}
+
 void survive_get_ctx_lock(SurviveContext *ctx) {
 	struct SurviveContext_private *pctx = ctx->private_members;
 	// SV_VERBOSE(100, "Trying to get lock on %lx", pthread_self());
@@ -310,9 +353,12 @@ SurviveContext *survive_init_internal(int argc, char *const *argv, void *userDat
 	struct SurviveContext_private *pctx = ctx->private_members = SV_CALLOC(1, sizeof(struct SurviveContext_private));
 
 	pctx->poll_sema = OGCreateSema();
+	survive_clock_init(ctx);
 
 	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
 		ctx->bsd[i].mode = -1;
+	}
+	for (int i = 0; i < NUM_GEN2_CHANNELS; i++) {
 		ctx->bsd_map[i] = -1;
 	}
 	ctx->state = SURVIVE_STOPPED;
@@ -440,7 +486,7 @@ SurviveContext *survive_init_internal(int argc, char *const *argv, void *userDat
 
 	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
 		if (config_read_lighthouse(ctx->lh_config, &(ctx->bsd[i]), i)) {
-			if (ctx->bsd[i].mode >= 0 && ctx->bsd[i].mode < 16)
+			if (ctx->bsd[i].mode >= 0 && ctx->bsd[i].mode < NUM_GEN2_CHANNELS)
 				ctx->bsd_map[ctx->bsd[i].mode] = i;
 			ctx->activeLighthouses++;
 			SV_VERBOSE(50, "Adding LH %d mode: %d id: %08x", i, ctx->bsd[i].mode, (unsigned)ctx->bsd[i].BaseStationID);
@@ -555,6 +601,16 @@ int survive_startup(SurviveContext *ctx) {
 
 	survive_install_recording(ctx);
 
+	// Restore lighthouse calibration before any driver can start delivering light data
+	const char *cache_path = survive_configs(ctx, "calibration-cache", SC_GET, "");
+	if (cache_path && *cache_path) {
+		survive_cache_load(ctx, cache_path);
+	}
+
+	survive_optimizer_install_capture(ctx);
+	survive_telemetry_install(ctx);
+	survive_metrics_install(ctx);
+
 	// initialize the button queue
 	memset(&(ctx->buttonQueue), 0, sizeof(ctx->buttonQueue));
 	ctx->buttonQueue.buttonservicesem = OGCreateSema();
@@ -564,6 +620,9 @@ int survive_startup(SurviveContext *ctx) {
 
 	PoserCB PreferredPoserCB = (PoserCB)GetDriverByConfig(ctx, "Poser", "poser", "MPFIT");
 	ctx->lightcapproc = GetDriverByConfig(ctx, "Disambiguator", "disambiguator", "StateBased");
+	struct SurviveContext_private *pctx = ctx->private_members;
+	pctx->batched_lightcapproc = ctx->lightcapproc;
+	pctx->lightcapbatchproc = find_lightcap_batch_fn(ctx->lightcapproc);
 
 	const char *DriverName;
 
@@ -650,6 +709,7 @@ int survive_startup(SurviveContext *ctx) {
 		SV_INFO("Force ootx flag set -- clearing ootx on all lighthouses");
 		for (int i = 0; i < ctx->activeLighthouses; i++) {
 			ctx->bsd[i].OOTXSet = 0;
+			ctx->bsd[i].OOTXCached = 0;
 			memset(ctx->bsd[i].fcal, 0, sizeof(ctx->bsd[i].fcal));
 		}
 	}
@@ -725,6 +785,8 @@ void survive_remove_object(SurviveContext *ctx, SurviveObject *obj) {
 	ctx->objs[ctx->objs_ct] = 0;
 
 	SV_INFO("Removing tracked object %s from %s", obj->codename, obj->drivername);
+	survive_telemetry_remove_object(ctx, obj);
+	survive_metrics_remove_object(ctx, obj);
 	free(obj);
 }
 
@@ -842,7 +904,9 @@ void survive_close(SurviveContext *ctx) {
 	ctx->PoserFn = 0;
 
 	config_save(ctx);
-
+	survive_cache_save(ctx);
+	survive_telemetry_free(ctx);
+	survive_metrics_free(ctx);
 
 	for (int i = 0; i < ctx->objs_ct; i++) {
 		survive_destroy_device(ctx->objs[i]);
@@ -853,6 +917,10 @@ void survive_close(SurviveContext *ctx) {
 	}
 
 	survive_destroy_recording(ctx);
+	survive_cache_free(ctx);
+	survive_device_config_cache_free(ctx);
+	survive_optimizer_close_capture(ctx);
+	survive_event_export_free(ctx);
 		
 	destroy_config_group(ctx->global_config_values);
 	destroy_config_group(ctx->temporary_config_values);
@@ -869,6 +937,7 @@ void survive_close(SurviveContext *ctx) {
 	struct SurviveContext_private *pctx = ctx->private_members;
 	OGDeleteSema(pctx->poll_sema);
 	free(pctx);
+	survive_clock_free(ctx);
 
 	free(ctx->objs);
 	free(ctx->drivers);
@@ -911,7 +980,8 @@ int survive_poll(struct SurviveContext *ctx) {
 	}
 
 	survive_release_ctx_lock(ctx);
-	if (ctx->poll_min_time_ms > 0) {
+	// With virtual time there is no real time to keep pace with
+	if (ctx->poll_min_time_ms > 0 && survive_clock_mode(ctx) != SURVIVE_CLOCK_VIRTUAL) {
 		uint64_t timeNow = OGGetAbsoluteTimeMS();
 		if ((timeStart + ctx->poll_min_time_ms) > timeNow) {
 			uint64_t sleepTime = (timeStart + ctx->poll_min_time_ms) - timeNow;
@@ -1017,20 +1087,13 @@ inline void survive_apply_ang_velocity(LinmathQuat out, const SurviveAngularVelo
 	quatrotateabout(out, rot_change, t0);
 }
 
-static double timestamp_in_s() {
-	static double start_time_s = 0;
-	if (start_time_s == 0.)
-		start_time_s = OGGetAbsoluteTime();
-	return OGGetAbsoluteTime() - start_time_s;
-}
-
 double survive_run_time(const SurviveContext *ctx) {
 	struct SurviveContext_private *pctx = ctx->private_members;
 	if (pctx->runTimeFn) {
 		return pctx->lastRunTime = pctx->runTimeFn(ctx, pctx->runTimeFnUser);
 	}
 
-	return pctx->lastRunTime = timestamp_in_s();
+	return pctx->lastRunTime = survive_clock_time(ctx);
 }
 
 double static_time(const SurviveContext *ctx, void *user) {
@@ -0,0 +1,68 @@
+#include "survive_arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct survive_arena_block {
+	struct survive_arena_block *next;
+	// Padding keeps the payload at SURVIVE_ARENA_ALIGNMENT
+	uint8_t padding[SURVIVE_ARENA_ALIGNMENT - sizeof(void *)];
+	uint8_t data[];
+} survive_arena_block;
+
+// Blocks come straight from malloc, which already aligns to 16 bytes on every platform we build for. Growth is tracked
+// through grow_cnt rather than the debug allocation counter, so an arena adapting to a larger problem doesn't trip
+// the steady state checks.
+static void *arena_malloc(size_t size) {
+	void *rtn = malloc(size);
+	if (rtn == 0) {
+		fprintf(stderr, "Survive: arena allocation of %lu bytes failed, exiting", (unsigned long)size);
+		exit(EXIT_FAILURE);
+	}
+	return rtn;
+}
+
+void survive_arena_init(survive_arena *arena, size_t capacity) {
+	*arena = (survive_arena){0};
+	if (capacity) {
+		arena->base = arena_malloc(capacity);
+		arena->capacity = capacity;
+	}
+}
+
+void *survive_arena_alloc_overflow(survive_arena *arena, size_t size) {
+	survive_arena_block *block = arena_malloc(sizeof(survive_arena_block) + size);
+	block->next = arena->overflow;
+	arena->overflow = block;
+	arena->grow_cnt++;
+	return block->data;
+}
+
+static void free_overflow(survive_arena *arena) {
+	while (arena->overflow) {
+		survive_arena_block *next = arena->overflow->next;
+		free(arena->overflow);
+		arena->overflow = next;
+	}
+}
+
+void survive_arena_reset(survive_arena *arena) {
+	if (arena->overflow) {
+		free_overflow(arena);
+
+		// Grow with some headroom so a slowly growing workload doesn't reallocate every cycle
+		size_t capacity = arena->requested + arena->requested / 2;
+		free(arena->base);
+		arena->base = arena_malloc(capacity);
+		arena->capacity = capacity;
+	}
+
+	arena->used = 0;
+	arena->requested = 0;
+}
+
+void survive_arena_free(survive_arena *arena) {
+	free_overflow(arena);
+	free(arena->base);
+	*arena = (survive_arena){0};
+}
@@ -5,7 +5,9 @@ static void run_buffer(survive_async_optimizer *self, uint8_t idx) {
 	self->active_buffer = idx;
 	OGUnlockMutex(self->active_buffer_lock);
 	self->completed++;
+	double start = OGGetAbsoluteTime();
 	int status = survive_optimizer_run(&self->buffers[idx].optimizer, &results);
+	self->buffers[idx].solve_time = OGGetAbsoluteTime() - start;
 	if (self->cb) {
 		self->cb(&self->buffers[idx], status, &results);
 	}
@@ -52,6 +54,7 @@ survive_async_optimizer_buffer *survive_async_optimizer_alloc_optimizer(struct s
 		rtn = &self->buffers[0];
 		self->buffer_ready[0] = false;
 	}
+	survive_arena_reset(&rtn->arena);
 	self->submitted++;
 	OGUnlockMutex(self->active_buffer_lock);
 	return rtn;
@@ -81,7 +84,7 @@ void survive_async_free(struct survive_async_optimizer *self) {
 	OGDeleteMutex(self->active_buffer_lock);
 
 	for (int i = 0; i < 2; i++) {
-		SURVIVE_OPTIMIZER_CLEANUP_HEAP_BUFFERS(self->buffers[i].optimizer);
+		survive_arena_free(&self->buffers[i].arena);
 		free(self->buffers[i].user);
 	}
 
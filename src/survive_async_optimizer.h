@@ -5,7 +5,11 @@
 
 typedef struct survive_async_optimizer_buffer {
 	survive_optimizer optimizer;
+	// Backs the optimizer buffers; reset each time the buffer is handed out
+	survive_arena arena;
 	void *user;
+	// Wall time the last solve in this buffer took
+	double solve_time;
 } survive_async_optimizer_buffer;
 
 typedef void (*survive_async_optimizer_cb)(struct survive_async_optimizer_buffer *buffer, int return_code,
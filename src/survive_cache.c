@@ -0,0 +1,302 @@
+#include "survive_cache.h"
+#include "survive_kalman_tracker.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+STATIC_CONFIG_ITEM(CALIBRATION_CACHE, "calibration-cache", 's',
+				   "Binary cache file for lighthouse OOTX / pose data and device IMU bias. Empty disables it.", "")
+
+static const char survive_cache_magic[8] = {'S', 'V', 'C', 'A', 'C', 'H', 'E', 0};
+
+typedef struct SurviveCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t lighthouse_size;
+	uint32_t device_size;
+	uint32_t lighthouse_cnt;
+	uint32_t device_cnt;
+	uint32_t reserved;
+} SurviveCacheHeader;
+
+static SurviveCacheLighthouse *find_lighthouse(SurviveCache *cache, uint8_t idx) {
+	for (size_t i = 0; i < cache->lighthouse_cnt; i++) {
+		if (cache->lighthouses[i].idx == idx)
+			return &cache->lighthouses[i];
+	}
+	return 0;
+}
+
+static SurviveCacheDevice *find_device(SurviveCache *cache, const char *serial_number) {
+	for (size_t i = 0; i < cache->device_cnt; i++) {
+		if (strncmp(cache->devices[i].serial_number, serial_number, sizeof(cache->devices[i].serial_number)) == 0)
+			return &cache->devices[i];
+	}
+	return 0;
+}
+
+static void cal_to_cache(double *out, const BaseStationCal *cal) {
+	out[0] = cal->phase;
+	out[1] = cal->tilt;
+	out[2] = cal->curve;
+	out[3] = cal->gibpha;
+	out[4] = cal->gibmag;
+	out[5] = cal->ogeephase;
+	out[6] = cal->ogeemag;
+}
+
+static void cal_from_cache(BaseStationCal *cal, const double *in) {
+	cal->phase = in[0];
+	cal->tilt = in[1];
+	cal->curve = in[2];
+	cal->gibpha = in[3];
+	cal->gibmag = in[4];
+	cal->ogeephase = in[5];
+	cal->ogeemag = in[6];
+}
+
+static bool apply_lighthouse(SurviveContext *ctx, const SurviveCacheLighthouse *entry) {
+	if (entry->idx >= NUM_GEN2_LIGHTHOUSES || entry->mode >= NUM_GEN2_CHANNELS)
+		return false;
+
+	BaseStationData *bsd = &ctx->bsd[entry->idx];
+	bool empty = bsd->mode == 0xFF;
+
+	if (empty) {
+		if (ctx->bsd_map[entry->mode] != -1)
+			return false;
+
+		*bsd = (BaseStationData){0};
+		bsd->mode = entry->mode;
+		bsd->BaseStationID = entry->BaseStationID;
+		ctx->bsd_map[entry->mode] = entry->idx;
+		if (ctx->activeLighthouses < entry->idx + 1) {
+			ctx->activeLighthouses = entry->idx + 1;
+		}
+	} else if (bsd->mode != entry->mode || (bsd->BaseStationID != 0 && bsd->BaseStationID != entry->BaseStationID)) {
+		SV_INFO("Calibration cache entry for LH %d (ID: %08x, mode: %d) does not match config (ID: %08x, mode: %d); "
+				"ignoring it",
+				entry->idx, (unsigned)entry->BaseStationID, entry->mode, (unsigned)bsd->BaseStationID, bsd->mode);
+		return false;
+	}
+
+	if (entry->OOTXSet) {
+		if (!bsd->OOTXSet) {
+			bsd->BaseStationID = entry->BaseStationID;
+			for (int i = 0; i < 2; i++) {
+				cal_from_cache(&bsd->fcal[i], entry->fcal[i]);
+			}
+			for (int i = 0; i < 3; i++) {
+				bsd->accel[i] = entry->accel[i];
+			}
+			bsd->OOTXSet = 1;
+			bsd->OOTXCached = 1;
+		}
+	}
+
+	if (entry->PositionSet && !bsd->PositionSet) {
+		for (int i = 0; i < 7; i++) {
+			bsd->Pose.Pos[i] = entry->pose[i];
+		}
+		bsd->confidence = entry->confidence;
+		bsd->PositionSet = 1;
+	}
+
+	SV_VERBOSE(10, "Restored LH %d (ID: %08x, mode: %2d) from calibration cache", entry->idx,
+			   (unsigned)bsd->BaseStationID, bsd->mode);
+	return true;
+}
+
+size_t survive_cache_bytes_left(FILE *f) {
+	long pos = ftell(f);
+	if (pos < 0 || fseek(f, 0L, SEEK_END) != 0)
+		return 0;
+	long end = ftell(f);
+	if (fseek(f, pos, SEEK_SET) != 0 || end < pos)
+		return 0;
+	return (size_t)(end - pos);
+}
+
+int survive_cache_load(SurviveContext *ctx, const char *path) {
+	if (ctx->cache == 0) {
+		ctx->cache = SV_CALLOC(1, sizeof(SurviveCache));
+	}
+	SurviveCache *cache = ctx->cache;
+	strncpy(cache->path, path, FILENAME_MAX - 1);
+
+	FILE *f = fopen(path, "rb");
+	if (f == 0) {
+		SV_VERBOSE(5, "No calibration cache found at '%s'", path);
+		return -1;
+	}
+
+	SurviveCacheHeader hdr = {0};
+	bool valid = fread(&hdr, sizeof(hdr), 1, f) == 1 && memcmp(hdr.magic, survive_cache_magic, sizeof(hdr.magic)) == 0;
+	if (!valid || hdr.version != SURVIVE_CACHE_VERSION || hdr.lighthouse_size != sizeof(SurviveCacheLighthouse) ||
+		hdr.device_size != sizeof(SurviveCacheDevice) || hdr.lighthouse_cnt > NUM_GEN2_LIGHTHOUSES ||
+		hdr.device_cnt > survive_cache_bytes_left(f) / sizeof(SurviveCacheDevice)) {
+		SV_WARN("Calibration cache '%s' is invalid or from a different version; ignoring it", path);
+		fclose(f);
+		return -1;
+	}
+
+	SurviveCacheDevice *devices = hdr.device_cnt ? SV_CALLOC(hdr.device_cnt, sizeof(SurviveCacheDevice)) : 0;
+	if (fread(cache->lighthouses, sizeof(SurviveCacheLighthouse), hdr.lighthouse_cnt, f) != hdr.lighthouse_cnt ||
+		fread(devices, sizeof(SurviveCacheDevice), hdr.device_cnt, f) != hdr.device_cnt) {
+		SV_WARN("Calibration cache '%s' is truncated; ignoring it", path);
+		free(devices);
+		memset(cache->lighthouses, 0, sizeof(cache->lighthouses));
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	free(cache->devices);
+	cache->devices = devices;
+	cache->device_cnt = hdr.device_cnt;
+	cache->lighthouse_cnt = hdr.lighthouse_cnt;
+
+	int restored = 0;
+	for (size_t i = 0; i < cache->lighthouse_cnt; i++) {
+		restored += apply_lighthouse(ctx, &cache->lighthouses[i]);
+	}
+
+	SV_INFO("Loaded calibration cache '%s' with %d lighthouse(s) and %d device(s)", path, restored,
+			(int)cache->device_cnt);
+	return restored;
+}
+
+static void update_cache(SurviveContext *ctx, SurviveCache *cache) {
+	for (int i = 0; i < ctx->activeLighthouses; i++) {
+		const BaseStationData *bsd = &ctx->bsd[i];
+		if (bsd->mode == 0xFF || (!bsd->OOTXSet && !bsd->PositionSet))
+			continue;
+
+		SurviveCacheLighthouse *entry = find_lighthouse(cache, i);
+		if (entry == 0) {
+			assert(cache->lighthouse_cnt < NUM_GEN2_LIGHTHOUSES);
+			entry = &cache->lighthouses[cache->lighthouse_cnt++];
+		}
+
+		*entry = (SurviveCacheLighthouse){
+			.BaseStationID = bsd->BaseStationID,
+			.idx = i,
+			.mode = bsd->mode,
+			.OOTXSet = bsd->OOTXSet,
+			.PositionSet = bsd->PositionSet,
+			.confidence = bsd->confidence,
+		};
+		for (int j = 0; j < 2; j++) {
+			cal_to_cache(entry->fcal[j], &bsd->fcal[j]);
+		}
+		for (int j = 0; j < 3; j++) {
+			entry->accel[j] = bsd->accel[j];
+		}
+		for (int j = 0; j < 7; j++) {
+			entry->pose[j] = bsd->Pose.Pos[j];
+		}
+	}
+
+	for (int i = 0; i < ctx->objs_ct; i++) {
+		SurviveObject *so = ctx->objs[i];
+		SurviveKalmanTracker *tracker = so->tracker;
+		if (so->serial_number[0] == 0 || tracker == 0 || !tracker->model_gyro_bias || tracker->stats.imu_count == 0)
+			continue;
+
+		SurviveCacheDevice *entry = find_device(cache, so->serial_number);
+		if (entry == 0) {
+			cache->devices = SV_REALLOC(cache->devices, (cache->device_cnt + 1) * sizeof(SurviveCacheDevice));
+			entry = &cache->devices[cache->device_cnt++];
+			memset(entry, 0, sizeof(*entry));
+			strncpy(entry->serial_number, so->serial_number, sizeof(entry->serial_number) - 1);
+		}
+
+		for (int j = 0; j < 3; j++) {
+			entry->gyro_bias[j] = tracker->state.GyroBias[j];
+		}
+	}
+}
+
+int survive_cache_save(SurviveContext *ctx) {
+	SurviveCache *cache = ctx->cache;
+	if (cache == 0)
+		return -1;
+
+	update_cache(ctx, cache);
+
+	// Write to a temporary file first so a crash mid-write never leaves a torn cache behind
+	char tmp_path[FILENAME_MAX + 8];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache->path);
+
+	FILE *f = fopen(tmp_path, "wb");
+	if (f == 0) {
+		static bool warnedOnce = false;
+		if (!warnedOnce) {
+			SV_WARN("Could not open '%.512s' for writing; calibration cache will not persist.", tmp_path);
+			warnedOnce = true;
+		}
+		return -1;
+	}
+
+	SurviveCacheHeader hdr = {
+		.version = SURVIVE_CACHE_VERSION,
+		.lighthouse_size = sizeof(SurviveCacheLighthouse),
+		.device_size = sizeof(SurviveCacheDevice),
+		.lighthouse_cnt = (uint32_t)cache->lighthouse_cnt,
+		.device_cnt = (uint32_t)cache->device_cnt,
+	};
+	memcpy(hdr.magic, survive_cache_magic, sizeof(hdr.magic));
+
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+			  fwrite(cache->lighthouses, sizeof(SurviveCacheLighthouse), cache->lighthouse_cnt, f) ==
+				  cache->lighthouse_cnt &&
+			  fwrite(cache->devices, sizeof(SurviveCacheDevice), cache->device_cnt, f) == cache->device_cnt;
+	ok &= fclose(f) == 0;
+
+	if (!ok) {
+		SV_WARN("Failed writing calibration cache '%.512s'", tmp_path);
+		remove(tmp_path);
+		return -1;
+	}
+
+#ifdef _WIN32
+	remove(cache->path);
+#endif
+	if (rename(tmp_path, cache->path) != 0) {
+		SV_WARN("Could not move calibration cache into place at '%.512s'", cache->path);
+		remove(tmp_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+void survive_cache_apply_device(SurviveObject *so) {
+	SurviveContext *ctx = so->ctx;
+	SurviveCache *cache = ctx->cache;
+	SurviveKalmanTracker *tracker = so->tracker;
+	if (cache == 0 || tracker == 0 || !tracker->model_gyro_bias || so->serial_number[0] == 0)
+		return;
+
+	SurviveCacheDevice *entry = find_device(cache, so->serial_number);
+	if (entry == 0)
+		return;
+
+	for (int i = 0; i < 3; i++) {
+		tracker->state.GyroBias[i] = entry->gyro_bias[i];
+	}
+	SV_VERBOSE(5, "Seeded gyro bias for %s (%s) from calibration cache " Point3_format, so->codename,
+			   so->serial_number, LINMATH_VEC3_EXPAND(tracker->state.GyroBias));
+}
+
+void survive_cache_free(SurviveContext *ctx) {
+	SurviveCache *cache = ctx->cache;
+	if (cache == 0)
+		return;
+
+	free(cache->devices);
+	free(cache);
+	ctx->cache = 0;
+}
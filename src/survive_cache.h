@@ -0,0 +1,82 @@
+#ifndef _SURVIVE_CACHE_H
+#define _SURVIVE_CACHE_H
+
+#include <survive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The calibration cache is a small binary file which holds everything libsurvive learns about the environment that is
+ * expensive to re-learn on startup:
+ *
+ * - OOTX / fcal data per lighthouse, keyed by BaseStationID
+ * - The last solved pose per lighthouse
+ * - The estimated gyro bias per device, keyed by serial number
+ *
+ * It is loaded before any drivers start. Lighthouse data restored from the cache is marked with `OOTXCached` so that
+ * the OOTX decoder keeps running and checks it against the live OOTX packets as they come in; if a lighthouse turns out
+ * to be a different unit the cached data is dropped.
+ */
+#define SURVIVE_CACHE_VERSION 1
+
+typedef struct SurviveCacheLighthouse {
+	double fcal[2][7];
+	double pose[7];
+	double confidence;
+
+	uint32_t BaseStationID;
+	uint8_t idx;
+	uint8_t mode;
+	uint8_t OOTXSet;
+	uint8_t PositionSet;
+	int8_t accel[3];
+	uint8_t reserved[5];
+} SurviveCacheLighthouse;
+
+typedef struct SurviveCacheDevice {
+	double gyro_bias[3];
+	char serial_number[16];
+} SurviveCacheDevice;
+
+typedef struct SurviveCache {
+	char path[FILENAME_MAX];
+
+	size_t lighthouse_cnt;
+	SurviveCacheLighthouse lighthouses[NUM_GEN2_LIGHTHOUSES];
+
+	size_t device_cnt;
+	SurviveCacheDevice *devices;
+} SurviveCache;
+
+/**
+ * Reads the cache file at `path` and applies the lighthouse data in it to the context. Returns the number of
+ * lighthouses restored, or -1 if there was no usable cache file. The context keeps the cache around afterwards so that
+ * device entries can be applied as devices connect, and so that it can be written back out.
+ */
+SURVIVE_EXPORT int survive_cache_load(SurviveContext *ctx, const char *path);
+
+/**
+ * Merges the current lighthouse and device state into the cache and writes it out.
+ */
+SURVIVE_EXPORT int survive_cache_save(SurviveContext *ctx);
+
+/**
+ * Seeds per-device state (gyro bias) from the cache. Called once the device serial number is known.
+ */
+SURVIVE_EXPORT void survive_cache_apply_device(SurviveObject *so);
+
+SURVIVE_EXPORT void survive_cache_free(SurviveContext *ctx);
+
+/**
+ * Bytes from the current position to the end of the file, or 0 if that can't be told. Cache readers check record
+ * counts from file headers against this before allocating for them.
+ */
+SURVIVE_EXPORT size_t survive_cache_bytes_left(FILE *f);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+#include "survive_clock.h"
+
+#include <os_generic.h>
+#include <stdlib.h>
+
+struct SurviveClock {
+	// Wall time the context was created
+	double created;
+
+	SurviveClockMode mode;
+	bool has_source;
+	double factor;
+
+	// Wall time, relative to created, that lines up with session time 0 when scaled
+	double source_start;
+	double session_time;
+};
+
+void survive_clock_init(SurviveContext *ctx) {
+	struct SurviveClock *clock = SV_CALLOC(1, sizeof(struct SurviveClock));
+	clock->created = OGGetAbsoluteTime();
+	ctx->clock = clock;
+}
+
+void survive_clock_free(SurviveContext *ctx) {
+	free(ctx->clock);
+	ctx->clock = 0;
+}
+
+SurviveClockMode survive_clock_mode(const SurviveContext *ctx) { return ctx->clock->mode; }
+
+double survive_clock_real_time(const SurviveContext *ctx) { return OGGetAbsoluteTime() - ctx->clock->created; }
+
+double survive_clock_time(const SurviveContext *ctx) {
+	const struct SurviveClock *clock = ctx->clock;
+	if (clock->has_source || clock->mode != SURVIVE_CLOCK_REAL)
+		return clock->session_time;
+	return survive_clock_real_time(ctx);
+}
+
+void survive_clock_set_factor(SurviveContext *ctx, double factor) {
+	struct SurviveClock *clock = ctx->clock;
+	if (factor < 0)
+		factor = 0;
+
+	// Rebase so the current session time is due right now at the new pace
+	clock->source_start = survive_clock_real_time(ctx) - clock->session_time * factor;
+	clock->factor = factor;
+	clock->mode = factor == 0 ? SURVIVE_CLOCK_VIRTUAL : SURVIVE_CLOCK_SCALED;
+}
+
+void survive_clock_attach_source(SurviveContext *ctx, double factor) {
+	struct SurviveClock *clock = ctx->clock;
+	if (clock->has_source) {
+		SV_WARN("A clock source is already attached; the last one attached drives session time");
+	}
+	clock->has_source = true;
+	clock->session_time = 0;
+	survive_clock_set_factor(ctx, factor);
+}
+
+void survive_clock_detach_source(SurviveContext *ctx) {
+	struct SurviveClock *clock = ctx->clock;
+	clock->has_source = false;
+}
+
+void survive_clock_advance(SurviveContext *ctx, double session_time) { ctx->clock->session_time = session_time; }
+
+double survive_clock_wait_time(const SurviveContext *ctx, double session_time) {
+	const struct SurviveClock *clock = ctx->clock;
+	if (!clock->has_source || clock->mode != SURVIVE_CLOCK_SCALED)
+		return 0;
+
+	double due = clock->source_start + session_time * clock->factor;
+	double wait = due - survive_clock_real_time(ctx);
+	return wait > 0 ? wait : 0;
+}
+
+uint64_t survive_clock_wait_until(const SurviveContext *ctx, double session_time) {
+	double wait = survive_clock_wait_time(ctx, session_time);
+	if (wait <= 0)
+		return 0;
+
+	uint64_t us = (uint64_t)(wait * 1e6) + 1;
+	OGUSleep((int)us);
+	return us;
+}
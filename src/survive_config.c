@@ -687,7 +687,14 @@ void handle_config_group(char *tag) {
 
 	int lhMatch = sscanf(tag, "lighthouse%d", &lh_idx);
 	if (lhMatch == 1) {
-		cg_stack[cg_stack_head] = survive_context->lh_config + lh_idx;
+		// Builds with a smaller NUM_GEN2_LIGHTHOUSES just drop the entries of lighthouses they can't track
+		if (lh_idx < 0 || lh_idx >= NUM_GEN2_LIGHTHOUSES) {
+			SurviveContext *ctx = survive_context;
+			SV_WARN("Ignoring config for %s; this build supports %d lighthouses", tag, NUM_GEN2_LIGHTHOUSES);
+			cg_stack[cg_stack_head] = 0;
+		} else {
+			cg_stack[cg_stack_head] = survive_context->lh_config + lh_idx;
+		}
 	} else {
 		cg_stack[cg_stack_head] = survive_context->global_config_values;
 	}
@@ -760,6 +767,8 @@ void handle_tag_value(char *tag, char **values, uint8_t count) {
 	// print_json_value(tag,values,count);
 
 	config_group *cg = cg_stack[cg_stack_head];
+	if (cg == NULL)
+		return;
 
 	if (NULL != *values) {
 		if (parse_uint32(tag, values, count) > 0)
@@ -1,6 +1,7 @@
 #include "survive_default_devices.h"
 #include "assert.h"
 #include "json_helpers.h"
+#include "survive_cache.h"
 #include "survive_kalman_tracker.h"
 #include <jsmn.h>
 #include <math.h>
@@ -82,7 +83,13 @@ static int ParsePoints(SurviveContext *ctx, SurviveObject *so, char *ct0conf, FL
 	
 	so->sensor_ct = 0;
 	assert(*floats_out == 0);
-	*floats_out = SV_CALLOC(1, sizeof(**floats_out) * 32 * 3);
+	*floats_out = SV_CALLOC(1, sizeof(**floats_out) * SENSORS_PER_OBJECT * 3);
+
+	if (pts > SENSORS_PER_OBJECT) {
+		SV_WARN("%s has %d sensors but this build only supports %d; ignoring the rest", so->codename, pts,
+				SENSORS_PER_OBJECT);
+		pts = SENSORS_PER_OBJECT;
+	}
 
 	for (int k = 0; k < pts; k++) {
 		tk = &t[2 + k * 4];
@@ -362,10 +369,7 @@ static int process_jsontok(scratch_space_t *scratch, char *d, stack_entry_t *sta
 	return 0;
 }
 
-int survive_load_htc_config_format(SurviveObject *so, char *ct0conf, int len) {
-	if (len == 0)
-		return -1;
-
+static int parse_htc_config_format(SurviveObject *so, char *ct0conf, int len) {
 	SurviveContext *ctx = so->ctx;
 	// From JSMN example.
 	jsmn_parser p;
@@ -447,6 +451,309 @@ int survive_load_htc_config_format(SurviveObject *so, char *ct0conf, int len) {
 	return 0;
 }
 
+STATIC_CONFIG_ITEM(DEVICE_CONFIG_CACHE, "device-config-cache", 's',
+				   "Binary cache file of parsed device configs, keyed by serial number. Empty disables it.", "")
+
+#define DEVICE_CONFIG_CACHE_VERSION 1
+#define DEVICE_CONFIG_CHANNEL_MAP_LEN 32
+
+static const char device_config_cache_magic[8] = {'S', 'V', 'D', 'E', 'V', 'C', 'F', 'G'};
+
+/**
+ * Everything survive_load_htc_config_format derives from a config blob. The variable length parts -- sensor locations,
+ * normals and the channel map -- follow each record in the file.
+ */
+typedef struct device_config_record {
+	char serial_number[16];
+	char codename[4];
+	uint32_t config_len;
+	uint64_t config_hash;
+
+	int32_t object_type;
+	int32_t object_subtype;
+	int32_t sensor_ct;
+	uint8_t has_sensor_locations;
+	uint8_t has_channel_map;
+	uint8_t reserved[6];
+
+	double imu_freq;
+	double acc_bias[3], acc_scale[3];
+	double gyro_bias[3], gyro_scale[3];
+	double head2trackref[7], imu2trackref[7], head2imu[7];
+} device_config_record;
+
+typedef struct device_config_entry {
+	device_config_record record;
+	double *sensor_locations;
+	double *sensor_normals;
+	int32_t channel_map[DEVICE_CONFIG_CHANNEL_MAP_LEN];
+} device_config_entry;
+
+typedef struct SurviveDeviceConfigCache {
+	char path[FILENAME_MAX];
+	size_t entry_cnt;
+	device_config_entry *entries;
+} SurviveDeviceConfigCache;
+
+typedef struct device_config_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t entry_cnt;
+	uint32_t reserved;
+} device_config_cache_header;
+
+static uint64_t hash_config(const char *ct0conf, int len) {
+	// FNV-1a; this only needs to tell configs apart, not resist tampering
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (int i = 0; i < len; i++) {
+		hash = (hash ^ (uint8_t)ct0conf[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static void copy_to_doubles(double *out, const FLT *in, size_t cnt) {
+	for (size_t i = 0; i < cnt; i++)
+		out[i] = in[i];
+}
+
+static void copy_from_doubles(FLT *out, const double *in, size_t cnt) {
+	for (size_t i = 0; i < cnt; i++)
+		out[i] = in[i];
+}
+
+static void device_config_entry_free(device_config_entry *entry) {
+	free(entry->sensor_locations);
+	free(entry->sensor_normals);
+	entry->sensor_locations = entry->sensor_normals = 0;
+}
+
+static bool read_device_config_cache(SurviveContext *ctx, SurviveDeviceConfigCache *cache) {
+	FILE *f = fopen(cache->path, "rb");
+	if (f == 0)
+		return false;
+
+	device_config_cache_header hdr = {0};
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, device_config_cache_magic, sizeof(hdr.magic)) != 0 ||
+		hdr.version != DEVICE_CONFIG_CACHE_VERSION || hdr.record_size != sizeof(device_config_record) ||
+		hdr.entry_cnt > survive_cache_bytes_left(f) / sizeof(device_config_record)) {
+		SV_WARN("Device config cache '%.512s' is invalid or from a different version; ignoring it", cache->path);
+		fclose(f);
+		return false;
+	}
+
+	cache->entries = SV_CALLOC(hdr.entry_cnt + 1, sizeof(device_config_entry));
+	for (cache->entry_cnt = 0; cache->entry_cnt < hdr.entry_cnt; cache->entry_cnt++) {
+		device_config_entry *entry = &cache->entries[cache->entry_cnt];
+		// Objects never have more sensors than SENSORS_PER_OBJECT; anything beyond that is a corrupt entry
+		if (fread(&entry->record, sizeof(entry->record), 1, f) != 1 || entry->record.sensor_ct < 0 ||
+			entry->record.sensor_ct > SENSORS_PER_OBJECT)
+			break;
+
+		size_t pts = entry->record.sensor_ct * 3;
+		entry->sensor_locations = SV_CALLOC(pts + 1, sizeof(double));
+		entry->sensor_normals = SV_CALLOC(pts + 1, sizeof(double));
+		if (fread(entry->sensor_locations, sizeof(double), pts, f) != pts ||
+			fread(entry->sensor_normals, sizeof(double), pts, f) != pts ||
+			(entry->record.has_channel_map &&
+			 fread(entry->channel_map, sizeof(entry->channel_map), 1, f) != 1)) {
+			device_config_entry_free(entry);
+			break;
+		}
+	}
+
+	if (cache->entry_cnt != hdr.entry_cnt) {
+		SV_WARN("Device config cache '%.512s' is truncated or corrupt; using the first %d entries", cache->path,
+				(int)cache->entry_cnt);
+	}
+
+	fclose(f);
+	return true;
+}
+
+static void write_device_config_cache(SurviveContext *ctx, const SurviveDeviceConfigCache *cache) {
+	char tmp_path[FILENAME_MAX + 8];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache->path);
+
+	FILE *f = fopen(tmp_path, "wb");
+	if (f == 0) {
+		SV_WARN("Could not open '%.512s' for writing; device config cache will not persist.", tmp_path);
+		return;
+	}
+
+	device_config_cache_header hdr = {
+		.version = DEVICE_CONFIG_CACHE_VERSION,
+		.record_size = sizeof(device_config_record),
+		.entry_cnt = (uint32_t)cache->entry_cnt,
+	};
+	memcpy(hdr.magic, device_config_cache_magic, sizeof(hdr.magic));
+
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	for (size_t i = 0; ok && i < cache->entry_cnt; i++) {
+		const device_config_entry *entry = &cache->entries[i];
+		size_t pts = entry->record.sensor_ct * 3;
+		ok = fwrite(&entry->record, sizeof(entry->record), 1, f) == 1 &&
+			 fwrite(entry->sensor_locations, sizeof(double), pts, f) == pts &&
+			 fwrite(entry->sensor_normals, sizeof(double), pts, f) == pts &&
+			 (!entry->record.has_channel_map || fwrite(entry->channel_map, sizeof(entry->channel_map), 1, f) == 1);
+	}
+	ok &= fclose(f) == 0;
+
+#ifdef _WIN32
+	if (ok)
+		remove(cache->path);
+#endif
+	if (!ok || rename(tmp_path, cache->path) != 0) {
+		SV_WARN("Failed writing device config cache '%.512s'", cache->path);
+		remove(tmp_path);
+	}
+}
+
+static SurviveDeviceConfigCache *get_device_config_cache(SurviveContext *ctx) {
+	if (ctx->device_config_cache)
+		return ctx->device_config_cache;
+
+	const char *path = survive_configs(ctx, DEVICE_CONFIG_CACHE_TAG, SC_GET, "");
+	if (path == 0 || *path == 0)
+		return 0;
+
+	SurviveDeviceConfigCache *cache = ctx->device_config_cache = SV_CALLOC(1, sizeof(SurviveDeviceConfigCache));
+	strncpy(cache->path, path, FILENAME_MAX - 1);
+	if (read_device_config_cache(ctx, cache)) {
+		SV_VERBOSE(10, "Loaded %d device configs from '%.512s'", (int)cache->entry_cnt, cache->path);
+	}
+	return cache;
+}
+
+static void apply_device_config_entry(SurviveObject *so, const device_config_entry *entry) {
+	const device_config_record *r = &entry->record;
+
+	memcpy(so->serial_number, r->serial_number, sizeof(so->serial_number));
+	so->object_type = (SurviveObjectType)r->object_type;
+	so->object_subtype = (SurviveObjectSubtype)r->object_subtype;
+	so->imu_freq = r->imu_freq;
+
+	copy_from_doubles(so->acc_bias, r->acc_bias, 3);
+	copy_from_doubles(so->acc_scale, r->acc_scale, 3);
+	copy_from_doubles(so->gyro_bias, r->gyro_bias, 3);
+	copy_from_doubles(so->gyro_scale, r->gyro_scale, 3);
+	copy_from_doubles(so->head2trackref.Pos, r->head2trackref, 7);
+	copy_from_doubles(so->imu2trackref.Pos, r->imu2trackref, 7);
+	copy_from_doubles(so->head2imu.Pos, r->head2imu, 7);
+
+	size_t pts = r->sensor_ct * 3;
+	free(so->sensor_locations);
+	free(so->sensor_normals);
+	so->sensor_ct = r->sensor_ct;
+	so->sensor_locations = SV_CALLOC(pts + 1, sizeof(FLT));
+	so->sensor_normals = SV_CALLOC(pts + 1, sizeof(FLT));
+	copy_from_doubles(so->sensor_locations, entry->sensor_locations, pts);
+	copy_from_doubles(so->sensor_normals, entry->sensor_normals, pts);
+	so->has_sensor_locations = r->has_sensor_locations;
+
+	free(so->channel_map);
+	so->channel_map = 0;
+	if (r->has_channel_map) {
+		so->channel_map = SV_MALLOC(sizeof(int) * DEVICE_CONFIG_CHANNEL_MAP_LEN);
+		for (int i = 0; i < DEVICE_CONFIG_CHANNEL_MAP_LEN; i++)
+			so->channel_map[i] = entry->channel_map[i];
+	}
+}
+
+static void store_device_config_entry(SurviveDeviceConfigCache *cache, SurviveObject *so, uint64_t hash, int len) {
+	device_config_entry *entry = 0;
+	for (size_t i = 0; i < cache->entry_cnt; i++) {
+		if (strncmp(cache->entries[i].record.serial_number, so->serial_number, sizeof(so->serial_number)) == 0 &&
+			strncmp(cache->entries[i].record.codename, so->codename, sizeof(so->codename)) == 0) {
+			entry = &cache->entries[i];
+			device_config_entry_free(entry);
+			break;
+		}
+	}
+
+	if (entry == 0) {
+		cache->entries = SV_REALLOC(cache->entries, (cache->entry_cnt + 1) * sizeof(device_config_entry));
+		entry = &cache->entries[cache->entry_cnt++];
+	}
+	memset(entry, 0, sizeof(*entry));
+
+	device_config_record *r = &entry->record;
+	memcpy(r->serial_number, so->serial_number, sizeof(r->serial_number));
+	memcpy(r->codename, so->codename, sizeof(r->codename));
+	r->config_len = len;
+	r->config_hash = hash;
+	r->object_type = so->object_type;
+	r->object_subtype = so->object_subtype;
+	r->sensor_ct = so->sensor_ct;
+	r->has_sensor_locations = so->has_sensor_locations;
+	r->has_channel_map = so->channel_map != 0;
+	r->imu_freq = so->imu_freq;
+
+	copy_to_doubles(r->acc_bias, so->acc_bias, 3);
+	copy_to_doubles(r->acc_scale, so->acc_scale, 3);
+	copy_to_doubles(r->gyro_bias, so->gyro_bias, 3);
+	copy_to_doubles(r->gyro_scale, so->gyro_scale, 3);
+	copy_to_doubles(r->head2trackref, so->head2trackref.Pos, 7);
+	copy_to_doubles(r->imu2trackref, so->imu2trackref.Pos, 7);
+	copy_to_doubles(r->head2imu, so->head2imu.Pos, 7);
+
+	size_t pts = so->sensor_ct * 3;
+	entry->sensor_locations = SV_CALLOC(pts + 1, sizeof(double));
+	entry->sensor_normals = SV_CALLOC(pts + 1, sizeof(double));
+	if (so->sensor_locations)
+		copy_to_doubles(entry->sensor_locations, so->sensor_locations, pts);
+	if (so->sensor_normals)
+		copy_to_doubles(entry->sensor_normals, so->sensor_normals, pts);
+	if (so->channel_map) {
+		for (int i = 0; i < DEVICE_CONFIG_CHANNEL_MAP_LEN; i++)
+			entry->channel_map[i] = so->channel_map[i];
+	}
+}
+
+int survive_load_htc_config_format(SurviveObject *so, char *ct0conf, int len) {
+	if (len == 0)
+		return -1;
+
+	SurviveContext *ctx = so->ctx;
+	SurviveDeviceConfigCache *cache = get_device_config_cache(ctx);
+	if (cache == 0) {
+		return parse_htc_config_format(so, ct0conf, len);
+	}
+
+	// The config blob is only ever handed to us whole, so a hash over it is enough to check that the cached entry
+	// still describes the device as it is now.
+	uint64_t hash = hash_config(ct0conf, len);
+	for (size_t i = 0; i < cache->entry_cnt; i++) {
+		const device_config_record *r = &cache->entries[i].record;
+		if (r->config_hash == hash && r->config_len == (uint32_t)len &&
+			strncmp(r->codename, so->codename, sizeof(so->codename)) == 0) {
+			apply_device_config_entry(so, &cache->entries[i]);
+			SV_VERBOSE(50, "Read config for %s (%s) from device config cache", so->codename, so->serial_number);
+			return 0;
+		}
+	}
+
+	int rtn = parse_htc_config_format(so, ct0conf, len);
+	if (rtn == 0 && so->serial_number[0]) {
+		store_device_config_entry(cache, so, hash, len);
+		write_device_config_cache(ctx, cache);
+	}
+	return rtn;
+}
+
+void survive_device_config_cache_free(SurviveContext *ctx) {
+	SurviveDeviceConfigCache *cache = ctx->device_config_cache;
+	if (cache == 0)
+		return;
+
+	for (size_t i = 0; i < cache->entry_cnt; i++) {
+		device_config_entry_free(&cache->entries[i]);
+	}
+	free(cache->entries);
+	free(cache);
+	ctx->device_config_cache = 0;
+}
+
 int survive_load_htc_config_format_from_file(SurviveObject *so, const char *filename) {
 	if (so == 0 || so->ctx == 0)
 		return -1;
@@ -469,8 +776,41 @@ int survive_load_htc_config_format_from_file(SurviveObject *so, const char *file
 	return -1;
 }
 
+size_t survive_report_device_memory(SurviveObject *so, int verbosity) {
+	SurviveContext *ctx = so->ctx;
+
+	size_t geometry = 0;
+	if (so->sensor_locations)
+		geometry += so->sensor_ct * 3 * sizeof(FLT);
+	if (so->sensor_normals)
+		geometry += so->sensor_ct * 3 * sizeof(FLT);
+	if (so->channel_map)
+		geometry += DEVICE_CONFIG_CHANNEL_MAP_LEN * sizeof(int);
+
+	size_t tracker = 0;
+	if (so->tracker) {
+		tracker = sizeof(SurviveKalmanTracker) +
+				  so->tracker->model.state_cnt * so->tracker->model.state_cnt * sizeof(FLT);
+	}
+
+	size_t total = sizeof(SurviveObject) + geometry + so->conf_cnt + tracker;
+
+	SV_VERBOSE(verbosity, "Memory for %s (%d lighthouses x %d sensors build)", so->codename, NUM_GEN2_LIGHTHOUSES,
+			   SENSORS_PER_OBJECT);
+	SV_VERBOSE(verbosity, "\tObject                    %8u", (unsigned)sizeof(SurviveObject));
+	SV_VERBOSE(verbosity, "\t\tSensor activations  %8u", (unsigned)sizeof(SurviveSensorActivations));
+	SV_VERBOSE(verbosity, "\tSensor geometry           %8u", (unsigned)geometry);
+	SV_VERBOSE(verbosity, "\tDevice config             %8u", (unsigned)so->conf_cnt);
+	SV_VERBOSE(verbosity, "\tKalman tracker            %8u", (unsigned)tracker);
+	SV_VERBOSE(verbosity, "\tTotal                     %8u", (unsigned)total);
+
+	return total;
+}
+
 void survive_destroy_device(SurviveObject *so) {
 	SurviveContext *ctx = so->ctx;
+	survive_report_device_memory(so, 5);
+
 	SV_VERBOSE(5, "Statistics for %s (driver %s)", so->codename, so->drivername);
 	SV_VERBOSE(5, "\tExtent hits               %6u", so->stats.extent_hits);
 	SV_VERBOSE(5, "\tNaive hits                %6u", so->stats.naive_hits);
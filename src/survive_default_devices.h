@@ -8,6 +8,13 @@ SURVIVE_EXPORT SurviveObject *survive_create_device(SurviveContext *ctx, const c
 
 SURVIVE_EXPORT void survive_destroy_device(SurviveObject *so);
 
+/**
+ * Logs how much memory the object holds -- the struct itself, which is sized by the NUM_GEN2_LIGHTHOUSES x
+ * SENSORS_PER_OBJECT capacities, plus what hangs off of it. Poser and disambiguator data aren't included. Returns the
+ * total in bytes.
+ */
+SURVIVE_EXPORT size_t survive_report_device_memory(SurviveObject *so, int verbosity);
+
 SURVIVE_EXPORT SurviveObject *survive_create_hmd(SurviveContext *ctx, const char *driver_name,
 								  void *driver);
 SURVIVE_EXPORT SurviveObject *survive_create_wm0(SurviveContext *ctx, const char *driver_name,
@@ -21,6 +28,11 @@ SURVIVE_EXPORT SurviveObject *survive_create_tr1(SurviveContext *ctx, const char
 SURVIVE_EXPORT SurviveObject *survive_create_ww0(SurviveContext *ctx, const char *driver_name,
 								  void *driver);
 
+/**
+ * Loads the vive JSON config blob into the object. If `device-config-cache` is set, configs which were parsed before
+ * are restored from the binary cache instead of being parsed again.
+ */
 SURVIVE_EXPORT int survive_load_htc_config_format(SurviveObject *so, char *ct0conf, int length);
+SURVIVE_EXPORT void survive_device_config_cache_free(SurviveContext *ctx);
 SURVIVE_EXPORT int survive_load_htc_config_format_from_file(SurviveObject *so, const char *filename);
 #endif
@@ -1,5 +1,6 @@
 #include "survive.h"
 
+#include "survive_internal.h"
 #include "survive_recording.h"
 #include <assert.h>
 #include <os_generic.h>
@@ -52,7 +53,7 @@ bool handle_lightcap(SurviveObject *so, const LightcapElement *_le) {
 		// positives while on gen2; we also check the timing -- it must see x correctly distanced 60/120hz pulses
 		// of the right length to get flagged in. This should be pretty solid -- LH2 all operate at <55hz, so they
 		// would have a hard time generating this signature.
-		bool isOOTXPulseLength = _le->length >= 3000 && _le->length < 6500;
+		bool isOOTXPulseLength = _le->length >= 3000 && _le->length < 6500 && _le->sensor_id < SENSORS_PER_OBJECT;
 		if (isOOTXPulseLength) {
 			uint32_t pulse_dist = _le->timestamp - dv->last_pulse_times[_le->sensor_id];
 			dv->last_pulse_times[_le->sensor_id] = _le->timestamp;
@@ -88,3 +89,40 @@ bool handle_lightcap(SurviveObject *so, const LightcapElement *_le) {
 
 	return true;
 }
+
+bool handle_lightcaps(SurviveObject *so, const LightcapElement *les, size_t cnt) {
+	SurviveContext *ctx = so->ctx;
+	lightcap_batch_process_func batch = survive_lightcap_batch_fn(ctx);
+
+	// Gen detection looks at pulses one at a time, and only runs until the first few hundred are in
+	if (batch == 0 || ctx->lh_version == -1) {
+		bool rtn = true;
+		for (size_t i = 0; i < cnt; i++) {
+			rtn &= handle_lightcap(so, &les[i]);
+		}
+		return rtn;
+	}
+
+	bool rtn = true;
+	LightcapElement mapped[SENSORS_PER_OBJECT];
+	while (cnt > 0) {
+		size_t chunk = cnt < SENSORS_PER_OBJECT ? cnt : SENSORS_PER_OBJECT, mapped_cnt = 0;
+		for (size_t i = 0; i < chunk; i++) {
+			LightcapElement le = les[i];
+			survive_recording_lightcap(so, &le);
+
+			le.sensor_id = survive_map_sensor_id(so, le.sensor_id);
+			if (le.sensor_id == (uint8_t)-1) {
+				rtn = false;
+				continue;
+			}
+			mapped[mapped_cnt++] = le;
+		}
+
+		batch(so, mapped, mapped_cnt);
+		les += chunk;
+		cnt -= chunk;
+	}
+
+	return rtn;
+}
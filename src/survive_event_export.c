@@ -0,0 +1,255 @@
+#include "survive_event_export.h"
+
+#include <os_generic.h>
+#include <string.h>
+
+typedef struct event_ring {
+	og_mutex_t lock;
+	uint8_t *data;
+	size_t record_size;
+	size_t capacity;
+	size_t head, count;
+	uint64_t dropped;
+} event_ring;
+
+typedef struct SurviveEventExport {
+	event_ring rings[SURVIVE_EVENT_EXPORT_TYPE_CNT];
+
+	// Null for hooks the exporter is not chained into
+	angle_process_func prior_angle;
+	sweep_angle_process_func prior_sweep_angle;
+	imu_process_func prior_imu;
+	pose_process_func prior_pose;
+} SurviveEventExport;
+
+static const size_t record_sizes[SURVIVE_EVENT_EXPORT_TYPE_CNT] = {
+	sizeof(SurviveLightEvent), sizeof(SurviveImuEvent), sizeof(SurvivePoseEvent)};
+
+size_t survive_event_export_record_size(SurviveEventExportType type) {
+	return type < SURVIVE_EVENT_EXPORT_TYPE_CNT ? record_sizes[type] : 0;
+}
+
+// Returns the slot to fill with the lock held, or null if the ring is full. The record is built in place so the hooks
+// only ever copy each event once.
+static void *ring_begin_push(event_ring *ring) {
+	OGLockMutex(ring->lock);
+	if (ring->count == ring->capacity) {
+		ring->dropped++;
+		OGUnlockMutex(ring->lock);
+		return 0;
+	}
+
+	size_t idx = (ring->head + ring->count) % ring->capacity;
+	return ring->data + idx * ring->record_size;
+}
+
+static void ring_end_push(event_ring *ring) {
+	ring->count++;
+	OGUnlockMutex(ring->lock);
+}
+
+static size_t ring_drain(event_ring *ring, uint8_t *dst, size_t max_cnt) {
+	OGLockMutex(ring->lock);
+	size_t cnt = ring->count < max_cnt ? ring->count : max_cnt;
+	if (cnt == 0) {
+		OGUnlockMutex(ring->lock);
+		return 0;
+	}
+
+	// At most two contiguous spans; the tail of the buffer and then its start
+	size_t first = ring->capacity - ring->head;
+	if (first > cnt)
+		first = cnt;
+	memcpy(dst, ring->data + ring->head * ring->record_size, first * ring->record_size);
+	memcpy(dst + first * ring->record_size, ring->data, (cnt - first) * ring->record_size);
+
+	ring->head = (ring->head + cnt) % ring->capacity;
+	ring->count -= cnt;
+	OGUnlockMutex(ring->lock);
+	return cnt;
+}
+
+static inline void copy_name(char *dst, const SurviveObject *so) {
+	memset(dst, 0, SURVIVE_EVENT_EXPORT_NAME_LEN);
+	strncpy(dst, so->codename, SURVIVE_EVENT_EXPORT_NAME_LEN - 1);
+}
+
+static void push_light(SurviveObject *so, int sensor_id, int lh, int plane, survive_timecode timecode, FLT angle,
+					   FLT length) {
+	SurviveContext *ctx = so->ctx;
+	event_ring *ring = &ctx->event_export->rings[SURVIVE_EVENT_EXPORT_LIGHT];
+	SurviveLightEvent *ev = ring_begin_push(ring);
+	if (ev == 0)
+		return;
+
+	ev->time = survive_run_time(ctx);
+	copy_name(ev->object, so);
+	ev->timecode = timecode;
+	ev->sensor_id = sensor_id;
+	ev->lh = lh;
+	ev->plane = plane;
+	ev->angle = angle;
+	ev->length = length;
+	ring_end_push(ring);
+}
+
+static void export_angle(SurviveObject *so, int sensor_id, int acode, survive_timecode timecode, FLT length, FLT angle,
+						 uint32_t lh) {
+	push_light(so, sensor_id, lh, acode & 1, timecode, angle, length);
+	so->ctx->event_export->prior_angle(so, sensor_id, acode, timecode, length, angle, lh);
+}
+
+static void export_sweep_angle(SurviveObject *so, survive_channel channel, int sensor_id, survive_timecode timecode,
+							   int8_t plane, FLT angle) {
+	push_light(so, sensor_id, survive_get_bsd_idx(so->ctx, channel), plane, timecode, angle, 0);
+	so->ctx->event_export->prior_sweep_angle(so, channel, sensor_id, timecode, plane, angle);
+}
+
+static void export_imu(SurviveObject *so, int mask, FLT *accelgyro, survive_timecode timecode, int id) {
+	SurviveContext *ctx = so->ctx;
+	event_ring *ring = &ctx->event_export->rings[SURVIVE_EVENT_EXPORT_IMU];
+	SurviveImuEvent *ev = ring_begin_push(ring);
+	if (ev) {
+		ev->time = survive_run_time(ctx);
+		copy_name(ev->object, so);
+		ev->timecode = timecode;
+		ev->mask = mask;
+		ev->id = id;
+		ev->reserved = 0;
+		for (int i = 0; i < 9; i++)
+			ev->accelgyro[i] = accelgyro[i];
+		ring_end_push(ring);
+	}
+
+	ctx->event_export->prior_imu(so, mask, accelgyro, timecode, id);
+}
+
+static void export_pose(SurviveObject *so, survive_timecode timecode, const SurvivePose *pose) {
+	SurviveContext *ctx = so->ctx;
+	event_ring *ring = &ctx->event_export->rings[SURVIVE_EVENT_EXPORT_POSE];
+	SurvivePoseEvent *ev = ring_begin_push(ring);
+	if (ev) {
+		ev->time = survive_run_time(ctx);
+		copy_name(ev->object, so);
+		ev->timecode = timecode;
+		ev->reserved = 0;
+		for (int i = 0; i < 3; i++)
+			ev->pos[i] = pose->Pos[i];
+		for (int i = 0; i < 4; i++)
+			ev->rot[i] = pose->Rot[i];
+		ring_end_push(ring);
+	}
+
+	ctx->event_export->prior_pose(so, timecode, pose);
+}
+
+int survive_event_export_install(SurviveContext *ctx, size_t capacity) {
+	if (capacity == 0)
+		return -1;
+
+	SurviveEventExport *e = ctx->event_export;
+	if (e == 0) {
+		e = SV_CALLOC(1, sizeof(SurviveEventExport));
+		for (int i = 0; i < SURVIVE_EVENT_EXPORT_TYPE_CNT; i++) {
+			e->rings[i].lock = OGCreateMutex();
+			e->rings[i].record_size = record_sizes[i];
+		}
+
+		ctx->event_export = e;
+	}
+
+	// After a free that left some hooks chained through the exporter, only the others need hooking again
+	if (e->prior_angle == 0)
+		e->prior_angle = survive_install_angle_fn(ctx, export_angle);
+	if (e->prior_sweep_angle == 0)
+		e->prior_sweep_angle = survive_install_sweep_angle_fn(ctx, export_sweep_angle);
+	if (e->prior_imu == 0)
+		e->prior_imu = survive_install_imu_fn(ctx, export_imu);
+	if (e->prior_pose == 0)
+		e->prior_pose = survive_install_pose_fn(ctx, export_pose);
+
+	for (int i = 0; i < SURVIVE_EVENT_EXPORT_TYPE_CNT; i++) {
+		event_ring *ring = &e->rings[i];
+		OGLockMutex(ring->lock);
+		ring->data = SV_REALLOC(ring->data, ring->record_size * capacity);
+		ring->capacity = capacity;
+		ring->head = ring->count = 0;
+		OGUnlockMutex(ring->lock);
+	}
+
+	SV_VERBOSE(10, "Exporting events with %lu records per buffer", (unsigned long)capacity);
+	return 0;
+}
+
+size_t survive_event_export_count(SurviveContext *ctx, SurviveEventExportType type) {
+	if (ctx->event_export == 0 || type >= SURVIVE_EVENT_EXPORT_TYPE_CNT)
+		return 0;
+
+	event_ring *ring = &ctx->event_export->rings[type];
+	OGLockMutex(ring->lock);
+	size_t rtn = ring->count;
+	OGUnlockMutex(ring->lock);
+	return rtn;
+}
+
+uint64_t survive_event_export_dropped(SurviveContext *ctx, SurviveEventExportType type) {
+	if (ctx->event_export == 0 || type >= SURVIVE_EVENT_EXPORT_TYPE_CNT)
+		return 0;
+
+	event_ring *ring = &ctx->event_export->rings[type];
+	OGLockMutex(ring->lock);
+	uint64_t rtn = ring->dropped;
+	OGUnlockMutex(ring->lock);
+	return rtn;
+}
+
+size_t survive_event_export_drain(SurviveContext *ctx, SurviveEventExportType type, void *dst, size_t max_cnt) {
+	if (ctx->event_export == 0 || type >= SURVIVE_EVENT_EXPORT_TYPE_CNT || dst == 0)
+		return 0;
+	return ring_drain(&ctx->event_export->rings[type], dst, max_cnt);
+}
+
+void survive_event_export_free(SurviveContext *ctx) {
+	SurviveEventExport *e = ctx->event_export;
+	if (e == 0)
+		return;
+
+	// A hook installed on top of the exporter still calls through it, so only the ones still on top are unhooked
+	if (ctx->angleproc == export_angle) {
+		survive_install_angle_fn(ctx, e->prior_angle);
+		e->prior_angle = 0;
+	}
+	if (ctx->sweep_angleproc == export_sweep_angle) {
+		survive_install_sweep_angle_fn(ctx, e->prior_sweep_angle);
+		e->prior_sweep_angle = 0;
+	}
+	if (ctx->imuproc == export_imu) {
+		survive_install_imu_fn(ctx, e->prior_imu);
+		e->prior_imu = 0;
+	}
+	if (ctx->poseproc == export_pose) {
+		survive_install_pose_fn(ctx, e->prior_pose);
+		e->prior_pose = 0;
+	}
+
+	bool chained = e->prior_angle || e->prior_sweep_angle || e->prior_imu || e->prior_pose;
+	if (chained) {
+		// The exporter stays in the chain, forwarding to the prior hooks without recording anything
+		for (int i = 0; i < SURVIVE_EVENT_EXPORT_TYPE_CNT; i++) {
+			event_ring *ring = &e->rings[i];
+			OGLockMutex(ring->lock);
+			free(ring->data);
+			ring->data = 0;
+			ring->capacity = ring->head = ring->count = 0;
+			OGUnlockMutex(ring->lock);
+		}
+		return;
+	}
+
+	ctx->event_export = 0;
+	for (int i = 0; i < SURVIVE_EVENT_EXPORT_TYPE_CNT; i++) {
+		OGDeleteMutex(e->rings[i].lock);
+		free(e->rings[i].data);
+	}
+	free(e);
+}
@@ -9,6 +9,8 @@
 #define gzwrite(file, buf, len) fwrite(buf, 1, len, file)
 #define gzeof feof
 #define gzseek fseek
+#define gztell ftell
+typedef long z_off_t;
 #define gzgetc fgetc
 #else
 #include <zlib.h>
@@ -26,6 +26,9 @@ void survive_load_plugins(const char *additional_plugin_dir);
 typedef double (*survive_run_time_fn)(const SurviveContext *ctx, void *user);
 SURVIVE_EXPORT void survive_install_run_time_fn(SurviveContext *ctx, survive_run_time_fn fn, void *user);
 
+// The batch entry point of the active disambiguator, or 0 if it has none or another lightcap hook was installed over it
+lightcap_batch_process_func survive_lightcap_batch_fn(const SurviveContext *ctx);
+
 #endif
 
 
@@ -102,6 +102,7 @@ void survive_kalman_state_init(survive_kalman_state_t *k, size_t state_cnt, kalm
 
 	k->Predict_fn = kalman_linear_predict;
 	k->user = user;
+	k->joseph_form = SURVIVE_KALMAN_JOSEPH_FORM_DEFAULT;
 
 	k->state = state;
 
@@ -166,10 +167,10 @@ static void survive_kalman_update_covariance(survive_kalman_state_t *k, survive_
 	for (int i = 0; i < H->rows; i++) {
 		for (int j = 0; j < H->rows; j++) {
 			if (i == j) {
-				diag += fabs(_S[i + j * H->rows]);
-				_iS[i + j * H->rows] = 1. / _S[i + j * H->rows];
+				diag += FLT_FABS(_S[i + j * H->rows]);
+				_iS[i + j * H->rows] = (FLT)1. / _S[i + j * H->rows];
 			} else {
-				non_diag += fabs(_S[i + j * H->rows]);
+				non_diag += FLT_FABS(_S[i + j * H->rows]);
 				_iS[i + j * H->rows] = 0;
 			}
 		}
@@ -195,8 +196,16 @@ static void survive_kalman_update_covariance(survive_kalman_state_t *k, survive_
 	CREATE_STACK_MAT(tmp, dims, dims);
 	cvCopy(&Pk_k, &tmp, 0);
 
-	// P_k|k = (I - K * H) * P_k|k-1
-	cvGEMM(&ikh, &tmp, 1, 0, 0, &Pk_k, 0);
+	if (k->joseph_form) {
+		// P_k|k = (I - K * H) * P_k|k-1 * (I - K * H)^T + K * R * K^T
+		// Costs an extra product but P stays symmetric positive semi-definite even when K is off from rounding
+		CREATE_STACK_MAT(KRKt, dims, dims);
+		matrix_ABAt_add(&KRKt, K, R, 0);
+		matrix_ABAt_add(&Pk_k, &ikh, &tmp, &KRKt);
+	} else {
+		// P_k|k = (I - K * H) * P_k|k-1
+		cvGEMM(&ikh, &tmp, 1, 0, 0, &Pk_k, 0);
+	}
 
 	if (log_level >= KALMAN_LOG_LEVEL) {
 		fprintf(stdout, "INFO gain\t");
@@ -30,6 +30,17 @@
 struct survive_kalman_state_s;
 struct CvMat;
 
+/**
+ * The short form of the covariance update, P = (I - KH)P, is only correct for the optimal gain and in single precision
+ * drifts away from symmetric / positive definite over long runs. The Joseph form is stable at the cost of another
+ * matrix product, so it's the default for USE_FLOAT builds.
+ */
+#ifdef USE_FLOAT
+#define SURVIVE_KALMAN_JOSEPH_FORM_DEFAULT 1
+#else
+#define SURVIVE_KALMAN_JOSEPH_FORM_DEFAULT 0
+#endif
+
 // Generates the transition matrix F
 typedef void (*kalman_transition_fn_t)(FLT dt, FLT *f_out, const struct CvMat *x0);
 
@@ -65,6 +76,9 @@ typedef struct survive_kalman_state_s {
 
 	// Current time
 	FLT t;
+
+	// Use the Joseph form of the covariance update; see SURVIVE_KALMAN_JOSEPH_FORM_DEFAULT
+	bool joseph_form;
 } survive_kalman_state_t;
 
 /**
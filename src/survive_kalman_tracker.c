@@ -4,6 +4,7 @@
 #include "survive_internal.h"
 #include "survive_kalman.h"
 #include "survive_kalman_tracker.h"
+#include "survive_metrics.h"
 #include <assert.h>
 #include <malloc.h>
 #include <memory.h>
@@ -169,8 +170,10 @@ void survive_kalman_tracker_integrate_light(SurviveKalmanTracker *tracker, Poser
 			.pdl = data,
 		};
 
+		double start = SURVIVE_METRIC_TIMER_START(tracker->light_latency);
 		FLT rtn = survive_kalman_predict_update_state_extended(time, &tracker->model, &Z, &tracker->light_var,
 															   map_light_data, &cbctx, tracker->adaptive_lightcap);
+		SURVIVE_METRIC_TIMER_STOP(tracker->light_latency, start);
 
 		tracker->stats.lightcap_total_error += rtn;
 
@@ -313,8 +316,10 @@ void survive_kalman_tracker_integrate_imu(SurviveKalmanTracker *tracker, PoserDa
 		SV_VERBOSE(600, "Integrating IMU " Point6_format " with cov " Point6_format,
 				   LINMATH_VEC6_EXPAND((FLT *)&data->accel[0]), LINMATH_VEC6_EXPAND(R));
 
+		double start = SURVIVE_METRIC_TIMER_START(tracker->imu_latency);
 		FLT err = survive_kalman_predict_update_state_extended(time, &tracker->model, &Z, R, map_imu_data, &fn_ctx,
 															   tracker->adaptive_imu);
+		SURVIVE_METRIC_TIMER_STOP(tracker->imu_latency, start);
 
 		tracker->stats.imu_total_error += err;
 		tracker->imu_residuals *= .9;
@@ -527,7 +532,9 @@ void survive_kalman_tracker_integrate_observation(PoserData *pd, SurviveKalmanTr
 	tracker->last_light_time = time;
 
 	if (tracker->obs_pos_var >= 0 && tracker->obs_rot_var >= 0) {
+		double start = SURVIVE_METRIC_TIMER_START(tracker->obs_latency);
 		tracker->stats.obs_total_error += integrate_pose(tracker, time, pose, tracker->adaptive_obs ? 0 : R);
+		SURVIVE_METRIC_TIMER_STOP(tracker->obs_latency, start);
 		tracker->stats.obs_count++;
 
 		survive_kalman_tracker_report_state(pd, tracker);
@@ -575,6 +582,8 @@ STATIC_CONFIG_ITEM(IMU_GYRO_VARIANCE, "imu-gyro-variance", 'f', "Variance of gyr
 
 STATIC_CONFIG_ITEM(USE_IMU, "use-imu", 'i', "Use the IMU as part of the pose solver", 1)
 STATIC_CONFIG_ITEM(USE_KALMAN, "use-kalman", 'i', "Apply kalman filter as part of the pose solver", 1)
+STATIC_CONFIG_ITEM(KALMAN_JOSEPH_FORM, "kalman-joseph-form", 'i',
+				   "Use the numerically stable Joseph form covariance update", SURVIVE_KALMAN_JOSEPH_FORM_DEFAULT)
 
 typedef void (*survive_attach_detach_fn)(SurviveContext *ctx, const char *tag, FLT *var);
 
@@ -652,6 +661,18 @@ void survive_kalman_tracker_init(SurviveKalmanTracker *tracker, SurviveObject *s
 
 	tracker->use_error_for_lh_pos = survive_configi(ctx, KALMAN_USE_ERROR_FOR_LH_CONFIDENCE_TAG, SC_GET, 1);
 
+	const char *update_help = "Time taken by a kalman update";
+	char labels[64];
+	snprintf(labels, sizeof(labels), "object=\"%s\",update=\"imu\"", so->codename);
+	tracker->imu_latency =
+		survive_metric_register(ctx, SURVIVE_METRIC_HISTOGRAM, "survive_kalman_update_seconds", update_help, labels);
+	snprintf(labels, sizeof(labels), "object=\"%s\",update=\"light\"", so->codename);
+	tracker->light_latency =
+		survive_metric_register(ctx, SURVIVE_METRIC_HISTOGRAM, "survive_kalman_update_seconds", update_help, labels);
+	snprintf(labels, sizeof(labels), "object=\"%s\",update=\"observation\"", so->codename);
+	tracker->obs_latency =
+		survive_metric_register(ctx, SURVIVE_METRIC_HISTOGRAM, "survive_kalman_update_seconds", update_help, labels);
+
 	survive_kalman_tracker_config(tracker, survive_attach_configf);
 
 	bool use_imu = (bool)survive_configi(ctx, "use-imu", SC_GET, 1);
@@ -681,6 +702,8 @@ void survive_kalman_tracker_init(SurviveKalmanTracker *tracker, SurviveObject *s
 	survive_kalman_state_init(&tracker->model, state_cnt, model_predict_jac, model_q_fn, tracker,
 							  (FLT *)&tracker->state);
 	tracker->model.Predict_fn = model_predict;
+	tracker->model.joseph_form =
+		survive_configi(ctx, KALMAN_JOSEPH_FORM_TAG, SC_GET, SURVIVE_KALMAN_JOSEPH_FORM_DEFAULT) != 0;
 
 	survive_kalman_tracker_reinit(tracker);
 
@@ -87,6 +87,9 @@ typedef struct SurviveKalmanTracker {
 	FLT Lightcap_R;
 
 	bool use_error_for_lh_pos;
+
+	// Null unless metrics are enabled
+	struct SurviveMetric *imu_latency, *light_latency, *obs_latency;
 } SurviveKalmanTracker;
 
 SURVIVE_EXPORT SurviveVelocity survive_kalman_tracker_velocity(const SurviveKalmanTracker *tracker);
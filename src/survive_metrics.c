@@ -0,0 +1,453 @@
+#include "survive_metrics.h"
+#include "survive_config.h"
+#include "survive_event_export.h"
+#include "survive_str.h"
+#include "survive_telemetry.h"
+
+#include <os_generic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+STATIC_CONFIG_ITEM(METRICS, "metrics", 'i', "Collect tracking metrics; see survive_metrics_format", 0)
+STATIC_CONFIG_ITEM(METRICS_PORT, "metrics-port", 'i',
+				   "Serve tracking metrics in the Prometheus text format on this localhost port; 0 to disable", 0)
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define METRIC_THREAD_LOCAL __declspec(thread)
+#define metric_atomic_add(ptr, v) InterlockedExchangeAdd64((volatile LONG64 *)(ptr), (LONG64)(v))
+#define metric_atomic_load(ptr) InterlockedCompareExchange64((volatile LONG64 *)(ptr), 0, 0)
+#define metric_atomic_store(ptr, v) InterlockedExchange64((volatile LONG64 *)(ptr), (LONG64)(v))
+#else
+#define METRIC_THREAD_LOCAL __thread
+#define metric_atomic_add(ptr, v) __atomic_fetch_add(ptr, v, __ATOMIC_RELAXED)
+#define metric_atomic_load(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define metric_atomic_store(ptr, v) __atomic_store_n(ptr, v, __ATOMIC_RELAXED)
+#endif
+
+// Each thread increments its own cache line of a counter, so the hot paths on different threads never contend
+#define METRIC_SHARDS 8
+#define METRIC_NAME_LEN 64
+#define METRIC_LABELS_LEN 96
+
+static const double histogram_buckets[] = {10e-6, 25e-6, 50e-6, 100e-6, 250e-6, 500e-6, 1e-3,
+										   2.5e-3, 5e-3,  10e-3, 25e-3,  50e-3,  100e-3, 250e-3};
+#define METRIC_BUCKET_CNT (sizeof(histogram_buckets) / sizeof(histogram_buckets[0]))
+
+typedef struct metric_shard {
+	uint64_t value;
+	uint8_t padding[64 - sizeof(uint64_t)];
+} metric_shard;
+
+struct SurviveMetric {
+	SurviveMetricType type;
+	char name[METRIC_NAME_LEN];
+	char labels[METRIC_LABELS_LEN];
+	const char *help;
+
+	union {
+		metric_shard shards[METRIC_SHARDS];
+		// Gauges hold the bits of a double
+		uint64_t gauge;
+		struct {
+			// Non cumulative; the scrape sums them up. The last one is +Inf.
+			uint64_t buckets[METRIC_BUCKET_CNT + 1];
+			uint64_t sum_ns;
+		} histogram;
+	} u;
+};
+
+typedef struct SurviveMetrics {
+	SurviveContext *ctx;
+
+	// Guards the registry and object list; only taken to register metrics and to scrape
+	og_mutex_t lock;
+	SurviveMetric **metrics;
+	size_t metrics_cnt;
+	SurviveObject **objs;
+	size_t objs_cnt;
+
+	new_object_process_func prior_new_object;
+
+	int listen_fd;
+	volatile bool running;
+	og_thread_t thread;
+} SurviveMetrics;
+
+static uint32_t next_shard;
+static int thread_shard() {
+	static METRIC_THREAD_LOCAL int shard = -1;
+	if (shard < 0)
+		shard = (int)(metric_atomic_add(&next_shard, 1) % METRIC_SHARDS);
+	return shard;
+}
+
+SurviveMetric *survive_metric_register(SurviveContext *ctx, SurviveMetricType type, const char *name,
+									   const char *help, const char *labels) {
+	SurviveMetrics *m = ctx->metrics;
+	if (m == 0)
+		return 0;
+	if (labels == 0)
+		labels = "";
+
+	OGLockMutex(m->lock);
+	SurviveMetric *rtn = 0;
+	for (size_t i = 0; i < m->metrics_cnt && rtn == 0; i++) {
+		if (strcmp(m->metrics[i]->name, name) == 0 && strcmp(m->metrics[i]->labels, labels) == 0)
+			rtn = m->metrics[i];
+	}
+
+	if (rtn == 0) {
+		rtn = SV_CALLOC(1, sizeof(SurviveMetric));
+		rtn->type = type;
+		rtn->help = help;
+		strncpy(rtn->name, name, METRIC_NAME_LEN - 1);
+		strncpy(rtn->labels, labels, METRIC_LABELS_LEN - 1);
+
+		m->metrics = SV_REALLOC(m->metrics, sizeof(SurviveMetric *) * (m->metrics_cnt + 1));
+		m->metrics[m->metrics_cnt++] = rtn;
+	} else if (rtn->type != type) {
+		SV_WARN("Metric %s{%s} was registered with two different types", name, labels);
+		rtn = 0;
+	}
+	OGUnlockMutex(m->lock);
+	return rtn;
+}
+
+void survive_metric_add(SurviveMetric *metric, uint64_t value) {
+	if (metric)
+		metric_atomic_add(&metric->u.shards[thread_shard()].value, value);
+}
+
+void survive_metric_set(SurviveMetric *metric, double value) {
+	if (metric) {
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		metric_atomic_store(&metric->u.gauge, bits);
+	}
+}
+
+void survive_metric_observe(SurviveMetric *metric, double seconds) {
+	if (metric == 0)
+		return;
+
+	size_t bucket = 0;
+	while (bucket < METRIC_BUCKET_CNT && seconds > histogram_buckets[bucket])
+		bucket++;
+	metric_atomic_add(&metric->u.histogram.buckets[bucket], 1);
+	metric_atomic_add(&metric->u.histogram.sum_ns, (uint64_t)(seconds * 1e9));
+}
+
+static void format_metric(cstring *out, const SurviveMetric *metric) {
+	const char *sep = *metric->labels ? "," : "";
+	char labels[METRIC_LABELS_LEN + 2] = "";
+	if (*metric->labels)
+		snprintf(labels, sizeof(labels), "{%s}", metric->labels);
+
+	switch (metric->type) {
+	case SURVIVE_METRIC_COUNTER: {
+		uint64_t total = 0;
+		for (int i = 0; i < METRIC_SHARDS; i++)
+			total += metric_atomic_load(&metric->u.shards[i].value);
+		str_append_printf(out, "%s%s %llu\n", metric->name, labels, (unsigned long long)total);
+		break;
+	}
+	case SURVIVE_METRIC_GAUGE: {
+		uint64_t bits = metric_atomic_load(&metric->u.gauge);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		str_append_printf(out, "%s%s %g\n", metric->name, labels, value);
+		break;
+	}
+	case SURVIVE_METRIC_HISTOGRAM: {
+		uint64_t cnt = 0;
+		for (size_t i = 0; i <= METRIC_BUCKET_CNT; i++) {
+			cnt += metric_atomic_load(&metric->u.histogram.buckets[i]);
+			if (i < METRIC_BUCKET_CNT) {
+				str_append_printf(out, "%s_bucket{%s%sle=\"%g\"} %llu\n", metric->name, metric->labels, sep,
+								  histogram_buckets[i], (unsigned long long)cnt);
+			} else {
+				str_append_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", metric->name, metric->labels, sep,
+								  (unsigned long long)cnt);
+			}
+		}
+		str_append_printf(out, "%s_sum%s %.9f\n", metric->name, labels,
+						  metric_atomic_load(&metric->u.histogram.sum_ns) / 1e9);
+		str_append_printf(out, "%s_count%s %llu\n", metric->name, labels, (unsigned long long)cnt);
+		break;
+	}
+	}
+}
+
+static void format_header(cstring *out, const char *name, const char *type, const char *help) {
+	if (help)
+		str_append_printf(out, "# HELP %s %s\n", name, help);
+	str_append_printf(out, "# TYPE %s %s\n", name, type);
+}
+
+#define OBJECT_COUNTER(field, metric_name, help)                                                                       \
+	{offsetof(SurviveTelemetrySample, field), sizeof(((SurviveTelemetrySample *)0)->field), metric_name, help}
+
+static const struct object_counter {
+	size_t offset, size;
+	const char *name, *help;
+} object_counters[] = {
+	OBJECT_COUNTER(syncs, "survive_syncs_total", "Syncs seen from all lighthouses"),
+	OBJECT_COUNTER(skipped_syncs, "survive_skipped_syncs_total", "Syncs skipped"),
+	OBJECT_COUNTER(bad_syncs, "survive_bad_syncs_total", "Syncs with bad timing"),
+	OBJECT_COUNTER(hit_from_lhs, "survive_light_hits_total", "Light hits from all lighthouses"),
+	OBJECT_COUNTER(rejected_data, "survive_light_rejected_total", "Light data rejected"),
+	OBJECT_COUNTER(dropped_light, "survive_light_dropped_total", "Light data dropped"),
+	OBJECT_COUNTER(late_imu_dropped, "survive_kalman_late_imu_total", "IMU updates dropped for being late"),
+	OBJECT_COUNTER(late_light_dropped, "survive_kalman_late_light_total", "Light updates dropped for being late"),
+	OBJECT_COUNTER(reported_poses, "survive_poses_reported_total", "Poses reported by the kalman tracker"),
+	OBJECT_COUNTER(dropped_poses, "survive_poses_dropped_total", "Poses withheld for their variance"),
+	OBJECT_COUNTER(optimizer_meas_cnt, "survive_optimizer_meas_total", "Measurements given to the optimizer"),
+	OBJECT_COUNTER(optimizer_dropped_meas_cnt, "survive_optimizer_meas_dropped_total",
+				   "Measurements the optimizer dropped as outliers"),
+};
+
+static void format_objects(cstring *out, SurviveMetrics *m) {
+	double now = survive_run_time(m->ctx);
+	SurviveTelemetrySample *samples = SV_MALLOC(sizeof(SurviveTelemetrySample) * (m->objs_cnt + 1));
+	for (size_t i = 0; i < m->objs_cnt; i++)
+		survive_telemetry_sample(m->objs[i], now, &samples[i]);
+
+	for (size_t c = 0; c < sizeof(object_counters) / sizeof(object_counters[0]) && m->objs_cnt; c++) {
+		const struct object_counter *counter = &object_counters[c];
+		format_header(out, counter->name, "counter", counter->help);
+		for (size_t i = 0; i < m->objs_cnt; i++) {
+			const uint8_t *field = (const uint8_t *)&samples[i] + counter->offset;
+			unsigned long long value = counter->size == sizeof(uint64_t) ? *(const uint64_t *)field
+																		   : *(const uint32_t *)field;
+			str_append_printf(out, "%s{object=\"%s\"} %llu\n", counter->name, samples[i].object, value);
+		}
+	}
+
+	if (m->objs_cnt) {
+		format_header(out, "survive_pose_confidence", "gauge", "Pose confidence reported by the poser");
+		for (size_t i = 0; i < m->objs_cnt; i++)
+			str_append_printf(out, "survive_pose_confidence{object=\"%s\"} %g\n", samples[i].object,
+							  (double)m->objs[i]->poseConfidence);
+	}
+	free(samples);
+}
+
+static void format_context(cstring *out, SurviveContext *ctx) {
+	format_header(out, "survive_lighthouse_confidence", "gauge", "Confidence in each lighthouse's position");
+	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
+		const BaseStationData *bsd = &ctx->bsd[i];
+		if (bsd->mode == 0xFF)
+			continue;
+		str_append_printf(out, "survive_lighthouse_confidence{lh=\"%d\",channel=\"%d\"} %g\n", i, bsd->mode,
+						  bsd->PositionSet ? (double)bsd->confidence : 0.);
+	}
+
+	format_header(out, "survive_queue_depth", "gauge", "Entries waiting in internal queues");
+	str_append_printf(out, "survive_queue_depth{queue=\"button\"} %lu\n",
+					  (unsigned long)survive_input_event_count(ctx));
+	if (ctx->event_export) {
+		static const char *names[SURVIVE_EVENT_EXPORT_TYPE_CNT] = {"export_light", "export_imu", "export_pose"};
+		for (int i = 0; i < SURVIVE_EVENT_EXPORT_TYPE_CNT; i++) {
+			str_append_printf(out, "survive_queue_depth{queue=\"%s\"} %lu\n", names[i],
+							  (unsigned long)survive_event_export_count(ctx, (SurviveEventExportType)i));
+		}
+	}
+}
+
+char *survive_metrics_format(SurviveContext *ctx) {
+	SurviveMetrics *m = ctx->metrics;
+	cstring out = {0};
+	if (m == 0) {
+		str_append(&out, "");
+		return out.d;
+	}
+
+	static const char *type_names[] = {"counter", "gauge", "histogram"};
+
+	OGLockMutex(m->lock);
+	for (size_t i = 0; i < m->metrics_cnt; i++) {
+		const SurviveMetric *metric = m->metrics[i];
+
+		// Each family gets one header, followed by all of its label sets
+		bool seen = false;
+		for (size_t j = 0; j < i && !seen; j++)
+			seen = strcmp(m->metrics[j]->name, metric->name) == 0;
+		if (seen)
+			continue;
+
+		format_header(&out, metric->name, type_names[metric->type], metric->help);
+		for (size_t j = i; j < m->metrics_cnt; j++) {
+			if (strcmp(m->metrics[j]->name, metric->name) == 0)
+				format_metric(&out, m->metrics[j]);
+		}
+	}
+	format_objects(&out, m);
+	OGUnlockMutex(m->lock);
+
+	format_context(&out, ctx);
+	return out.d;
+}
+
+static void add_object(SurviveMetrics *m, SurviveObject *so) {
+	OGLockMutex(m->lock);
+	m->objs = SV_REALLOC(m->objs, sizeof(SurviveObject *) * (m->objs_cnt + 1));
+	m->objs[m->objs_cnt++] = so;
+	OGUnlockMutex(m->lock);
+}
+
+static void metrics_new_object(SurviveObject *so) {
+	SurviveMetrics *m = so->ctx->metrics;
+	add_object(m, so);
+	m->prior_new_object(so);
+}
+
+void survive_metrics_remove_object(SurviveContext *ctx, SurviveObject *so) {
+	SurviveMetrics *m = ctx->metrics;
+	if (m == 0)
+		return;
+
+	OGLockMutex(m->lock);
+	for (size_t i = 0; i < m->objs_cnt; i++) {
+		if (m->objs[i] == so) {
+			m->objs[i] = m->objs[--m->objs_cnt];
+			break;
+		}
+	}
+	OGUnlockMutex(m->lock);
+}
+
+#ifndef _WIN32
+static void write_all(int fd, const char *data, size_t len) {
+	while (len > 0) {
+		ssize_t written = write(fd, data, len);
+		if (written <= 0)
+			return;
+		data += written;
+		len -= written;
+	}
+}
+
+static void serve_client(SurviveMetrics *m, int fd) {
+	// Scrapers send tiny requests; only the request line matters
+	char request[1024] = {0};
+	struct pollfd pfd = {.fd = fd, .events = POLLIN};
+	if (poll(&pfd, 1, 1000) <= 0 || read(fd, request, sizeof(request) - 1) <= 0)
+		return;
+
+	char header[256];
+	if (strncmp(request, "GET /metrics", 12) != 0 && strncmp(request, "GET / ", 6) != 0) {
+		const char *not_found = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		write_all(fd, not_found, strlen(not_found));
+		return;
+	}
+
+	char *body = survive_metrics_format(m->ctx);
+	size_t body_len = strlen(body);
+	int header_len = snprintf(header, sizeof(header),
+							  "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %lu\r\n"
+							  "Connection: close\r\n\r\n",
+							  (unsigned long)body_len);
+	write_all(fd, header, header_len);
+	write_all(fd, body, body_len);
+	free(body);
+}
+
+static void *metrics_thread(void *_m) {
+	SurviveMetrics *m = _m;
+	while (m->running) {
+		// Wake up regularly to notice shutdown
+		struct pollfd pfd = {.fd = m->listen_fd, .events = POLLIN};
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		int fd = accept(m->listen_fd, 0, 0);
+		if (fd < 0)
+			continue;
+		serve_client(m, fd);
+		close(fd);
+	}
+	return 0;
+}
+
+static int open_listener(SurviveContext *ctx, int port) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	int reuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons((uint16_t)port)};
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+		SV_WARN("Could not listen for metrics on localhost:%d", port);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+#endif
+
+void survive_metrics_install(SurviveContext *ctx) {
+	int port = survive_configi(ctx, METRICS_PORT_TAG, SC_GET, 0);
+	if (port <= 0 && !survive_configi(ctx, METRICS_TAG, SC_GET, 0))
+		return;
+
+	SurviveMetrics *m = SV_CALLOC(1, sizeof(SurviveMetrics));
+	m->ctx = ctx;
+	m->lock = OGCreateMutex();
+	m->listen_fd = -1;
+	ctx->metrics = m;
+
+	for (int i = 0; i < ctx->objs_ct; i++)
+		add_object(m, ctx->objs[i]);
+	m->prior_new_object = survive_install_new_object_fn(ctx, metrics_new_object);
+
+	if (port > 0) {
+#ifndef _WIN32
+		m->listen_fd = open_listener(ctx, port);
+		if (m->listen_fd >= 0) {
+			m->running = true;
+			m->thread = OGCreateThread(metrics_thread, "metrics", m);
+			SV_INFO("Serving metrics on http://localhost:%d/metrics", port);
+		}
+#else
+		SV_WARN("metrics-port isn't supported on this platform");
+#endif
+	}
+}
+
+void survive_metrics_free(SurviveContext *ctx) {
+	SurviveMetrics *m = ctx->metrics;
+	if (m == 0)
+		return;
+
+#ifndef _WIN32
+	if (m->running) {
+		m->running = false;
+		OGJoinThread(m->thread);
+	}
+	if (m->listen_fd >= 0)
+		close(m->listen_fd);
+#endif
+
+	survive_install_new_object_fn(ctx, m->prior_new_object);
+	ctx->metrics = 0;
+
+	for (size_t i = 0; i < m->metrics_cnt; i++)
+		free(m->metrics[i]);
+	free(m->metrics);
+	free(m->objs);
+	OGDeleteMutex(m->lock);
+	free(m);
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <linmath_inline.h>
 #include <math.h>
 #include <survive_optimizer.h>
 #include <survive_reproject.h>
@@ -197,7 +198,7 @@ static inline void run_pair_measurement(survive_optimizer *mpfunc_ctx, size_t me
 	const FLT *pt = &sensor_points[meas->sensor_idx * 3];
 
 	LinmathPoint3d sensorPtInLH;
-	ApplyAxisAnglePoseToPoint(sensorPtInLH, obj2lh, pt);
+	ApplyAxisAnglePoseToPoint_inline(sensorPtInLH, obj2lh, pt);
 
 	FLT out[2];
 	reprojectModel->reprojectXY(cal, sensorPtInLH, out);
@@ -267,7 +268,7 @@ static void run_single_measurement(survive_optimizer *mpfunc_ctx, size_t meas_id
 
 	LinmathPoint3d sensorPtInLH;
 	/*Transform position of sensor from tracker to lighthouse frame*/
-	ApplyAxisAnglePoseToPoint(sensorPtInLH, obj2lh, pt);
+	ApplyAxisAnglePoseToPoint_inline(sensorPtInLH, obj2lh, pt);
 	/*Deviation of estimate from measurement*/
 	FLT out = reprojectModel->reprojectAxisFn[meas->axis](cal, sensorPtInLH);
 	deviates[0] = (out - meas->value) / meas->variance;
@@ -446,7 +447,7 @@ static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *priva
 				/*
 				 * This function SETS obj2lh !!!
 				 */
-				ApplyAxisAnglePoseToPose(&obj2lh[lh], (const LinmathAxisAnglePose *)&cameras[lh], pose);
+				ApplyAxisAnglePoseToPose_inline(&obj2lh[lh], (const LinmathAxisAnglePose *)&cameras[lh], pose);
 			}
 		}
 
@@ -460,7 +461,7 @@ static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *priva
 								meas[0].sensor_idx == meas[1].sensor_idx && !meas[1].invalid;
 
 		LinmathPoint3d sensorPtInLH;
-		ApplyAxisAnglePoseToPoint(sensorPtInLH, &obj2lh[lh], pt);
+		ApplyAxisAnglePoseToPoint_inline(sensorPtInLH, &obj2lh[lh], pt);
 
 		if (nextIsPair) {
 			run_pair_measurement(mpfunc_ctx, i, reprojectModel, meas, pose, &obj2lh[lh], world2lh, deviates + i,
@@ -538,6 +539,8 @@ static mp_config *survive_optimizer_get_cfg(SurviveContext *ctx) {
 	return &cachedCfg;
 }
 
+static void capture_problem(SurviveContext *ctx, const survive_optimizer *optimizer, const mp_config *cfg);
+
 mp_config precise_cfg = {0};
 SURVIVE_EXPORT mp_config *survive_optimizer_precise_config() { return &precise_cfg; }
 
@@ -548,6 +551,10 @@ int survive_optimizer_run(survive_optimizer *optimizer, struct mp_result_struct
 	if (cfg == 0)
 		cfg = survive_optimizer_get_cfg(ctx);
 
+	if (ctx && ctx->optimizer_capture) {
+		capture_problem(ctx, optimizer, cfg);
+	}
+
 	SurvivePose *poses = survive_optimizer_get_pose(optimizer);
 	for (int i = 0; i < optimizer->poseLength + optimizer->cameraLength; i++) {
 		quattoaxisanglemag(poses[i].Rot, poses[i].Rot);
@@ -769,7 +776,7 @@ SURVIVE_EXPORT void survive_optimizer_set_nonfixed(survive_optimizer *ctx, FLT *
 
 SURVIVE_EXPORT size_t survive_optimizer_get_total_buffer_size(const survive_optimizer *ctx) {
 	size_t par_count = survive_optimizer_get_parameters_count(ctx);
-	size_t sensor_cnt = 32;
+	size_t sensor_cnt = SENSORS_PER_OBJECT;
 	return par_count * (sizeof(FLT) +				  // parameters
 						sizeof(struct mp_par_struct)) // parameters_info
 		   + ctx->poseLength * sizeof(survive_optimizer_measurement) * 2 * sensor_cnt *
@@ -785,7 +792,7 @@ SURVIVE_EXPORT void survive_optimizer_setup_buffers(survive_optimizer *ctx, void
 		ctx->parameters[i] = NAN;
 	size_t par_offset = par_count * sizeof(FLT);
 	ctx->parameters_info = (struct mp_par_struct *)(parameter_info_buffer);
-	size_t sensor_cnt = 32;
+	size_t sensor_cnt = SENSORS_PER_OBJECT;
 
 	size_t par_info_offset = par_offset + sizeof(struct mp_par_struct) * par_count;
 
@@ -802,3 +809,279 @@ SURVIVE_EXPORT void survive_optimizer_setup_buffers(survive_optimizer *ctx, void
 }
 
 SURVIVE_EXPORT void *survive_optimizer_realloc(void *old_ptr, size_t size) { return realloc(old_ptr, size); }
+
+STATIC_CONFIG_ITEM(OPTIMIZER_CAPTURE, "optimizer-capture", 's', "File to append binary captures of optimizer problems to",
+				   "")
+STATIC_CONFIG_ITEM(OPTIMIZER_CAPTURE_EVERY, "optimizer-capture-every", 'i', "Capture every Nth optimizer problem", 1)
+
+static const char problem_magic[8] = {'S', 'V', 'O', 'P', 'T', 'P', 'R', 'B'};
+#define SURVIVE_OPTIMIZER_PROBLEM_VERSION 1
+
+typedef struct survive_optimizer_capture {
+	FILE *f;
+	og_mutex_t lock;
+	uint32_t every;
+	uint64_t seen, written;
+} survive_optimizer_capture;
+
+typedef struct problem_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t flt_size;
+	uint32_t measurement_size;
+	uint32_t reserved;
+} problem_file_header;
+
+typedef struct problem_header {
+	uint32_t param_cnt;
+	uint32_t meas_cnt;
+	int32_t poseLength, cameraLength, ptsLength;
+	uint8_t gen2_model;
+	uint8_t nofilter;
+	uint8_t reserved[2];
+	FLT current_bias;
+	SurvivePose initialPose;
+
+	// Solver settings the problem was captured with
+	FLT ftol, xtol, gtol, epsfcn, stepfactor, covtol, normtol;
+	int32_t maxiter, maxfev, douserscale;
+} problem_header;
+
+typedef struct problem_object {
+	char codename[8];
+	uint32_t sensor_ct;
+} problem_object;
+
+typedef struct problem_parameter {
+	int32_t fixed, limited[2], side, deriv_debug;
+	FLT limits[2], step, relstep, deriv_reltol, deriv_abstol;
+} problem_parameter;
+
+int survive_optimizer_write_problem_header(FILE *f) {
+	problem_file_header hdr = {.version = SURVIVE_OPTIMIZER_PROBLEM_VERSION,
+							   .flt_size = sizeof(FLT),
+							   .measurement_size = sizeof(survive_optimizer_measurement)};
+	memcpy(hdr.magic, problem_magic, sizeof(hdr.magic));
+	return fwrite(&hdr, sizeof(hdr), 1, f) == 1 ? 0 : -1;
+}
+
+int survive_optimizer_read_problem_header(FILE *f) {
+	problem_file_header hdr = {0};
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, problem_magic, sizeof(hdr.magic)) != 0 ||
+		hdr.version != SURVIVE_OPTIMIZER_PROBLEM_VERSION || hdr.flt_size != sizeof(FLT) ||
+		hdr.measurement_size != sizeof(survive_optimizer_measurement)) {
+		return -1;
+	}
+	return 0;
+}
+
+int survive_optimizer_write_problem(FILE *f, const survive_optimizer *opt, const mp_config *cfg) {
+	uint32_t param_cnt = survive_optimizer_get_parameters_count(opt);
+	problem_header hdr = {
+		.param_cnt = param_cnt,
+		.meas_cnt = (uint32_t)opt->measurementsCnt,
+		.poseLength = opt->poseLength,
+		.cameraLength = opt->cameraLength,
+		.ptsLength = opt->ptsLength,
+		.gen2_model = opt->reprojectModel != &survive_reproject_model,
+		.nofilter = opt->nofilter,
+		.current_bias = opt->current_bias,
+		.initialPose = opt->initialPose,
+		.ftol = cfg->ftol,
+		.xtol = cfg->xtol,
+		.gtol = cfg->gtol,
+		.epsfcn = cfg->epsfcn,
+		.stepfactor = cfg->stepfactor,
+		.covtol = cfg->covtol,
+		.normtol = cfg->normtol,
+		.maxiter = cfg->maxiter,
+		.maxfev = cfg->maxfev,
+		.douserscale = cfg->douserscale,
+	};
+
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	for (int i = 0; ok && i < opt->poseLength; i++) {
+		const SurviveObject *so = opt->sos[i];
+		problem_object obj = {.sensor_ct = so ? so->sensor_ct : 0};
+		if (so) {
+			memcpy(obj.codename, so->codename, sizeof(so->codename));
+		}
+		ok = fwrite(&obj, sizeof(obj), 1, f) == 1 &&
+			 (!so || fwrite(so->sensor_locations, sizeof(FLT) * 3, obj.sensor_ct, f) == obj.sensor_ct);
+	}
+
+	ok = ok && fwrite(opt->parameters, sizeof(FLT), param_cnt, f) == param_cnt;
+	for (uint32_t i = 0; ok && i < param_cnt; i++) {
+		const struct mp_par_struct *info = &opt->parameters_info[i];
+		problem_parameter p = {
+			.fixed = info->fixed,
+			.limited = {info->limited[0], info->limited[1]},
+			.side = info->side,
+			.deriv_debug = info->deriv_debug,
+			.limits = {info->limits[0], info->limits[1]},
+			.step = info->step,
+			.relstep = info->relstep,
+			.deriv_reltol = info->deriv_reltol,
+			.deriv_abstol = info->deriv_abstol,
+		};
+		ok = fwrite(&p, sizeof(p), 1, f) == 1;
+	}
+
+	return ok && fwrite(opt->measurements, sizeof(survive_optimizer_measurement), hdr.meas_cnt, f) == hdr.meas_cnt
+			   ? 0
+			   : -1;
+}
+
+static char *loaded_parameter_name = "Loaded parameter";
+
+survive_optimizer *survive_optimizer_read_problem(FILE *f, mp_config *cfg) {
+	problem_header hdr;
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1)
+		return 0;
+
+	survive_optimizer *opt = SV_CALLOC(1, sizeof(survive_optimizer));
+	opt->poseLength = hdr.poseLength;
+	opt->cameraLength = hdr.cameraLength;
+	opt->ptsLength = hdr.ptsLength;
+
+	size_t meas_capacity = opt->poseLength * 2 * SENSORS_PER_OBJECT * NUM_GEN2_LIGHTHOUSES;
+	if (hdr.poseLength <= 0 || hdr.cameraLength <= 0 || hdr.cameraLength > NUM_GEN2_LIGHTHOUSES ||
+		hdr.ptsLength < 0 || hdr.param_cnt != survive_optimizer_get_parameters_count(opt) ||
+		hdr.meas_cnt > meas_capacity) {
+		free(opt);
+		return 0;
+	}
+
+	SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(*opt, 0);
+	opt->reprojectModel = hdr.gen2_model ? &survive_reproject_gen2_model : &survive_reproject_model;
+	opt->nofilter = hdr.nofilter;
+	opt->current_bias = hdr.current_bias;
+	opt->initialPose = hdr.initialPose;
+	opt->measurementsCnt = hdr.meas_cnt;
+
+	bool ok = true;
+	for (int i = 0; ok && i < opt->poseLength; i++) {
+		problem_object obj;
+		ok = fread(&obj, sizeof(obj), 1, f) == 1 && obj.sensor_ct <= 256;
+		if (!ok)
+			break;
+
+		SurviveObject *so = opt->sos[i] = SV_CALLOC(1, sizeof(SurviveObject));
+		memcpy(so->codename, obj.codename, sizeof(so->codename));
+		so->codename[sizeof(so->codename) - 1] = 0;
+		so->sensor_ct = obj.sensor_ct;
+		so->sensor_locations = SV_CALLOC(obj.sensor_ct + 1, sizeof(FLT) * 3);
+		ok = fread(so->sensor_locations, sizeof(FLT) * 3, obj.sensor_ct, f) == obj.sensor_ct;
+	}
+
+	ok = ok && fread(opt->parameters, sizeof(FLT), hdr.param_cnt, f) == hdr.param_cnt;
+	for (uint32_t i = 0; ok && i < hdr.param_cnt; i++) {
+		problem_parameter p;
+		ok = fread(&p, sizeof(p), 1, f) == 1;
+		opt->parameters_info[i] = (struct mp_par_struct){
+			.fixed = p.fixed,
+			.limited = {p.limited[0], p.limited[1]},
+			.limits = {p.limits[0], p.limits[1]},
+			.parname = loaded_parameter_name,
+			.step = p.step,
+			.relstep = p.relstep,
+			.side = p.side,
+			.deriv_debug = p.deriv_debug,
+			.deriv_reltol = p.deriv_reltol,
+			.deriv_abstol = p.deriv_abstol,
+		};
+	}
+	ok = ok && fread(opt->measurements, sizeof(survive_optimizer_measurement), hdr.meas_cnt, f) == hdr.meas_cnt;
+
+	if (!ok) {
+		survive_optimizer_free_problem(opt);
+		return 0;
+	}
+
+	if (cfg) {
+		*cfg = (mp_config){
+			.ftol = hdr.ftol,
+			.xtol = hdr.xtol,
+			.gtol = hdr.gtol,
+			.epsfcn = hdr.epsfcn,
+			.stepfactor = hdr.stepfactor,
+			.covtol = hdr.covtol,
+			.normtol = hdr.normtol,
+			.maxiter = hdr.maxiter,
+			.maxfev = hdr.maxfev,
+			.douserscale = hdr.douserscale,
+		};
+	}
+	return opt;
+}
+
+void survive_optimizer_free_problem(survive_optimizer *opt) {
+	if (opt == 0)
+		return;
+
+	for (int i = 0; opt->sos && i < opt->poseLength; i++) {
+		if (opt->sos[i]) {
+			free(opt->sos[i]->sensor_locations);
+			free(opt->sos[i]);
+		}
+	}
+	free(opt->sos);
+	free(opt->parameters);
+	free(opt->parameters_info);
+	free(opt->measurements);
+	free(opt);
+}
+
+void survive_optimizer_install_capture(SurviveContext *ctx) {
+	const char *fn = survive_configs(ctx, OPTIMIZER_CAPTURE_TAG, SC_GET, "");
+	if (fn == 0 || *fn == 0)
+		return;
+
+	FILE *f = fopen(fn, "ab");
+	if (f == 0) {
+		SV_WARN("Could not open optimizer capture '%s'", fn);
+		return;
+	}
+
+	// Buffer generously; a capture is written from inside the solver and shouldn't wait on the disk
+	setvbuf(f, 0, _IOFBF, 1 << 20);
+	if (ftell(f) == 0) {
+		survive_optimizer_write_problem_header(f);
+	}
+
+	survive_optimizer_capture *capture = SV_CALLOC(1, sizeof(survive_optimizer_capture));
+	capture->f = f;
+	capture->lock = OGCreateMutex();
+	capture->every = survive_configi(ctx, OPTIMIZER_CAPTURE_EVERY_TAG, SC_GET, 1);
+	if (capture->every == 0)
+		capture->every = 1;
+	ctx->optimizer_capture = capture;
+
+	SV_INFO("Capturing every %u optimizer problem(s) to '%s'", capture->every, fn);
+}
+
+void survive_optimizer_close_capture(SurviveContext *ctx) {
+	survive_optimizer_capture *capture = ctx->optimizer_capture;
+	if (capture == 0)
+		return;
+
+	SV_VERBOSE(5, "Captured %lu of %lu optimizer problems", (unsigned long)capture->written,
+			   (unsigned long)capture->seen);
+	fclose(capture->f);
+	OGDeleteMutex(capture->lock);
+	free(capture);
+	ctx->optimizer_capture = 0;
+}
+
+static void capture_problem(SurviveContext *ctx, const survive_optimizer *optimizer, const mp_config *cfg) {
+	survive_optimizer_capture *capture = ctx->optimizer_capture;
+
+	// The async optimizer solves off of the ctx lock, so captures take their own
+	OGLockMutex(capture->lock);
+	if (capture->seen++ % capture->every == 0) {
+		if (survive_optimizer_write_problem(capture->f, optimizer, cfg) == 0) {
+			capture->written++;
+		}
+	}
+	OGUnlockMutex(capture->lock);
+}
@@ -0,0 +1,373 @@
+#include "survive_posetrack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef NOZLIB
+#include <zlib.h>
+#endif
+
+#define POSETRACK_CHUNK_ROWS 1024
+
+static const char posetrack_magic[8] = {'S', 'V', 'P', 'T', 'R', 'A', 'C', 'K'};
+
+enum posetrack_columns {
+	COL_TIME = 0,
+	COL_POSE = 1,
+	COL_VELOCITY = COL_POSE + 7,
+	COL_VARIANCE = COL_VELOCITY + 6,
+	COL_CNT = COL_VARIANCE + 7
+};
+
+typedef struct posetrack_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t column_cnt;
+} posetrack_file_header;
+
+typedef struct posetrack_chunk_entry {
+	double time_start, time_end;
+	uint64_t offset;
+	uint32_t object;
+	uint32_t rows;
+} posetrack_chunk_entry;
+
+typedef struct posetrack_file_trailer {
+	uint64_t index_offset;
+	char magic[8];
+} posetrack_file_trailer;
+
+typedef struct posetrack_object {
+	char name[SURVIVE_POSETRACK_NAME_LEN];
+	size_t rows;
+	bool last_has_velocity;
+	SurvivePose last_pose;
+	double columns[COL_CNT][POSETRACK_CHUNK_ROWS];
+} posetrack_object;
+
+struct survive_posetrack_writer {
+	FILE *f;
+
+	posetrack_object **objects;
+	size_t object_cnt;
+
+	posetrack_chunk_entry *chunks;
+	size_t chunk_cnt;
+
+	uint8_t *compressed_scratch;
+	size_t compressed_scratch_size;
+	bool failed;
+};
+
+struct survive_posetrack_reader {
+	FILE *f;
+
+	char (*names)[SURVIVE_POSETRACK_NAME_LEN];
+	size_t object_cnt;
+
+	posetrack_chunk_entry *chunks;
+	size_t chunk_cnt;
+
+	double *scratch;
+	uint8_t *compressed_scratch;
+};
+
+survive_posetrack_writer *survive_posetrack_writer_open(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if (f == 0)
+		return 0;
+
+	posetrack_file_header hdr = {.version = SURVIVE_POSETRACK_VERSION, .column_cnt = COL_CNT};
+	memcpy(hdr.magic, posetrack_magic, sizeof(hdr.magic));
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+		fclose(f);
+		return 0;
+	}
+
+	survive_posetrack_writer *writer = SV_CALLOC(1, sizeof(survive_posetrack_writer));
+	writer->f = f;
+	return writer;
+}
+
+static posetrack_object *get_object(survive_posetrack_writer *writer, const char *name, uint32_t *idx) {
+	for (size_t i = 0; i < writer->object_cnt; i++) {
+		if (strncmp(writer->objects[i]->name, name, SURVIVE_POSETRACK_NAME_LEN) == 0) {
+			*idx = i;
+			return writer->objects[i];
+		}
+	}
+
+	writer->objects = SV_REALLOC(writer->objects, (writer->object_cnt + 1) * sizeof(posetrack_object *));
+	posetrack_object *obj = writer->objects[writer->object_cnt] = SV_CALLOC(1, sizeof(posetrack_object));
+	strncpy(obj->name, name, SURVIVE_POSETRACK_NAME_LEN - 1);
+	obj->last_pose.Rot[0] = 1;
+	*idx = writer->object_cnt++;
+	return obj;
+}
+
+static bool write_column(survive_posetrack_writer *writer, const double *column, size_t rows) {
+	uint32_t size = (uint32_t)(rows * sizeof(double));
+	const void *data = column;
+
+#ifndef NOZLIB
+	// Poses change slowly between samples, so even the fastest setting does well here
+	uLongf compressed_size = compressBound(size);
+	if (writer->compressed_scratch_size < compressed_size) {
+		writer->compressed_scratch = SV_REALLOC(writer->compressed_scratch, compressed_size);
+		writer->compressed_scratch_size = compressed_size;
+	}
+	if (compress2(writer->compressed_scratch, &compressed_size, (const Bytef *)column, size, Z_BEST_SPEED) == Z_OK &&
+		compressed_size < size) {
+		size = (uint32_t)compressed_size;
+		data = writer->compressed_scratch;
+	}
+#endif
+
+	return fwrite(&size, sizeof(size), 1, writer->f) == 1 && fwrite(data, 1, size, writer->f) == size;
+}
+
+static void flush_object(survive_posetrack_writer *writer, posetrack_object *obj, uint32_t idx) {
+	if (obj->rows == 0)
+		return;
+
+	writer->chunks = SV_REALLOC(writer->chunks, (writer->chunk_cnt + 1) * sizeof(posetrack_chunk_entry));
+	writer->chunks[writer->chunk_cnt++] = (posetrack_chunk_entry){
+		.time_start = obj->columns[COL_TIME][0],
+		.time_end = obj->columns[COL_TIME][obj->rows - 1],
+		.offset = (uint64_t)ftell(writer->f),
+		.object = idx,
+		.rows = (uint32_t)obj->rows,
+	};
+
+	for (int c = 0; c < COL_CNT && !writer->failed; c++) {
+		writer->failed |= !write_column(writer, obj->columns[c], obj->rows);
+	}
+	obj->rows = 0;
+}
+
+static void append_row(survive_posetrack_writer *writer, posetrack_object *obj, uint32_t idx, double time) {
+	if (obj->rows == POSETRACK_CHUNK_ROWS) {
+		flush_object(writer, obj, idx);
+	}
+
+	size_t row = obj->rows++;
+	for (int c = 0; c < COL_CNT; c++) {
+		obj->columns[c][row] = 0;
+	}
+	obj->columns[COL_TIME][row] = time;
+	obj->last_has_velocity = false;
+}
+
+int survive_posetrack_write_pose(survive_posetrack_writer *writer, const char *name, double time,
+								 const SurvivePose *pose, const FLT *variance) {
+	if (writer == 0 || writer->failed)
+		return -1;
+
+	uint32_t idx;
+	posetrack_object *obj = get_object(writer, name, &idx);
+	append_row(writer, obj, idx, time);
+
+	size_t row = obj->rows - 1;
+	for (int i = 0; i < 7; i++) {
+		obj->columns[COL_POSE + i][row] = pose->Pos[i];
+		obj->columns[COL_VARIANCE + i][row] = variance ? variance[i] : 0;
+	}
+	obj->last_pose = *pose;
+	return 0;
+}
+
+int survive_posetrack_write_velocity(survive_posetrack_writer *writer, const char *name, double time,
+									 const SurviveVelocity *velocity) {
+	if (writer == 0 || writer->failed)
+		return -1;
+
+	uint32_t idx;
+	posetrack_object *obj = get_object(writer, name, &idx);
+	if (obj->rows == 0 || obj->last_has_velocity) {
+		append_row(writer, obj, idx, time);
+		for (int i = 0; i < 7; i++) {
+			obj->columns[COL_POSE + i][obj->rows - 1] = obj->last_pose.Pos[i];
+		}
+	}
+
+	size_t row = obj->rows - 1;
+	for (int i = 0; i < 3; i++) {
+		obj->columns[COL_VELOCITY + i][row] = velocity->Pos[i];
+		obj->columns[COL_VELOCITY + 3 + i][row] = velocity->AxisAngleRot[i];
+	}
+	obj->last_has_velocity = true;
+	return 0;
+}
+
+int survive_posetrack_writer_close(survive_posetrack_writer *writer) {
+	if (writer == 0)
+		return -1;
+
+	for (size_t i = 0; i < writer->object_cnt; i++) {
+		flush_object(writer, writer->objects[i], (uint32_t)i);
+	}
+
+	posetrack_file_trailer trailer = {.index_offset = (uint64_t)ftell(writer->f)};
+	memcpy(trailer.magic, posetrack_magic, sizeof(trailer.magic));
+
+	uint32_t object_cnt = (uint32_t)writer->object_cnt, chunk_cnt = (uint32_t)writer->chunk_cnt;
+	bool ok = !writer->failed && fwrite(&object_cnt, sizeof(object_cnt), 1, writer->f) == 1;
+	for (size_t i = 0; ok && i < writer->object_cnt; i++) {
+		ok = fwrite(writer->objects[i]->name, SURVIVE_POSETRACK_NAME_LEN, 1, writer->f) == 1;
+	}
+	ok = ok && fwrite(&chunk_cnt, sizeof(chunk_cnt), 1, writer->f) == 1 &&
+		 fwrite(writer->chunks, sizeof(posetrack_chunk_entry), chunk_cnt, writer->f) == chunk_cnt &&
+		 fwrite(&trailer, sizeof(trailer), 1, writer->f) == 1;
+	ok &= fclose(writer->f) == 0;
+
+	for (size_t i = 0; i < writer->object_cnt; i++) {
+		free(writer->objects[i]);
+	}
+	free(writer->objects);
+	free(writer->chunks);
+	free(writer->compressed_scratch);
+	free(writer);
+	return ok ? 0 : -1;
+}
+
+survive_posetrack_reader *survive_posetrack_reader_open(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (f == 0)
+		return 0;
+
+	posetrack_file_header hdr = {0};
+	posetrack_file_trailer trailer = {0};
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, posetrack_magic, sizeof(hdr.magic)) != 0 ||
+		hdr.version != SURVIVE_POSETRACK_VERSION || hdr.column_cnt != COL_CNT ||
+		fseek(f, -(long)sizeof(trailer), SEEK_END) != 0 || fread(&trailer, sizeof(trailer), 1, f) != 1 ||
+		memcmp(trailer.magic, posetrack_magic, sizeof(trailer.magic)) != 0 ||
+		fseek(f, (long)trailer.index_offset, SEEK_SET) != 0) {
+		fclose(f);
+		return 0;
+	}
+
+	survive_posetrack_reader *reader = SV_CALLOC(1, sizeof(survive_posetrack_reader));
+	reader->f = f;
+
+	uint32_t object_cnt = 0, chunk_cnt = 0;
+	bool ok = fread(&object_cnt, sizeof(object_cnt), 1, f) == 1;
+	if (ok) {
+		reader->object_cnt = object_cnt;
+		reader->names = SV_CALLOC(object_cnt + 1, SURVIVE_POSETRACK_NAME_LEN);
+		ok = fread(reader->names, SURVIVE_POSETRACK_NAME_LEN, object_cnt, f) == object_cnt &&
+			 fread(&chunk_cnt, sizeof(chunk_cnt), 1, f) == 1;
+	}
+	if (ok) {
+		reader->chunk_cnt = chunk_cnt;
+		reader->chunks = SV_CALLOC(chunk_cnt + 1, sizeof(posetrack_chunk_entry));
+		ok = fread(reader->chunks, sizeof(posetrack_chunk_entry), chunk_cnt, f) == chunk_cnt;
+	}
+
+	if (!ok) {
+		survive_posetrack_reader_close(reader);
+		return 0;
+	}
+
+	reader->scratch = SV_MALLOC(COL_CNT * POSETRACK_CHUNK_ROWS * sizeof(double));
+	return reader;
+}
+
+void survive_posetrack_reader_close(survive_posetrack_reader *reader) {
+	if (reader == 0)
+		return;
+
+	fclose(reader->f);
+	free(reader->names);
+	free(reader->chunks);
+	free(reader->scratch);
+	free(reader->compressed_scratch);
+	free(reader);
+}
+
+size_t survive_posetrack_object_count(const survive_posetrack_reader *reader) { return reader->object_cnt; }
+
+const char *survive_posetrack_object_name(const survive_posetrack_reader *reader, size_t idx) {
+	if (idx >= reader->object_cnt)
+		return 0;
+	return reader->names[idx];
+}
+
+static bool read_chunk(survive_posetrack_reader *reader, const posetrack_chunk_entry *chunk) {
+	if (chunk->rows > POSETRACK_CHUNK_ROWS || fseek(reader->f, (long)chunk->offset, SEEK_SET) != 0)
+		return false;
+
+	size_t raw_size = chunk->rows * sizeof(double);
+	for (int c = 0; c < COL_CNT; c++) {
+		double *column = reader->scratch + c * POSETRACK_CHUNK_ROWS;
+
+		uint32_t size;
+		if (fread(&size, sizeof(size), 1, reader->f) != 1 || size > raw_size)
+			return false;
+
+		if (size == raw_size) {
+			if (fread(column, 1, size, reader->f) != size)
+				return false;
+			continue;
+		}
+
+#ifndef NOZLIB
+		if (reader->compressed_scratch == 0) {
+			reader->compressed_scratch = SV_MALLOC(POSETRACK_CHUNK_ROWS * sizeof(double));
+		}
+		uLongf out_size = (uLongf)raw_size;
+		if (fread(reader->compressed_scratch, 1, size, reader->f) != size ||
+			uncompress((Bytef *)column, &out_size, reader->compressed_scratch, size) != Z_OK || out_size != raw_size)
+			return false;
+#else
+		return false;
+#endif
+	}
+	return true;
+}
+
+int survive_posetrack_read_range(survive_posetrack_reader *reader, const char *name, double start, double end,
+								 survive_posetrack_sample **out, size_t *out_capacity) {
+	uint32_t object = 0;
+	while (object < reader->object_cnt && strncmp(reader->names[object], name, SURVIVE_POSETRACK_NAME_LEN) != 0) {
+		object++;
+	}
+	if (object == reader->object_cnt)
+		return 0;
+
+	size_t cnt = 0;
+	for (size_t i = 0; i < reader->chunk_cnt; i++) {
+		const posetrack_chunk_entry *chunk = &reader->chunks[i];
+		if (chunk->object != object || chunk->time_end < start || chunk->time_start > end)
+			continue;
+
+		if (!read_chunk(reader, chunk))
+			return -1;
+
+		if (*out_capacity < cnt + chunk->rows) {
+			*out_capacity = cnt + chunk->rows;
+			*out = SV_REALLOC(*out, *out_capacity * sizeof(survive_posetrack_sample));
+		}
+
+#define SCRATCH(c, row) reader->scratch[(c)*POSETRACK_CHUNK_ROWS + (row)]
+		for (size_t row = 0; row < chunk->rows; row++) {
+			double time = SCRATCH(COL_TIME, row);
+			if (time < start || time > end)
+				continue;
+
+			survive_posetrack_sample *sample = &(*out)[cnt++];
+			sample->time = time;
+			for (int j = 0; j < 7; j++) {
+				sample->pose.Pos[j] = SCRATCH(COL_POSE + j, row);
+				sample->variance[j] = SCRATCH(COL_VARIANCE + j, row);
+			}
+			for (int j = 0; j < 3; j++) {
+				sample->velocity.Pos[j] = SCRATCH(COL_VELOCITY + j, row);
+				sample->velocity.AxisAngleRot[j] = SCRATCH(COL_VELOCITY + 3 + j, row);
+			}
+		}
+#undef SCRATCH
+	}
+
+	return (int)cnt;
+}
@@ -1,6 +1,7 @@
 //<>< (C) 2016 C. N. Lohr, FULLY Under MIT/x11 License.
 //All MIT/x11 Licensed Code in this file may be relicensed freely under the GPL or LGPL licenses.
 
+#include "survive_cache.h"
 #include "survive_config.h"
 #include "survive_default_devices.h"
 #include "survive_recording.h"
@@ -57,6 +58,7 @@ void survive_default_external_pose_process(SurviveContext *ctx, const char *name
 void survive_default_ootx_received_process(struct SurviveContext *ctx, uint8_t bsd_idx) {
 	config_set_lighthouse(ctx->lh_config, &ctx->bsd[bsd_idx], bsd_idx);
 	config_save(ctx);
+	survive_cache_save(ctx);
 }
 void survive_default_lighthouse_pose_process(SurviveContext *ctx, uint8_t lighthouse, SurvivePose *lighthouse_pose) {
 	if (lighthouse_pose) {
@@ -68,6 +70,7 @@ void survive_default_lighthouse_pose_process(SurviveContext *ctx, uint8_t lighth
 
 	config_set_lighthouse(ctx->lh_config, &ctx->bsd[lighthouse], lighthouse);
 	config_save(ctx);
+	survive_cache_save(ctx);
 
 	survive_recording_lighthouse_process(ctx, lighthouse, lighthouse_pose);
 	SV_VERBOSE(10, "Position found for LH %d(ID: %08x, mode: %2d) " SurvivePose_format, lighthouse,
@@ -82,6 +85,9 @@ int survive_default_config_process(SurviveObject *so, char *ct0conf, int len) {
 	so->conf_cnt = len;
 
 	int rtn = survive_load_htc_config_format(so, ct0conf, len);
+	if (rtn == 0) {
+		survive_cache_apply_device(so);
+	}
 	if (survive_configi(so->ctx, "serialize-device-config", SC_GET, 0) != 0) {
 		for (int i = 0; i < 2; i++) {
 			char raw_fname[128];
@@ -190,7 +196,9 @@ void survive_default_imu_process( SurviveObject * so, int mask, FLT * accelgyrom
 	SurviveContext *ctx = so->ctx;
 
 	SV_VERBOSE(400, "IMU %d: " Point6_format, timecode, LINMATH_VEC3_EXPAND(imu.accel), LINMATH_VEC3_EXPAND(imu.gyro))
+	SV_ASSERT_NO_ALLOCS_BEGIN();
 	survive_kalman_tracker_integrate_imu(so->tracker, &imu);
+	SV_ASSERT_NO_ALLOCS_END(so->tracker && so->tracker->stats.imu_count > 1, "IMU integration");
 	SURVIVE_POSER_INVOKE(so, &imu);
 
 	survive_recording_imu_process(so, mask, accelgyromag, timecode, id);
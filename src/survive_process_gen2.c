@@ -8,7 +8,7 @@
 #include <math.h>
 #include <survive.h>
 
-static FLT freq_per_channel[NUM_GEN2_LIGHTHOUSES] = {
+static FLT freq_per_channel[NUM_GEN2_CHANNELS] = {
 	50.0521, 50.1567, 50.3673, 50.5796, 50.6864, 50.9014, 51.0096, 51.1182,
 
 	51.2273, 51.6685, 52.2307, 52.6894, 52.9217, 53.2741, 53.7514, 54.1150,
@@ -47,7 +47,18 @@ static void ootx_packet_clbk_d_gen2(ootx_decoder_context *ct, ootx_packet *packe
 
 	BaseStationData *b = &ctx->bsd[id];
 
-	bool doSave = b->BaseStationID != v15.id || b->OOTXSet == false;
+	bool doSave = b->BaseStationID != v15.id || b->OOTXSet == false || b->OOTXCached;
+
+	if (b->OOTXCached) {
+		if (b->BaseStationID == v15.id) {
+			SV_INFO("Verified cached OOTX data for LH %d (ID: %08x)", id, (unsigned)v15.id);
+		} else {
+			SV_WARN("Cached OOTX data for LH %d was for ID %08x, but live data is from %08x; dropping cached pose", id,
+					(unsigned)b->BaseStationID, (unsigned)v15.id);
+			b->PositionSet = 0;
+		}
+		b->OOTXCached = 0;
+	}
 
 	if (doSave) {
 	  SV_INFO("Got OOTX packet %d %08x", ctx->bsd[id].mode, (unsigned)v15.id);
@@ -87,6 +98,13 @@ static void ootx_packet_cblk_d_gen1(ootx_decoder_context *ct, ootx_packet *packe
 
 	BaseStationData *b = &ctx->bsd[id];
 
+	if (b->OOTXCached && b->BaseStationID != v6.id) {
+		SV_WARN("Cached OOTX data for LH %d was for ID %08x, but live data is from %08x; dropping cached pose", id,
+				(unsigned)b->BaseStationID, (unsigned)v6.id);
+		b->PositionSet = 0;
+	}
+	b->OOTXCached = 0;
+
 	b->BaseStationID = v6.id;
 	b->fcal[0].phase = v6.fcal_0_phase;
 	b->fcal[1].phase = v6.fcal_1_phase;
@@ -131,7 +149,7 @@ void survive_ootx_free_decoder_context(struct SurviveContext *ctx, int bsd_idx)
 }
 void survive_ootx_behavior(SurviveObject *so, int8_t bsd_idx, int8_t lh_version, int ootx) {
 	struct SurviveContext *ctx = so->ctx;
-	if (ctx->bsd[bsd_idx].OOTXSet == false) {
+	if (ctx->bsd[bsd_idx].OOTXSet == false || ctx->bsd[bsd_idx].OOTXCached) {
 		ootx_decoder_context *decoderContext = ctx->bsd[bsd_idx].ootx_data;
 
 		if (decoderContext == 0) {
@@ -153,7 +171,7 @@ void survive_ootx_behavior(SurviveObject *so, int8_t bsd_idx, int8_t lh_version,
 		if (decoderContext->user == so) {
 			ootx_pump_bit(decoderContext, ootx);
 
-			if (ctx->bsd[bsd_idx].OOTXSet) {
+			if (ctx->bsd[bsd_idx].OOTXSet && !ctx->bsd[bsd_idx].OOTXCached) {
 				survive_ootx_free_decoder_context(ctx, bsd_idx);
 			}
 		}
@@ -165,11 +183,12 @@ SURVIVE_EXPORT void survive_default_sync_process(SurviveObject *so, survive_chan
 	struct SurviveContext *ctx = so->ctx;
 	int8_t bsd_idx = survive_get_bsd_idx(ctx, channel);
 	if (bsd_idx == -1) {
-		SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
+		if (channel >= NUM_GEN2_CHANNELS)
+			SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
 		return;
 	}
 
-	assert(channel <= NUM_GEN2_LIGHTHOUSES);
+	assert(channel < NUM_GEN2_CHANNELS);
 
 	survive_recording_sync_process(so, channel, timecode, ootx, gen);
 
@@ -285,7 +304,8 @@ SURVIVE_EXPORT void survive_default_sweep_process(SurviveObject *so, survive_cha
 
 	int8_t bsd_idx = survive_get_bsd_idx(ctx, channel);
 	if (bsd_idx == -1) {
-		SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
+		if (channel >= NUM_GEN2_CHANNELS)
+			SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
 		return;
 	}
 
@@ -297,7 +317,7 @@ SURVIVE_EXPORT void survive_default_sweep_process(SurviveObject *so, survive_cha
 	if (last_sweep == 0) {
 		return;
 	}
-	assert(channel <= NUM_GEN2_LIGHTHOUSES);
+	assert(channel < NUM_GEN2_CHANNELS);
 
 	// SV_INFO("Sensor ch%2d %2d %d %12x %6d", channel, sensor_id, flag, timecode, timecode
 	// so->last_sync_time[bsd_idx]);
@@ -346,7 +366,8 @@ SURVIVE_EXPORT void survive_default_sweep_angle_process(SurviveObject *so, survi
 	struct SurviveContext *ctx = so->ctx;
 	int8_t bsd_idx = survive_get_bsd_idx(ctx, channel);
 	if (bsd_idx == -1) {
-		SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
+		if (channel >= NUM_GEN2_CHANNELS)
+			SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
 		return;
 	}
 
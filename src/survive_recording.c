@@ -26,6 +26,8 @@
 #include "stdarg.h"
 
 #include "survive_gz.h"
+#include "survive_kalman_tracker.h"
+#include "survive_posetrack.h"
 
 STATIC_CONFIG_ITEM(PLAYBACK_RECORD_RAWLIGHT, "record-rawlight", 'i', "Whether or not to output raw light data", 1)
 STATIC_CONFIG_ITEM(PLAYBACK_RECORD_IMU, "record-imu", 'i', "Whether or not to output imu data", 1)
@@ -35,6 +37,8 @@ STATIC_CONFIG_ITEM(PLAYBACK_RECORD_ANGLE, "record-angle", 'i', "Whether or not t
 
 STATIC_CONFIG_ITEM(RECORD, "record", 's', "File to record to if you wish to make a recording.", "")
 STATIC_CONFIG_ITEM(RECORD_STDOUT, "record-stdout", 'i', "Whether or not to dump recording data to stdout", 0)
+STATIC_CONFIG_ITEM(RECORD_POSE_TRACK, "record-pose-track", 's',
+				   "File to write solved poses to in the columnar, time indexed pose track format.", "")
   
 typedef struct SurviveRecordingData {
 	SurviveContext *ctx;
@@ -44,6 +48,7 @@ typedef struct SurviveRecordingData {
 		bool writeCalIMU;
 		bool writeAngle;
 		gzFile output_file;
+		survive_posetrack_writer *pose_track;
 } SurviveRecordingData;
 
 static void write_to_output_raw(SurviveRecordingData *recordingData, const char *string, int len) {
@@ -125,6 +130,10 @@ void survive_recording_velocity_process(SurviveObject *so, uint8_t lighthouse, c
 		recordingData, "%s VELOCITY " FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF "\r\n",
 		so->codename, pose->Pos[0], pose->Pos[1], pose->Pos[2], pose->AxisAngleRot[0], pose->AxisAngleRot[1],
 		pose->AxisAngleRot[2]);
+
+	if (recordingData->pose_track) {
+		survive_posetrack_write_velocity(recordingData->pose_track, so->codename, survive_run_time(so->ctx), pose);
+	}
 }
 void survive_recording_raw_pose_process(SurviveObject *so, uint8_t lighthouse, const SurvivePose *pose) {
 	SurviveRecordingData *recordingData = so->ctx->recptr;
@@ -134,6 +143,18 @@ void survive_recording_raw_pose_process(SurviveObject *so, uint8_t lighthouse, c
 	survive_recording_write_to_output(
 		recordingData, "%s POSE " FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF "\r\n",
 		so->codename, pose->Pos[0], pose->Pos[1], pose->Pos[2], pose->Rot[0], pose->Rot[1], pose->Rot[2], pose->Rot[3]);
+
+	if (recordingData->pose_track) {
+		FLT variance[7] = {0};
+		SurviveKalmanTracker *tracker = so->tracker;
+		if (tracker && tracker->model.P && tracker->model.state_cnt >= 7) {
+			for (int i = 0; i < 7; i++) {
+				variance[i] = tracker->model.P[i * tracker->model.state_cnt + i];
+			}
+		}
+		survive_posetrack_write_pose(recordingData->pose_track, so->codename, survive_run_time(so->ctx), pose,
+									 variance);
+	}
 }
 
 void survive_recording_external_velocity_process(SurviveContext *ctx, const char *name, const SurviveVelocity *pose) {
@@ -319,7 +340,12 @@ void survive_recording_raw_imu_process(struct SurviveObject *so, int mask, FLT *
 
 void survive_destroy_recording(SurviveContext *ctx) {
 	if (ctx->recptr) {
-		gzclose(ctx->recptr->output_file);
+		if (ctx->recptr->output_file) {
+			gzclose(ctx->recptr->output_file);
+		}
+		if (ctx->recptr->pose_track && survive_posetrack_writer_close(ctx->recptr->pose_track) != 0) {
+			SV_WARN("Failed to write pose track");
+		}
 		free(ctx->recptr);
 		ctx->recptr = 0;
 	}
@@ -334,8 +360,9 @@ void survive_record_config(SurviveContext *ctx, const char *tag, uint8_t type, v
 void survive_install_recording(SurviveContext *ctx) {
 	const char *dataout_file = survive_configs(ctx, "record", SC_GET, "");
 	int record_to_stdout = survive_configi(ctx, "record-stdout", SC_GET, 0);
+	const char *pose_track_file = survive_configs(ctx, "record-pose-track", SC_GET, "");
 
-	if (strlen(dataout_file) > 0 || record_to_stdout) {
+	if (strlen(dataout_file) > 0 || record_to_stdout || strlen(pose_track_file) > 0) {
 		ctx->recptr = SV_CALLOC(1, sizeof(struct SurviveRecordingData));
 		ctx->recptr->ctx = ctx;
 		if (strlen(dataout_file) > 0) {
@@ -363,6 +390,15 @@ void survive_install_recording(SurviveContext *ctx) {
 			}
 		}
 
+		if (strlen(pose_track_file) > 0) {
+			ctx->recptr->pose_track = survive_posetrack_writer_open(pose_track_file);
+			if (ctx->recptr->pose_track) {
+				SV_INFO("Recording pose track to '%s'", pose_track_file);
+			} else {
+				SV_WARN("Could not open pose track '%s' for writing", pose_track_file);
+			}
+		}
+
 		ctx->recptr->alwaysWriteStdOut = record_to_stdout;
 		if (record_to_stdout) {
 			SV_INFO("Recording to stdout");
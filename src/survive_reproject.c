@@ -1,5 +1,6 @@
 #include "survive_reproject.h"
 #include <assert.h>
+#include <linmath_inline.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -56,17 +57,17 @@ void survive_reproject_xy(const BaseStationCal *bcal, LinmathVec3d const ptInLh,
 void survive_reproject_full(const BaseStationCal *bcal, const SurvivePose *world2lh, const SurvivePose *obj2world,
 							const LinmathVec3d obj_pt, SurviveAngleReading out) {
 	LinmathVec3d world_pt;
-	ApplyPoseToPoint(world_pt, obj2world, obj_pt);
+	ApplyPoseToPoint_inline(world_pt, obj2world, obj_pt);
 
 	LinmathPoint3d t_pt;
-	ApplyPoseToPoint(t_pt, world2lh, world_pt);
+	ApplyPoseToPoint_inline(t_pt, world2lh, world_pt);
 
 	survive_reproject_xy(bcal, t_pt, out);
 }
 void survive_reproject_from_pose_with_bcal(const BaseStationCal *bcal, const SurvivePose *world2lh,
 										   LinmathVec3d const ptInWorld, SurviveAngleReading out) {
 	LinmathPoint3d ptInLh;
-	ApplyPoseToPoint(ptInLh, world2lh, ptInWorld);
+	ApplyPoseToPoint_inline(ptInLh, world2lh, ptInWorld);
 	survive_reproject_xy(bcal, ptInLh, out);
 }
 
@@ -1,5 +1,6 @@
 #define _USE_MATH_DEFINES
 #include <assert.h>
+#include <linmath_inline.h>
 #include <math.h>
 #include <survive_reproject.h>
 #include <survive_reproject_gen2.h>
@@ -128,7 +129,7 @@ void survive_reproject_xy_gen2(const BaseStationCal *bcal, LinmathVec3d const pt
 void survive_reproject_from_pose_with_bcal_gen2(const BaseStationCal *bcal, const SurvivePose *world2lh,
 												LinmathVec3d const ptInWorld, SurviveAngleReading out) {
 	LinmathPoint3d ptInLh;
-	ApplyPoseToPoint(ptInLh, world2lh, ptInWorld);
+	ApplyPoseToPoint_inline(ptInLh, world2lh, ptInWorld);
 	survive_reproject_xy_gen2(bcal, ptInLh, out);
 }
 
@@ -146,10 +147,10 @@ void survive_reproject_gen2(const SurviveContext *ctx, int lighthouse, LinmathVe
 void survive_reproject_full_gen2(const BaseStationCal *bcal, const SurvivePose *world2lh, const SurvivePose *obj2world,
 								 const LinmathVec3d obj_pt, SurviveAngleReading out) {
 	LinmathVec3d world_pt;
-	ApplyPoseToPoint(world_pt, obj2world, obj_pt);
+	ApplyPoseToPoint_inline(world_pt, obj2world, obj_pt);
 
 	LinmathPoint3d t_pt;
-	ApplyPoseToPoint(t_pt, world2lh, world_pt);
+	ApplyPoseToPoint_inline(t_pt, world2lh, world_pt);
 
 	survive_reproject_xy_gen2(bcal, t_pt, out);
 }
@@ -163,6 +163,9 @@ void SurviveSensorActivations_add(SurviveSensorActivations *self, struct PoserDa
 
 	int axis = (_lightData->acode & 1);
 	PoserDataLight *lightData = &_lightData->common;
+	if (lightData->sensor_id >= SENSORS_PER_OBJECT || lightData->lh >= NUM_GEN1_LIGHTHOUSES)
+		return;
+
 	survive_long_timecode *data_timecode = &self->timecode[lightData->sensor_id][lightData->lh][axis];
 
 	FLT *angle = &self->angles[lightData->sensor_id][lightData->lh][axis];
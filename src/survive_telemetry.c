@@ -0,0 +1,273 @@
+#include "survive_telemetry.h"
+#include "survive_config.h"
+#include "survive_kalman_tracker.h"
+
+#include <os_generic.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+STATIC_CONFIG_ITEM(TELEMETRY_FILE, "telemetry-file", 's', "File to stream per object tracking telemetry to as CSV", "")
+STATIC_CONFIG_ITEM(TELEMETRY_SOCKET, "telemetry-socket", 's',
+				   "Unix datagram socket to send per object tracking telemetry to as CSV", "")
+STATIC_CONFIG_ITEM(TELEMETRY_PERIOD, "telemetry-period", 'f', "Seconds between telemetry samples", 1.)
+
+// Big enough for the header plus a row for a few dozen objects in one datagram
+#define TELEMETRY_BUFFER_SIZE (1 << 16)
+
+typedef struct SurviveTelemetry {
+	SurviveContext *ctx;
+
+	// Guards the object list and latest samples; never held while the tracker runs
+	og_mutex_t lock;
+	SurviveObject **objs;
+	SurviveTelemetrySample *latest;
+	size_t objs_cnt;
+
+	FILE *f;
+	int socket_fd;
+	char socket_path[108];
+
+	double period;
+	volatile bool running;
+	og_thread_t thread;
+
+	new_object_process_func prior_new_object;
+
+	char *buffer;
+} SurviveTelemetry;
+
+static uint32_t sum_lhs(const uint32_t *counts) {
+	uint32_t rtn = 0;
+	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++)
+		rtn += counts[i];
+	return rtn;
+}
+
+static double mean(FLT total, size_t cnt) { return cnt ? total / (double)cnt : 0; }
+
+void survive_telemetry_sample(const SurviveObject *so, double time, SurviveTelemetrySample *sample) {
+	*sample = (SurviveTelemetrySample){
+		.time = time,
+		.syncs = sum_lhs(so->stats.syncs),
+		.skipped_syncs = sum_lhs(so->stats.skipped_syncs),
+		.bad_syncs = sum_lhs(so->stats.bad_syncs),
+		.sync_resets = sum_lhs(so->stats.sync_resets),
+		.hit_from_lhs = sum_lhs(so->stats.hit_from_lhs),
+		.rejected_data = sum_lhs(so->stats.rejected_data),
+		.dropped_light = sum_lhs(so->stats.dropped_light),
+		.optimizer_meas_cnt = so->stats.optimizer_meas_cnt,
+		.optimizer_dropped_meas_cnt = so->stats.optimizer_dropped_meas_cnt,
+		.optimizer_lh_cnt = so->stats.optimizer_lh_cnt,
+		.optimizer_dropped_lh_cnt = so->stats.optimizer_dropped_lh_cnt,
+	};
+	strncpy(sample->object, so->codename, SURVIVE_TELEMETRY_NAME_LEN - 1);
+
+	const SurviveKalmanTracker *tracker = so->tracker;
+	if (tracker) {
+		sample->late_imu_dropped = tracker->stats.late_imu_dropped;
+		sample->late_light_dropped = tracker->stats.late_light_dropped;
+		sample->imu_cnt = tracker->stats.imu_count;
+		sample->lightcap_cnt = tracker->stats.lightcap_count;
+		sample->obs_cnt = tracker->stats.obs_count;
+		sample->reported_poses = tracker->stats.reported_poses;
+		sample->dropped_poses = tracker->stats.dropped_poses;
+		sample->imu_error = mean(tracker->stats.imu_total_error, sample->imu_cnt);
+		sample->lightcap_error = mean(tracker->stats.lightcap_total_error, sample->lightcap_cnt);
+		sample->obs_error = mean(tracker->stats.obs_total_error, sample->obs_cnt);
+	}
+}
+
+int survive_telemetry_format_header(char *buffer, size_t len) {
+	return snprintf(buffer, len,
+					"time,object,syncs,skipped_syncs,bad_syncs,sync_resets,hits,rejected_data,dropped_light,"
+					"late_imu_dropped,late_light_dropped,imu_cnt,lightcap_cnt,obs_cnt,reported_poses,dropped_poses,"
+					"imu_error,lightcap_error,obs_error,optimizer_meas_cnt,optimizer_dropped_meas_cnt,"
+					"optimizer_lh_cnt,optimizer_dropped_lh_cnt\n");
+}
+
+int survive_telemetry_format_sample(const SurviveTelemetrySample *s, char *buffer, size_t len) {
+	return snprintf(buffer, len, "%.6f,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%g,%g,%g,%u,%u,%u,%u\n",
+					s->time, s->object, s->syncs, s->skipped_syncs, s->bad_syncs, s->sync_resets, s->hit_from_lhs,
+					s->rejected_data, s->dropped_light, s->late_imu_dropped, s->late_light_dropped,
+					(unsigned long long)s->imu_cnt, (unsigned long long)s->lightcap_cnt,
+					(unsigned long long)s->obs_cnt, (unsigned long long)s->reported_poses,
+					(unsigned long long)s->dropped_poses, s->imu_error, s->lightcap_error, s->obs_error,
+					s->optimizer_meas_cnt, s->optimizer_dropped_meas_cnt, s->optimizer_lh_cnt,
+					s->optimizer_dropped_lh_cnt);
+}
+
+size_t survive_telemetry_latest(SurviveContext *ctx, SurviveTelemetrySample *out, size_t max_cnt) {
+	SurviveTelemetry *t = ctx->telemetry;
+	if (t == 0)
+		return 0;
+
+	OGLockMutex(t->lock);
+	size_t cnt = t->objs_cnt;
+	memcpy(out, t->latest, sizeof(SurviveTelemetrySample) * (cnt < max_cnt ? cnt : max_cnt));
+	OGUnlockMutex(t->lock);
+	return cnt;
+}
+
+static void add_object(SurviveTelemetry *t, SurviveObject *so) {
+	OGLockMutex(t->lock);
+	t->objs = SV_REALLOC(t->objs, sizeof(SurviveObject *) * (t->objs_cnt + 1));
+	t->latest = SV_REALLOC(t->latest, sizeof(SurviveTelemetrySample) * (t->objs_cnt + 1));
+	t->objs[t->objs_cnt] = so;
+	t->latest[t->objs_cnt] = (SurviveTelemetrySample){0};
+	t->objs_cnt++;
+	OGUnlockMutex(t->lock);
+}
+
+static void telemetry_new_object(SurviveObject *so) {
+	SurviveTelemetry *t = so->ctx->telemetry;
+	add_object(t, so);
+	t->prior_new_object(so);
+}
+
+void survive_telemetry_remove_object(SurviveContext *ctx, SurviveObject *so) {
+	SurviveTelemetry *t = ctx->telemetry;
+	if (t == 0)
+		return;
+
+	OGLockMutex(t->lock);
+	for (size_t i = 0; i < t->objs_cnt; i++) {
+		if (t->objs[i] == so) {
+			t->objs_cnt--;
+			t->objs[i] = t->objs[t->objs_cnt];
+			t->latest[i] = t->latest[t->objs_cnt];
+			break;
+		}
+	}
+	OGUnlockMutex(t->lock);
+}
+
+static void publish(SurviveTelemetry *t) {
+	double now = survive_run_time(t->ctx);
+
+	OGLockMutex(t->lock);
+	size_t len = survive_telemetry_format_header(t->buffer, TELEMETRY_BUFFER_SIZE);
+	size_t header_len = len;
+	for (size_t i = 0; i < t->objs_cnt; i++) {
+		survive_telemetry_sample(t->objs[i], now, &t->latest[i]);
+		if (len < TELEMETRY_BUFFER_SIZE)
+			len += survive_telemetry_format_sample(&t->latest[i], t->buffer + len, TELEMETRY_BUFFER_SIZE - len);
+	}
+	OGUnlockMutex(t->lock);
+
+	if (len >= TELEMETRY_BUFFER_SIZE)
+		len = TELEMETRY_BUFFER_SIZE - 1;
+
+	// The file gets the header once; every datagram carries it so listeners can attach at any time
+	if (t->f) {
+		fwrite(t->buffer + header_len, 1, len - header_len, t->f);
+		fflush(t->f);
+	}
+
+#ifndef _WIN32
+	if (t->socket_fd >= 0) {
+		struct sockaddr_un addr = {.sun_family = AF_UNIX};
+		strncpy(addr.sun_path, t->socket_path, sizeof(addr.sun_path) - 1);
+		// Nobody listening is the normal case; just drop the sample
+		sendto(t->socket_fd, t->buffer, len, MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr));
+	}
+#endif
+}
+
+static void *telemetry_thread(void *_t) {
+	SurviveTelemetry *t = _t;
+
+	// Sleep in short steps so shutdown doesn't wait out a whole period
+	const double step = .01;
+	double waited = 0;
+	while (t->running) {
+		OGUSleep((int)(step * 1e6));
+		waited += step;
+		if (waited >= t->period) {
+			waited = 0;
+			publish(t);
+		}
+	}
+	return 0;
+}
+
+void survive_telemetry_install(SurviveContext *ctx) {
+	const char *fn = survive_configs(ctx, TELEMETRY_FILE_TAG, SC_GET, "");
+	const char *socket_path = survive_configs(ctx, TELEMETRY_SOCKET_TAG, SC_GET, "");
+	bool has_file = fn && *fn, has_socket = socket_path && *socket_path;
+	if (!has_file && !has_socket)
+		return;
+
+	SurviveTelemetry *t = SV_CALLOC(1, sizeof(SurviveTelemetry));
+	t->ctx = ctx;
+	t->lock = OGCreateMutex();
+	t->socket_fd = -1;
+	t->buffer = SV_MALLOC(TELEMETRY_BUFFER_SIZE);
+	t->period = survive_configf(ctx, TELEMETRY_PERIOD_TAG, SC_GET, 1.);
+	if (t->period <= 0)
+		t->period = 1.;
+
+	if (has_file) {
+		t->f = fopen(fn, "w");
+		if (t->f) {
+			survive_telemetry_format_header(t->buffer, TELEMETRY_BUFFER_SIZE);
+			fputs(t->buffer, t->f);
+		} else {
+			SV_WARN("Could not open telemetry file '%s'", fn);
+		}
+	}
+
+	if (has_socket) {
+#ifndef _WIN32
+		t->socket_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+		strncpy(t->socket_path, socket_path, sizeof(t->socket_path) - 1);
+		if (t->socket_fd < 0)
+			SV_WARN("Could not create telemetry socket for '%s'", socket_path);
+#else
+		SV_WARN("telemetry-socket isn't supported on this platform");
+#endif
+	}
+
+	ctx->telemetry = t;
+	for (int i = 0; i < ctx->objs_ct; i++)
+		add_object(t, ctx->objs[i]);
+	t->prior_new_object = survive_install_new_object_fn(ctx, telemetry_new_object);
+
+	t->running = true;
+	t->thread = OGCreateThread(telemetry_thread, "telemetry", t);
+
+	SV_INFO("Writing telemetry every %.2fs to %s%s%s", t->period, has_file ? fn : "",
+			has_file && has_socket ? " and " : "", has_socket ? socket_path : "");
+}
+
+void survive_telemetry_free(SurviveContext *ctx) {
+	SurviveTelemetry *t = ctx->telemetry;
+	if (t == 0)
+		return;
+
+	t->running = false;
+	OGJoinThread(t->thread);
+
+	// One last sample so the file always ends with the final counts
+	publish(t);
+
+	survive_install_new_object_fn(ctx, t->prior_new_object);
+	ctx->telemetry = 0;
+
+	if (t->f)
+		fclose(t->f);
+#ifndef _WIN32
+	if (t->socket_fd >= 0)
+		close(t->socket_fd);
+#endif
+	OGDeleteMutex(t->lock);
+	free(t->objs);
+	free(t->latest);
+	free(t->buffer);
+	free(t);
+}
@@ -0,0 +1,29 @@
+#include "survive_arena.h"
+#include "test_case.h"
+
+TEST(Survive, ArenaGrowsToSteadyState) {
+	survive_arena arena;
+	survive_arena_init(&arena, 64);
+
+	for (int cycle = 0; cycle < 3; cycle++) {
+		survive_arena_reset(&arena);
+		uint8_t *a = survive_arena_alloc(&arena, 10);
+		uint8_t *b = survive_arena_alloc(&arena, 100);
+		uint8_t *c = survive_arena_alloc(&arena, 1);
+
+		uintptr_t misaligned = ((uintptr_t)a | (uintptr_t)b | (uintptr_t)c) & (SURVIVE_ARENA_ALIGNMENT - 1);
+		ASSERT_EQ(misaligned, 0);
+		memset(a, 1, 10);
+		memset(b, 2, 100);
+		*c = 3;
+		ASSERT_EQ(a[9], 1);
+		ASSERT_EQ(b[99], 2);
+	}
+
+	// Only the first cycle overflowed; after that the main block holds everything
+	ASSERT_EQ(arena.grow_cnt, 1);
+	ASSERT_EQ((arena.overflow == 0), 1);
+
+	survive_arena_free(&arena);
+	return 0;
+}
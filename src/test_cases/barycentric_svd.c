@@ -0,0 +1,83 @@
+#include "../barycentric_svd/barycentric_svd.h"
+#include "test_case.h"
+#include <linmath.h>
+
+// Same plane equations the poser uses for gen1 lighthouses
+static void fill_m(void *user, FLT *eq, int axis, FLT angle) {
+	FLT sv = sin(angle), cv = cos(angle);
+	eq[0] = axis == 0 ? cv : 0;
+	eq[1] = axis == 1 ? cv : 0;
+	eq[2] = -sv;
+}
+
+#define PT_CNT 24
+
+static void make_object(LinmathPoint3d *pts) {
+	for (int i = 0; i < PT_CNT; i++) {
+		FLT theta = i * 2.39996, z = 1 - (2 * i + 1) / (FLT)PT_CNT;
+		FLT r = sqrt(1 - z * z);
+		pts[i][0] = .1 * r * cos(theta);
+		pts[i][1] = .1 * r * sin(theta);
+		pts[i][2] = .1 * z;
+	}
+}
+
+static void add_view(bc_svd *bc, LinmathPoint3d *pts, const SurvivePose *obj2cam) {
+	for (int i = 0; i < PT_CNT; i++) {
+		LinmathPoint3d p;
+		ApplyPoseToPoint(p, obj2cam, pts[i]);
+		bc_svd_add_correspondence(bc, i, atan2(p[0], p[2]), atan2(p[1], p[2]));
+	}
+}
+
+TEST(BarycentricSVD, RecoversPose) {
+	LinmathPoint3d pts[PT_CNT];
+	make_object(pts);
+
+	bc_svd bc;
+	bc_svd_bc_svd(&bc, 0, fill_m, (const LinmathPoint3d *)pts, PT_CNT);
+
+	SurvivePose obj2cam = {.Pos = {.3, -.2, 2.5}};
+	LinmathEulerAngle euler = {.3, -.5, 1.2};
+	quatfromeuler(obj2cam.Rot, euler);
+
+	// Junk from a previous solve must not leak through the reset
+	SurvivePose other = {.Pos = {-1, 0, 4}, .Rot = {1}};
+	add_view(&bc, pts, &other);
+	bc_svd_reset_correspondences(&bc);
+	add_view(&bc, pts, &obj2cam);
+	ASSERT_EQ(bc.meas_cnt, 2 * PT_CNT);
+
+	FLT R[3][3], t[3];
+	FLT err = bc_svd_compute_pose(&bc, R, t);
+	ASSERT_GE(err, 0.);
+	ASSERT_GT(1e-6, err);
+	ASSERT_DOUBLE_ARRAY_EQ(3, t, obj2cam.Pos);
+
+	LinmathQuat q;
+	quatfrommatrix33(q, R[0]);
+	if (q[0] * obj2cam.Rot[0] < 0)
+		quatscale(q, q, -1);
+	ASSERT_QUAT_EQ(q, obj2cam.Rot);
+
+	bc_svd_dtor(&bc);
+	return 0;
+}
+
+TEST(BarycentricSVD, NeedsBothAxes) {
+	LinmathPoint3d pts[PT_CNT];
+	make_object(pts);
+
+	bc_svd bc;
+	bc_svd_bc_svd(&bc, 0, fill_m, (const LinmathPoint3d *)pts, PT_CNT);
+
+	for (int i = 0; i < PT_CNT; i++)
+		bc_svd_add_correspondence(&bc, i, .1 * i, NAN);
+
+	FLT R[3][3], t[3];
+	FLT err = bc_svd_compute_pose(&bc, R, t);
+	ASSERT_EQ((err < 0), true);
+
+	bc_svd_dtor(&bc);
+	return 0;
+}
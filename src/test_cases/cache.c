@@ -0,0 +1,129 @@
+#include "../survive_cache.h"
+#include "string.h"
+#include "test_case.h"
+
+static SurviveContext *create_context() {
+	SurviveContext *ctx = SV_CALLOC(1, sizeof(SurviveContext));
+#define SURVIVE_HOOK_PROCESS_DEF(hook) survive_install_##hook##_fn(ctx, 0);
+#define SURVIVE_HOOK_FEEDBACK_DEF(hook) survive_install_##hook##_fn(ctx, 0);
+#include "survive_hooks.h"
+
+	ctx->log_target = stderr;
+	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
+		ctx->bsd[i].mode = -1;
+		ctx->bsd_map[i] = -1;
+	}
+	return ctx;
+}
+
+TEST(Survive, CalibrationCacheRoundTrip) {
+	const char *path = "test_calibration.cache";
+	remove(path);
+
+	SurviveContext *ctx = create_context();
+	ASSERT_EQ(survive_cache_load(ctx, path), -1);
+
+	BaseStationData *bsd = &ctx->bsd[1];
+	*bsd = (BaseStationData){.BaseStationID = 0x12345678, .mode = 3, .OOTXSet = 1, .PositionSet = 1};
+	bsd->Pose = (SurvivePose){.Pos = {1, 2, 3}, .Rot = {0, 1, 0, 0}};
+	bsd->fcal[1].ogeemag = .25;
+	bsd->accel[2] = 127;
+	ctx->bsd_map[3] = 1;
+	ctx->activeLighthouses = 2;
+
+	ASSERT_EQ(survive_cache_save(ctx), 0);
+	survive_cache_free(ctx);
+	free(ctx);
+
+	ctx = create_context();
+	ASSERT_EQ(survive_cache_load(ctx, path), 1);
+
+	bsd = &ctx->bsd[1];
+	ASSERT_EQ(ctx->activeLighthouses, 2);
+	ASSERT_EQ(ctx->bsd_map[3], 1);
+	ASSERT_EQ(bsd->BaseStationID, 0x12345678);
+	ASSERT_EQ(bsd->OOTXSet, 1);
+	ASSERT_EQ(bsd->OOTXCached, 1);
+	ASSERT_EQ(bsd->PositionSet, 1);
+	ASSERT_EQ(bsd->accel[2], 127);
+	ASSERT_DOUBLE_EQ(bsd->fcal[1].ogeemag, .25);
+	ASSERT_DOUBLE_EQ(bsd->Pose.Pos[2], 3.);
+	ASSERT_DOUBLE_EQ(bsd->Pose.Rot[1], 1.);
+	ASSERT_EQ(ctx->bsd[0].mode, 0xFF);
+
+	survive_cache_free(ctx);
+	free(ctx);
+	remove(path);
+	return 0;
+}
+
+TEST(Survive, CalibrationCacheRejectsBadDeviceCount) {
+	const char *path = "test_calibration_bad.cache";
+	remove(path);
+
+	SurviveContext *ctx = create_context();
+	ASSERT_EQ(survive_cache_load(ctx, path), -1);
+	ctx->bsd[0] = (BaseStationData){.BaseStationID = 0x12345678, .mode = 1, .OOTXSet = 1};
+	ctx->activeLighthouses = 1;
+	ASSERT_EQ(survive_cache_save(ctx), 0);
+	survive_cache_free(ctx);
+	free(ctx);
+
+	// The device count follows the magic, version, both record sizes and the lighthouse count in the header
+	uint32_t device_cnt = 0x7fffffff;
+	FILE *f = fopen(path, "r+b");
+	ASSERT_EQ(fseek(f, 24, SEEK_SET), 0);
+	ASSERT_EQ(fwrite(&device_cnt, sizeof(device_cnt), 1, f), 1);
+	fclose(f);
+
+	ctx = create_context();
+	ASSERT_EQ(survive_cache_load(ctx, path), -1);
+	ASSERT_EQ(ctx->bsd[0].OOTXSet, 0);
+
+	survive_cache_free(ctx);
+	free(ctx);
+	remove(path);
+	return 0;
+}
+
+TEST(Survive, CalibrationCacheForceOotx) {
+	const char *path = "test_calibration_ootx.cache";
+	const char *recording = "test_calibration_ootx.rec";
+	remove(path);
+
+	SurviveContext *ctx = create_context();
+	ASSERT_EQ(survive_cache_load(ctx, path), -1);
+	ctx->bsd[0] = (BaseStationData){.BaseStationID = 0x12345678, .mode = 1, .OOTXSet = 1};
+	ctx->bsd_map[1] = 0;
+	ctx->activeLighthouses = 1;
+	ASSERT_EQ(survive_cache_save(ctx), 0);
+	survive_cache_free(ctx);
+	free(ctx);
+
+	// OOTX that came from the config is not the cache's to vouch for
+	ctx = create_context();
+	ctx->bsd[0] = (BaseStationData){.BaseStationID = 0x12345678, .mode = 1, .OOTXSet = 1};
+	ctx->bsd_map[1] = 0;
+	ctx->activeLighthouses = 1;
+	ASSERT_EQ(survive_cache_load(ctx, path), 1);
+	ASSERT_EQ(ctx->bsd[0].OOTXSet, 1);
+	ASSERT_EQ(ctx->bsd[0].OOTXCached, 0);
+	survive_cache_free(ctx);
+	free(ctx);
+
+	// --force-ootx is applied at startup, so this starts a context on an empty recording
+	fclose(fopen(recording, "w"));
+
+	char *const args[] = {"test", "--v", "0", "--playback", (char *)recording, "--calibration-cache", (char *)path,
+						  "--force-ootx", "1"};
+	ctx = survive_init_internal(sizeof(args) / sizeof(args[0]), args, 0, 0);
+	ASSERT_EQ(survive_startup(ctx), 0);
+	ASSERT_EQ(ctx->activeLighthouses, 1);
+	ASSERT_EQ(ctx->bsd[0].OOTXSet, 0);
+	ASSERT_EQ(ctx->bsd[0].OOTXCached, 0);
+	survive_close(ctx);
+
+	remove(path);
+	remove(recording);
+	return 0;
+}
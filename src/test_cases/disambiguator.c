@@ -0,0 +1,272 @@
+#include "../survive_default_devices.h"
+#include "../survive_internal.h"
+#include "test_case.h"
+
+#include <os_generic.h>
+#include <string.h>
+
+// Gen1 A/B mode timing; see the table at the top of disambiguator_statebased.c
+#define CYCLE_TICKS 1600000
+#define SWEEP_HIT_OFFSET 100000
+
+static const struct {
+	int offset, acode, lh, is_sweep;
+} schedule[] = {
+	{0, 4, 1, 0},		{20000, 0, 0, 0},	{40000, 0, 0, 1},	{400000, 5, 1, 0},
+	{420000, 1, 0, 0},	{440000, 1, 0, 1},	{800000, 0, 1, 0},	{820000, 4, 0, 0},
+	{840000, 4, 1, 1},	{1200000, 1, 1, 0}, {1220000, 5, 0, 0}, {1240000, 5, 1, 1},
+};
+
+typedef struct {
+	uint32_t start;
+	int sweep_hits, syncs, mismatches;
+} disambiguator_test_result;
+
+static disambiguator_test_result result;
+
+static int sensor_hit_time(int sensor) { return SWEEP_HIT_OFFSET + sensor * 5000; }
+
+static void check_light(SurviveObject *so, int sensor_id, int acode, int timeinsweep, survive_timecode timecode,
+						survive_timecode length, uint32_t lighthouse) {
+	if (sensor_id < 0) {
+		result.syncs++;
+		return;
+	}
+
+	// Which sweep this hit came from follows from where it landed in the cycle
+	int in_cycle = (uint32_t)(timecode - result.start) % CYCLE_TICKS;
+	int lh = in_cycle >= 800000;
+	int axis = (in_cycle % 800000) >= 400000;
+	int sync_time = lh * 800000 + axis * 400000 + (lh ? 0 : 20000);
+	int expected = in_cycle + length / 2 - sync_time;
+
+	result.sweep_hits++;
+	if (lighthouse != lh || (acode & 1) != axis || timeinsweep != expected)
+		result.mismatches++;
+}
+
+static size_t generate_cycles(LightcapElement *out, int sensor_ct, uint32_t start, int cycles) {
+	size_t cnt = 0;
+	for (int c = 0; c < cycles; c++) {
+		uint32_t base = start + (uint32_t)c * CYCLE_TICKS;
+		for (size_t i = 0; i < sizeof(schedule) / sizeof(schedule[0]); i++) {
+			for (int sensor = 0; sensor < sensor_ct; sensor++) {
+				LightcapElement le = {.sensor_id = sensor};
+				if (schedule[i].is_sweep) {
+					le.timestamp = base + schedule[i].offset + sensor_hit_time(sensor);
+					le.length = 300;
+				} else {
+					le.timestamp = base + schedule[i].offset;
+					le.length = 3000 + (schedule[i].acode & 1) * 500 + ((schedule[i].acode >> 2) & 1) * 2000;
+				}
+				out[cnt++] = le;
+			}
+		}
+	}
+	return cnt;
+}
+
+static SurviveObject *create_test_object(SurviveContext **ctx_out, int sensor_ct) {
+	// survive_init loads the plugins, which is where the disambiguators live
+	char *const args[] = {"test", "--v", "0"};
+	SurviveContext *ctx = survive_init_internal(3, args, 0, 0);
+	survive_install_light_fn(ctx, check_light);
+
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->sensor_ct = sensor_ct;
+	*ctx_out = ctx;
+	return so;
+}
+
+static void destroy_test_object(SurviveObject *so, lightcap_process_func disambiguator) {
+	// The context was never started, so only what the test created is torn down
+	disambiguator(so, 0);
+	survive_destroy_device(so);
+}
+
+TEST(Disambiguator, StateBasedLocksAcrossRollover) {
+	const int sensor_ct = 8, cycles = 300;
+	SurviveContext *ctx;
+	SurviveObject *so = create_test_object(&ctx, sensor_ct);
+	lightcap_process_func disambiguator = (lightcap_process_func)GetDriver("DisambiguatorStateBased");
+	ASSERT_EQ((disambiguator != 0), 1);
+
+	// Starts close enough to the end of the 32 bit timecode that it rolls over part way through
+	memset(&result, 0, sizeof(result));
+	result.start = 0xFFFFFFFF - 100 * CYCLE_TICKS;
+	LightcapElement *les = SV_MALLOC(sizeof(LightcapElement) * 12 * sensor_ct * cycles);
+	size_t cnt = generate_cycles(les, sensor_ct, result.start, cycles);
+	for (size_t i = 0; i < cnt; i++)
+		disambiguator(so, &les[i]);
+
+	TEST_PRINTF("%d sweep hits, %d syncs, %d mismatches\n", result.sweep_hits, result.syncs, result.mismatches);
+	ASSERT_EQ(result.mismatches, 0);
+	// All but the lock in and the confidence ramp up should come through
+	ASSERT_GT((double)result.sweep_hits, .9 * 4 * sensor_ct * cycles);
+
+	free(les);
+	destroy_test_object(so, disambiguator);
+	return 0;
+}
+
+static double time_stream(const LightcapElement *les, size_t cnt, int sensor_ct, size_t batch_size) {
+	SurviveContext *ctx;
+	SurviveObject *so = create_test_object(&ctx, sensor_ct);
+	lightcap_process_func disambiguator = (lightcap_process_func)GetDriver("DisambiguatorStateBased");
+	lightcap_batch_process_func batch = (lightcap_batch_process_func)GetDriver("BatchDisambiguatorStateBased");
+
+	double start = OGGetAbsoluteTime();
+	if (batch_size == 1) {
+		for (size_t i = 0; i < cnt; i++)
+			disambiguator(so, &les[i]);
+	} else {
+		for (size_t i = 0; i < cnt; i += batch_size)
+			batch(so, &les[i], cnt - i < batch_size ? cnt - i : batch_size);
+	}
+	double elapsed = OGGetAbsoluteTime() - start;
+
+	destroy_test_object(so, disambiguator);
+	return elapsed;
+}
+
+TEST(Disambiguator, StateBasedThroughput) {
+	const int sensor_ct = 32, cycles = 1000;
+	LightcapElement *les = SV_MALLOC(sizeof(LightcapElement) * 12 * sensor_ct * cycles);
+	memset(&result, 0, sizeof(result));
+	size_t cnt = generate_cycles(les, sensor_ct, result.start, cycles);
+
+	// Watchman reports carry up to 10 lightcaps
+	size_t batch_sizes[] = {1, 10};
+	for (int i = 0; i < 2; i++) {
+		int sweep_hits = result.sweep_hits;
+		double elapsed = time_stream(les, cnt, sensor_ct, batch_sizes[i]);
+		printf("StateBased disambiguator, batches of %2zu: %zu lightcaps in %.3fs; %.1f ns per lightcap\n",
+			   batch_sizes[i], cnt, elapsed, elapsed / cnt * 1e9);
+		ASSERT_EQ(result.mismatches, 0);
+		if (i > 0) {
+			ASSERT_EQ(result.sweep_hits - sweep_hits, sweep_hits);
+		}
+	}
+
+	free(les);
+	return 0;
+}
+
+static int lightcaps_hooked, lightcaps_hooked_mismatches, gen_detected = -1;
+
+// Sensor r is reported as 7 - r; anything reported past that has no sensor behind it
+#define MAPPED_SENSORS 8
+#define REPORTED_SENSORS 10
+
+static void count_lightcap(SurviveObject *so, const LightcapElement *le) {
+	// Called without a lightcap when the context closes
+	if (le == 0)
+		return;
+
+	lightcaps_hooked++;
+	if (le->sensor_id >= MAPPED_SENSORS)
+		lightcaps_hooked_mismatches++;
+}
+
+static void record_gen_detected(SurviveObject *so, int lh_version) {
+	gen_detected = lh_version;
+	so->ctx->lh_version = lh_version;
+}
+
+// handle_lightcaps only batches for the disambiguator picked at startup, so this starts a context that replays a
+// recording with nothing but the test object in it
+static SurviveObject *create_started_object(SurviveContext **ctx_out) {
+	FILE *f = fopen("test-disambiguator.rec", "w");
+	fputs("0.000000 TS0 CONFIG {}\n", f);
+	fclose(f);
+
+	char *const args[] = {"test", "--v", "0", "--playback", "test-disambiguator.rec", "--playback-factor", "0"};
+	SurviveContext *ctx = survive_init_internal(sizeof(args) / sizeof(args[0]), args, 0, 0);
+	survive_install_light_fn(ctx, check_light);
+	survive_install_gen_detected_fn(ctx, record_gen_detected);
+	survive_startup(ctx);
+
+	SurviveObject *so = survive_get_so_by_name(ctx, "TS0");
+	so->sensor_ct = MAPPED_SENSORS;
+	so->channel_map = SV_MALLOC(sizeof(int) * 32);
+	for (int i = 0; i < 32; i++)
+		so->channel_map[i] = i < MAPPED_SENSORS ? MAPPED_SENSORS - 1 - i : -1;
+
+	ctx->lh_version = 0;
+	lightcaps_hooked = lightcaps_hooked_mismatches = 0;
+	gen_detected = -1;
+	memset(&result, 0, sizeof(result));
+	*ctx_out = ctx;
+	return so;
+}
+
+TEST(Disambiguator, HandleLightcapsBatchesMappedSensors) {
+	const int cycles = 300;
+	SurviveContext *ctx;
+	SurviveObject *so = create_started_object(&ctx);
+
+	LightcapElement *les = SV_MALLOC(sizeof(LightcapElement) * 12 * MAPPED_SENSORS * cycles);
+	size_t cnt = generate_cycles(les, MAPPED_SENSORS, result.start, cycles);
+
+	// Far more than SENSORS_PER_OBJECT at once, so it goes through in chunks
+	ASSERT_EQ(handle_lightcaps(so, les, cnt), 1);
+
+	TEST_PRINTF("%d sweep hits, %d syncs, %d mismatches\n", result.sweep_hits, result.syncs, result.mismatches);
+	ASSERT_EQ(result.mismatches, 0);
+	ASSERT_GT((double)result.sweep_hits, .9 * 4 * MAPPED_SENSORS * cycles);
+
+	// Unmapped sensors are dropped and reported, and the rest of their chunk still goes through
+	LightcapElement unmapped[2] = {les[0], les[1]};
+	unmapped[0].sensor_id = REPORTED_SENSORS - 1;
+	ASSERT_EQ(handle_lightcaps(so, unmapped, 2), 0);
+	ASSERT_EQ(result.mismatches, 0);
+
+	free(les);
+	survive_close(ctx);
+	remove("test-disambiguator.rec");
+	return 0;
+}
+
+TEST(Disambiguator, HandleLightcapsFallsBackForHooks) {
+	const int cycles = 1;
+	SurviveContext *ctx;
+	SurviveObject *so = create_started_object(&ctx);
+
+	LightcapElement *les = SV_MALLOC(sizeof(LightcapElement) * 12 * REPORTED_SENSORS * cycles);
+	size_t cnt = generate_cycles(les, REPORTED_SENSORS, result.start, cycles);
+
+	// A user lightcap hook sees every mapped lightcap itself, and nothing reaches the disambiguator
+	survive_install_lightcap_fn(ctx, count_lightcap);
+	ASSERT_EQ(handle_lightcaps(so, les, cnt), 0);
+	ASSERT_EQ(lightcaps_hooked, cnt / REPORTED_SENSORS * MAPPED_SENSORS);
+	ASSERT_EQ(lightcaps_hooked_mismatches, 0);
+	ASSERT_EQ(result.sweep_hits + result.syncs, 0);
+
+	free(les);
+	survive_close(ctx);
+	remove("test-disambiguator.rec");
+	return 0;
+}
+
+TEST(Disambiguator, HandleLightcapsDetectsGenFirst) {
+	const int cycles = 2;
+	SurviveContext *ctx;
+	SurviveObject *so = create_started_object(&ctx);
+	ctx->lh_version = -1;
+
+	LightcapElement *les = SV_MALLOC(sizeof(LightcapElement) * 12 * REPORTED_SENSORS * cycles);
+	size_t cnt = generate_cycles(les, REPORTED_SENSORS, result.start, cycles);
+
+	// Until the gen is known lightcaps go one at a time to the detection, which settles on gen2 after 100 of them
+	// without OOTX pulses
+	ASSERT_EQ(handle_lightcaps(so, les, 100), 1);
+	ASSERT_EQ(gen_detected, -1);
+	ASSERT_EQ(result.sweep_hits + result.syncs, 0);
+	ASSERT_EQ(handle_lightcaps(so, les + 100, cnt - 100), 0);
+	ASSERT_EQ(gen_detected, 1);
+
+	free(les);
+	survive_close(ctx);
+	remove("test-disambiguator.rec");
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include "../survive_default_devices.h"
+#include "survive_event_export.h"
+#include "test_case.h"
+
+#include <string.h>
+
+static int imu_forwarded, imu_chained;
+static imu_process_func chained_prior;
+
+static void count_imu(SurviveObject *so, int mask, FLT *accelgyro, survive_timecode timecode, int id) {
+	imu_forwarded++;
+}
+
+static void chained_imu(SurviveObject *so, int mask, FLT *accelgyro, survive_timecode timecode, int id) {
+	imu_chained++;
+	chained_prior(so, mask, accelgyro, timecode, id);
+}
+
+static void send_imu(SurviveObject *so, int id) {
+	FLT accelgyro[9] = {0};
+	so->ctx->imuproc(so, 3, accelgyro, 1000 + id, id);
+}
+
+TEST(Survive, EventExportRing) {
+	char *const args[] = {"test", "--v", "0"};
+	SurviveContext *ctx = survive_init_internal(3, args, 0, 0);
+	survive_install_imu_fn(ctx, count_imu);
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+
+	ASSERT_EQ(survive_event_export_install(ctx, 4), 0);
+	SurviveImuEvent events[8];
+
+	for (int id = 0; id < 3; id++)
+		send_imu(so, id);
+	ASSERT_EQ(survive_event_export_drain(ctx, SURVIVE_EVENT_EXPORT_IMU, events, 2), 2);
+	ASSERT_EQ(events[0].id, 0);
+	ASSERT_EQ(events[1].id, 1);
+
+	// Wraps around the end of the buffer, and the last event no longer fits
+	for (int id = 3; id < 7; id++)
+		send_imu(so, id);
+	ASSERT_EQ(imu_forwarded, 7);
+	ASSERT_EQ(survive_event_export_count(ctx, SURVIVE_EVENT_EXPORT_IMU), 4);
+	ASSERT_EQ(survive_event_export_dropped(ctx, SURVIVE_EVENT_EXPORT_IMU), 1);
+
+	ASSERT_EQ(survive_event_export_drain(ctx, SURVIVE_EVENT_EXPORT_IMU, events, 3), 3);
+	for (int i = 0; i < 3; i++) {
+		ASSERT_EQ(events[i].id, i + 2);
+		ASSERT_EQ(events[i].timecode, 1002 + i);
+		ASSERT_EQ(strcmp(events[i].object, "TS0"), 0);
+	}
+	ASSERT_EQ(survive_event_export_drain(ctx, SURVIVE_EVENT_EXPORT_IMU, events, 8), 1);
+	ASSERT_EQ(events[0].id, 5);
+	ASSERT_EQ(survive_event_export_drain(ctx, SURVIVE_EVENT_EXPORT_IMU, events, 8), 0);
+	ASSERT_EQ(survive_event_export_count(ctx, SURVIVE_EVENT_EXPORT_POSE), 0);
+
+	survive_event_export_free(ctx);
+	ASSERT_EQ((ctx->imuproc == count_imu), 1);
+	ASSERT_EQ((ctx->event_export == 0), 1);
+
+	// The context was never started, so only what the test created is torn down
+	survive_destroy_device(so);
+	return 0;
+}
+
+TEST(Survive, EventExportKeepsChainedHooks) {
+	char *const args[] = {"test", "--v", "0"};
+	SurviveContext *ctx = survive_init_internal(3, args, 0, 0);
+	survive_install_imu_fn(ctx, count_imu);
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	imu_forwarded = imu_chained = 0;
+
+	ASSERT_EQ(survive_event_export_install(ctx, 4), 0);
+	angle_process_func angle_before = ctx->angleproc;
+	chained_prior = survive_install_imu_fn(ctx, chained_imu);
+
+	// The hook on top of the export survives it, and the export only forwards from then on
+	survive_event_export_free(ctx);
+	ASSERT_EQ((ctx->imuproc == chained_imu), 1);
+	ASSERT_EQ((ctx->angleproc != angle_before), 1);
+	send_imu(so, 0);
+	ASSERT_EQ(imu_chained, 1);
+	ASSERT_EQ(imu_forwarded, 1);
+	ASSERT_EQ(survive_event_export_count(ctx, SURVIVE_EVENT_EXPORT_IMU), 0);
+
+	// Installing again picks the chained hook back up without hooking twice
+	ASSERT_EQ(survive_event_export_install(ctx, 4), 0);
+	ASSERT_EQ((ctx->imuproc == chained_imu), 1);
+	send_imu(so, 1);
+	ASSERT_EQ(imu_forwarded, 2);
+	ASSERT_EQ(survive_event_export_count(ctx, SURVIVE_EVENT_EXPORT_IMU), 1);
+
+	survive_destroy_device(so);
+	return 0;
+}
@@ -352,3 +352,52 @@ TEST(Kalman, AngleQuat) {
 	survive_kalman_state_free(&rotation);
 	return 0;
 }
+
+// The Joseph form is algebraically the same update as the short form for the optimal gain; it should track the same
+// states while keeping P exactly symmetric.
+TEST(Kalman, JosephForm) {
+	FLT pos_Q_per_sec[36] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 25, 0, 0, 0, 0, 0, 0, 25, 0, 0, 0, 0, 0, 0, 25,
+	};
+	FLT P_init[6] = {1, 1, 1, 1, 1, 1};
+
+	survive_kalman_state_t filters[2];
+	for (int f = 0; f < 2; f++) {
+		survive_kalman_state_init(&filters[f], 6, pos_f, 0, pos_Q_per_sec, 0);
+		filters[f].joseph_form = f == 1;
+		survive_kalman_set_P(&filters[f], P_init);
+	}
+
+	FLT _H[18] = {0};
+	for (int i = 0; i < 3; i++)
+		_H[i * 6 + i] = 1;
+	CvMat H = cvMat(3, 6, SURVIVE_CV_F, _H);
+	FLT R[] = {.01, .01, .01};
+
+	for (int i = 1; i < 100; i++) {
+		FLT t = i * .01;
+		FLT _Z[3] = {sin(t), cos(t), t};
+		CvMat Z = cvMat(3, 1, SURVIVE_CV_F, _Z);
+
+		for (int f = 0; f < 2; f++) {
+			survive_kalman_predict_update_state(t, &filters[f], &Z, &H, R, false);
+		}
+
+		FLT diff[6];
+		subnd(diff, filters[0].state, filters[1].state, 6);
+		ASSERT_EQ((normnd(diff, 6) < 1e-3), 1);
+
+		for (int r = 0; r < 6; r++) {
+			for (int c = 0; c < 6; c++) {
+				ASSERT_EQ(filters[1].P[r * 6 + c], filters[1].P[c * 6 + r]);
+				ASSERT_EQ((fabs(filters[0].P[r * 6 + c] - filters[1].P[r * 6 + c]) < 1e-3), 1);
+			}
+			ASSERT_EQ((filters[1].P[r * 6 + r] > 0), 1);
+		}
+	}
+
+	for (int f = 0; f < 2; f++) {
+		survive_kalman_state_free(&filters[f]);
+	}
+	return 0;
+}
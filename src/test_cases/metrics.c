@@ -0,0 +1,48 @@
+#include "survive_metrics.h"
+#include "test_case.h"
+
+#include <os_generic.h>
+#include <string.h>
+
+static void *count_from_thread(void *metric) {
+	for (int i = 0; i < 1000; i++)
+		survive_metric_add(metric, 1);
+	return 0;
+}
+
+TEST(Survive, MetricsFormat) {
+	char *const args[] = {"test", "--metrics", "1", "--v", "0"};
+	SurviveContext *ctx = survive_init_internal(5, args, 0, 0);
+	ASSERT_EQ((survive_metric_register(ctx, SURVIVE_METRIC_COUNTER, "test_total", 0, 0) == 0), 1);
+	survive_metrics_install(ctx);
+
+	SurviveMetric *counter = survive_metric_register(ctx, SURVIVE_METRIC_COUNTER, "test_total", "A counter", 0);
+	ASSERT_EQ((counter != 0), 1);
+	ASSERT_EQ((survive_metric_register(ctx, SURVIVE_METRIC_COUNTER, "test_total", "A counter", 0) == counter), 1);
+
+	// Each thread lands on its own shard; the scrape has to add them all back up
+	og_thread_t threads[4];
+	for (int i = 0; i < 4; i++)
+		threads[i] = OGCreateThread(count_from_thread, "metrics test", counter);
+	for (int i = 0; i < 4; i++)
+		OGJoinThread(threads[i]);
+
+	survive_metric_set(survive_metric_register(ctx, SURVIVE_METRIC_GAUGE, "test_gauge", 0, "lh=\"1\""), 2.5);
+	SurviveMetric *histogram = survive_metric_register(ctx, SURVIVE_METRIC_HISTOGRAM, "test_seconds", 0, 0);
+	survive_metric_observe(histogram, 20e-6);
+	survive_metric_observe(histogram, 2.);
+
+	char *text = survive_metrics_format(ctx);
+	ASSERT_EQ((strstr(text, "# TYPE test_total counter\n") != 0), 1);
+	ASSERT_EQ((strstr(text, "\ntest_total 4000\n") != 0), 1);
+	ASSERT_EQ((strstr(text, "\ntest_gauge{lh=\"1\"} 2.5\n") != 0), 1);
+	ASSERT_EQ((strstr(text, "\ntest_seconds_bucket{le=\"1e-05\"} 0\n") != 0), 1);
+	ASSERT_EQ((strstr(text, "\ntest_seconds_bucket{le=\"2.5e-05\"} 1\n") != 0), 1);
+	ASSERT_EQ((strstr(text, "\ntest_seconds_bucket{le=\"+Inf\"} 2\n") != 0), 1);
+	ASSERT_EQ((strstr(text, "\ntest_seconds_count 2\n") != 0), 1);
+	free(text);
+
+	// The context was never started, so the metrics are the only thing to tear down
+	survive_metrics_free(ctx);
+	return 0;
+}
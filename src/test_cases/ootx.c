@@ -0,0 +1,106 @@
+#include "../ootx_decoder.h"
+#include "test_case.h"
+
+#ifdef NOZLIB
+#include "crc32.h"
+#else
+#include <zlib.h>
+#endif
+
+typedef struct ootx_test_stream {
+	int8_t bits[2048];
+	size_t cnt;
+} ootx_test_stream;
+
+typedef struct ootx_test_result {
+	int packets, bad_crcs;
+	uint8_t data[OOTX_MAX_BUFF_SIZE];
+	uint16_t length;
+} ootx_test_result;
+
+static void push_bit(ootx_test_stream *s, int8_t bit) { s->bits[s->cnt++] = bit; }
+
+// Frames a payload the way a lighthouse sends it: a 17 zero preamble, then 16 bit words of the length, the payload and
+// its CRC32, each followed by a sync bit.
+static void encode_packet(ootx_test_stream *s, const uint8_t *payload, uint16_t length) {
+	uint8_t buffer[OOTX_MAX_BUFF_SIZE] = {0};
+	uint16_t padded_length = length + (length & 1);
+	uint32_t crc = crc32(0L, payload, length);
+	memcpy(buffer, &length, 2);
+	memcpy(buffer + 2, payload, length);
+	memcpy(buffer + 2 + padded_length, &crc, 4);
+
+	for (int i = 0; i < 17; i++)
+		push_bit(s, 0);
+	push_bit(s, 1);
+
+	for (int word = 0; word < (padded_length + 6) / 2; word++) {
+		for (int bit = 0; bit < 16; bit++) {
+			push_bit(s, (buffer[word * 2 + bit / 8] >> (7 - bit % 8)) & 1);
+		}
+		push_bit(s, 1);
+	}
+}
+
+static void packet_clbk(ootx_decoder_context *ctx, ootx_packet *packet) {
+	ootx_test_result *r = ctx->user;
+	r->packets++;
+	r->length = packet->length;
+	memcpy(r->data, packet->data, packet->length);
+}
+
+static void bad_crc_clbk(ootx_decoder_context *ctx, ootx_packet *packet, uint32_t crc) {
+	ootx_test_result *r = ctx->user;
+	r->bad_crcs++;
+}
+
+static void run_stream(ootx_decoder_context *ctx, const ootx_test_stream *s) {
+	for (size_t i = 0; i < s->cnt; i++)
+		ootx_pump_bit(ctx, s->bits[i]);
+}
+
+TEST(OOTX, DecodesPackets) {
+	uint8_t payload[33];
+	for (int i = 0; i < sizeof(payload); i++)
+		payload[i] = i * 37 + 11;
+
+	ootx_test_result result = {0};
+	ootx_decoder_context ctx = {.user = &result, .ootx_packet_clbk = packet_clbk, .ootx_bad_crc_clbk = bad_crc_clbk};
+	ootx_init_decoder_context(&ctx, 0);
+
+	ootx_test_stream s = {0};
+	for (int i = 0; i < 5; i++)
+		push_bit(&s, i & 1);
+	encode_packet(&s, payload, sizeof(payload));
+	run_stream(&ctx, &s);
+
+	ASSERT_EQ(result.packets, 1);
+	ASSERT_EQ(result.length, sizeof(payload));
+	ASSERT_EQ(memcmp(result.data, payload, sizeof(payload)), 0);
+
+	// Missed bits on a repeat of the same packet keep what was decoded for them the last time around
+	ootx_test_stream repeat = {0};
+	encode_packet(&repeat, payload, sizeof(payload));
+	for (size_t i = 40; i < repeat.cnt; i += 7) {
+		bool is_sync_bit = (i - 34) % 17 == 0;
+		if (!is_sync_bit)
+			repeat.bits[i] = -1;
+	}
+	run_stream(&ctx, &repeat);
+
+	ASSERT_EQ(result.packets, 2);
+	ASSERT_EQ(memcmp(result.data, payload, sizeof(payload)), 0);
+	ASSERT_EQ((ctx.stats.guess_bits > 0), 1);
+
+	// A flipped payload bit fails the CRC
+	repeat.cnt = 0;
+	encode_packet(&repeat, payload, sizeof(payload));
+	repeat.bits[18 + 17 * 3 + 5] ^= 1;
+	run_stream(&ctx, &repeat);
+
+	ASSERT_EQ(result.packets, 2);
+	ASSERT_EQ(result.bad_crcs, 1);
+
+	ootx_free_decoder_context(&ctx);
+	return 0;
+}
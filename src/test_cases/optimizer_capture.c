@@ -0,0 +1,54 @@
+#include "survive_optimizer.h"
+#include "survive_reproject_gen2.h"
+#include "test_case.h"
+
+TEST(Survive, OptimizerProblemRoundTrip) {
+	FLT sensors[] = {.1, .2, .3, -.1, -.2, -.3};
+	SurviveObject so = {.codename = "TST", .sensor_ct = 2, .sensor_locations = sensors};
+
+	survive_optimizer opt = {
+		.reprojectModel = &survive_reproject_gen2_model, .poseLength = 1, .cameraLength = 2, .current_bias = .5};
+	SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(opt, &so);
+
+	SurvivePose pose = {.Pos = {1, 2, 3}, .Rot = {1}};
+	survive_optimizer_setup_pose(&opt, &pose, false, 1);
+	opt.measurements[opt.measurementsCnt++] = (survive_optimizer_measurement){
+		.value = .25, .variance = 1e-3, .lh = 1, .sensor_idx = 1, .axis = 1};
+	mp_config cfg = {.maxiter = 10, .ftol = 1e-5};
+
+	FILE *f = tmpfile();
+	ASSERT_EQ(survive_optimizer_write_problem_header(f), 0);
+	ASSERT_EQ(survive_optimizer_write_problem(f, &opt, &cfg), 0);
+	rewind(f);
+
+	mp_config read_cfg;
+	ASSERT_EQ(survive_optimizer_read_problem_header(f), 0);
+	survive_optimizer *read = survive_optimizer_read_problem(f, &read_cfg);
+	ASSERT_EQ((read != 0), 1);
+	ASSERT_EQ((survive_optimizer_read_problem(f, 0) == 0), 1);
+
+	ASSERT_EQ((read->reprojectModel == &survive_reproject_gen2_model), 1);
+	ASSERT_EQ(read->cameraLength, 2);
+	ASSERT_EQ(read->measurementsCnt, 1);
+	ASSERT_EQ(read->measurements[0].sensor_idx, 1);
+	ASSERT_EQ(read_cfg.maxiter, 10);
+	ASSERT_DOUBLE_EQ(read->current_bias, .5);
+	ASSERT_DOUBLE_EQ(read->parameters[2], 3.);
+	ASSERT_DOUBLE_EQ(read->sos[0]->sensor_locations[5], -.3);
+	ASSERT_EQ(strcmp(read->sos[0]->codename, "TST"), 0);
+
+	int param_cnt = survive_optimizer_get_parameters_count(&opt);
+	bool same_info = true;
+	for (int i = 0; i < param_cnt; i++) {
+		same_info &= read->parameters_info[i].fixed == opt.parameters_info[i].fixed &&
+					 read->parameters_info[i].side == opt.parameters_info[i].side &&
+					 read->parameters_info[i].limits[1] == opt.parameters_info[i].limits[1];
+	}
+	ASSERT_EQ(same_info, 1);
+
+	survive_optimizer_free_problem(read);
+	fclose(f);
+	SURVIVE_OPTIMIZER_CLEANUP_HEAP_BUFFERS(opt);
+	free(opt.sos);
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include "../survive_internal.h"
+#include "survive_clock.h"
+#include "test_case.h"
+
+#include <os_generic.h>
+#include <string.h>
+
+typedef struct {
+	char codename[4];
+	int id;
+} playback_test_imu;
+
+static playback_test_imu imu_seen[8];
+static size_t imu_seen_cnt;
+static int lightcodes_seen;
+
+static void record_imu(SurviveObject *so, int mask, FLT *accelgyro, survive_timecode timecode, int id) {
+	if (imu_seen_cnt < sizeof(imu_seen) / sizeof(imu_seen[0])) {
+		memcpy(imu_seen[imu_seen_cnt].codename, so->codename, sizeof(so->codename));
+		imu_seen[imu_seen_cnt++].id = id;
+	}
+}
+
+static void record_light(SurviveObject *so, int sensor_id, int acode, int timeinsweep, survive_timecode timecode,
+						 survive_timecode length, uint32_t lighthouse) {
+	if (sensor_id == 7)
+		lightcodes_seen++;
+}
+
+static void write_recording(const char *path, const char *contents) {
+	FILE *f = fopen(path, "w");
+	fputs(contents, f);
+	fclose(f);
+}
+
+static const char *imu_seen_by(int id) {
+	for (size_t i = 0; i < imu_seen_cnt; i++) {
+		if (imu_seen[i].id == id)
+			return imu_seen[i].codename;
+	}
+	return "";
+}
+
+TEST(Playback, MergeRenamesOverlappingDevices) {
+	const char *main_path = "test-playback-main.rec";
+	const char *merge_path = "test-playback-merge.rec";
+
+	// The main recording has raw light, which must not hide the light codes of the merged one
+	write_recording(main_path, "0.000000 WM0 CONFIG {}\n"
+							   "0.100000 WM0 i 0 0 0 0 0 0 0 0 0 0 0 1\n"
+							   "0.200000 WM0 C 0 1000 100\n");
+	write_recording(merge_path, "0.000000 WM0 CONFIG {}\n"
+								"0.000000 WM1 CONFIG {}\n"
+								"0.300000 WM0 i 0 0 0 0 0 0 0 0 0 0 0 2\n"
+								"0.400000 WM1 i 0 0 0 0 0 0 0 0 0 0 0 3\n"
+								"0.500000 WM1 R X 7 0 100 2000 50 0\n");
+
+	char *const args[] = {"test", "--v", "0", "--playback", (char *)main_path, "--playback-merge", (char *)merge_path,
+						  "--playback-factor", "0"};
+	imu_seen_cnt = 0;
+	lightcodes_seen = 0;
+
+	SurviveContext *ctx = survive_init_internal(sizeof(args) / sizeof(args[0]), args, 0, 0);
+	ASSERT_EQ((ctx != 0), 1);
+	survive_install_raw_imu_fn(ctx, record_imu);
+	survive_install_light_fn(ctx, record_light);
+	ASSERT_EQ(survive_startup(ctx), 0);
+
+	while (survive_poll(ctx) == 0)
+		OGUSleep(1000);
+
+	// The merged WM0 can't take WM1 since the merged recording uses that name itself
+	ASSERT_EQ(ctx->objs_ct, 3);
+	ASSERT_EQ((survive_get_so_by_name(ctx, "WM0") != 0), 1);
+	ASSERT_EQ((survive_get_so_by_name(ctx, "WM1") != 0), 1);
+	ASSERT_EQ((survive_get_so_by_name(ctx, "WM2") != 0), 1);
+
+	ASSERT_EQ(imu_seen_cnt, 3);
+	ASSERT_EQ((strcmp(imu_seen_by(1), "WM0") == 0), 1);
+	ASSERT_EQ((strcmp(imu_seen_by(2), "WM2") == 0), 1);
+	ASSERT_EQ((strcmp(imu_seen_by(3), "WM1") == 0), 1);
+	ASSERT_EQ(lightcodes_seen, 1);
+
+	survive_close(ctx);
+	remove(main_path);
+	remove(merge_path);
+	return 0;
+}
+
+// One IMU sample every half second with the sample index as its id, and a lighthouse pose right after the start
+#define SEEK_TEST_SAMPLES 15
+
+static double seek_wall_times[SEEK_TEST_SAMPLES];
+static int seek_first_id, seek_lh_poses;
+static SurvivePose seek_lh_pose;
+
+static void record_seek_imu(SurviveObject *so, int mask, FLT *accelgyro, survive_timecode timecode, int id) {
+	if (seek_first_id < 0)
+		seek_first_id = id;
+	if (id >= 0 && id < SEEK_TEST_SAMPLES)
+		seek_wall_times[id] = survive_clock_real_time(so->ctx);
+}
+
+static void record_seek_lh_pose(SurviveContext *ctx, const char *name, const SurvivePose *pose) {
+	if (strcmp(name, "previous_LH0") == 0) {
+		seek_lh_poses++;
+		seek_lh_pose = *pose;
+	}
+}
+
+static int run_seek_recording(const char *path, const char *start, const char *preroll, const char *factor) {
+	char *const args[] = {"test", "--v", "0", "--playback", (char *)path, "--playback-start", (char *)start,
+						  "--playback-preroll", (char *)preroll, "--playback-factor", (char *)factor,
+						  "--playback-replay-pose", "1"};
+	seek_first_id = -1;
+	seek_lh_poses = 0;
+	memset(seek_wall_times, 0, sizeof(seek_wall_times));
+
+	SurviveContext *ctx = survive_init_internal(sizeof(args) / sizeof(args[0]), args, 0, 0);
+	if (ctx == 0)
+		return -1;
+	survive_install_raw_imu_fn(ctx, record_seek_imu);
+	survive_install_external_pose_fn(ctx, record_seek_lh_pose);
+	if (survive_startup(ctx) != 0)
+		return -1;
+
+	while (survive_poll(ctx) == 0)
+		OGUSleep(1000);
+	survive_close(ctx);
+	return 0;
+}
+
+TEST(Playback, SeekPrerollsFromCheckpoint) {
+	const char *path = "test-playback-seek.rec";
+
+	char contents[2048] = "0.000000 WM0 CONFIG {}\n"
+						  "0.250000 0 LH_POSE 1.000000 2.000000 3.000000 1.000000 0.000000 0.000000 0.000000\n";
+	for (int i = 0; i < SEEK_TEST_SAMPLES; i++) {
+		char line[128];
+		snprintf(line, sizeof(line), "%f WM0 i 0 0 0 0 0 0 0 0 0 0 0 %d\n", i * .5, i);
+		strcat(contents, line);
+	}
+	write_recording(path, contents);
+
+	// Starts at 6s with 2s of preroll, so replay begins at the checkpoint at 4s. The lighthouse pose from before it
+	// comes from the checkpoint, and everything up to 6s goes through without waiting.
+	ASSERT_EQ(run_seek_recording(path, "6", "2", "1"), 0);
+	ASSERT_EQ(seek_first_id, 8);
+	ASSERT_EQ(seek_lh_poses, 1);
+	ASSERT_DOUBLE_EQ(seek_lh_pose.Pos[1], 2.);
+	TEST_PRINTF("Preroll took %fs, then 1s of replay took %fs\n", seek_wall_times[12] - seek_wall_times[8],
+				seek_wall_times[14] - seek_wall_times[12]);
+	ASSERT_GT(.5, seek_wall_times[12] - seek_wall_times[8]);
+	ASSERT_GT(seek_wall_times[14] - seek_wall_times[12], .8);
+
+	// A preroll reaching back before the first checkpoint replays from the start, lighthouse pose line included
+	ASSERT_EQ(run_seek_recording(path, "1", "5", "0"), 0);
+	ASSERT_EQ(seek_first_id, 0);
+	ASSERT_EQ(seek_lh_poses, 1);
+
+	remove(path);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "string.h"
+#include "survive_posetrack.h"
+#include "test_case.h"
+
+TEST(Survive, PoseTrackRoundTrip) {
+	const char *path = "test_posetrack.svpt";
+	remove(path);
+
+	survive_posetrack_writer *writer = survive_posetrack_writer_open(path);
+	ASSERT_EQ((writer != 0), 1);
+
+	// Enough samples to span several chunks, interleaved between two objects
+	for (int i = 0; i < 3000; i++) {
+		double time = i * .01;
+		SurvivePose pose = {.Pos = {i, 2 * i, 1}, .Rot = {1, 0, 0, 0}};
+		FLT variance[7] = {i * .5};
+		ASSERT_EQ(survive_posetrack_write_pose(writer, "T20", time, &pose, variance), 0);
+
+		SurviveVelocity velocity = {.Pos = {-i}, .AxisAngleRot = {0, 0, 1}};
+		ASSERT_EQ(survive_posetrack_write_velocity(writer, "T20", time, &velocity), 0);
+
+		if (i % 2 == 0) {
+			pose.Pos[2] = -1;
+			ASSERT_EQ(survive_posetrack_write_pose(writer, "HMD", time, &pose, 0), 0);
+		}
+	}
+	ASSERT_EQ(survive_posetrack_writer_close(writer), 0);
+
+	survive_posetrack_reader *reader = survive_posetrack_reader_open(path);
+	ASSERT_EQ((reader != 0), 1);
+	ASSERT_EQ(survive_posetrack_object_count(reader), 2);
+	ASSERT_EQ(strcmp(survive_posetrack_object_name(reader, 1), "HMD"), 0);
+
+	survive_posetrack_sample *samples = 0;
+	size_t capacity = 0;
+	ASSERT_EQ(survive_posetrack_read_range(reader, "T20", 10.005, 20.005, &samples, &capacity), 1000);
+	ASSERT_DOUBLE_EQ(samples[0].time, 10.01);
+	ASSERT_DOUBLE_EQ(samples[0].pose.Pos[0], 1001.);
+	ASSERT_DOUBLE_EQ(samples[0].pose.Pos[1], 2002.);
+	ASSERT_DOUBLE_EQ(samples[0].velocity.Pos[0], -1001.);
+	ASSERT_DOUBLE_EQ(samples[0].velocity.AxisAngleRot[2], 1.);
+	ASSERT_DOUBLE_EQ(samples[0].variance[0], 500.5);
+	ASSERT_DOUBLE_EQ(samples[999].pose.Pos[0], 2000.);
+
+	ASSERT_EQ(survive_posetrack_read_range(reader, "HMD", 0, 100, &samples, &capacity), 1500);
+	ASSERT_DOUBLE_EQ(samples[1].pose.Pos[0], 2.);
+	ASSERT_DOUBLE_EQ(samples[1].pose.Pos[2], -1.);
+	ASSERT_DOUBLE_EQ(samples[1].variance[0], 0.);
+
+	ASSERT_EQ(survive_posetrack_read_range(reader, "WM0", 0, 100, &samples, &capacity), 0);
+
+	free(samples);
+	survive_posetrack_reader_close(reader);
+	remove(path);
+	return 0;
+}
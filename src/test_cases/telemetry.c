@@ -0,0 +1,45 @@
+#include "../survive_kalman_tracker.h"
+#include "survive_telemetry.h"
+#include "test_case.h"
+
+static int count_columns(const char *line) {
+	int rtn = 1;
+	for (; *line; line++)
+		rtn += *line == ',';
+	return rtn;
+}
+
+TEST(Survive, TelemetrySample) {
+	SurviveObject *so = SV_CALLOC(1, sizeof(SurviveObject));
+	SurviveKalmanTracker *tracker = SV_CALLOC(1, sizeof(SurviveKalmanTracker));
+	strcpy(so->codename, "TR0");
+	so->tracker = tracker;
+
+	so->stats.syncs[0] = 10;
+	so->stats.syncs[1] = 5;
+	so->stats.hit_from_lhs[1] = 7;
+	so->stats.optimizer_dropped_meas_cnt = 3;
+	tracker->stats.lightcap_count = 4;
+	tracker->stats.lightcap_total_error = 2;
+	tracker->stats.reported_poses = 9;
+
+	SurviveTelemetrySample sample;
+	survive_telemetry_sample(so, 1.5, &sample);
+	ASSERT_EQ(strcmp(sample.object, "TR0"), 0);
+	ASSERT_EQ(sample.syncs, 15);
+	ASSERT_EQ(sample.hit_from_lhs, 7);
+	ASSERT_EQ(sample.optimizer_dropped_meas_cnt, 3);
+	ASSERT_EQ(sample.reported_poses, 9);
+	ASSERT_DOUBLE_EQ(sample.lightcap_error, .5);
+	ASSERT_DOUBLE_EQ(sample.imu_error, 0.);
+
+	char header[1024], row[1024];
+	survive_telemetry_format_header(header, sizeof(header));
+	survive_telemetry_format_sample(&sample, row, sizeof(row));
+	ASSERT_EQ(count_columns(header), count_columns(row));
+	ASSERT_EQ(strncmp(row, "1.500000,TR0,15,", 16), 0);
+
+	free(tracker);
+	free(so);
+	return 0;
+}
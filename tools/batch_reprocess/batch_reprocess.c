@@ -0,0 +1,295 @@
+// Reprocesses a set of recordings through the full libsurvive pipeline in parallel worker processes.
+//
+// Each recording -- and optionally each object within a recording -- becomes one job. Jobs run in forked worker
+// processes with the playback driver running as fast as possible; since playback drives survive_run_time, every
+// worker runs on the virtual time of its recording. Solved poses are written out per job as a pose track file; see
+// survive_posetrack.h.
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <survive.h>
+
+#define MAX_OBJECTS 32
+#define OBJECT_NAME_LEN 32
+
+typedef struct job {
+	char recording[FILENAME_MAX];
+	// Empty to process all objects in the recording
+	char object[OBJECT_NAME_LEN];
+	char blacklist[MAX_OBJECTS * (OBJECT_NAME_LEN + 1)];
+	pid_t pid;
+	int status;
+} job;
+
+typedef struct options {
+	const char *out_dir;
+	int jobs;
+	bool shard_objects;
+	int survive_argc;
+	char **survive_argv;
+} options;
+
+static bool has_suffix(const char *s, const char *suffix) {
+	size_t l = strlen(s), sl = strlen(suffix);
+	return l >= sl && strcmp(s + l - sl, suffix) == 0;
+}
+
+static bool is_recording(const char *name) {
+	return has_suffix(name, ".rec") || has_suffix(name, ".rec.gz") || has_suffix(name, ".pcap") ||
+		   has_suffix(name, ".pcap.gz");
+}
+
+static const char *base_name(const char *path) {
+	const char *slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+static void job_output_path(char *out, size_t len, const options *opts, const job *j, const char *ext) {
+	if (j->object[0]) {
+		snprintf(out, len, "%s/%s.%s%s", opts->out_dir, base_name(j->recording), j->object, ext);
+	} else {
+		snprintf(out, len, "%s/%s%s", opts->out_dir, base_name(j->recording), ext);
+	}
+}
+
+static int run_worker(const options *opts, const job *j) {
+	char config_path[FILENAME_MAX], init_config_path[FILENAME_MAX + 8], output_path[FILENAME_MAX];
+	job_output_path(config_path, sizeof(config_path), opts, j, ".json");
+	job_output_path(output_path, sizeof(output_path), opts, j, ".svpt");
+	snprintf(init_config_path, sizeof(init_config_path), "%s.json", j->recording);
+
+	// Each worker gets its own config file so concurrent workers never write to the same one
+	char *base_args[] = {"survive-batch-reprocess", "--playback", (char *)j->recording, "--playback-factor", "0",
+						 "--configfile", config_path, "--record-pose-track", output_path};
+	int base_argc = sizeof(base_args) / sizeof(base_args[0]);
+
+	char **argv = calloc(base_argc + opts->survive_argc + 4, sizeof(char *));
+	int argc = 0;
+	for (int i = 0; i < base_argc; i++)
+		argv[argc++] = base_args[i];
+
+	if (j->blacklist[0]) {
+		argv[argc++] = "--blacklist-devs";
+		argv[argc++] = (char *)j->blacklist;
+	}
+
+	struct stat st;
+	if (stat(init_config_path, &st) == 0) {
+		argv[argc++] = "--init-configfile";
+		argv[argc++] = init_config_path;
+	}
+	for (int i = 0; i < opts->survive_argc; i++)
+		argv[argc++] = opts->survive_argv[i];
+
+	SurviveContext *ctx = survive_init(argc, argv);
+	if (ctx == 0)
+		return -1;
+
+	int rtn = survive_startup(ctx);
+	if (rtn == 0) {
+		while (survive_poll(ctx) == 0) {
+		}
+	}
+
+	SV_INFO("Processed %.512s%s%s in %7.2fs of recording time", j->recording, j->object[0] ? " for " : "", j->object,
+			survive_run_time(ctx));
+	survive_close(ctx);
+	free(argv);
+
+	return rtn;
+}
+
+/* Reads the device names out of the CONFIG lines at the start of a recording. */
+static int scan_objects(const char *recording, char names[MAX_OBJECTS][OBJECT_NAME_LEN]) {
+	gzFile f = gzopen(recording, "r");
+	if (f == 0)
+		return 0;
+
+	int cnt = 0;
+	char line[4096];
+	while (cnt < MAX_OBJECTS && gzgets(f, line, sizeof(line))) {
+		double time;
+		char dev[OBJECT_NAME_LEN], command[32];
+		if (sscanf(line, "%lf %31s %31s", &time, dev, command) != 3)
+			continue;
+
+		// Same cutoff the playback driver uses for finding configurations
+		if (time > 60)
+			break;
+
+		if (strcmp(command, "CONFIG") == 0) {
+			strcpy(names[cnt++], dev);
+		}
+
+		// Config lines are long; skip the remainder of them
+		while (strchr(line, '\n') == 0 && gzgets(f, line, sizeof(line))) {
+		}
+	}
+	gzclose(f);
+	return cnt;
+}
+
+static void add_jobs(job **jobs, size_t *job_cnt, const options *opts, const char *recording) {
+	char names[MAX_OBJECTS][OBJECT_NAME_LEN];
+	int object_cnt = 0;
+	if (opts->shard_objects && !strstr(recording, ".pcap")) {
+		object_cnt = scan_objects(recording, names);
+	}
+
+	int shard_cnt = object_cnt > 1 ? object_cnt : 1;
+	*jobs = realloc(*jobs, (*job_cnt + shard_cnt) * sizeof(job));
+	for (int i = 0; i < shard_cnt; i++) {
+		job *j = &(*jobs)[(*job_cnt)++];
+		memset(j, 0, sizeof(*j));
+		strncpy(j->recording, recording, sizeof(j->recording) - 1);
+
+		if (object_cnt > 1) {
+			strcpy(j->object, names[i]);
+			for (int k = 0; k < object_cnt; k++) {
+				if (k == i)
+					continue;
+				if (j->blacklist[0])
+					strcat(j->blacklist, ",");
+				strcat(j->blacklist, names[k]);
+			}
+		}
+	}
+}
+
+static void add_path(job **jobs, size_t *job_cnt, const options *opts, const char *path) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "Could not stat %s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	if (!S_ISDIR(st.st_mode)) {
+		add_jobs(jobs, job_cnt, opts, path);
+		return;
+	}
+
+	DIR *dir = opendir(path);
+	if (dir == 0)
+		return;
+
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		if (!is_recording(entry->d_name))
+			continue;
+
+		char full_path[FILENAME_MAX];
+		snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+		add_jobs(jobs, job_cnt, opts, full_path);
+	}
+	closedir(dir);
+}
+
+static void usage(const char *name) {
+	fprintf(stderr,
+			"Usage: %s [--jobs N] [--out DIR] [--shard-objects] <recording or directory>... [-- <libsurvive args>]\n"
+			"  --jobs N          Number of worker processes; defaults to the number of CPUs\n"
+			"  --out DIR         Directory for the pose track and config files; defaults to '.'\n"
+			"  --shard-objects   Run each object in a recording in its own worker\n",
+			name);
+}
+
+int main(int argc, char **argv) {
+	options opts = {.out_dir = ".", .jobs = (int)sysconf(_SC_NPROCESSORS_ONLN)};
+
+	job *jobs = 0;
+	size_t job_cnt = 0;
+
+	int i = 1;
+	for (; i < argc; i++) {
+		if (strcmp(argv[i], "--") == 0) {
+			i++;
+			break;
+		}
+		if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			opts.jobs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			opts.out_dir = argv[++i];
+		} else if (strcmp(argv[i], "--shard-objects") == 0) {
+			opts.shard_objects = true;
+		} else if (argv[i][0] == '-') {
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	opts.survive_argc = argc - i;
+	opts.survive_argv = argv + i;
+
+	// Recordings are collected in a second pass so libsurvive arguments after '--' are never treated as paths
+	for (int k = 1; k < argc - opts.survive_argc; k++) {
+		if (strcmp(argv[k], "--jobs") == 0 || strcmp(argv[k], "--out") == 0) {
+			k++;
+		} else if (argv[k][0] != '-') {
+			add_path(&jobs, &job_cnt, &opts, argv[k]);
+		}
+	}
+
+	if (job_cnt == 0) {
+		usage(argv[0]);
+		return -1;
+	}
+	if (opts.jobs < 1)
+		opts.jobs = 1;
+
+	// libsurvive resolves relative config paths against its config directory, so hand workers absolute paths
+	mkdir(opts.out_dir, 0755);
+	char out_dir[FILENAME_MAX];
+	if (realpath(opts.out_dir, out_dir) == 0) {
+		fprintf(stderr, "Could not create output directory %s: %s\n", opts.out_dir, strerror(errno));
+		return -1;
+	}
+	opts.out_dir = out_dir;
+	fprintf(stderr, "Reprocessing %d job(s) with %d worker(s)\n", (int)job_cnt, opts.jobs);
+
+	size_t next = 0, running = 0, failed = 0;
+	while (next < job_cnt || running > 0) {
+		while (running < (size_t)opts.jobs && next < job_cnt) {
+			job *j = &jobs[next++];
+			fflush(stdout);
+			fflush(stderr);
+			j->pid = fork();
+			if (j->pid == 0) {
+				_exit(run_worker(&opts, j) == 0 ? 0 : 1);
+			} else if (j->pid < 0) {
+				fprintf(stderr, "Could not fork worker for %s: %s\n", j->recording, strerror(errno));
+				j->status = -1;
+				failed++;
+				continue;
+			}
+			running++;
+		}
+
+		int status = 0;
+		pid_t pid = wait(&status);
+		if (pid < 0)
+			break;
+
+		for (size_t k = 0; k < next; k++) {
+			if (jobs[k].pid == pid) {
+				jobs[k].status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+				if (jobs[k].status != 0) {
+					fprintf(stderr, "Job for %s %s failed (%d)\n", jobs[k].recording, jobs[k].object, jobs[k].status);
+					failed++;
+				}
+				running--;
+				break;
+			}
+		}
+	}
+
+	fprintf(stderr, "Finished %d job(s); %d failed\n", (int)job_cnt, (int)failed);
+	free(jobs);
+	return failed ? 1 : 0;
+}
@@ -1,379 +1,497 @@
-#include <assert.h>
-#include <iostream>
-#include <libsurvive/survive.h>
-#include <libsurvive/survive_reproject.h>
+// Searches for the lighthouse calibration -- the fcal* values in BaseStationCal -- that best explains a set of
+// recordings.
+//
+// Each recording is played back once, as fast as possible, and every solved pose of a resting object is captured along
+// with the angles seen since the last one. Those scenes are kept in memory as sensor positions in each
+// lighthouse's frame, so scoring a candidate calibration is just the reprojection of each point. Calibration is per
+// base station and axis and the axes don't interact, so each one gets its own pattern search; every candidate of a
+// round, for every axis, is scored in parallel on a pool of worker threads. A candidate is dropped as soon as its
+// running error passes the best complete error for its axis, since it can no longer win the round, or once the error
+// projected from what it has scored so far is clearly worse (--prune-ratio).
+//
+// A <recording>.json next to a recording is passed as its --init-configfile. Arguments after `--` go to every
+// playback.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <map>
 #include <math.h>
-#include <memory>
-#include <set>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
 #include <vector>
 
-#include <sba/sba.h>
+#include <os_generic.h>
+#include <survive.h>
+#include <survive_reproject.h>
+#include <survive_reproject_gen2.h>
 
-struct SBAData {
-	int last_acode = -1;
-	int last_lh = -1;
+// Measurements are scored in blocks; the pruning bound is checked between blocks.
+#define SCORE_BLOCK 256
 
-	int failures_to_reset = 1;
-	int failures_to_reset_cntr = 0;
-	int successes_to_reset = 1;
-	int successes_to_reset_cntr = 0;
+static const char *param_names[] = {"phase", "tilt", "curve", "gibpha", "gibmag", "ogeephase", "ogeemag"};
+static const FLT param_initial_step[] = {.005, .005, .005, .1, .005, .1, .05};
+#define PARAM_CNT (int)(sizeof(param_names) / sizeof(param_names[0]))
+#define GEN1_PARAM_CNT 5
 
-	FLT sensor_variance = 1.;
-	FLT sensor_variance_per_second = 0;
-	int sensor_time_window = SurviveSensorActivations_default_tolerance;
+static FLT *cal_param(BaseStationCal *cal, int param) {
+	FLT *fields[] = {&cal->phase, &cal->tilt, &cal->curve, &cal->gibpha, &cal->gibmag, &cal->ogeephase, &cal->ogeemag};
+	return fields[param];
+}
 
-	int required_meas = 8;
+struct Options {
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+	int max_rounds = 200;
+	// Steps stop shrinking at this fraction of their initial size
+	FLT min_step_ratio = 1. / 1024.;
+	// Relative error reduction a step needs to be taken; keeps the search from wandering along flat directions
+	double min_improvement = 1e-4;
+	// Candidates whose error projects to this many times the best are dropped early
+	FLT prune_ratio = 2;
+	// Poses that moved further than this since the objects last pose aren't captured
+	FLT max_motion = .001;
+	int min_meas = 8;
+	bool params[PARAM_CNT] = {true, true, true, true, true, true, true};
+	std::vector<const char *> recordings;
+	std::vector<const char *> survive_args;
 };
 
-struct PlaybackDataInput {
-	SurviveObject *so = nullptr;
-	SurvivePose position;
-	uint32_t timestamp;
-	std::vector<char> vmask;
-	std::vector<double> meas, cov;
-	SurviveSensorActivations activations;
-	PlaybackDataInput(SurviveObject *so, const SurvivePose &position)
-		: so(so), position(position), activations(so->activations) {
-		int32_t sensor_count = so->sensor_ct;
-		vmask.resize(sensor_count * NUM_LIGHTHOUSES);
-		cov.resize(4 * sensor_count * NUM_LIGHTHOUSES);
-		meas.resize(2 * sensor_count * NUM_LIGHTHOUSES);
-	}
-	void shrink(size_t new_size) {
-		cov.resize(4 * new_size);
-		meas.resize(2 * new_size);
-	}
-	~PlaybackDataInput() {}
+// All the captured measurements of one axis of one base station, across every recording
+struct AxisData {
+	uint64_t key;
+	uint32_t id;
+	int lh, axis, param_cnt;
+	survive_reproject_axis_fn_t reproject;
+
+	std::vector<FLT> pts; // 3 per measurement, in the lighthouse's frame
+	std::vector<FLT> angles;
+
+	BaseStationCal initial, best;
+	// Both axes as loaded, for printing an axis that wasn't seen
+	BaseStationCal loaded[2];
+	double initial_sse = 0, best_sse = 0;
+	FLT step[PARAM_CNT];
+	bool converged = false;
+
+	// Lowest complete error seen for this axis in the current round
+	std::atomic<double> bound;
+
+	AxisData() : bound(0) {}
+	size_t size() const { return angles.size(); }
 };
 
-struct PlaybackData {
-	SurviveObject *so = nullptr;
-	BaseStationData bsd[2];
-	std::vector<PlaybackDataInput> inputs;
+struct Candidate {
+	AxisData *axis;
+	BaseStationCal cal;
+	double sse;
+	size_t evaluated;
 };
 
-SBAData settings;
-static size_t construct_input_from_scene(SurviveObject *so, uint32_t timestamp, char *vmask, double *meas,
-										 double *cov) {
-	size_t rtn = 0;
-	auto scene = &so->activations;
-	for (size_t sensor = 0; sensor < so->sensor_ct; sensor++) {
-		for (size_t lh = 0; lh < 2; lh++) {
-			if (SurviveSensorActivations_isPairValid(scene, settings.sensor_time_window, timestamp, sensor, lh)) {
-				double *a = scene->angles[sensor][lh];
-				vmask[sensor * NUM_LIGHTHOUSES + lh] = 1;
-
-				if (cov) {
-					*(cov++) = settings.sensor_variance +
-							   std::abs((double)timestamp - scene->timecode[sensor][lh][0]) *
-								   settings.sensor_variance_per_second / (double)so->timebase_hz;
-					*(cov++) = 0;
-					*(cov++) = 0;
-					*(cov++) = settings.sensor_variance +
-							   std::abs((double)timestamp - scene->timecode[sensor][lh][1]) *
-								   settings.sensor_variance_per_second / (double)so->timebase_hz;
-				}
-				meas[rtn++] = a[0];
-				meas[rtn++] = a[1];
-			} else {
-				vmask[sensor * NUM_LIGHTHOUSES + lh] = 0;
+struct LightSample {
+	int lh, axis;
+	LinmathPoint3d ptInWorld;
+	FLT angle;
+};
+
+struct ObjectCapture {
+	SurvivePose last_pose;
+	// Timecode of each reading as of the last captured scene, so a reading is only captured once
+	survive_long_timecode captured[SENSORS_PER_OBJECT][NUM_GEN2_LIGHTHOUSES][2];
+};
+
+struct Capture {
+	const Options *opts;
+	imupose_process_func prior_pose;
+	std::map<SurviveObject *, ObjectCapture> objects;
+	std::vector<LightSample> samples;
+	size_t scenes = 0;
+};
+
+// Sensor locations are in the IMU's frame, so this hooks the IMU pose rather than the reported one. That fires at IMU
+// rate, far more often than the angles change, so each reading is only captured with the first resting pose after it.
+static void capture_pose(SurviveObject *so, survive_timecode timecode, const SurvivePose *pose) {
+	Capture *capture = (Capture *)so->ctx->user_ptr;
+	capture->prior_pose(so, timecode, pose);
+
+	auto last = capture->objects.find(so);
+	if (last == capture->objects.end()) {
+		capture->objects[so].last_pose = *pose;
+		return;
+	}
+
+	ObjectCapture *obj = &last->second;
+	bool resting = dist3d(obj->last_pose.Pos, pose->Pos) < capture->opts->max_motion;
+	obj->last_pose = *pose;
+	if (!resting)
+		return;
+
+	size_t start = capture->samples.size();
+	const SurviveSensorActivations *activations = &so->activations;
+	for (int sensor = 0; sensor < so->sensor_ct; sensor++) {
+		for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+			for (int axis = 0; axis < 2; axis++) {
+				if (activations->timecode[sensor][lh][axis] == obj->captured[sensor][lh][axis] ||
+					!SurviveSensorActivations_isReadingValid(activations, SurviveSensorActivations_default_tolerance,
+															 sensor, lh, axis))
+					continue;
+
+				LightSample sample = {lh, axis};
+				sample.angle = activations->angles[sensor][lh][axis];
+				ApplyPoseToPoint(sample.ptInWorld, pose, &so->sensor_locations[sensor * 3]);
+				capture->samples.push_back(sample);
 			}
 		}
 	}
-	return rtn;
-}
-uint32_t timestamp;
 
-void light_process(SurviveObject *so, int sensor_id, int acode, int timeinsweep, uint32_t timecode, uint32_t length,
-				   uint32_t lighthouse) {
-	timestamp = timecode;
-	survive_default_light_process(so, sensor_id, acode, timeinsweep, timecode, length, lighthouse);
+	// Too few new readings stay uncaptured, to go with a later pose
+	if (capture->samples.size() - start < (size_t)capture->opts->min_meas) {
+		capture->samples.resize(start);
+		return;
+	}
+
+	capture->scenes++;
+	memcpy(obj->captured, activations->timecode, sizeof(obj->captured));
 }
 
-SurvivePose lastPose = {};
-void pose_process(SurviveObject *so, uint32_t timecode, SurvivePose *pose) {
-	survive_default_raw_pose_process(so, timecode, pose);
-	PlaybackData *d = (PlaybackData *)so->ctx->user_ptr;
-	d->so = so;
-	d->inputs.emplace_back(so, *pose);
-	auto &input = d->inputs.back();
-	input.timestamp = timestamp;
-	int meas = construct_input_from_scene(so, timestamp, &input.vmask.front(), &input.meas.front(), &input.cov.front());
-	input.shrink(meas / 2);
-
-	double dist = 0;
-	if (d->inputs.empty() == false) {
-		dist = dist3d(pose->Pos, lastPose.Pos);
+static AxisData *find_axis(std::vector<AxisData *> &axes, uint64_t key, int axis) {
+	for (auto a : axes) {
+		if (a->key == key && a->axis == axis)
+			return a;
 	}
-	if (meas / 2 < 8 || dist > .00009)
-		d->inputs.pop_back();
-	lastPose = *pose;
+	return nullptr;
 }
 
-void lighthouse_process(SurviveContext *ctx, uint8_t lighthouse, SurvivePose *pose, SurvivePose *obj_pose) {
-	survive_default_lighthouse_pose_process(ctx, lighthouse, pose, obj_pose);
-	PlaybackData *d = (PlaybackData *)ctx->user_ptr;
-	d->bsd[lighthouse] = ctx->bsd[lighthouse];
-}
+static int capture_recording(const Options &opts, int rec_idx, std::vector<AxisData *> &axes) {
+	const char *recording = opts.recordings[rec_idx];
+	std::string init_config = std::string(recording) + ".json";
+	struct stat st;
 
-std::map<size_t, std::map<size_t, double>> errors;
+	std::vector<const char *> args = {"findoptimalconfig", "--playback", recording, "--playback-factor", "0"};
+	if (stat(init_config.c_str(), &st) == 0) {
+		args.push_back("--init-configfile");
+		args.push_back(init_config.c_str());
+	}
+	args.insert(args.end(), opts.survive_args.begin(), opts.survive_args.end());
 
-typedef struct {
-	survive_calibration_config calibration_config;
-	SurviveObject *so;
-	SurvivePose obj_pose;
-} sba_context;
+	SurviveContext *ctx = survive_init((int)args.size(), (char *const *)&args[0]);
+	if (ctx == 0)
+		return -1;
 
-static void str_metric_function(int j, int i, double *bi, double *xij, void *adata) {
-	SurvivePose obj = *(SurvivePose *)bi;
-	int sensor_idx = j >> 1;
-	int lh = j & 1;
+	Capture capture;
+	capture.opts = &opts;
+	ctx->user_ptr = &capture;
+	capture.prior_pose = survive_install_imupose_fn(ctx, capture_pose);
 
-	sba_context *ctx = (sba_context *)(adata);
-	SurviveObject *so = ctx->so;
+	int rtn = survive_startup(ctx);
+	if (rtn == 0) {
+		while (survive_poll(ctx) == 0) {
+		}
+	}
 
-	assert(lh < 2);
-	assert(sensor_idx < so->sensor_ct);
+	// Lighthouse poses are taken from the end of the recording, when they are as settled as they get
+	SurvivePose world2lh[NUM_GEN2_LIGHTHOUSES];
+	for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++)
+		InvertPose(&world2lh[lh], &ctx->bsd[lh].Pose);
+
+	bool gen2 = ctx->lh_version == 1;
+	const survive_reproject_model_t *model = gen2 ? &survive_reproject_gen2_model : &survive_reproject_model;
+
+	size_t used = 0;
+	for (const LightSample &sample : capture.samples) {
+		BaseStationData *bsd = &ctx->bsd[sample.lh];
+		if (!bsd->PositionSet)
+			continue;
+
+		// Base stations are matched up across recordings by ID and index -- the index follows the channel, and keeps
+		// apart stations that report the same ID. Without an ID they can't be matched up at all.
+		uint64_t key = bsd->BaseStationID ? ((uint64_t)bsd->BaseStationID << 8 | sample.lh)
+										  : ((1ull << 40) | ((uint64_t)rec_idx << 8) | sample.lh);
+		AxisData *a = find_axis(axes, key, sample.axis);
+		if (a == nullptr) {
+			a = new AxisData();
+			a->key = key;
+			a->id = bsd->BaseStationID;
+			a->lh = sample.lh;
+			a->axis = sample.axis;
+			a->param_cnt = gen2 ? PARAM_CNT : GEN1_PARAM_CNT;
+			a->reproject = model->reprojectAxisFn[sample.axis];
+			a->initial = a->best = bsd->fcal[sample.axis];
+			a->loaded[0] = bsd->fcal[0];
+			a->loaded[1] = bsd->fcal[1];
+			axes.push_back(a);
+		}
+
+		LinmathPoint3d ptInLh;
+		ApplyPoseToPoint(ptInLh, &world2lh[sample.lh], sample.ptInWorld);
+		a->pts.insert(a->pts.end(), ptInLh, ptInLh + 3);
+		a->angles.push_back(sample.angle);
+		used++;
+	}
 
-	quatnormalize(obj.Rot, obj.Rot);
-	FLT xyz[3];
-	ApplyPoseToPoint(xyz, &obj, &so->sensor_locations[sensor_idx * 3]);
+	SV_INFO("Captured %zu scenes, %zu measurements from %s", capture.scenes, used, recording);
+	survive_close(ctx);
+	return rtn;
+}
 
-	// std::cerr << "Processing " << sensor_idx << ", " << lh << std::endl;
-	SurvivePose *camera = &so->ctx->bsd[lh].Pose;
-	survive_reproject_from_pose_with_config(so->ctx, &ctx->calibration_config, lh, camera, xyz, xij);
+// Scoring walks the measurements in order, so they are shuffled once up front; that way a partial sum is a fair
+// sample of the whole and bad candidates get pruned early.
+static void shuffle_axis(AxisData *a) {
+	std::mt19937 rng(a->key * 2 + a->axis);
+	for (size_t i = a->size(); i > 1; i--) {
+		size_t j = rng() % i;
+		std::swap(a->angles[i - 1], a->angles[j]);
+		std::swap_ranges(&a->pts[3 * (i - 1)], &a->pts[3 * (i - 1)] + 3, &a->pts[3 * j]);
+	}
 }
 
-double sba_opt(SurviveContext *ctx, const survive_calibration_config &config, PlaybackDataInput &data) {
-	double *covx = 0;
-	SurviveObject *so = data.so;
-
-	SurvivePose soLocation = data.position;
-
-	double opts[SBA_OPTSSZ] = {0};
-	double info[SBA_INFOSZ] = {0};
-
-	sba_context _ctx = {config, so};
-
-	opts[0] = SBA_INIT_MU;
-	opts[1] = SBA_STOP_THRESH;
-	opts[2] = SBA_STOP_THRESH;
-	opts[3] = SBA_STOP_THRESH;
-	opts[3] = SBA_STOP_THRESH; // max_reproj_error * meas.size();
-	opts[4] = 0.0;
-
-	int status = sba_str_levmar(1, // Number of 3d points
-								0, // Number of 3d points to fix in spot
-								NUM_LIGHTHOUSES * so->sensor_ct, &data.vmask.front(),
-								soLocation.Pos,		// Reads as the full pose though
-								7,					// pnp -- SurvivePose
-								&data.meas.front(), // x* -- measurement data
-								&data.cov.front(),  // cov data
-								2,					// mnp -- 2 points per image
-								str_metric_function,
-								0,	 // jacobia of metric_func
-								&_ctx, // user data
-								100,   // Max iterations
-								0,	 // verbosity
-								opts,  // options
-								info); // info
-
-	int meas_size = data.meas.size() / 2;
-	if (meas_size == 0)
-		return 0;
-
-	{
-		SurviveContext *ctx = so->ctx;
-		// Docs say info[0] should be divided by meas; I don't buy it really...
-		static int cnt = 0;
-		if (cnt++ > 1000) {
-			SV_INFO("%f original reproj error for %u meas", (info[0] / meas_size * 2), (int)meas_size);
-			SV_INFO("%f cur reproj error", (info[1] / meas_size * 2));
-			cnt = 0;
+// With a bound, gives up and returns INFINITY once the candidate can't beat it: either its partial error is already
+// past it, or -- after a few blocks -- the error projected from the measurements seen so far is prune_ratio times it.
+static double score(const AxisData *a, const BaseStationCal *cal, const std::atomic<double> *bound, FLT prune_ratio,
+					size_t *evaluated) {
+	// The reprojection functions take both axes' calibration and only read their own
+	BaseStationCal pair[2];
+	pair[a->axis] = *cal;
+
+	double sse = 0;
+	size_t n = a->size();
+	const FLT *pts = &a->pts[0], *angles = &a->angles[0];
+	for (size_t start = 0; start < n; start += SCORE_BLOCK) {
+		size_t end = std::min(n, start + SCORE_BLOCK);
+		for (size_t i = start; i < end; i++) {
+			FLT err = a->reproject(pair, pts + 3 * i) - angles[i];
+			sse += err * err;
+		}
+		double limit = bound ? bound->load(std::memory_order_relaxed) : INFINITY;
+		bool projected_worse = end >= 4 * SCORE_BLOCK && sse * n > limit * prune_ratio * end;
+		if (sse > limit || projected_worse) {
+			*evaluated = end;
+			return INFINITY;
 		}
 	}
-	assert(!isinf(info[1]));
-	return info[1] / meas_size * 2;
+	*evaluated = n;
+	return sse;
 }
 
-struct optimal_cal_ctx {
-	std::vector<double> sensors;
-	std::vector<int> lighthouses;
-	SurviveContext *ctx;
-};
+static void lower_bound(std::atomic<double> *bound, double sse) {
+	double current = bound->load(std::memory_order_relaxed);
+	while (sse < current && !bound->compare_exchange_weak(current, sse, std::memory_order_relaxed)) {
+	}
+}
 
-static void metric_function(int j, int i, double *aj, double *xij, void *adata) {
-	optimal_cal_ctx *ctx = (optimal_cal_ctx *)(adata);
+static void score_candidates(std::vector<Candidate> &candidates, const Options &opts) {
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for (size_t i = next++; i < candidates.size(); i = next++) {
+			Candidate &c = candidates[i];
+			c.sse = score(c.axis, &c.cal, &c.axis->bound, opts.prune_ratio, &c.evaluated);
+			if (isfinite(c.sse))
+				lower_bound(&c.axis->bound, c.sse);
+		}
+	};
 
-	FLT sensorInWorld[3] = {ctx->sensors[i * 3 + 0], ctx->sensors[i * 3 + 1], ctx->sensors[i * 3 + 2]};
-	int lh = ctx->lighthouses[i];
-	BaseStationData bsd = ctx->ctx->bsd[lh];
-	survive_calibration_config cfg = *(survive_calibration_config *)aj;
+	std::vector<std::thread> pool;
+	for (int i = 1; i < opts.threads; i++)
+		pool.emplace_back(worker);
+	worker();
+	for (auto &t : pool)
+		t.join();
+}
 
-	survive_reproject_from_pose_with_bcal(&bsd, &cfg, &ctx->ctx->bsd[lh].Pose, sensorInWorld, xij);
+static FLT rms(double sse, size_t n) { return n ? sqrt(sse / n) : 0; }
+
+static void print_cal(const BaseStationCal *cal, int param_cnt) {
+	for (int p = 0; p < param_cnt; p++)
+		printf(" %s=%+.6f", param_names[p], *cal_param((BaseStationCal *)cal, p));
 }
 
-double find_optimal_cal(SurviveContext *ctx, PlaybackData &data) {
-	optimal_cal_ctx _ctx;
-	std::vector<char> vmask;
-	std::vector<double> cov, meas;
-	_ctx.ctx = ctx;
-	for (auto &in : data.inputs) {
-		for (size_t sensor = 0; sensor < in.so->sensor_ct; sensor++) {
-			FLT p[3];
-			ApplyPoseToPoint(p, &in.position, &data.so->sensor_locations[sensor * 3]);
-			for (size_t lh = 0; lh < 2; lh++) {
-				_ctx.sensors.emplace_back(p[0]);
-				_ctx.sensors.emplace_back(p[1]);
-				_ctx.sensors.emplace_back(p[2]);
-				_ctx.lighthouses.emplace_back(lh);
-
-				auto scene = &in.activations;
-				if (SurviveSensorActivations_isPairValid(scene, settings.sensor_time_window, in.timestamp, sensor,
-														 lh)) {
-					double *a = scene->angles[sensor][lh];
-					vmask.emplace_back(1); //[sensor * NUM_LIGHTHOUSES + lh] = 1;
-
-					meas.emplace_back(a[0]);
-					meas.emplace_back(a[1]);
-				} else {
-					vmask.emplace_back(0);
-				}
+static void print_config(const std::vector<AxisData *> &axes) {
+	std::map<uint64_t, std::array<AxisData *, 2>> stations;
+	for (auto a : axes)
+		stations[a->key][a->axis] = a;
+
+	for (auto &station : stations) {
+		AxisData *any = station.second[0] ? station.second[0] : station.second[1];
+		printf("{ \"index\": %d, \"id\": %u", any->lh, any->id);
+		for (int p = 0; p < any->param_cnt; p++) {
+			printf(", \"fcal%s\": [", param_names[p]);
+			for (int axis = 0; axis < 2; axis++) {
+				AxisData *a = station.second[axis];
+				printf("%s%.7f", axis ? ", " : "", *cal_param(a ? &a->best : &any->loaded[axis], p));
 			}
+			printf("]");
 		}
+		printf(" }\n");
 	}
-
-	double *covx = 0;
-	SurviveObject *so = data.so;
-
-	double opts[SBA_OPTSSZ] = {0};
-	double info[SBA_INFOSZ] = {0};
-
-	survive_calibration_config config = {0};
-	config.use_flag = SVCal_All;
-
-	opts[0] = SBA_INIT_MU;
-	opts[1] = SBA_STOP_THRESH;
-	opts[2] = SBA_STOP_THRESH;
-	opts[3] = SBA_STOP_THRESH;
-	opts[3] = SBA_STOP_THRESH; // max_reproj_error * meas.size();
-	opts[4] = 0.0;
-
-	int status = sba_mot_levmar(data.inputs.size() * so->sensor_ct * NUM_LIGHTHOUSES, // number of 3d points
-								1,				   // Number of cameras -- 2 lighthouses
-								0,				   // Number of cameras to not modify
-								&vmask[0],		   // boolean vis mask
-								(double *)&config, // camera parameters
-								4,				   // sizeof(BaseStationCal) / sizeof(FLT),
-								&meas[0],		   // 2d points for 3d objs
-								covx,			   // covariance of measurement. Null sets to identity
-								2,				   // 2 points per image
-								metric_function,
-								0,	 // jacobia of metric_func
-								&_ctx, // user data
-								50,	// Max iterations
-								0,	 // verbosity
-								opts,  // options
-								info); // info
-
-	if (status > 0) {
-	} else {
-		assert(false);
-	}
-	int meas_size = _ctx.sensors.size() / 2;
-	if (meas_size == 0)
-		return 0;
-
-	{
-		SurviveContext *ctx = so->ctx;
-		// Docs say info[0] should be divided by meas; I don't buy it really...
-		static int cnt = 0;
-		if (cnt++ > 1000) {
-			SV_INFO("%f original reproj error for %u meas", (info[0] / meas_size * 2), (int)meas_size);
-			SV_INFO("%f cur reproj error", (info[1] / meas_size * 2));
-			cnt = 0;
-		}
-	}
-	assert(!isinf(info[1]));
-	std::cerr << "Used " << meas_size << " measurements" << std::endl;
-
-	return info[1] / meas_size * 2;
 }
-double find_avg_reproj_error(SurviveContext *ctx, const survive_calibration_config &config, PlaybackDataInput &data) {
-	return sba_opt(ctx, config, data);
-	/*
-	for (size_t sensor = 0; sensor < data.so->sensor_ct; sensor++) {
-	  for (size_t lh = 0; lh < 2; lh++) {
-		if( *(vmask++) ) {
-	  cnt++;
-	  FLT pt[3];
-	  ApplyPoseToPoint(pt, &data.position, data.so->sensor_locations + sensor * 3);
-
-	  FLT reproj_meas[2];
-	  survive_reproject_from_pose_with_config(ctx, &config, lh, &ctx->bsd[lh].Pose, pt, reproj_meas);
-
-	  auto x = reproj_meas[0] - meas[0];
-	  auto y = reproj_meas[1] - meas[1];
-	  err += cov[0]*x*x + cov[2]*y*y;
-
-	  meas += 2;
-	  cov += 4;
-		}
-	  }
-	  }*/
+
+static int usage(const char *name) {
+	fprintf(stderr,
+			"Usage: %s [--threads n] [--params phase,tilt,...] [--max-rounds n] [--prune-ratio r] [--max-motion m] "
+			"recording... [-- survive args]\n",
+			name);
+	return -1;
 }
 
-double find_avg_reproj_error(SurviveContext *ctx, const survive_calibration_config &config, PlaybackData &data) {
-	double err = 0;
-	for (auto &in : data.inputs) {
-		err += find_avg_reproj_error(ctx, config, in);
+static bool parse_params(Options &opts, const char *list) {
+	std::fill(opts.params, opts.params + PARAM_CNT, false);
+	std::string s(list);
+	size_t start = 0;
+	while (start <= s.size()) {
+		size_t end = s.find(',', start);
+		if (end == std::string::npos)
+			end = s.size();
+		std::string name = s.substr(start, end - start);
+		int p = 0;
+		while (p < PARAM_CNT && name != param_names[p])
+			p++;
+		if (p == PARAM_CNT) {
+			fprintf(stderr, "Unknown calibration parameter '%s'\n", name.c_str());
+			return false;
+		}
+		opts.params[p] = true;
+		start = end + 1;
 	}
-	return err / data.inputs.size();
+	return true;
 }
 
 int main(int argc, char **argv) {
-	std::vector<std::pair<size_t, size_t>> sections = {
-		{5, 0}, // phase
-				//{ 5, 5 },  // tilt
-				//{ 5, 10 }, // curve
-				//{ 11, 15 } // gibs + useSin
-	};
-
+	Options opts;
 	for (int i = 1; i < argc; i++) {
-		PlaybackData data;
-
-		char const *args[] = {argv[0],
-							  "--use-bsd-cal",
-							  "0",
-							  "--calibrate",
-							  "--playback-factor",
-							  "0",
-							  "--disambiguator",
-							  "StateBased",
-							  "--defaultposer",
-							  "SBA",
-							  "--sba-required-meas",
-							  "8",
-							  "--sba-max-error",
-							  ".1",
-							  "--playback",
-							  argv[i]};
-
-		auto ctx = survive_init(sizeof(args) / sizeof(args[0]), (char *const *)args);
-		ctx->user_ptr = &data;
-
-		survive_install_pose_fn(ctx, pose_process);
-		survive_install_lighthouse_pose_fn(ctx, lighthouse_process);
-		survive_install_light_fn(ctx, light_process);
+		if (strcmp(argv[i], "--") == 0) {
+			opts.survive_args.assign(argv + i + 1, argv + argc);
+			break;
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			opts.threads = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--max-rounds") == 0 && i + 1 < argc) {
+			opts.max_rounds = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--prune-ratio") == 0 && i + 1 < argc) {
+			opts.prune_ratio = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--max-motion") == 0 && i + 1 < argc) {
+			opts.max_motion = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--params") == 0 && i + 1 < argc) {
+			if (!parse_params(opts, argv[++i]))
+				return -1;
+		} else if (argv[i][0] == '-') {
+			return usage(argv[0]);
+		} else {
+			opts.recordings.push_back(argv[i]);
+		}
+	}
+	if (opts.recordings.empty())
+		return usage(argv[0]);
+
+	double start = OGGetAbsoluteTime();
+	std::vector<AxisData *> axes;
+	for (size_t i = 0; i < opts.recordings.size(); i++) {
+		if (capture_recording(opts, (int)i, axes) != 0)
+			fprintf(stderr, "Could not play back %s\n", opts.recordings[i]);
+	}
+	double captured = OGGetAbsoluteTime();
+	std::sort(axes.begin(), axes.end(),
+			  [](const AxisData *a, const AxisData *b) { return a->key != b->key ? a->key < b->key : a->axis < b->axis; });
+
+	for (auto a : axes) {
+		shuffle_axis(a);
+		size_t evaluated;
+		a->initial_sse = a->best_sse = score(a, &a->initial, nullptr, 0, &evaluated);
+		for (int p = 0; p < PARAM_CNT; p++)
+			a->step[p] = param_initial_step[p];
+	}
 
-		while (survive_poll(ctx) == 0) {
+	size_t scored = 0, pruned = 0, meas_evaluated = 0, meas_total = 0;
+	int round = 0;
+	std::vector<Candidate> candidates;
+	for (; round < opts.max_rounds; round++) {
+		candidates.clear();
+		for (auto a : axes) {
+			if (a->converged || a->size() == 0)
+				continue;
+
+			a->bound = a->best_sse;
+			// Steps along each parameter, and along each pair of them since some -- eg phase and tilt -- trade off
+			// against each other
+			for (int p = 0; p < a->param_cnt; p++) {
+				if (!opts.params[p])
+					continue;
+				for (int dir = -1; dir <= 1; dir += 2) {
+					Candidate c = {a, a->best};
+					*cal_param(&c.cal, p) += dir * a->step[p];
+					candidates.push_back(c);
+
+					for (int q = p + 1; q < a->param_cnt; q++) {
+						if (!opts.params[q])
+							continue;
+						for (int dir2 = -1; dir2 <= 1; dir2 += 2) {
+							Candidate pair = c;
+							*cal_param(&pair.cal, q) += dir2 * a->step[q];
+							candidates.push_back(pair);
+						}
+					}
+				}
+			}
 		}
+		if (candidates.empty())
+			break;
 
-		find_optimal_cal(ctx, data);
+		score_candidates(candidates, opts);
+
+		for (auto a : axes) {
+			Candidate *winner = nullptr;
+			for (auto &c : candidates) {
+				if (c.axis == a && isfinite(c.sse) && c.sse < a->best_sse * (1 - opts.min_improvement) &&
+					(!winner || c.sse < winner->sse))
+					winner = &c;
+			}
 
-		survive_close(ctx);
+			// Compass search: move on improvement and lengthen the steps that were taken, otherwise tighten every step
+			if (winner) {
+				for (int p = 0; p < a->param_cnt; p++) {
+					if (*cal_param(&winner->cal, p) != *cal_param(&a->best, p))
+						a->step[p] *= 2;
+				}
+				a->best = winner->cal;
+				a->best_sse = winner->sse;
+			} else if (!a->converged && a->size()) {
+				a->converged = true;
+				for (int p = 0; p < a->param_cnt; p++) {
+					a->step[p] *= .5;
+					a->converged &= a->step[p] < param_initial_step[p] * opts.min_step_ratio;
+				}
+			}
+		}
+
+		for (auto &c : candidates) {
+			scored++;
+			pruned += !isfinite(c.sse);
+			meas_evaluated += c.evaluated;
+			meas_total += c.axis->size();
+		}
 	}
+	double searched = OGGetAbsoluteTime();
+
+	for (auto a : axes) {
+		printf("LH%d (%08x) axis %d, %zu measurements: rms %.7f -> %.7f\n", a->lh, a->id, a->axis, a->size(),
+			   rms(a->initial_sse, a->size()), rms(a->best_sse, a->size()));
+		printf("\tfrom");
+		print_cal(&a->initial, a->param_cnt);
+		printf("\n\tto  ");
+		print_cal(&a->best, a->param_cnt);
+		printf("\n");
+	}
+	print_config(axes);
+
+	fprintf(stderr,
+			"Capture took %.2fs; search took %.2fs over %d rounds on %d threads. %zu of %zu candidates pruned, "
+			"%.1f%% of measurements scored\n",
+			captured - start, searched - captured, round, opts.threads, pruned, scored,
+			meas_total ? 100. * meas_evaluated / meas_total : 0.);
 
+	for (auto a : axes)
+		delete a;
 	return 0;
 }
@@ -1,152 +1,620 @@
-#include <chrono>
-#include <iostream>
-#include <libsurvive/survive.h>
-#include <libsurvive/survive_optimizer.h>
-#include <libsurvive/survive_reproject.h>
-#include <map>
+// Scenes are captured from the tracker's IMU poses as playback runs. Each reading is up to a sweep older than the pose
+// it is captured with, so it is tied to the pose moved back along the tracker's velocity by the reading's age; objects
+// moving faster than --max-speed are skipped since that extrapolation stops holding. A scene is only kept as a
+// keyframe when it adds viewpoint information: it is dropped if its object already has a keyframe nearby
+// (--keyframe-distance, --keyframe-angle) that saw at least the same lighthouses. Keyframes hold their own
+// measurements, so memory grows with the number of distinct viewpoints rather than the length of the recording, and is
+// capped by --max-keyframes.
+//
+// The solve is Levenberg-Marquardt over every keyframe pose and every lighthouse pose, with one lighthouse held fixed
+// to pin down the world frame. Each measurement touches one keyframe and one lighthouse, so the normal equations are
+// block sparse; the keyframe blocks are eliminated with a Schur complement, leaving a dense system only as big as the
+// lighthouses. Cost per iteration is linear in the measurement count.
+//
+// With --window n, the last n keyframes are refined every n/4 new ones while playback continues, and keyframes that
+// slide out of the window are written out and freed; this keeps memory bounded on captures of any length. Otherwise
+// everything is solved once at the end.
+//
+// Refined lighthouse poses are reported through the lighthouse pose hook, so they are saved like a calibration.
+// --tracks writes the refined keyframe poses as a pose track file; see survive_posetrack.h. Every other argument goes
+// to survive_init.
+
+#include <algorithm>
+#include <deque>
 #include <math.h>
-#include <memory>
-#include <mpfit/mpfit.h>
-#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 
-uint32_t timestamp;
-std::vector<survive_optimizer_measurement> measurements;
-
-SurvivePose currentPose = LinmathPose_Identity;
-std::vector<SurvivePose> poses;
-
-static size_t construct_input_from_scene(SurviveObject *so, size_t timecode, survive_timecode sensor_time_window,
-										 FLT sensor_variance, FLT sensor_variance_per_second) {
-	size_t rtn = 0;
-	auto scene = &so->activations;
-	const bool force_pair = false;
-	for (uint8_t sensor = 0; sensor < so->sensor_ct; sensor++) {
-		for (uint8_t lh = 0; lh < 2; lh++) {
-			for (uint8_t axis = 0; axis < 2; axis++) {
-				bool isReadingValue =
-					SurviveSensorActivations_isReadingValid(scene, sensor_time_window, timecode, sensor, lh, axis);
-				if (force_pair) {
-					isReadingValue =
-						SurviveSensorActivations_isPairValid(scene, sensor_time_window, timecode, sensor, lh);
-				}
-				if (isReadingValue) {
-					const double *a = scene->angles[sensor][lh];
-					measurements.push_back({});
-					auto meas = &measurements.back();
-					meas->axis = axis;
-					meas->value = a[axis];
-					meas->sensor_idx = sensor;
-					meas->lh = lh;
-					meas->object = poses.size();
-					survive_timecode diff = survive_timecode_difference(timecode, scene->timecode[sensor][lh][axis]);
-					meas->variance = sensor_variance + diff * sensor_variance_per_second / (double)so->timebase_hz;
-					rtn++;
-				}
-			}
-		}
-	}
+#include <os_generic.h>
+#include <survive.h>
+#include <survive_posetrack.h>
+#include <survive_reproject.h>
+#include <survive_reproject_gen2.h>
+
+struct Options {
+	FLT keyframe_distance = .05;
+	FLT keyframe_angle = 10. / 180. * LINMATHPI;
+	size_t max_keyframes = 4096;
+	size_t window = 0;
+	// Scenes from an object moving faster than this, in m/s, aren't captured
+	FLT max_speed = 1;
+	// Oldest reading, in seconds, that is captured with a scene
+	FLT max_age = .05;
+	int min_meas = 8;
+	int max_iterations = 50;
+	// Residuals past this many radians are down weighted (Huber)
+	FLT huber = .002;
+	const char *tracks = nullptr;
+};
+
+struct Measurement {
+	uint8_t sensor, lh, axis;
+	FLT value;
+	// Seconds between the keyframe pose and the reading; negative for older readings
+	FLT dt;
+};
+
+struct Keyframe {
+	SurviveObject *so;
+	double time;
+	LinmathAxisAnglePose pose; // imu2world
+	SurviveVelocity velocity;
+	uint32_t lh_mask;
+	std::vector<Measurement> meas;
+};
+
+struct BundleAdjustment {
+	Options opts;
+	SurviveContext *ctx = nullptr;
+	imupose_process_func prior_imupose = nullptr;
+	survive_posetrack_writer *tracks = nullptr;
+
+	std::deque<Keyframe> keyframes;
+	size_t new_keyframes = 0, scenes = 0, window_solves = 0;
+	bool warned_full = false;
+
+	// world2lh; only meaningful for lighthouses with PositionSet
+	LinmathAxisAnglePose lighthouses[NUM_GEN2_LIGHTHOUSES];
+	bool lighthouse_seeded[NUM_GEN2_LIGHTHOUSES] = {};
+};
+
+static void to_axis_angle(LinmathAxisAnglePose *out, const SurvivePose *pose) {
+	LinmathAxisAngleMag aa;
+	quattoaxisanglemag(aa, pose->Rot);
+	copy3d(out->Pos, pose->Pos);
+	copy3d(out->AxisAngleRot, aa);
+}
+
+static SurvivePose from_axis_angle(const LinmathAxisAnglePose *pose) {
+	SurvivePose rtn;
+	copy3d(rtn.Pos, pose->Pos);
+	quatfromaxisanglemag(rtn.Rot, pose->AxisAngleRot);
 	return rtn;
 }
 
-static void capture_data(SurviveObject *so) {
-	auto cnt = construct_input_from_scene(so, timestamp, SurviveSensorActivations_default_tolerance, 1, 10);
-	if (cnt < 8) {
-		while (!measurements.empty() && measurements.back().object == poses.size())
-			measurements.pop_back();
-	} else {
-		poses.push_back(currentPose);
+// Rotation angle between two keyframe orientations
+static FLT rotation_between(const LinmathAxisAnglePose *a, const LinmathAxisAnglePose *b) {
+	SurvivePose pa = from_axis_angle(a), pb = from_axis_angle(b);
+	FLT d = fabs(quatinnerproduct(pa.Rot, pb.Rot));
+	return 2 * acos(linmath_min(1., d));
+}
+
+static bool adds_viewpoint(const BundleAdjustment *ba, const Keyframe &candidate) {
+	for (const Keyframe &k : ba->keyframes) {
+		if (k.so != candidate.so || (candidate.lh_mask & ~k.lh_mask) != 0)
+			continue;
+		if (dist3d(k.pose.Pos, candidate.pose.Pos) < ba->opts.keyframe_distance &&
+			rotation_between(&k.pose, &candidate.pose) < ba->opts.keyframe_angle)
+			return false;
+	}
+	return true;
+}
+
+static void seed_lighthouses(BundleAdjustment *ba) {
+	for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+		if (ba->lighthouse_seeded[lh] || !ba->ctx->bsd[lh].PositionSet)
+			continue;
+		SurvivePose world2lh = InvertPoseRtn(&ba->ctx->bsd[lh].Pose);
+		to_axis_angle(&ba->lighthouses[lh], &world2lh);
+		ba->lighthouse_seeded[lh] = true;
 	}
 }
 
-int last_lh = -1, last_acode = -1;
-survive_timecode last_timecode = -1;
-void light_process(SurviveObject *so, int sensor_id, int acode, int timeinsweep, uint32_t timecode, uint32_t length,
-				   uint32_t lighthouse) {
-	survive_default_light_process(so, sensor_id, acode, timeinsweep, timecode, length, lighthouse);
+/* Block sparse Levenberg-Marquardt */
+
+#define BLOCK 6
+#define BLOCK_SIZE (BLOCK * BLOCK)
 
-	timestamp = timecode;
-	if (last_lh != lighthouse || last_acode != acode) {
-		if (last_timecode == -1 || survive_timecode_difference(timecode, last_timecode) / (FLT)so->timebase_hz > 1.) {
-			capture_data(so);
-			last_timecode = timecode;
+// In place Cholesky solve of the n x n system a * x = b; a is destroyed. Returns false if a isn't positive definite.
+static bool cholesky_solve(int n, FLT *a, FLT *b) {
+	for (int j = 0; j < n; j++) {
+		FLT d = a[j * n + j];
+		for (int k = 0; k < j; k++)
+			d -= a[j * n + k] * a[j * n + k];
+		if (!(d > 0))
+			return false;
+		d = sqrt(d);
+		a[j * n + j] = d;
+		for (int i = j + 1; i < n; i++) {
+			FLT s = a[i * n + j];
+			for (int k = 0; k < j; k++)
+				s -= a[i * n + k] * a[j * n + k];
+			a[i * n + j] = s / d;
 		}
 	}
-	last_lh = lighthouse;
-	last_acode = acode;
+	for (int i = 0; i < n; i++) {
+		for (int k = 0; k < i; k++)
+			b[i] -= a[i * n + k] * b[k];
+		b[i] /= a[i * n + i];
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		for (int k = i + 1; k < n; k++)
+			b[i] -= a[k * n + i] * b[k];
+		b[i] /= a[i * n + i];
+	}
+	return true;
 }
 
-void raw_pose_process(SurviveObject *so, uint32_t lighthouse, SurvivePose *pose) {
-	survive_default_raw_pose_process(so, lighthouse, pose);
-	currentPose = *pose;
+static void invert_block(FLT *out, const FLT *in) {
+	for (int c = 0; c < BLOCK; c++) {
+		FLT a[BLOCK_SIZE], col[BLOCK] = {0};
+		memcpy(a, in, sizeof(a));
+		col[c] = 1;
+		if (!cholesky_solve(BLOCK, a, col))
+			memset(col, 0, sizeof(col));
+		for (int r = 0; r < BLOCK; r++)
+			out[r * BLOCK + c] = col[r];
+	}
 }
 
-static double full_bundle_adjustment(SurviveObject *so) {
-	struct SurviveContext *ctx = so->ctx;
+static void damp(FLT *m, int n, FLT lambda) {
+	for (int i = 0; i < n; i++)
+		m[i * n + i] += lambda * (m[i * n + i] + 1e-9);
+}
 
-	survive_optimizer mpfitctx = {};
-	mpfitctx.so = so;
-	mpfitctx.poseLength = poses.size();
-	mpfitctx.cameraLength = so->ctx->activeLighthouses;
+struct ProblemView {
+	const survive_reproject_model_t *model;
+	const BaseStationCal *cal[NUM_GEN2_LIGHTHOUSES];
+	// Index into the reduced system, or -1 for the lighthouse that is held fixed or isn't present
+	int slot[NUM_GEN2_LIGHTHOUSES];
+	int slot_cnt;
+};
 
-	std::vector<double> parameters(survive_optimizer_get_parameters_count(&mpfitctx));
-	std::vector<mp_par_struct> parameter_infos(survive_optimizer_get_parameters_count(&mpfitctx));
-	mpfitctx.parameters = &parameters.front();
-	mpfitctx.measurements = &measurements.front();
-	mpfitctx.measurementsCnt = measurements.size();
-	mpfitctx.parameters_info = &parameter_infos.front();
+static FLT huber_weight(FLT r, FLT delta) { return fabs(r) <= delta ? 1 : delta / fabs(r); }
 
-	SurvivePose *soLocation = survive_optimizer_get_pose(&mpfitctx);
-	survive_optimizer_setup_cameras(&mpfitctx, ctx, true);
-	int start = survive_optimizer_get_camera_index(&mpfitctx);
-	for (int i = start + 7; i < start + 7 * mpfitctx.cameraLength; i++) {
-		mpfitctx.parameters_info[i].fixed = false;
+// Moves the keyframe pose to when the reading was taken, using the tracker's velocity at the keyframe
+static void pose_at_reading(LinmathAxisAnglePose *out, const Keyframe &k, const LinmathAxisAnglePose *pose,
+							const Measurement &m) {
+	*out = *pose;
+	if (m.dt == 0)
+		return;
+	SurvivePose p = from_axis_angle(pose);
+	survive_apply_ang_velocity(p.Rot, k.velocity.AxisAngleRot, m.dt, p.Rot);
+	scale3d(out->Pos, k.velocity.Pos, m.dt);
+	add3d(p.Pos, p.Pos, out->Pos);
+	to_axis_angle(out, &p);
+}
+
+static FLT residual(const ProblemView &view, const Keyframe &k, const LinmathAxisAnglePose *pose,
+					const Measurement &m, const LinmathAxisAnglePose *lighthouses) {
+	const SurviveObject *so = k.so;
+	LinmathAxisAnglePose obj2world, obj2lh;
+	LinmathPoint3d ptInLh;
+	pose_at_reading(&obj2world, k, pose, m);
+	ApplyAxisAnglePoseToPose(&obj2lh, &lighthouses[m.lh], &obj2world);
+	ApplyAxisAnglePoseToPoint(ptInLh, &obj2lh, &so->sensor_locations[m.sensor * 3]);
+	return view.model->reprojectAxisFn[m.axis](view.cal[m.lh], ptInLh) - m.value;
+}
+
+static double cost(const BundleAdjustment *ba, const ProblemView &view, size_t first,
+				   const std::vector<LinmathAxisAnglePose> &poses, const LinmathAxisAnglePose *lighthouses) {
+	double c = 0;
+	FLT delta = ba->opts.huber;
+	for (size_t i = first; i < ba->keyframes.size(); i++) {
+		const Keyframe &k = ba->keyframes[i];
+		for (const Measurement &m : k.meas) {
+			FLT r = fabs(residual(view, k, &poses[i - first], m, lighthouses));
+			c += r <= delta ? .5 * r * r : delta * (r - .5 * delta);
+		}
+	}
+	return c;
+}
+
+// Solves keyframes [first, end) together with the lighthouse poses. Returns the final rms residual.
+static FLT solve(BundleAdjustment *ba, size_t first) {
+	SurviveContext *ctx = ba->ctx;
+	size_t kf_cnt = ba->keyframes.size() - first;
+	if (kf_cnt == 0)
+		return 0;
+
+	ProblemView view = {};
+	view.model = ctx->lh_version == 1 ? &survive_reproject_gen2_model : &survive_reproject_model;
+	uint32_t seen = 0;
+	size_t meas_cnt = 0;
+	for (size_t i = first; i < ba->keyframes.size(); i++) {
+		seen |= ba->keyframes[i].lh_mask;
+		meas_cnt += ba->keyframes[i].meas.size();
 	}
 
-	int use_jacobian_function = 0;
-	survive_optimizer_setup_pose(&mpfitctx, &poses.front(), false, use_jacobian_function);
+	// The lowest numbered lighthouse defines the world frame
+	int fixed = -1;
+	for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+		view.cal[lh] = ctx->bsd[lh].fcal;
+		view.slot[lh] = -1;
+		if ((seen & (1u << lh)) == 0)
+			continue;
+		if (fixed == -1)
+			fixed = lh;
+		else
+			view.slot[lh] = view.slot_cnt++;
+	}
+
+	int n = view.slot_cnt * BLOCK;
+	std::vector<LinmathAxisAnglePose> poses(kf_cnt), trial_poses(kf_cnt);
+	for (size_t i = 0; i < kf_cnt; i++)
+		poses[i] = ba->keyframes[first + i].pose;
+	LinmathAxisAnglePose trial_lighthouses[NUM_GEN2_LIGHTHOUSES];
+
+	// Per keyframe terms kept for the back substitution
+	std::vector<FLT> u_inv(kf_cnt * BLOCK_SIZE), g_pose(kf_cnt * BLOCK), w(kf_cnt * NUM_GEN2_LIGHTHOUSES * BLOCK_SIZE);
+	std::vector<FLT> s(n * n), rhs(n), dc(n);
+	std::vector<FLT> v(view.slot_cnt * BLOCK_SIZE), g_lh(n);
 
-	mp_result result = {0};
+	FLT lambda = 1e-3;
+	double current = cost(ba, view, first, poses, ba->lighthouses);
+	double initial = current;
+	int iteration = 0;
+	for (; iteration < ba->opts.max_iterations; iteration++) {
+		std::fill(v.begin(), v.end(), 0);
+		std::fill(g_lh.begin(), g_lh.end(), 0);
+		std::fill(w.begin(), w.end(), 0);
+		std::fill(s.begin(), s.end(), 0);
 
-	mpfitctx.initialPose = LinmathPose_Identity;
+		for (size_t i = 0; i < kf_cnt; i++) {
+			const Keyframe &k = ba->keyframes[first + i];
+			FLT u[BLOCK_SIZE] = {0}, *g = &g_pose[i * BLOCK], *wk = &w[i * NUM_GEN2_LIGHTHOUSES * BLOCK_SIZE];
+			std::fill(g, g + BLOCK, 0);
 
-	int res = survive_optimizer_run(&mpfitctx, &result);
+			for (const Measurement &m : k.meas) {
+				FLT r = residual(view, k, &poses[i], m, ba->lighthouses);
+				if (!isfinite(r))
+					continue;
+				FLT weight = huber_weight(r, ba->opts.huber);
 
-	double rtn = -1;
-	bool status_failure = res <= 0;
+				// The short motion to the reading is treated as constant when differentiating
+				LinmathAxisAnglePose safe_pose;
+				pose_at_reading(&safe_pose, k, &poses[i], m);
+				if (magnitude3d(safe_pose.AxisAngleRot) == 0)
+					safe_pose.AxisAngleRot[0] = 1e-10;
 
-	if (!status_failure) {
-		quatnormalize(soLocation->Rot, soLocation->Rot);
-		rtn = result.bestnorm;
+				LinmathAxisAnglePose safe_lh = ba->lighthouses[m.lh];
+				if (magnitude3d(safe_lh.AxisAngleRot) == 0)
+					safe_lh.AxisAngleRot[0] = 1e-10;
 
-		SurvivePose *cameras = survive_optimizer_get_camera(&mpfitctx);
-		for (int i = 0; i < mpfitctx.cameraLength; i++) {
-			SurvivePose p = InvertPoseRtn(cameras + i);
-			so->ctx->lighthouseposeproc(so->ctx, i, &p, soLocation);
-			SV_INFO("%f %f %f", p.Pos[0], p.Pos[1], p.Pos[2]);
+				const FLT *pt = &k.so->sensor_locations[m.sensor * 3];
+				FLT jp[7] = {0}, jc[7] = {0};
+				view.model->reprojectAxisAngleAxisJacobFn[m.axis](jp, &safe_pose, pt, &safe_lh, view.cal[m.lh]);
+				for (int a = 0; a < BLOCK; a++) {
+					if (!isfinite(jp[a]))
+						jp[a] = 0;
+					g[a] += weight * jp[a] * r;
+					for (int b = 0; b < BLOCK; b++)
+						u[a * BLOCK + b] += weight * jp[a] * jp[b];
+				}
+
+				int slot = view.slot[m.lh];
+				if (slot < 0)
+					continue;
+				view.model->reprojectAxisAngleAxisJacobLhPoseFn[m.axis](jc, &safe_pose, pt, &safe_lh,
+																		view.cal[m.lh]);
+				FLT *vl = &v[slot * BLOCK_SIZE], *wl = &wk[slot * BLOCK_SIZE];
+				for (int a = 0; a < BLOCK; a++) {
+					if (!isfinite(jc[a]))
+						jc[a] = 0;
+					g_lh[slot * BLOCK + a] += weight * jc[a] * r;
+					for (int b = 0; b < BLOCK; b++) {
+						vl[a * BLOCK + b] += weight * jc[a] * jc[b];
+						wl[a * BLOCK + b] += weight * jp[a] * jc[b];
+					}
+				}
+			}
+
+			damp(u, BLOCK, lambda);
+			invert_block(&u_inv[i * BLOCK_SIZE], u);
+		}
+
+		// Schur complement: s = V - sum W^T U^-1 W, rhs = -g_lh + sum W^T U^-1 g_pose
+		for (int a = 0; a < view.slot_cnt; a++) {
+			FLT vl[BLOCK_SIZE];
+			memcpy(vl, &v[a * BLOCK_SIZE], sizeof(vl));
+			damp(vl, BLOCK, lambda);
+			for (int r = 0; r < BLOCK; r++) {
+				for (int c = 0; c < BLOCK; c++)
+					s[(a * BLOCK + r) * n + a * BLOCK + c] = vl[r * BLOCK + c];
+				rhs[a * BLOCK + r] = -g_lh[a * BLOCK + r];
+			}
+		}
+		for (size_t i = 0; i < kf_cnt; i++) {
+			const FLT *ui = &u_inv[i * BLOCK_SIZE], *g = &g_pose[i * BLOCK], *wk = &w[i * NUM_GEN2_LIGHTHOUSES * BLOCK_SIZE];
+			uint32_t mask = ba->keyframes[first + i].lh_mask;
+
+			// y_a = U^-1 W_a for each lighthouse this keyframe saw
+			FLT y[NUM_GEN2_LIGHTHOUSES][BLOCK_SIZE], ug[BLOCK] = {0};
+			for (int r = 0; r < BLOCK; r++)
+				for (int c = 0; c < BLOCK; c++)
+					ug[r] += ui[r * BLOCK + c] * g[c];
+
+			for (int lh_a = 0; lh_a < NUM_GEN2_LIGHTHOUSES; lh_a++) {
+				int a = view.slot[lh_a];
+				if (a < 0 || (mask & (1u << lh_a)) == 0)
+					continue;
+				const FLT *wa = &wk[a * BLOCK_SIZE];
+				for (int r = 0; r < BLOCK; r++) {
+					for (int c = 0; c < BLOCK; c++) {
+						FLT sum = 0;
+						for (int k = 0; k < BLOCK; k++)
+							sum += ui[r * BLOCK + k] * wa[k * BLOCK + c];
+						y[a][r * BLOCK + c] = sum;
+					}
+				}
+				for (int c = 0; c < BLOCK; c++) {
+					FLT sum = 0;
+					for (int k = 0; k < BLOCK; k++)
+						sum += wa[k * BLOCK + c] * ug[k];
+					rhs[a * BLOCK + c] += sum;
+				}
+			}
+
+			for (int lh_a = 0; lh_a < NUM_GEN2_LIGHTHOUSES; lh_a++) {
+				int a = view.slot[lh_a];
+				if (a < 0 || (mask & (1u << lh_a)) == 0)
+					continue;
+				const FLT *wa = &wk[a * BLOCK_SIZE];
+				for (int lh_b = 0; lh_b < NUM_GEN2_LIGHTHOUSES; lh_b++) {
+					int b = view.slot[lh_b];
+					if (b < 0 || (mask & (1u << lh_b)) == 0)
+						continue;
+					for (int r = 0; r < BLOCK; r++) {
+						for (int c = 0; c < BLOCK; c++) {
+							FLT sum = 0;
+							for (int k = 0; k < BLOCK; k++)
+								sum += wa[k * BLOCK + r] * y[b][k * BLOCK + c];
+							s[(a * BLOCK + r) * n + b * BLOCK + c] -= sum;
+						}
+					}
+				}
+			}
+		}
+
+		dc = rhs;
+		bool solved = n == 0 || cholesky_solve(n, &s[0], &dc[0]);
+
+		if (solved) {
+			// Back substitution: dp = U^-1 (-g_pose - W dc)
+			for (size_t i = 0; i < kf_cnt; i++) {
+				const FLT *ui = &u_inv[i * BLOCK_SIZE], *g = &g_pose[i * BLOCK],
+						  *wk = &w[i * NUM_GEN2_LIGHTHOUSES * BLOCK_SIZE];
+				FLT t[BLOCK];
+				for (int r = 0; r < BLOCK; r++)
+					t[r] = -g[r];
+				for (int a = 0; a < view.slot_cnt; a++) {
+					const FLT *wa = &wk[a * BLOCK_SIZE];
+					for (int r = 0; r < BLOCK; r++)
+						for (int c = 0; c < BLOCK; c++)
+							t[r] -= wa[r * BLOCK + c] * dc[a * BLOCK + c];
+				}
+				trial_poses[i] = poses[i];
+				FLT *p = (FLT *)&trial_poses[i];
+				for (int r = 0; r < BLOCK; r++) {
+					FLT sum = 0;
+					for (int c = 0; c < BLOCK; c++)
+						sum += ui[r * BLOCK + c] * t[c];
+					p[r] += sum;
+				}
+			}
+
+			memcpy(trial_lighthouses, ba->lighthouses, sizeof(trial_lighthouses));
+			for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+				if (view.slot[lh] < 0)
+					continue;
+				FLT *p = (FLT *)&trial_lighthouses[lh];
+				for (int r = 0; r < BLOCK; r++)
+					p[r] += dc[view.slot[lh] * BLOCK + r];
+			}
+		}
+
+		double trial = solved ? cost(ba, view, first, trial_poses, trial_lighthouses) : INFINITY;
+		if (trial < current) {
+			bool converged = current - trial < 1e-10 * current;
+			current = trial;
+			poses.swap(trial_poses);
+			memcpy(ba->lighthouses, trial_lighthouses, sizeof(trial_lighthouses));
+			lambda = linmath_max(lambda / 10, 1e-9);
+			if (converged)
+				break;
+		} else {
+			lambda *= 10;
+			if (lambda > 1e9)
+				break;
 		}
-	} else {
-		SV_INFO("Optimization failure");
 	}
-	SV_INFO("Optimization %f/%f (%d measurements) %d", result.orignorm, result.bestnorm, (int)measurements.size(), res);
 
-	return rtn;
+	for (size_t i = 0; i < kf_cnt; i++)
+		ba->keyframes[first + i].pose = poses[i];
+
+	// Report plain rms of the residuals, regardless of the robust weighting
+	double sse = 0;
+	for (size_t i = first; i < ba->keyframes.size(); i++)
+		for (const Measurement &m : ba->keyframes[i].meas) {
+			FLT r = residual(view, ba->keyframes[i], &ba->keyframes[i].pose, m, ba->lighthouses);
+			sse += r * r;
+		}
+	FLT rms = meas_cnt ? sqrt(sse / meas_cnt) : 0;
+	SV_VERBOSE(10, "Solved %zu keyframes, %zu measurements, %d lighthouses in %d iterations; cost %f -> %f, rms %f",
+			   kf_cnt, meas_cnt, view.slot_cnt + 1, iteration, initial, current, rms);
+	return rms;
+}
+
+static void write_keyframe(BundleAdjustment *ba, const Keyframe &k) {
+	if (ba->tracks == nullptr)
+		return;
+	SurvivePose pose = from_axis_angle(&k.pose);
+	survive_posetrack_write_pose(ba->tracks, survive_object_codename(k.so), k.time, &pose, nullptr);
+}
+
+static void refine_window(BundleAdjustment *ba) {
+	size_t window = ba->opts.window;
+	while (ba->keyframes.size() > window) {
+		write_keyframe(ba, ba->keyframes.front());
+		ba->keyframes.pop_front();
+	}
+	solve(ba, 0);
+	ba->new_keyframes = 0;
+	ba->window_solves++;
+}
+
+static void capture_imupose(SurviveObject *so, survive_timecode timecode, const SurvivePose *pose) {
+	BundleAdjustment *ba = (BundleAdjustment *)so->ctx->user_ptr;
+	ba->prior_imupose(so, timecode, pose);
+	seed_lighthouses(ba);
+
+	// Readings are up to a sweep older than the pose; they are moved back along the velocity, which only holds for
+	// fairly slow motion
+	if (norm3d(so->velocity.Pos) > ba->opts.max_speed)
+		return;
+
+	Keyframe k;
+	k.so = so;
+	k.time = survive_run_time(so->ctx);
+	k.lh_mask = 0;
+	k.velocity = so->velocity;
+	to_axis_angle(&k.pose, pose);
+
+	const SurviveSensorActivations *activations = &so->activations;
+	survive_long_timecode max_age = ba->opts.max_age * so->timebase_hz;
+	for (int sensor = 0; sensor < so->sensor_ct; sensor++) {
+		for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+			if (!ba->lighthouse_seeded[lh])
+				continue;
+			for (int axis = 0; axis < 2; axis++) {
+				if (!SurviveSensorActivations_isReadingValid(activations, max_age, sensor, lh, axis))
+					continue;
+				int32_t age = (int32_t)((survive_timecode)activations->timecode[sensor][lh][axis] - timecode);
+				Measurement m = {(uint8_t)sensor, (uint8_t)lh, (uint8_t)axis, activations->angles[sensor][lh][axis],
+								 age / (FLT)so->timebase_hz};
+				k.meas.push_back(m);
+				k.lh_mask |= 1u << lh;
+			}
+		}
+	}
+	if (k.meas.size() < (size_t)ba->opts.min_meas)
+		return;
+
+	ba->scenes++;
+	if (!adds_viewpoint(ba, k))
+		return;
+
+	if (ba->opts.window == 0 && ba->keyframes.size() >= ba->opts.max_keyframes) {
+		if (!ba->warned_full) {
+			SurviveContext *ctx = so->ctx;
+			SV_WARN("Keyframe limit of %zu reached; later scenes are ignored. Use --window for long captures",
+					ba->opts.max_keyframes);
+			ba->warned_full = true;
+		}
+		return;
+	}
+
+	k.meas.shrink_to_fit();
+	ba->keyframes.push_back(std::move(k));
+	ba->new_keyframes++;
+
+	if (ba->opts.window && ba->new_keyframes >= std::max<size_t>(1, ba->opts.window / 4))
+		refine_window(ba);
+}
+
+static void report_lighthouses(BundleAdjustment *ba) {
+	SurviveContext *ctx = ba->ctx;
+	for (int lh = 0; lh < NUM_GEN2_LIGHTHOUSES; lh++) {
+		if (!ba->lighthouse_seeded[lh])
+			continue;
+		SurvivePose world2lh = from_axis_angle(&ba->lighthouses[lh]);
+		SurvivePose lh2world = InvertPoseRtn(&world2lh);
+		SV_INFO("LH%d " SurvivePose_format " (moved %.4fm)", lh, SURVIVE_POSE_EXPAND(lh2world),
+				dist3d(lh2world.Pos, ctx->bsd[lh].Pose.Pos));
+		ctx->lighthouse_poseproc(ctx, lh, &lh2world);
+	}
+}
+
+static bool parse_option(Options &opts, int &i, int argc, char **argv) {
+	if (i + 1 >= argc)
+		return false;
+	const char *arg = argv[i], *value = argv[i + 1];
+	if (strcmp(arg, "--keyframe-distance") == 0)
+		opts.keyframe_distance = atof(value);
+	else if (strcmp(arg, "--keyframe-angle") == 0)
+		opts.keyframe_angle = atof(value) / 180. * LINMATHPI;
+	else if (strcmp(arg, "--max-speed") == 0)
+		opts.max_speed = atof(value);
+	else if (strcmp(arg, "--max-age") == 0)
+		opts.max_age = atof(value);
+	else if (strcmp(arg, "--max-keyframes") == 0)
+		opts.max_keyframes = atoi(value);
+	else if (strcmp(arg, "--window") == 0)
+		opts.window = atoi(value);
+	else if (strcmp(arg, "--huber") == 0)
+		opts.huber = atof(value);
+	else if (strcmp(arg, "--max-iterations") == 0)
+		opts.max_iterations = atoi(value);
+	else if (strcmp(arg, "--tracks") == 0)
+		opts.tracks = value;
+	else
+		return false;
+	i++;
+	return true;
 }
 
 int main(int argc, char **argv) {
-	auto ctx = survive_init(argc, argv);
+	BundleAdjustment ba;
+	std::vector<char *> survive_args = {argv[0]};
+	for (int i = 1; i < argc; i++) {
+		if (!parse_option(ba.opts, i, argc, argv))
+			survive_args.push_back(argv[i]);
+	}
+
+	SurviveContext *ctx = survive_init((int)survive_args.size(), &survive_args[0]);
 	if (ctx == nullptr)
 		return -1;
 
-	survive_install_light_fn(ctx, light_process);
-	survive_install_pose_fn(ctx, raw_pose_process);
+	ba.ctx = ctx;
+	ctx->user_ptr = &ba;
+	ba.prior_imupose = survive_install_imupose_fn(ctx, capture_imupose);
+	if (ba.opts.tracks) {
+		ba.tracks = survive_posetrack_writer_open(ba.opts.tracks);
+		if (ba.tracks == nullptr)
+			SV_WARN("Could not open %s for writing", ba.opts.tracks);
+	}
 
-	while (survive_poll(ctx) == 0) {
+	double start = OGGetAbsoluteTime();
+	if (survive_startup(ctx) == 0) {
+		while (survive_poll(ctx) == 0) {
+		}
 	}
+	// Nothing more should be captured while the results are reported
+	survive_install_imupose_fn(ctx, ba.prior_imupose);
 
-	full_bundle_adjustment(ctx->objs[0]);
+	double captured = OGGetAbsoluteTime();
+	FLT rms = solve(&ba, 0);
+	SV_INFO("%zu keyframes from %zu scenes; %zu window solves; final rms %f. Capture %.2fs, solve %.2fs",
+			ba.keyframes.size(), ba.scenes, ba.window_solves, rms, captured - start, OGGetAbsoluteTime() - captured);
 
-	survive_close(ctx);
+	report_lighthouses(&ba);
+	for (const Keyframe &k : ba.keyframes)
+		write_keyframe(&ba, k);
+	if (ba.tracks)
+		survive_posetrack_writer_close(ba.tracks);
 
+	survive_close(ctx);
 	return 0;
 }
@@ -0,0 +1,95 @@
+// Microbenchmark for the OOTX decoder. Streams repeated OOTX packets into one decoder per lighthouse, interleaving the
+// bits the way sync pulses from many base stations arrive, with a share of missed bits; reports decoded bits per second.
+//
+// ootx_bench [lighthouses] [packets per lighthouse] [missed bit %]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <os_generic.h>
+
+#include "ootx_decoder.h"
+
+#ifdef NOZLIB
+#include "crc32.h"
+#else
+#include <zlib.h>
+#endif
+
+#define MAX_LIGHTHOUSES 16
+#define PAYLOAD_LENGTH 43
+
+static size_t encode_packet(int8_t *bits, const uint8_t *payload, uint16_t length) {
+	uint8_t buffer[OOTX_MAX_BUFF_SIZE] = {0};
+	uint16_t padded_length = length + (length & 1);
+	uint32_t crc = crc32(0L, payload, length);
+	memcpy(buffer, &length, 2);
+	memcpy(buffer + 2, payload, length);
+	memcpy(buffer + 2 + padded_length, &crc, 4);
+
+	size_t cnt = 0;
+	for (int i = 0; i < 17; i++)
+		bits[cnt++] = 0;
+	bits[cnt++] = 1;
+
+	for (int word = 0; word < (padded_length + 6) / 2; word++) {
+		for (int bit = 0; bit < 16; bit++)
+			bits[cnt++] = (buffer[word * 2 + bit / 8] >> (7 - bit % 8)) & 1;
+		bits[cnt++] = 1;
+	}
+	return cnt;
+}
+
+static void count_packet(ootx_decoder_context *ctx, ootx_packet *packet) { (*(int *)ctx->user)++; }
+
+int main(int argc, char **argv) {
+	int lh_cnt = argc > 1 ? atoi(argv[1]) : MAX_LIGHTHOUSES;
+	int packet_cnt = argc > 2 ? atoi(argv[2]) : 20000;
+	int missed_pct = argc > 3 ? atoi(argv[3]) : 5;
+	if (lh_cnt < 1 || lh_cnt > MAX_LIGHTHOUSES || packet_cnt < 1) {
+		fprintf(stderr, "Usage: %s [lighthouses] [packets per lighthouse] [missed bit %%]\n", argv[0]);
+		return -1;
+	}
+
+	int8_t stream[MAX_LIGHTHOUSES][1024];
+	size_t stream_len = 0;
+	for (int lh = 0; lh < lh_cnt; lh++) {
+		uint8_t payload[PAYLOAD_LENGTH];
+		for (int i = 0; i < PAYLOAD_LENGTH; i++)
+			payload[i] = rand();
+		stream_len = encode_packet(stream[lh], payload, PAYLOAD_LENGTH);
+	}
+
+	int packets_found = 0;
+	ootx_decoder_context ctx[MAX_LIGHTHOUSES] = {0};
+	for (int lh = 0; lh < lh_cnt; lh++) {
+		ootx_init_decoder_context(&ctx[lh], 0);
+		ctx[lh].user = &packets_found;
+		ctx[lh].ootx_packet_clbk = count_packet;
+	}
+
+	// Prime every decoder with a clean copy so missed bits have something to fall back on
+	for (size_t i = 0; i < stream_len; i++)
+		for (int lh = 0; lh < lh_cnt; lh++)
+			ootx_pump_bit(&ctx[lh], stream[lh][i]);
+
+	for (int lh = 0; lh < lh_cnt; lh++)
+		for (size_t i = 18; i < stream_len; i++)
+			if ((i - 34) % 17 != 0 && rand() % 100 < missed_pct)
+				stream[lh][i] = -1;
+
+	packets_found = 0;
+	double start = OGGetAbsoluteTime();
+	for (int p = 0; p < packet_cnt; p++)
+		for (size_t i = 0; i < stream_len; i++)
+			for (int lh = 0; lh < lh_cnt; lh++)
+				ootx_pump_bit(&ctx[lh], stream[lh][i]);
+	double elapsed = OGGetAbsoluteTime() - start;
+
+	double bits = (double)packet_cnt * stream_len * lh_cnt;
+	printf("%d lighthouses, %d packets each: %.0f bits in %.3fs; %.2f Mbit/s, %.2f ns/bit, %d/%d packets decoded\n",
+		   lh_cnt, packet_cnt, bits, elapsed, bits / elapsed / 1e6, elapsed / bits * 1e9, packets_found,
+		   packet_cnt * lh_cnt);
+	return 0;
+}
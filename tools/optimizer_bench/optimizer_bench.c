@@ -0,0 +1,247 @@
+// Re-solves a corpus of captured optimizer problems outside of the tracking pipeline and reports solve time and
+// convergence statistics, so solver changes can be compared against a fixed set of real problems.
+//
+// Corpora are written by running libsurvive with --optimizer-capture <file>; see survive_optimizer.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpfit/mpfit.h>
+#include <os_generic.h>
+#include <survive.h>
+#include <survive_optimizer.h>
+
+// mpfit status codes run from MP_ERR_DOF up to MP_OK_NORM
+#define STATUS_CNT (MP_OK_NORM - MP_ERR_DOF + 1)
+
+typedef struct overrides {
+	FLT ftol, xtol, gtol, normtol, epsfcn, stepfactor;
+	int maxiter, maxfev;
+	bool numeric_jacobian;
+} overrides;
+
+typedef struct bench_stats {
+	double *solve_times;
+	size_t solve_cnt, solve_capacity;
+
+	size_t problem_cnt;
+	uint64_t total_iterations, total_fev, total_meas;
+	double total_orignorm, total_bestnorm;
+	size_t status_cnt[STATUS_CNT];
+} bench_stats;
+
+static void quiet_log(SurviveContext *ctx, SurviveLogLevel ll, const char *msg) {
+	if (ll != SURVIVE_LOG_LEVEL_INFO)
+		fprintf(stderr, "%s\n", msg);
+}
+
+// The solver only logs through the context of the objects; re-solving shouldn't print every filtered measurement
+static SurviveContext bench_ctx = {.logproc = quiet_log};
+
+static void apply_overrides(survive_optimizer *opt, mp_config *cfg, const overrides *o) {
+	if (o->ftol >= 0)
+		cfg->ftol = o->ftol;
+	if (o->xtol >= 0)
+		cfg->xtol = o->xtol;
+	if (o->gtol >= 0)
+		cfg->gtol = o->gtol;
+	if (o->normtol >= 0)
+		cfg->normtol = o->normtol;
+	if (o->epsfcn >= 0)
+		cfg->epsfcn = o->epsfcn;
+	if (o->stepfactor >= 0)
+		cfg->stepfactor = o->stepfactor;
+	if (o->maxiter >= 0)
+		cfg->maxiter = o->maxiter;
+	if (o->maxfev >= 0)
+		cfg->maxfev = o->maxfev;
+
+	if (o->numeric_jacobian) {
+		int param_cnt = survive_optimizer_get_parameters_count(opt);
+		for (int i = 0; i < param_cnt; i++) {
+			if (opt->parameters_info[i].side == 3)
+				opt->parameters_info[i].side = 0;
+		}
+	}
+}
+
+static void record_solve(bench_stats *stats, double t) {
+	if (stats->solve_cnt == stats->solve_capacity) {
+		stats->solve_capacity = stats->solve_capacity ? stats->solve_capacity * 2 : 1024;
+		stats->solve_times = SV_REALLOC(stats->solve_times, sizeof(double) * stats->solve_capacity);
+	}
+	stats->solve_times[stats->solve_cnt++] = t;
+}
+
+static int run_problem(bench_stats *stats, survive_optimizer *opt, mp_config *cfg, int repeat) {
+	int param_cnt = survive_optimizer_get_parameters_count(opt);
+	FLT *initial = SV_MALLOC(sizeof(FLT) * param_cnt);
+	memcpy(initial, opt->parameters, sizeof(FLT) * param_cnt);
+
+	opt->cfg = cfg;
+	for (int i = 0; i < opt->poseLength; i++) {
+		opt->sos[i]->ctx = &bench_ctx;
+	}
+
+	int status = 0;
+	for (int r = 0; r < repeat; r++) {
+		// Each repeat starts from the captured seed; measurement rejection from a previous run is undone as well
+		memcpy(opt->parameters, initial, sizeof(FLT) * param_cnt);
+		for (size_t m = 0; m < opt->measurementsCnt; m++) {
+			opt->measurements[m].invalid = false;
+		}
+
+		mp_result result = {0};
+		double start = OGGetAbsoluteTime();
+		status = survive_optimizer_run(opt, &result);
+		record_solve(stats, OGGetAbsoluteTime() - start);
+
+		if (r == 0) {
+			stats->total_iterations += result.niter;
+			stats->total_fev += result.nfev;
+			stats->total_orignorm += result.orignorm;
+			stats->total_bestnorm += result.bestnorm;
+			stats->total_meas += opt->measurementsCnt;
+			if (status >= MP_ERR_DOF && status <= MP_OK_NORM)
+				stats->status_cnt[status - MP_ERR_DOF]++;
+		}
+	}
+
+	free(initial);
+	return status;
+}
+
+static int compare_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+	return (da > db) - (da < db);
+}
+
+static double percentile(const bench_stats *stats, double p) {
+	size_t idx = (size_t)(p * (stats->solve_cnt - 1) + .5);
+	return stats->solve_times[idx];
+}
+
+static void print_report(bench_stats *stats) {
+	if (stats->solve_cnt == 0) {
+		printf("No problems solved\n");
+		return;
+	}
+
+	qsort(stats->solve_times, stats->solve_cnt, sizeof(double), compare_double);
+	double total = 0;
+	for (size_t i = 0; i < stats->solve_cnt; i++)
+		total += stats->solve_times[i];
+
+	double n = (double)stats->problem_cnt;
+	printf("Problems          %lu (%lu solves)\n", (unsigned long)stats->problem_cnt, (unsigned long)stats->solve_cnt);
+	printf("Measurements/pr   %10.2f\n", stats->total_meas / n);
+	printf("Solve time (us)   mean %9.2f p50 %9.2f p90 %9.2f p99 %9.2f max %9.2f\n", total / stats->solve_cnt * 1e6,
+		   percentile(stats, .5) * 1e6, percentile(stats, .9) * 1e6, percentile(stats, .99) * 1e6,
+		   stats->solve_times[stats->solve_cnt - 1] * 1e6);
+	printf("Iterations/pr     %10.2f\n", stats->total_iterations / n);
+	printf("Evaluations/pr    %10.2f\n", stats->total_fev / n);
+	printf("Original norm     %10.6f\n", stats->total_orignorm / n);
+	printf("Best norm         %10.6f\n", stats->total_bestnorm / n);
+	printf("Status:\n");
+	for (int i = 0; i < STATUS_CNT; i++) {
+		if (stats->status_cnt[i]) {
+			printf("\t%-24s %lu\n", survive_optimizer_error(i + MP_ERR_DOF), (unsigned long)stats->status_cnt[i]);
+		}
+	}
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+			"Usage: %s [options] <corpus>...\n"
+			"\t--repeat <n>          Solve each problem n times for timing\n"
+			"\t--limit <n>           Stop after n problems\n"
+			"\t--maxiter <n>         Override the captured solver settings\n"
+			"\t--maxfev <n>\n"
+			"\t--ftol <x>\n"
+			"\t--xtol <x>\n"
+			"\t--gtol <x>\n"
+			"\t--normtol <x>\n"
+			"\t--epsfcn <x>\n"
+			"\t--stepfactor <x>\n"
+			"\t--numeric-jacobian    Use finite differences in place of the analytic jacobians\n",
+			prog);
+}
+
+int main(int argc, char **argv) {
+	overrides o = {-1, -1, -1, -1, -1, -1, -1, -1, false};
+	int repeat = 1;
+	long limit = -1;
+
+	int i = 1;
+	for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : 0;
+		bool consumed = true;
+		if (strcmp(arg, "--numeric-jacobian") == 0) {
+			o.numeric_jacobian = true;
+			consumed = false;
+		} else if (value == 0) {
+			usage(argv[0]);
+			return -1;
+		} else if (strcmp(arg, "--repeat") == 0) {
+			repeat = atoi(value);
+		} else if (strcmp(arg, "--limit") == 0) {
+			limit = atol(value);
+		} else if (strcmp(arg, "--maxiter") == 0) {
+			o.maxiter = atoi(value);
+		} else if (strcmp(arg, "--maxfev") == 0) {
+			o.maxfev = atoi(value);
+		} else if (strcmp(arg, "--ftol") == 0) {
+			o.ftol = atof(value);
+		} else if (strcmp(arg, "--xtol") == 0) {
+			o.xtol = atof(value);
+		} else if (strcmp(arg, "--gtol") == 0) {
+			o.gtol = atof(value);
+		} else if (strcmp(arg, "--normtol") == 0) {
+			o.normtol = atof(value);
+		} else if (strcmp(arg, "--epsfcn") == 0) {
+			o.epsfcn = atof(value);
+		} else if (strcmp(arg, "--stepfactor") == 0) {
+			o.stepfactor = atof(value);
+		} else {
+			usage(argv[0]);
+			return -1;
+		}
+		if (consumed)
+			i++;
+	}
+
+	if (i >= argc || repeat < 1) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	bench_stats stats = {0};
+	for (; i < argc; i++) {
+		FILE *f = fopen(argv[i], "rb");
+		if (f == 0) {
+			fprintf(stderr, "Could not open '%s'\n", argv[i]);
+			return -1;
+		}
+		if (survive_optimizer_read_problem_header(f) != 0) {
+			fprintf(stderr, "'%s' is not an optimizer capture for this build\n", argv[i]);
+			fclose(f);
+			return -1;
+		}
+
+		mp_config cfg;
+		survive_optimizer *opt;
+		while ((limit < 0 || stats.problem_cnt < limit) && (opt = survive_optimizer_read_problem(f, &cfg))) {
+			apply_overrides(opt, &cfg, &o);
+			run_problem(&stats, opt, &cfg, repeat);
+			stats.problem_cnt++;
+			survive_optimizer_free_problem(opt);
+		}
+		fclose(f);
+	}
+
+	print_report(&stats);
+	free(stats.solve_times);
+	return 0;
+}